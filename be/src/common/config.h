@@ -102,6 +102,15 @@ namespace config {
     CONF_Int32(download_low_speed_limit_kbps, "50");
     // download low speed time(seconds)
     CONF_Int32(download_low_speed_time, "300");
+    // the number of files a clone task downloads at the same time
+    CONF_Int32(clone_download_num_threads, "4");
+    // the threads downloading the files, shared by all clone tasks
+    CONF_Int32(clone_download_thread_pool_size, "12");
+    CONF_Int32(clone_download_thread_pool_queue_size, "1024");
+    // the max download speed of all clone tasks together (bytes/s), 0 means no limit
+    CONF_Int64(clone_download_bytes_per_sec, "0");
+    // if true, clone checks the md5 of the downloaded files against the source
+    CONF_Bool(clone_download_verify_md5, "true");
     // curl verbose mode
     CONF_Int64(curl_verbose_mode, "1");
     // seconds to sleep for each time check table status
@@ -159,8 +168,14 @@ namespace config {
     CONF_String(local_library_dir, "${UDF_RUNTIME_DIR}");
     // number of olap scanner thread pool size
     CONF_Int32(doris_scanner_thread_pool_thread_num, "48");
-    // number of olap scanner thread pool size
+    // max number of olap scanner tasks waiting for a scanner thread
     CONF_Int32(doris_scanner_thread_pool_queue_size, "102400");
+    // Resource groups the queries can be tagged with by the session variable
+    // resource_group, a ';' separated list of
+    //   name:scanner_share:scan_bytes_per_second:mem_limit
+    // e.g. "dashboard:8:0:20%;report:1:104857600:40G". A scan_bytes_per_second of 0
+    // means no limit.
+    CONF_String(resource_groups, "");
     // number of etl thread pool size
     CONF_Int32(etl_thread_pool_size, "8");
     // number of etl thread pool size
@@ -171,8 +186,12 @@ namespace config {
     CONF_Int32(thrift_connect_timeout_seconds, "3");
     // max row count number for single scan range
     CONF_Int32(doris_scan_range_row_count, "524288");
-    // size of scanner queue between scanner thread and compute thread
+    // max size of scanner queue between scanner thread and compute thread, the queue
+    // starts at 1/16 of it and grows while the compute thread waits for the scanners
     CONF_Int32(doris_scanner_queue_size, "1024");
+    // target bytes of a row batch of olap scanner, which holds fewer rows than
+    // batch_size if the rows are wide. 0 means a batch always holds batch_size rows
+    CONF_Int32(doris_scanner_batch_bytes, "262144");
     // single read execute fragment row size
     CONF_Int32(doris_scanner_row_num, "16384");
     // number of max scan keys
@@ -181,10 +200,25 @@ namespace config {
     CONF_Int32(doris_max_pushdown_conjuncts_return_rate, "90");
     // (Advanced) Maximum size of per-query receive-side buffer
     CONF_Int32(exchg_node_buffer_size_bytes, "10485760");
+    // hand row batches to receivers in the same process directly, without
+    // serializing them and sending them via brpc
+    CONF_Bool(enable_local_exchange, "true");
+    // max number of in-flight transmit_data rpcs of one exchange channel
+    CONF_Int32(exchange_rpc_window_size, "4");
+    // a row batch whose tuple data compresses to more than this percentage of its
+    // size counts as incompressible, the sender then skips compressing the next batches
+    CONF_Int32(exchange_incompressible_ratio_percent, "90");
     // insert sort threadhold for sorter
     CONF_Int32(insertion_threadhold, "16");
     // the block_size every block allocate for sorter
     CONF_Int32(sorter_block_size, "8388608");
+    // the rows of one run sorted by a worker thread, if a sort node sorts
+    // with more than one thread (query option parallel_sort_degree)
+    CONF_Int64(parallel_sort_run_rows, "1048576");
+    // the threads sorting and merging the runs of the sort nodes with more than one
+    // thread, shared by all queries
+    CONF_Int32(sort_thread_pool_size, "16");
+    CONF_Int32(sort_thread_pool_queue_size, "1024");
     // push_write_mbytes_per_sec
     CONF_Int32(push_write_mbytes_per_sec, "10");
 
@@ -196,11 +230,27 @@ namespace config {
     CONF_String(module_output, "");
     // memory_limitation_per_thread_for_schema_change unit GB
     CONF_Int32(memory_limitation_per_thread_for_schema_change, "2");
+    // the number of historical rowsets converted at the same time by one schema change.
+    // every converting thread may use memory_limitation_per_thread_for_schema_change.
+    CONF_Int32(schema_change_convert_num_threads, "1");
+    // the threads converting the historical rowsets, shared by all schema changes
+    CONF_Int32(schema_change_thread_pool_size, "8");
+    CONF_Int32(schema_change_thread_pool_queue_size, "1024");
 
     CONF_Int64(max_unpacked_row_block_size, "104857600");
 
     CONF_Int32(file_descriptor_cache_clean_interval, "3600");
     CONF_Int32(disk_stat_monitor_interval, "5");
+    // the compactions, schema changes, clones and storage migrations on a data dir
+    // read and write at most this many bytes per second together, <= 0 means no
+    // limit. The tasks of higher priority go first when they are over the limit.
+    CONF_Int64(storage_background_io_bytes_per_sec, "0");
+    // lower the background io rate of a data dir while the queries read from it
+    // storage_io_auto_tune_cost_ratio times slower than they used to, and raise it
+    // back to storage_background_io_bytes_per_sec when they don't. The rate is
+    // tuned every disk_stat_monitor_interval seconds.
+    CONF_Bool(storage_io_auto_tune, "false");
+    CONF_Double(storage_io_auto_tune_cost_ratio, "2");
     CONF_Int32(unused_rowset_monitor_interval, "30");
     CONF_String(storage_root_path, "${DORIS_HOME}/storage");
     CONF_Int32(min_percentage_of_error_disk, "50");
@@ -249,11 +299,29 @@ namespace config {
     CONF_Int32(cumulative_compaction_num_threads_per_disk, "1");
     CONF_Int64(cumulative_compaction_budgeted_bytes, "104857600");
     CONF_Int32(cumulative_compaction_write_mbytes_per_sec, "100");
+    // cumulative compaction policy of the new tablets which don't specify one
+    // Valid configs: NUM_BASED, SIZE_TIERED
+    CONF_String(default_cumulative_compaction_policy, "NUM_BASED");
+    // size-tiered policy: the rowsets below min bytes are in level 0, each next level
+    // holds rowsets fanout times larger, and a level is merged once it has fanout
+    // rowsets. The rowsets over cumulative_compaction_budgeted_bytes go to base
+    // compaction.
+    CONF_Int64(size_tiered_compaction_min_bytes, "1048576");
+    CONF_Int64(size_tiered_compaction_fanout, "4");
 
     // if compaction of a tablet failed, this tablet should not be chosen to
     // compaction until this interval passes.
     CONF_Int64(min_compaction_failure_interval_sec, "600") // 10 min
 
+    // the compactions with at least compaction_parallel_merge_min_bytes of input and
+    // BETA output split the key space into this many ranges and merge them in parallel,
+    // 1 merges on the compaction thread only.
+    CONF_Int32(compaction_parallel_merge_num_ranges, "1");
+    CONF_Int64(compaction_parallel_merge_min_bytes, "10737418240");
+    // the threads merging the key ranges of the compactions, shared by all compactions
+    CONF_Int32(compaction_merge_thread_pool_size, "8");
+    CONF_Int32(compaction_merge_thread_pool_queue_size, "1024");
+
     // Port to start debug webserver on
     CONF_Int32(webserver_port, "8040");
     // Number of webserver workers
@@ -282,6 +350,10 @@ namespace config {
     // Fragment thread pool
     CONF_Int32(fragment_pool_thread_num, "64");
     CONF_Int32(fragment_pool_queue_size, "1024");
+    // Worker threads of the pipeline execution engine, 0 means the number of cores
+    CONF_Int32(pipeline_executor_threads, "0");
+    // A pipeline driver gives up its worker after running this long
+    CONF_Int32(pipeline_time_slice_ms, "100");
 
     //for cast
     CONF_Bool(cast, "true");
@@ -331,6 +403,10 @@ namespace config {
     CONF_Bool(enable_partitioned_hash_join, "false")
     CONF_Bool(enable_partitioned_aggregation, "false")
     CONF_Bool(enable_new_partitioned_aggregation, "true")
+    // Send the count/sum distinct states of dense integer values as bitmaps to
+    // the merging backends. Backends of older versions can't read them, only
+    // enable it once all backends are upgraded.
+    CONF_Bool(multi_distinct_bitmap_state, "false")
     
     // for kudu
     // "The maximum size of the row batch queue, for Kudu scanners."
@@ -484,6 +560,13 @@ namespace config {
     CONF_Int32(tablet_meta_checkpoint_min_new_rowsets_num, "10");
     CONF_Int32(tablet_meta_checkpoint_min_interval_secs, "600");
 
+    // the number of threads parsing the tablet metas of a data dir at startup
+    CONF_Int32(load_tablet_num_threads_per_data_dir, "4");
+
+    // the number of shards the tablets are split into by tablet id, each shard has
+    // a lock of its own. must be a power of 2
+    CONF_Int32(tablet_map_shard_size, "16");
+
     // config for default rowset type
     // Valid configs: ALPHA, BETA
     CONF_String(default_rowset_type, "ALPHA");
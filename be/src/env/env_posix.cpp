@@ -24,6 +24,7 @@
 #include "gutil/gscoped_ptr.h"
 #include "gutil/strings/substitute.h"
 #include "util/errno.h"
+#include "util/io_scheduler.h"
 #include "util/slice.h"
 
 namespace doris {
@@ -91,6 +92,7 @@ static Status do_readv_at(int fd, const std::string& filename, uint64_t offset,
         bytes_req += result.size;
         iov[i] = { result.data, result.size };
     }
+    IOScheduler::consume_current(bytes_req);
 
     uint64_t cur_offset = offset;
     size_t completed_iov = 0;
@@ -148,6 +150,7 @@ static Status do_writev_at(int fd, const string& filename, uint64_t offset,
         bytes_req += result.size;
         iov[i] = { result.data, result.size };
     }
+    IOScheduler::consume_current(bytes_req);
 
     uint64_t cur_offset = offset;
     size_t completed_iov = 0;
@@ -41,7 +41,7 @@ class RowDescriptor;
 // Superclass of all data sinks.
 class DataSink {
 public:
-    DataSink() : _closed(false) {}
+    DataSink() : _closed(false), _is_pipeline_sink(false) {}
     virtual ~DataSink() {}
 
     virtual Status init(const TDataSink& thrift_sink);
@@ -68,6 +68,23 @@ public:
         return Status::OK();
     }
 
+    // Pipeline execution (see runtime/pipeline_driver.h). Once set_pipeline_sink() was
+    // called, send() doesn't wait for other fragment instances to consume the data if
+    // is_ready() returned true, and close() doesn't wait for the data of earlier send()
+    // calls if is_idle() returned true.
+    virtual bool can_be_pipeline_sink() const {
+        return false;
+    }
+    void set_pipeline_sink() {
+        _is_pipeline_sink = true;
+    }
+    virtual bool is_ready() {
+        return true;
+    }
+    virtual bool is_idle() {
+        return is_ready();
+    }
+
     // Creates a new data sink from thrift_sink. A pointer to the
     // new sink is written to *sink, and is owned by the caller.
     static Status create_data_sink(
@@ -86,6 +103,7 @@ protected:
     // Set to true after close() has been called. subclasses should check and set this in
     // close().
     bool _closed;
+    bool _is_pipeline_sink;
     std::unique_ptr<MemTracker> _expr_mem_tracker;
 
     // Maybe this will be transfered to BufferControlBlock.
@@ -88,12 +88,17 @@ Status ExchangeNode::open(RuntimeState* state) {
         // create_merger() will populate its merging heap with batches from the _stream_recvr,
         // so it is not necessary to call fill_input_row_batch().
         RETURN_IF_ERROR(_stream_recvr->create_merger(less_than));
-    } else {
+    } else if (!_is_pipeline_source) {
         RETURN_IF_ERROR(fill_input_row_batch(state));
     }
     return Status::OK();
 }
 
+bool ExchangeNode::has_output() {
+    DCHECK(!_is_merging);
+    return reached_limit() || _stream_recvr->has_batch_or_eos();
+}
+
 Status ExchangeNode::collect_query_statistics(QueryStatistics* statistics) {
     RETURN_IF_ERROR(ExecNode::collect_query_statistics(statistics));
     statistics->merge(_sub_plan_query_statistics_recvr.get());
@@ -153,7 +158,7 @@ Status ExchangeNode::get_next(RuntimeState* state, RowBatch* output_batch, bool*
             RETURN_IF_CANCELLED(state);
             // copy rows until we hit the limit/capacity or until we exhaust _input_batch
             while (!reached_limit() && !output_batch->at_capacity()
-                    && _input_batch != NULL && _next_row_idx < _input_batch->capacity()) {
+                    && _input_batch != NULL && _next_row_idx < _input_batch->num_rows()) {
                 TupleRow* src = _input_batch->get_row(_next_row_idx);
 
                 if (ExecNode::eval_conjuncts(ctxs, num_ctxs, src)) {
@@ -195,6 +200,11 @@ Status ExchangeNode::get_next(RuntimeState* state, RowBatch* output_batch, bool*
             _input_batch->transfer_resource_ownership(output_batch);
         }
 
+        if (_is_pipeline_source && !_stream_recvr->has_batch_or_eos()) {
+            // return what we have instead of waiting, the driver polls has_output()
+            *eos = false;
+            return Status::OK();
+        }
         RETURN_IF_ERROR(fill_input_row_batch(state));
         *eos = (_input_batch == NULL);
         if (*eos) {
@@ -52,6 +52,14 @@ public:
     Status collect_query_statistics(QueryStatistics* statistics) override;
     virtual Status close(RuntimeState* state);
 
+    // A merging exchange waits for the first batch of every sender, so only a
+    // non-merging exchange can be a pipeline source. As a source, open() doesn't wait
+    // for the first batch and get_next() returns when no more batches are queued.
+    bool can_be_pipeline_source() const override {
+        return !_is_merging;
+    }
+    bool has_output() override;
+
     // the number of senders needs to be set after the c'tor, because it's not
     // recorded in TPlanNode, and before calling prepare()
     void set_num_senders(int num_senders) {
@@ -135,6 +135,7 @@ ExecNode::ExecNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl
         _rows_returned_counter(NULL),
         _rows_returned_rate(NULL),
         _memory_used_counter(NULL),
+        _is_pipeline_source(false),
         _is_closed(false){
     init_runtime_profile(print_plan_node_type(tnode.node_type));
 }
@@ -267,6 +268,18 @@ Status ExecNode::close(RuntimeState* state) {
     return result;
 }
 
+Status ExecNode::open_sink(RuntimeState* state) {
+    return Status::NotSupported("open_sink() is not supported by " + print_plan_node_type(_type));
+}
+
+Status ExecNode::sink(RuntimeState* state, RowBatch* batch) {
+    return Status::NotSupported("sink() is not supported by " + print_plan_node_type(_type));
+}
+
+Status ExecNode::close_sink(RuntimeState* state) {
+    return Status::NotSupported("close_sink() is not supported by " + print_plan_node_type(_type));
+}
+
 void ExecNode::add_runtime_exec_option(const std::string& str) {
     lock_guard<mutex> l(_exec_options_lock);
 
@@ -134,6 +134,32 @@ public:
     // each implementation should start out by calling the default implementation.
     virtual Status close(RuntimeState* state);
 
+    // Pipeline execution (see runtime/pipeline_driver.h).
+    //
+    // A pipeline breaker consumes its whole input before producing any output. Instead
+    // of pulling its child in open(), the pipeline driver opens it with open_sink(),
+    // which opens the children, pushes the child's batches into sink() and calls
+    // close_sink() after the last one. get_next() may be called afterwards.
+    virtual bool is_pipeline_breaker() const {
+        return false;
+    }
+    virtual Status open_sink(RuntimeState* state);
+    virtual Status sink(RuntimeState* state, RowBatch* batch);
+    virtual Status close_sink(RuntimeState* state);
+
+    // A pipeline source doesn't wait for other threads in open() once
+    // set_pipeline_source() was called, and its get_next() returns without waiting
+    // if has_output() returned true. get_next() may return an empty batch without eos.
+    virtual bool can_be_pipeline_source() const {
+        return false;
+    }
+    void set_pipeline_source() {
+        _is_pipeline_source = true;
+    }
+    virtual bool has_output() {
+        return true;
+    }
+
     llvm::Function* codegen_eval_conjuncts(
         RuntimeState* state, const std::vector<ExprContext*>& conjunct_ctxs, const char* name);
 
@@ -209,6 +235,9 @@ public:
     const std::vector<TupleId>& get_tuple_ids() const {
         return _tuple_ids;
     }
+    const std::vector<ExecNode*>& children() const {
+        return _children;
+    }
 
     RuntimeProfile* runtime_profile() {
         return _runtime_profile.get();
@@ -397,6 +426,9 @@ protected:
     /// ExecNode::QueryMaintenance().
     virtual Status QueryMaintenance(RuntimeState* state, const std::string& msg) WARN_UNUSED_RESULT;
 
+    // True if this node is the source of a pipeline
+    bool _is_pipeline_source;
+
 private:
     bool _is_closed;
 };
@@ -253,6 +253,43 @@ Status NewPartitionedAggregationNode::prepare(RuntimeState* state) {
 
 Status NewPartitionedAggregationNode::open(RuntimeState* state) {
   SCOPED_TIMER(_runtime_profile->total_time_counter());
+  RETURN_IF_ERROR(OpenSinkInternal(state));
+
+  // Streaming preaggregations do all processing in GetNext().
+  if (is_streaming_preagg_) return Status::OK();
+
+  RowBatch batch(child(0)->row_desc(), state->batch_size(), mem_tracker());
+  // Read all the rows from the child and process them.
+  bool eos = false;
+  do {
+    RETURN_IF_CANCELLED(state);
+    RETURN_IF_ERROR(state->check_query_state(
+            "New partitioned aggregation, while getting next from child 0."));
+    RETURN_IF_ERROR(_children[0]->get_next(state, &batch, &eos));
+    RETURN_IF_ERROR(AddInputBatch(&batch));
+    batch.reset();
+  } while (!eos);
+
+  return InputDone(state);
+}
+
+Status NewPartitionedAggregationNode::open_sink(RuntimeState* state) {
+  SCOPED_TIMER(_runtime_profile->total_time_counter());
+  return OpenSinkInternal(state);
+}
+
+Status NewPartitionedAggregationNode::sink(RuntimeState* state, RowBatch* batch) {
+  DCHECK(!is_streaming_preagg_);
+  SCOPED_TIMER(_runtime_profile->total_time_counter());
+  return AddInputBatch(batch);
+}
+
+Status NewPartitionedAggregationNode::close_sink(RuntimeState* state) {
+  SCOPED_TIMER(_runtime_profile->total_time_counter());
+  return InputDone(state);
+}
+
+Status NewPartitionedAggregationNode::OpenSinkInternal(RuntimeState* state) {
   // Open the child before consuming resources in this node.
   RETURN_IF_ERROR(child(0)->open(state));
   RETURN_IF_ERROR(ExecNode::open(state));
@@ -296,43 +333,36 @@ Status NewPartitionedAggregationNode::open(RuntimeState* state) {
     }
     RETURN_IF_ERROR(CreateHashPartitions(0));
   }
+  return Status::OK();
+}
 
-  // Streaming preaggregations do all processing in GetNext().
-  if (is_streaming_preagg_) return Status::OK();
-
-  RowBatch batch(child(0)->row_desc(), state->batch_size(), mem_tracker());
-  // Read all the rows from the child and process them.
-  bool eos = false;
-  do {
-    RETURN_IF_CANCELLED(state);
-    RETURN_IF_ERROR(state->check_query_state(
-            "New partitioned aggregation, while getting next from child 0."));
-    RETURN_IF_ERROR(_children[0]->get_next(state, &batch, &eos));
-    if (UNLIKELY(VLOG_ROW_IS_ON)) {
-      for (int i = 0; i < batch.num_rows(); ++i) {
-        TupleRow* row = batch.get_row(i);
-        VLOG_ROW << "input row: " << row->to_string(_children[0]->row_desc());
-      }
+Status NewPartitionedAggregationNode::AddInputBatch(RowBatch* batch) {
+  if (UNLIKELY(VLOG_ROW_IS_ON)) {
+    for (int i = 0; i < batch->num_rows(); ++i) {
+      TupleRow* row = batch->get_row(i);
+      VLOG_ROW << "input row: " << row->to_string(_children[0]->row_desc());
     }
+  }
 
-    SCOPED_TIMER(build_timer_);
-    if (grouping_exprs_.empty()) {
-      if (process_batch_no_grouping_fn_ != NULL) {
-        RETURN_IF_ERROR(process_batch_no_grouping_fn_(this, &batch));
-      } else {
-        RETURN_IF_ERROR(ProcessBatchNoGrouping(&batch));
-      }
+  SCOPED_TIMER(build_timer_);
+  if (grouping_exprs_.empty()) {
+    if (process_batch_no_grouping_fn_ != NULL) {
+      RETURN_IF_ERROR(process_batch_no_grouping_fn_(this, batch));
     } else {
-      // There is grouping, so we will do partitioned aggregation.
-      if (process_batch_fn_ != NULL) {
-        RETURN_IF_ERROR(process_batch_fn_(this, &batch, ht_ctx_.get()));
-      } else {
-        RETURN_IF_ERROR(ProcessBatch<false>(&batch, ht_ctx_.get()));
-      }
+      RETURN_IF_ERROR(ProcessBatchNoGrouping(batch));
     }
-    batch.reset();
-  } while (!eos);
+  } else {
+    // There is grouping, so we will do partitioned aggregation.
+    if (process_batch_fn_ != NULL) {
+      RETURN_IF_ERROR(process_batch_fn_(this, batch, ht_ctx_.get()));
+    } else {
+      RETURN_IF_ERROR(ProcessBatch<false>(batch, ht_ctx_.get()));
+    }
+  }
+  return Status::OK();
+}
 
+Status NewPartitionedAggregationNode::InputDone(RuntimeState* state) {
   // The child can be closed at this point in most cases because we have consumed all of
   // the input from the child and transfered ownership of the resources we need. The
   // exception is if we are inside a subplan expecting to call Open()/GetNext() on the
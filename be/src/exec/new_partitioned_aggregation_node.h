@@ -139,6 +139,13 @@ class NewPartitionedAggregationNode : public ExecNode {
   virtual Status reset(RuntimeState* state);
   virtual Status close(RuntimeState* state);
 
+  /// A streaming preaggregation passes its input through in GetNext(), every other
+  /// aggregation is a pipeline breaker.
+  virtual bool is_pipeline_breaker() const { return !is_streaming_preagg_; }
+  virtual Status open_sink(RuntimeState* state);
+  virtual Status sink(RuntimeState* state, RowBatch* batch);
+  virtual Status close_sink(RuntimeState* state);
+
   static const char* LLVM_CLASS_NAME;
 
  protected:
@@ -525,6 +532,13 @@ class NewPartitionedAggregationNode : public ExecNode {
   Tuple* GetOutputTuple(const std::vector<NewAggFnEvaluator*>& agg_fn_evals,
       Tuple* tuple, MemPool* pool);
 
+  /// The three steps of Open() for a non-streaming aggregation, also driven one by one
+  /// by open_sink(), sink() and close_sink() in pipeline execution: open the child and
+  /// the evaluators, aggregate one input batch, and finish the input.
+  Status OpenSinkInternal(RuntimeState* state);
+  Status AddInputBatch(RowBatch* batch);
+  Status InputDone(RuntimeState* state);
+
   /// Do the aggregation for all tuple rows in the batch when there is no grouping.
   /// This function is replaced by codegen.
   Status ProcessBatchNoGrouping(RowBatch* batch);
@@ -34,11 +34,13 @@
 #include "runtime/runtime_state.h"
 #include "runtime/row_batch.h"
 #include "runtime/string_value.h"
+#include "runtime/topn_threshold.h"
 #include "runtime/tuple_row.h"
+#include "runtime/resource_group.h"
+#include "runtime/scanner_scheduler.h"
 #include "util/runtime_profile.h"
 #include "util/thread_pool.hpp"
 #include "util/debug_util.h"
-#include "util/priority_thread_pool.hpp"
 #include "agent/cgroups_mgr.h"
 #include "common/resource_tls.h"
 #include <boost/variant.hpp>
@@ -57,7 +59,8 @@ OlapScanNode::OlapScanNode(ObjectPool* pool, const TPlanNode& tnode, const Descr
         _tuple_idx(0),
         _eos(false),
         _scanner_pool(new ObjectPool()),
-        _max_materialized_row_batches(config::doris_scanner_queue_size),
+        _max_materialized_row_batches(std::max(1, config::doris_scanner_queue_size / 16)),
+        _min_materialized_row_batches(_max_materialized_row_batches.load()),
         _start(false),
         _scanner_done(false),
         _transfer_done(false),
@@ -133,12 +136,19 @@ void OlapScanNode::_init_counter(RuntimeState* state) {
         ADD_COUNTER(_runtime_profile, "RowsStatsFiltered", TUnit::UNIT);
     _del_filtered_counter =
         ADD_COUNTER(_runtime_profile, "RowsDelFiltered", TUnit::UNIT);
+    _topn_filtered_counter =
+        ADD_COUNTER(_runtime_profile, "RowsTopNFiltered", TUnit::UNIT);
 
     _io_timer = ADD_TIMER(_runtime_profile, "IOTimer");
     _decompressor_timer = ADD_TIMER(_runtime_profile, "DecompressorTimer");
     _index_load_timer = ADD_TIMER(_runtime_profile, "IndexLoadTime");
 
     _scan_timer = ADD_TIMER(_runtime_profile, "ScanTime");
+    _scanner_wait_timer = ADD_TIMER(_runtime_profile, "ScannerQueueWaitTime");
+    _scanner_batch_rows_counter = ADD_COUNTER(_runtime_profile, "ScannerBatchRows", TUnit::UNIT);
+    _queue_depth_counter = ADD_COUNTER(_runtime_profile, "RowBatchQueueDepth", TUnit::UNIT);
+    _peak_queue_depth_counter =
+        _runtime_profile->AddHighWaterMarkCounter("PeakRowBatchQueueDepth", TUnit::UNIT);
 
     _total_pages_num_counter = ADD_COUNTER(_runtime_profile, "TotalPagesNum", TUnit::UNIT);
     _cached_pages_num_counter = ADD_COUNTER(_runtime_profile, "CachedPagesNum", TUnit::UNIT);
@@ -173,6 +183,11 @@ Status OlapScanNode::prepare(RuntimeState* state) {
         _string_slots.push_back(slots[i]);
     }
 
+    _scanner_batch_rows = _compute_scanner_batch_rows(state->batch_size(), _tuple_desc->byte_size());
+    COUNTER_SET(_scanner_batch_rows_counter, (int64_t)_scanner_batch_rows);
+    COUNTER_SET(_queue_depth_counter, (int64_t)_max_materialized_row_batches.load());
+    _peak_queue_depth_counter->set((int64_t)_max_materialized_row_batches.load());
+
     if (state->codegen_level() > 0) {
         LlvmCodeGen* codegen = NULL;
         RETURN_IF_ERROR(state->get_codegen(&codegen));
@@ -207,9 +222,31 @@ Status OlapScanNode::open(RuntimeState* state) {
 
     _resource_info = ResourceTls::get_resource_tls();
 
+    // A pipeline driver must not block in get_next(), so start the scanners here and
+    // let has_output() report when the first batch is materialized.
+    if (_is_pipeline_source && !_eos) {
+        Status status = start_scan(state);
+        if (!status.ok()) {
+            LOG(ERROR) << "StartScan Failed cause " << status.get_error_msg();
+            return status;
+        }
+        _start = true;
+    }
+
     return Status::OK();
 }
 
+bool OlapScanNode::has_output() {
+    if (_eos) {
+        return true;
+    }
+    if (!_start) {
+        return false;
+    }
+    boost::unique_lock<boost::mutex> l(_row_batches_lock);
+    return !_materialized_row_batches.empty() || _transfer_done;
+}
+
 Status OlapScanNode::get_next(RuntimeState* state, RowBatch* row_batch, bool* eos) {
     RETURN_IF_ERROR(exec_debug_action(TExecNodePhase::GETNEXT));
     SCOPED_TIMER(_runtime_profile->total_time_counter());
@@ -247,6 +284,10 @@ Status OlapScanNode::get_next(RuntimeState* state, RowBatch* row_batch, bool* eo
     RowBatch* materialized_batch = NULL;
     {
         boost::unique_lock<boost::mutex> l(_row_batches_lock);
+        if (_materialized_row_batches.empty() && !_transfer_done) {
+            // the scanners are slower than us, let more of them run ahead
+            _resize_row_batch_queue(_max_materialized_row_batches * 2);
+        }
         while (_materialized_row_batches.empty() && !_transfer_done) {
             if (state->is_cancelled()) {
                 _transfer_done = true;
@@ -383,6 +424,44 @@ Status OlapScanNode::set_scan_ranges(const std::vector<TScanRangeParams>& scan_r
     return Status::OK();
 }
 
+bool OlapScanNode::push_down_sorted_key_limit(
+        const std::vector<SlotId>& slot_ids, int64_t limit) {
+    const std::vector<std::string>& key_column_names = _olap_scan_node.key_column_name;
+    if (slot_ids.empty() || slot_ids.size() > key_column_names.size()) {
+        return false;
+    }
+    for (int i = 0; i < slot_ids.size(); ++i) {
+        const SlotDescriptor* slot = nullptr;
+        for (auto s : _tuple_desc->slots()) {
+            if (s->id() == slot_ids[i]) {
+                slot = s;
+                break;
+            }
+        }
+        if (slot == nullptr || !slot->is_materialized()
+                || slot->col_name() != key_column_names[i]) {
+            return false;
+        }
+    }
+    _sorted_key_limit = limit;
+    return true;
+}
+
+TopNThreshold* OlapScanNode::create_topn_threshold(SlotId slot_id, bool is_asc) {
+    for (auto slot : _tuple_desc->slots()) {
+        if (slot->id() != slot_id) {
+            continue;
+        }
+        if (!slot->is_materialized()) {
+            return nullptr;
+        }
+        _topn_threshold = _pool->add(new TopNThreshold(slot->col_name(), slot->type(), is_asc));
+        _topn_threshold_slot = slot;
+        return _topn_threshold;
+    }
+    return nullptr;
+}
+
 Status OlapScanNode::start_scan(RuntimeState* state) {
     RETURN_IF_CANCELLED(state);
 
@@ -564,9 +643,12 @@ Status OlapScanNode::build_scan_key() {
     return Status::OK();
 }
 
+// Split the tablet into about 'num_sections' sections of key ranges, each
+// of at least config::doris_scanner_row_num and at most
+// config::doris_scan_range_row_count rows.
 static Status get_hints(
         const TPaloScanRange& scan_range,
-        int block_row_count,
+        int num_sections,
         bool is_begin_include,
         bool is_end_include,
         const std::vector<std::unique_ptr<OlapScanRange>>& scan_key_range,
@@ -584,6 +666,9 @@ static Status get_hints(
         LOG(WARNING) << ss.str();
         return Status::InternalError(ss.str());
     }
+    int64_t block_row_count = table->num_rows() / std::max(1, num_sections);
+    block_row_count = std::min<int64_t>(block_row_count, config::doris_scan_range_row_count);
+    block_row_count = std::max<int64_t>(block_row_count, config::doris_scanner_row_num);
 
     RuntimeProfile::Counter* show_hints_timer = profile->get_counter("ShowHintsTime");
     std::vector<std::vector<OlapTuple>> ranges;
@@ -660,21 +745,25 @@ Status OlapScanNode::start_scan_thread(RuntimeState* state) {
         cond_ranges.emplace_back(new OlapScanRange());
     }
 
+    // Give each tablet its part of the scanner threads, the tablets of a small
+    // query are split into more key ranges to keep all the threads busy
+    int num_scanner_threads = std::max(1, config::doris_scanner_thread_pool_thread_num);
+    int scanners_per_tablet = std::max(1, num_scanner_threads / (int)_scan_ranges.size());
+
     bool need_split = true;
-    // If we have ranges more than 64, there is no need to call
+    // If we have more ranges than scanners, there is no need to call
     // ShowHint to split ranges
-    if (limit() != -1 || cond_ranges.size() > 64) {
+    if (limit() != -1 || _sorted_key_limit != -1 || cond_ranges.size() >= (size_t)scanners_per_tablet) {
         need_split = false;
     }
 
-    int scanners_per_tablet = std::max(1, 64 / (int)_scan_ranges.size());
     for (auto& scan_range : _scan_ranges) {
         std::vector<std::unique_ptr<OlapScanRange>>* ranges = &cond_ranges;
         std::vector<std::unique_ptr<OlapScanRange>> split_ranges;
         if (need_split) {
             auto st = get_hints(
                     *scan_range,
-                    config::doris_scan_range_row_count,
+                    scanners_per_tablet,
                     _scan_keys.begin_include(),
                     _scan_keys.end_include(),
                     cond_ranges,
@@ -1032,19 +1121,15 @@ void OlapScanNode::transfer_thread(RuntimeState* state) {
         }
     }
 
-    /*********************************
-     * 优先级调度基本策略:
-     * 1. 通过查询拆分的Range个数来确定初始nice值
-     *    Range个数越多，越倾向于认定为大查询，nice值越小
-     * 2. 通过查询累计读取的数据量来调整nice值
-     *    读取的数据越多，越倾向于认定为大查询，nice值越小
-     * 3. 通过nice值来判断查询的优先级
-     *    nice值越大的，越优先获得的查询资源
-     * 4. 定期提高队列内残留任务的优先级，避免大查询完全饿死
-     *********************************/
-    PriorityThreadPool* thread_pool = state->exec_env()->thread_pool();
-    _total_assign_num = 0;
-    _nice = 18 + std::max(0, 2 - (int)_olap_scanners.size() / 5);
+    // The scanner tasks of all scan nodes of the query share the scan threads
+    // with the other queries fairly, see ScannerScheduler
+    ScannerScheduler* scheduler = state->exec_env()->scanner_scheduler();
+    std::shared_ptr<ScannerScheduler::QueryShare> query_share;
+    if (state->resource_group() != nullptr) {
+        query_share = state->resource_group()->scanner_share();
+    } else {
+        query_share = scheduler->register_query(state->query_id());
+    }
     std::list<OlapScanner*> olap_scanners;
 
     int64_t mem_limit = 512 * 1024 * 1024;
@@ -1054,12 +1139,14 @@ void OlapScanNode::transfer_thread(RuntimeState* state) {
         mem_limit = state->fragment_mem_tracker()->limit();
         mem_consume = state->fragment_mem_tracker()->consumption();
     }
-    int max_thread = _max_materialized_row_batches;
-    if (config::doris_scanner_row_num > state->batch_size()) {
-        max_thread /= config::doris_scanner_row_num / state->batch_size();
-    }
     // read from scanner
     while (LIKELY(status.ok())) {
+        // a scanner task reads about doris_scanner_row_num rows, run as many of them
+        // as the queue can hold
+        int max_thread = _max_materialized_row_batches;
+        if (config::doris_scanner_row_num > _scanner_batch_rows) {
+            max_thread = std::max(1, max_thread / (config::doris_scanner_row_num / _scanner_batch_rows));
+        }
         int assigned_thread_num = 0;
         // copy to local
         {
@@ -1090,6 +1177,9 @@ void OlapScanNode::transfer_thread(RuntimeState* state) {
                     }
                 }
             }
+            if (assigned_thread_num >= max_thread) {
+                thread_slot_num = 0;
+            }
             thread_slot_num = std::min(thread_slot_num, _olap_scanners.size());
             for (int i = 0; i < thread_slot_num; ++i) {
                 olap_scanners.push_back(_olap_scanners.front());
@@ -1101,15 +1191,13 @@ void OlapScanNode::transfer_thread(RuntimeState* state) {
 
         auto iter = olap_scanners.begin();
         while (iter != olap_scanners.end()) {
-            PriorityThreadPool::Task task;
-            task.work_function = boost::bind(&OlapScanNode::scanner_thread, this, *iter);
-            task.priority = _nice;
-            if (thread_pool->offer(task)) {
+            if (scheduler->submit(query_share,
+                                  boost::bind(&OlapScanNode::scanner_thread, this, *iter),
+                                  _scanner_wait_timer)) {
                 olap_scanners.erase(iter++);
             } else {
                 LOG(FATAL) << "Failed to assign scanner task to thread pool!";
             }
-            ++_total_assign_num;
         }
 
         RowBatchInterface* scan_batch = NULL;
@@ -1117,14 +1205,6 @@ void OlapScanNode::transfer_thread(RuntimeState* state) {
             // 1 scanner idle task not empty, assign new sanner task
             boost::unique_lock<boost::mutex> l(_scan_batches_lock);
 
-            // scanner_row_num = 16k
-            // 16k * 10 * 12 * 8 = 15M(>2s)  --> nice=10
-            // 16k * 20 * 22 * 8 = 55M(>6s)  --> nice=0
-            while (_nice > 0
-                       && _total_assign_num > (22 - _nice) * (20 - _nice) * 6) {
-                --_nice;
-            }
-
             // 2 wait when all scanner are running & no result in queue
             while (UNLIKELY(_running_thread == assigned_thread_num
                             && _scan_row_batches.empty()
@@ -1218,8 +1298,15 @@ void OlapScanNode::scanner_thread(OlapScanner* scanner) {
                                  row_batch->tuple_data_pool()->total_reserved_bytes());
         }
         raw_rows_read = scanner->raw_rows_read();
+        if (scanner->throttle_ns() > 0) {
+            break;
+        }
     }
 
+    // A scanner over the scan bandwidth of its resource group is requeued once the
+    // group has the bandwidth again instead of waiting on the worker, it still counts
+    // as running meanwhile.
+    bool throttled = false;
     {
         boost::unique_lock<boost::mutex> l(_scan_batches_lock);
         // if we failed, check status.
@@ -1248,9 +1335,22 @@ void OlapScanNode::scanner_thread(OlapScanner* scanner) {
         }
         // If eos is true, we will process out of this lock block.
         if (!eos) {
-            _olap_scanners.push_front(scanner);
+            throttled = scanner->throttle_ns() > 0;
+            if (!throttled) {
+                _olap_scanners.push_front(scanner);
+            }
+        }
+        if (!throttled) {
+            _running_thread--;
+        }
+    }
+    if (throttled) {
+        ScannerScheduler* scheduler = _runtime_state->exec_env()->scanner_scheduler();
+        if (!scheduler->submit_delayed(state->resource_group()->scanner_share(),
+                                       boost::bind(&OlapScanNode::scanner_thread, this, scanner),
+                                       scanner->throttle_ns(), _scanner_wait_timer)) {
+            LOG(FATAL) << "Failed to assign scanner task to thread pool!";
         }
-        _running_thread--;
     }
     if (eos) {
         // close out of batches lock. we do this before _progress update
@@ -1271,6 +1371,10 @@ Status OlapScanNode::add_one_batch(RowBatchInterface* row_batch) {
     {
         boost::unique_lock<boost::mutex> l(_row_batches_lock);
 
+        if (_materialized_row_batches.size() >= _max_materialized_row_batches) {
+            // the consumer is slower than the scanners, hold fewer batches
+            _resize_row_batch_queue(_max_materialized_row_batches / 2);
+        }
         while (UNLIKELY(_materialized_row_batches.size()
                         >= _max_materialized_row_batches
                         && !_transfer_done)) {
@@ -1285,6 +1389,24 @@ Status OlapScanNode::add_one_batch(RowBatchInterface* row_batch) {
     return Status::OK();
 }
 
+int OlapScanNode::_compute_scanner_batch_rows(int batch_size, int tuple_byte_size) {
+    if (config::doris_scanner_batch_bytes <= 0 || tuple_byte_size <= 0) {
+        return batch_size;
+    }
+    return std::max(1, std::min(batch_size, config::doris_scanner_batch_bytes / tuple_byte_size));
+}
+
+void OlapScanNode::_resize_row_batch_queue(int depth) {
+    depth = std::max(_min_materialized_row_batches,
+                     std::min(depth, std::max(1, config::doris_scanner_queue_size)));
+    if (depth == _max_materialized_row_batches) {
+        return;
+    }
+    _max_materialized_row_batches = depth;
+    COUNTER_SET(_queue_depth_counter, (int64_t)depth);
+    _peak_queue_depth_counter->set((int64_t)depth);
+}
+
 void OlapScanNode::debug_string(
     int /* indentation_level */,
     std::stringstream* /* out */) const {
@@ -24,6 +24,7 @@
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
 #include <queue>
 
 #include "exec/olap_common.h"
@@ -37,6 +38,8 @@
 
 namespace doris {
 
+class TopNThreshold;
+
 enum TransferStatus {
     READ_ROWBATCH = 1,
     INIT_HEAP = 2,
@@ -57,10 +60,29 @@ public:
     virtual Status get_next(RuntimeState* state, RowBatch* row_batch, bool* eos);
     Status collect_query_statistics(QueryStatistics* statistics) override;
     virtual Status close(RuntimeState* state);
+    bool can_be_pipeline_source() const override {
+        return true;
+    }
+    // True if get_next() won't wait for the scanners: a batch is materialized or the
+    // scan is done. A pipeline source starts its scanners in open().
+    bool has_output() override;
     virtual Status set_scan_ranges(const std::vector<TScanRangeParams>& scan_ranges);
     inline void set_no_agg_finalize() {
         _need_agg_finalize = false;
     }
+
+    // The two functions below are called by a TopNNode directly above this
+    // node, after prepare() and before open().
+
+    // If the slots 'slot_ids' are a prefix of the key columns, make every
+    // scanner return its rows in key order and stop after 'limit' rows.
+    // Return false if they are not.
+    bool push_down_sorted_key_limit(const std::vector<SlotId>& slot_ids, int64_t limit);
+
+    // Return the bound on slot 'slot_id' the TopNNode publishes its heap top
+    // to, nullptr if the slot is not a materialized column of this scan.
+    // Scanners drop the rows beyond the bound and storage prunes pages by it.
+    TopNThreshold* create_topn_threshold(SlotId slot_id, bool is_asc);
 protected:
     typedef struct {
         Tuple* tuple;
@@ -158,10 +180,17 @@ protected:
 
 private:
     void _init_counter(RuntimeState* state);
+    // Rows of a scanner batch, at most batch_size and bounded by
+    // doris_scanner_batch_bytes of tuples.
+    static int _compute_scanner_batch_rows(int batch_size, int tuple_byte_size);
+    // Set the depth of _materialized_row_batches within its bounds.
+    // Must hold _row_batches_lock.
+    void _resize_row_batch_queue(int depth);
 
     void construct_is_null_pred_in_where_pred(Expr* expr, SlotDescriptor* slot, std::string is_null_str);
 
     friend class OlapScanner;
+    friend class OlapScanNodeQueueTest;
 
     std::vector<TCondition> _is_null_vector;
     // Tuple id resolved in prepare() to set _tuple_desc;
@@ -189,6 +218,12 @@ private:
     // Order Result Flag
     bool _is_result_order;
 
+    // rows each scanner returns at most in key order, -1 if not pushed down
+    int64_t _sorted_key_limit = -1;
+    // owned by _pool, nullptr if no TopNNode publishes a bound
+    TopNThreshold* _topn_threshold = nullptr;
+    const SlotDescriptor* _topn_threshold_slot = nullptr;
+
     // Pool for storing allocated scanner objects.  We don't want to use the
     // runtime pool to ensure that the scanner objects are deleted before this
     // object is.
@@ -219,21 +254,32 @@ private:
 
     std::list<OlapScanner*> _olap_scanners;
 
-    int _max_materialized_row_batches;
+    // The depth of _materialized_row_batches, which also bounds the running scanners.
+    // It grows while get_next() waits for the scanners and shrinks while the scanners
+    // wait for get_next(), between _min_materialized_row_batches and
+    // config::doris_scanner_queue_size.
+    std::atomic<int> _max_materialized_row_batches;
+    int _min_materialized_row_batches;
+    // max rows of a row batch read by a scanner, so that the tuples of a batch are
+    // about config::doris_scanner_batch_bytes
+    int _scanner_batch_rows = 0;
     bool _start;
     bool _scanner_done;
     bool _transfer_done;
     size_t _direct_conjunct_size;
 
     boost::posix_time::time_duration _wait_duration;
-    int _total_assign_num;
-    int _nice;
 
     // protect _status, for many thread may change _status
     SpinLock _status_mutex;
     Status _status;
     RuntimeState* _runtime_state;
     RuntimeProfile::Counter* _scan_timer;
+    // time the scanner tasks waited for a scan thread
+    RuntimeProfile::Counter* _scanner_wait_timer = nullptr;
+    RuntimeProfile::Counter* _scanner_batch_rows_counter = nullptr;
+    RuntimeProfile::Counter* _queue_depth_counter = nullptr;
+    RuntimeProfile::HighWaterMarkCounter* _peak_queue_depth_counter = nullptr;
     RuntimeProfile::Counter* _tablet_counter;
     RuntimeProfile::Counter* _rows_pushed_cond_filtered_counter = nullptr;
     RuntimeProfile::Counter* _reader_init_timer = nullptr;
@@ -258,6 +304,7 @@ private:
 
     RuntimeProfile::Counter* _stats_filtered_counter = nullptr;
     RuntimeProfile::Counter* _del_filtered_counter = nullptr;
+    RuntimeProfile::Counter* _topn_filtered_counter = nullptr;
 
     RuntimeProfile::Counter* _block_seek_timer = nullptr;
     RuntimeProfile::Counter* _block_convert_timer = nullptr;
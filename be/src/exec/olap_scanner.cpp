@@ -22,12 +22,16 @@
 #include "olap_scanner.h"
 #include "olap_scan_node.h"
 #include "olap_utils.h"
+#include "olap/data_dir.h"
 #include "olap/field.h"
 #include "service/backend_options.h"
 #include "runtime/descriptors.h"
 #include "runtime/runtime_state.h"
 #include "runtime/mem_pool.h"
 #include "runtime/mem_tracker.h"
+#include "runtime/raw_value.h"
+#include "runtime/resource_group.h"
+#include "runtime/topn_threshold.h"
 #include "util/mem_util.hpp"
 #include "util/network_util.h"
 #include "util/doris_metrics.h"
@@ -63,6 +67,10 @@ OlapScanner::OlapScanner(
         LOG(WARNING) << "OlapScanner preapre failed, status:" << _ctor_status.get_error_msg();
     }
     _rows_read_counter = parent->rows_read_counter();
+    if (parent->_topn_threshold != nullptr) {
+        _topn_threshold_checker.reset(new TopNThresholdChecker(
+                parent->_topn_threshold, parent->_topn_threshold_slot));
+    }
     _rows_pushed_cond_filtered_counter = parent->_rows_pushed_cond_filtered_counter;
 }
 
@@ -192,6 +200,14 @@ Status OlapScanner::_init_params(
     _params.profile = _profile;
     _params.runtime_state = _runtime_state;
 
+    // Rows only come out in key order within one key range, so the limit
+    // can't be pushed down to a scanner reading several of them.
+    if (_parent->_sorted_key_limit != -1 && key_ranges.size() <= 1) {
+        _sorted_key_limit = _parent->_sorted_key_limit;
+        _params.need_ordered_result = true;
+    }
+    _params.topn_threshold = _parent->_topn_threshold;
+
     if (_aggregation) {
         _params.return_columns = _return_columns;
     } else {
@@ -247,9 +263,11 @@ Status OlapScanner::_init_return_columns() {
 Status OlapScanner::get_batch(
         RuntimeState* state, RowBatch* batch, bool* eof) {
     // 2. Allocate Row's Tuple buf
+    int max_rows = std::min(_parent->_scanner_batch_rows, batch->capacity());
     uint8_t *tuple_buf = batch->tuple_data_pool()->allocate(
-        state->batch_size() * _tuple_desc->byte_size());
-    bzero(tuple_buf, state->batch_size() * _tuple_desc->byte_size());
+        max_rows * _tuple_desc->byte_size());
+    bzero(tuple_buf, max_rows * _tuple_desc->byte_size());
+    int64_t string_bytes_begin = batch->tuple_data_pool()->total_allocated_bytes();
     Tuple *tuple = reinterpret_cast<Tuple*>(tuple_buf);
 
     std::unique_ptr<MemTracker> tracker(new MemTracker(state->fragment_mem_tracker()->limit()));
@@ -259,11 +277,20 @@ Status OlapScanner::get_batch(
     {
         SCOPED_TIMER(_parent->_scan_timer);
         while (true) {
-            // Batch is full, break
-            if (batch->is_full()) {
+            // Batch is full, break. The string slots may make a batch of fewer
+            // rows reach the bytes as well
+            if (batch->num_rows() >= max_rows
+                    || (config::doris_scanner_batch_bytes > 0
+                        && batch->num_rows() * _tuple_desc->byte_size()
+                            + batch->tuple_data_pool()->total_allocated_bytes() - string_bytes_begin
+                            >= config::doris_scanner_batch_bytes)) {
                 _update_realtime_counter();
                 break;
             }
+            if (_sorted_key_limit != -1 && _num_rows_returned >= _sorted_key_limit) {
+                *eof = true;
+                break;
+            }
             // Read one row from reader
             auto res = _reader->next_row_with_aggregation(&_read_row_cursor, mem_pool.get(), batch->agg_object_pool(), eof);
             if (res != OLAP_SUCCESS) {
@@ -281,6 +308,18 @@ Status OlapScanner::get_batch(
                 VLOG_ROW << "OlapScanner input row: " << Tuple::to_string(tuple, *_tuple_desc);
             }
 
+            if (_topn_threshold_checker != nullptr && _topn_threshold_checker->is_beyond(tuple)) {
+                tuple->init(_tuple_desc->byte_size());
+                _num_rows_topn_filtered++;
+                if (_sorted_key_limit != -1) {
+                    // rows come in the order of the bounded column, the
+                    // following ones are all beyond the bound as well
+                    *eof = true;
+                    break;
+                }
+                continue;
+            }
+
             // 3.4 Set tuple to RowBatch(not commited)
             int row_idx = batch->add_row();
             TupleRow* row = batch->get_row(row_idx);
@@ -340,6 +379,7 @@ Status OlapScanner::get_batch(
 
                 // check direct && pushdown conjuncts success then commit tuple
                 batch->commit_last_row();
+                _num_rows_returned++;
                 char* new_tuple = reinterpret_cast<char*>(tuple);
                 new_tuple += _tuple_desc->byte_size();
                 tuple = reinterpret_cast<Tuple*>(new_tuple);
@@ -367,6 +407,25 @@ Status OlapScanner::get_batch(
         }
     }
 
+    // the scan node requeues the scanner later if the resource group of the query is
+    // over its scan bandwidth
+    _throttle_ns = 0;
+    ResourceGroup* resource_group = state->resource_group();
+    if (resource_group != nullptr) {
+        int64_t bytes_read = _compressed_bytes_read + _reader->stats().compressed_bytes_read;
+        _throttle_ns = resource_group->consume_scan_bytes(bytes_read - _resource_group_bytes_read);
+        _resource_group_bytes_read = bytes_read;
+    }
+
+    // lets the background io of the disk back off when the queries read slowly
+    int64_t io_ns = _reader->stats().io_ns;
+    int64_t bytes_read = _compressed_bytes_read + _reader->stats().compressed_bytes_read;
+    if (io_ns >= _io_scheduler_io_ns && bytes_read >= _io_scheduler_bytes_read) {
+        _tablet->data_dir()->io_scheduler()->report_foreground_read(
+                io_ns - _io_scheduler_io_ns, bytes_read - _io_scheduler_bytes_read);
+    }
+    _io_scheduler_io_ns = io_ns;
+    _io_scheduler_bytes_read = bytes_read;
     return Status::OK();
 }
 
@@ -476,6 +535,8 @@ void OlapScanner::update_counter() {
 
     COUNTER_UPDATE(_parent->_stats_filtered_counter, _reader->stats().rows_stats_filtered);
     COUNTER_UPDATE(_parent->_del_filtered_counter, _reader->stats().rows_del_filtered);
+    COUNTER_UPDATE(_parent->_topn_filtered_counter,
+                   _reader->stats().rows_topn_filtered + _num_rows_topn_filtered);
 
     COUNTER_UPDATE(_parent->_index_load_timer, _reader->stats().index_load_ns);
 
@@ -46,6 +46,7 @@ class OlapScanNode;
 class OLAPReader;
 class RuntimeProfile;
 class Field;
+class TopNThresholdChecker;
 
 class OlapScanner {
 public:
@@ -77,6 +78,9 @@ public:
     void set_id(int id) { _id = id; }
     bool is_open() const { return _is_open; }
     void set_opened() { _is_open = true; }
+    // How long the scanner has to wait after the last get_batch() for the scan
+    // bandwidth of the query's resource group, 0 if it may read on at once.
+    int64_t throttle_ns() const { return _throttle_ns; }
 
     int64_t raw_rows_read() const { return _raw_rows_read; }
 
@@ -136,11 +140,25 @@ private:
     int64_t _num_rows_read = 0;
     int64_t _raw_rows_read = 0;
     int64_t _compressed_bytes_read = 0;
+    // compressed bytes read already charged to the resource group of the query
+    int64_t _resource_group_bytes_read = 0;
+    int64_t _throttle_ns = 0;
+    // io time and compressed bytes read already reported to the io scheduler of the disk
+    int64_t _io_scheduler_io_ns = 0;
+    int64_t _io_scheduler_bytes_read = 0;
 
     RuntimeProfile::Counter* _rows_pushed_cond_filtered_counter = nullptr;
     // number rows filtered by pushed condition
     int64_t _num_rows_pushed_cond_filtered = 0;
 
+    // rows this scanner returns at most, -1 if unlimited
+    int64_t _sorted_key_limit = -1;
+    int64_t _num_rows_returned = 0;
+
+    // nullptr if no TopNNode above publishes a bound
+    std::unique_ptr<TopNThresholdChecker> _topn_threshold_checker;
+    int64_t _num_rows_topn_filtered = 0;
+
     bool _is_closed = false;
 };
 
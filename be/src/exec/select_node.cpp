@@ -94,6 +94,35 @@ Status SelectNode::get_next(RuntimeState* state, RowBatch* row_batch, bool* eos)
     return Status::OK();
 }
 
+Status SelectNode::open_operator(RuntimeState* state) {
+    RETURN_IF_ERROR(exec_debug_action(TExecNodePhase::OPEN));
+    return ExecNode::open(state);
+}
+
+Status SelectNode::push(RuntimeState* state, RowBatch* input, RowBatch* output, bool* eos) {
+    RETURN_IF_ERROR(exec_debug_action(TExecNodePhase::GETNEXT));
+    RETURN_IF_CANCELLED(state);
+    SCOPED_TIMER(_runtime_profile->total_time_counter());
+    DCHECK_EQ(output->num_rows(), 0);
+    DCHECK_GE(output->capacity(), input->num_rows());
+
+    ExprContext** ctxs = &_conjunct_ctxs[0];
+    int num_ctxs = _conjunct_ctxs.size();
+    for (int i = 0; i < input->num_rows() && !reached_limit(); ++i) {
+        TupleRow* src_row = input->get_row(i);
+        if (ExecNode::eval_conjuncts(ctxs, num_ctxs, src_row)) {
+            TupleRow* dst_row = output->get_row(output->add_row());
+            output->copy_row(src_row, dst_row);
+            output->commit_last_row();
+            ++_num_rows_returned;
+        }
+    }
+    COUNTER_SET(_rows_returned_counter, _num_rows_returned);
+    input->transfer_resource_ownership(output);
+    *eos = reached_limit();
+    return Status::OK();
+}
+
 bool SelectNode::copy_rows(RowBatch* output_batch) {
     ExprContext** ctxs = &_conjunct_ctxs[0];
     int num_ctxs = _conjunct_ctxs.size();
@@ -39,6 +39,14 @@ public:
     virtual Status get_next(RuntimeState* state, RowBatch* row_batch, bool* eos);
     virtual Status close(RuntimeState* state);
 
+    // Pipeline execution (see runtime/pipeline_driver.h): the driver opens this node
+    // without its child and pushes the child's batches through it.
+    Status open_operator(RuntimeState* state);
+    // Copy the rows of 'input' passing the conjuncts to 'output', up to the limit, and
+    // transfer the resources of 'input' to 'output'. 'output' must be empty and as
+    // large as 'input'. Sets 'eos' if the limit was reached.
+    Status push(RuntimeState* state, RowBatch* input, RowBatch* output, bool* eos);
+
 private:
     // current row batch of child
     boost::scoped_ptr<RowBatch> _child_row_batch;
@@ -17,6 +17,7 @@
 
 #include "exec/sort_node.h"
 #include "exec/sort_exec_exprs.h"
+#include "runtime/exec_env.h"
 #include "runtime/row_batch.h"
 #include "runtime/runtime_state.h"
 #include "util/runtime_profile.h"
@@ -64,7 +65,8 @@ Status SortNode::open(RuntimeState* state) {
         _is_asc_order, _nulls_first);
     _sorter.reset(new MergeSorter(
                       less_than, _sort_exec_exprs.sort_tuple_slot_expr_ctxs(),
-                      &_row_descriptor, runtime_profile(), state));
+                      &_row_descriptor, runtime_profile(), state,
+                      state->parallel_sort_degree(), state->exec_env()->sort_thread_pool()));
 
     // The child has been opened and the sorter created. Sort the input.
     // The final merge is done on-demand as rows are requested in GetNext().
@@ -120,8 +122,9 @@ Status SortNode::close(RuntimeState* state) {
     if (is_closed()) {
         return Status::OK();
     }
-    _sort_exec_exprs.close(state);
+    // The sorter's threads must stop before the exprs are closed
     _sorter.reset();
+    _sort_exec_exprs.close(state);
     return ExecNode::close(state);
 }
 
@@ -19,7 +19,9 @@
 
 #include <sstream>
 
+#include "exec/olap_scan_node.h"
 #include "exprs/expr.h"
+#include "exprs/slot_ref.h"
 #include "gen_cpp/Exprs_types.h"
 #include "gen_cpp/PlanNodes_types.h"
 #include "runtime/descriptors.h"
@@ -27,6 +29,7 @@
 #include "runtime/raw_value.h"
 #include "runtime/row_batch.h"
 #include "runtime/runtime_state.h"
+#include "runtime/topn_threshold.h"
 #include "runtime/tuple.h"
 #include "runtime/tuple_row.h"
 #include "util/runtime_profile.h"
@@ -41,6 +44,8 @@ TopNNode::TopNNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl
         _materialized_tuple_desc(NULL),
         _tuple_row_less_than(NULL),
         _tuple_pool(NULL),
+        _topn_threshold(NULL),
+        _topn_threshold_slot(NULL),
         _num_rows_skipped(0),
         _priority_queue(NULL) {
 }
@@ -102,6 +107,7 @@ Status TopNNode::open(RuntimeState* state) {
     // Allocate memory for a temporary tuple.
     _tmp_tuple = reinterpret_cast<Tuple*>(
             _tuple_pool->allocate(_materialized_tuple_desc->byte_size()));
+    push_down_to_scan_node();
     RETURN_IF_ERROR(child(0)->open(state));
 
     // Limit of 0, no need to fetch anything from children.
@@ -215,6 +221,72 @@ void TopNNode::insert_tuple_row(TupleRow* input_row) {
 
     if (insert_tuple != NULL) {
         _priority_queue->push(insert_tuple);
+        if (_topn_threshold != NULL && _priority_queue->size() == _offset + _limit) {
+            update_topn_threshold();
+        }
+    }
+}
+
+void TopNNode::update_topn_threshold() {
+    Tuple* top_tuple = _priority_queue->top();
+    if (top_tuple->is_null(_topn_threshold_slot->null_indicator_offset())) {
+        return;
+    }
+    _topn_threshold->update(top_tuple->get_slot(_topn_threshold_slot->tuple_offset()));
+}
+
+void TopNNode::push_down_to_scan_node() {
+    if (_limit <= 0 || child(0)->type() != TPlanNodeType::OLAP_SCAN_NODE) {
+        return;
+    }
+    OlapScanNode* scan_node = static_cast<OlapScanNode*>(child(0));
+    const std::vector<ExprContext*>& ordering_expr_ctxs =
+        _sort_exec_exprs.lhs_ordering_expr_ctxs();
+    const std::vector<ExprContext*>& slot_expr_ctxs =
+        _sort_exec_exprs.sort_tuple_slot_expr_ctxs();
+    const std::vector<SlotDescriptor*>& sort_slots = _materialized_tuple_desc->slots();
+
+    // Resolve the leading ordering exprs which are plain columns of the scan
+    std::vector<SlotId> scan_slot_ids;
+    std::vector<const SlotDescriptor*> sort_slot_descs;
+    for (auto ctx : ordering_expr_ctxs) {
+        if (ctx->root()->node_type() != TExprNodeType::SLOT_REF) {
+            break;
+        }
+        SlotId sort_slot_id = static_cast<SlotRef*>(ctx->root())->slot_id();
+        int idx = 0;
+        while (idx < sort_slots.size() && sort_slots[idx]->id() != sort_slot_id) {
+            ++idx;
+        }
+        if (idx >= slot_expr_ctxs.size()
+                || slot_expr_ctxs[idx]->root()->node_type() != TExprNodeType::SLOT_REF) {
+            break;
+        }
+        scan_slot_ids.push_back(static_cast<SlotRef*>(slot_expr_ctxs[idx]->root())->slot_id());
+        sort_slot_descs.push_back(sort_slots[idx]);
+    }
+    if (scan_slot_ids.empty()) {
+        return;
+    }
+
+    // Storage returns keys ascending with nulls first
+    bool sorted_by_scan = scan_slot_ids.size() == ordering_expr_ctxs.size();
+    for (int i = 0; sorted_by_scan && i < scan_slot_ids.size(); ++i) {
+        sorted_by_scan = TopNThreshold::in_storage_order(
+                _is_asc_order[i], _nulls_first[i], sort_slot_descs[i]->is_nullable());
+    }
+    if (sorted_by_scan && scan_node->push_down_sorted_key_limit(scan_slot_ids, _offset + _limit)) {
+        VLOG(1) << "push down sorted key limit " << _offset + _limit
+                << " to scan node " << scan_node->id();
+    }
+
+    // A null heap top can't bound anything, and with nulls first a full heap
+    // of non-null rows doesn't exclude nulls
+    if (TopNThreshold::can_bound(_nulls_first[0], sort_slot_descs[0]->is_nullable())) {
+        _topn_threshold = scan_node->create_topn_threshold(scan_slot_ids[0], _is_asc_order[0]);
+        if (_topn_threshold != NULL) {
+            _topn_threshold_slot = sort_slot_descs[0];
+        }
     }
 }
 
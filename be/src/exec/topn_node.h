@@ -30,6 +30,7 @@ namespace doris {
 class MemPool;
 class RuntimeState;
 class Tuple;
+class TopNThreshold;
 
 // Node for in-memory TopN (ORDER BY ... LIMIT)
 // This handles the case where the result fits in memory.  This node will do a deep
@@ -62,6 +63,13 @@ private:
     // Flatten and reverse the priority queue.
     void prepare_for_output();
 
+    // If the child is an OlapScanNode, push the limit down to it when the rows
+    // are sorted by a key prefix, and let it filter by the heap top.
+    void push_down_to_scan_node();
+
+    // Publish the first sort column of the heap top to _topn_threshold.
+    void update_topn_threshold();
+
     // number rows to skipped
     int64_t _offset;
 
@@ -92,6 +100,12 @@ private:
     std::vector<Tuple*>::iterator _get_next_iter;
     // std::vector<TupleRow*>::iterator _get_next_iter;
 
+    // Bound on the first sort column shared with the OlapScanNode child,
+    // nullptr if there is none. Owned by the child.
+    TopNThreshold* _topn_threshold;
+    // The slot of _materialized_tuple_desc the bound is taken from.
+    const SlotDescriptor* _topn_threshold_slot;
+
     // True if the _limit comes from DEFAULT_ORDER_BY_LIMIT and the query option
     // ABORT_ON_DEFAULT_LIMIT_EXCEEDED is set.
     bool _abort_on_default_limit_exceeded;
@@ -21,12 +21,14 @@
 #include <math.h>
 #include <sstream>
 #include <unordered_set>
+#include <roaring/roaring64map.hh>
 
+#include "common/config.h"
 #include "common/logging.h"
 #include "runtime/string_value.h"
 #include "runtime/datetime_value.h"
 #include "exprs/anyval_util.h"
-#include "exprs/hybird_set.h"
+#include "util/flat_hash_set.h"
 #include "util/tdigest.h"
 #include "util/debug_util.h"
 
@@ -1322,12 +1324,18 @@ doris_udf::HllVal AggregateFunctions::hll_raw_agg_finalize(
     return result;
 }
 
-// TODO chenhao , reduce memory copy
 // multi distinct state for numertic
-// serialize order type:value:value:value ...
+// Small sets are kept in an open addressing FlatHashSet, serialized as
+// type:value:value:value ...
+// Integer sets of up to 64 bits switch to a Roaring64Map once they grow past
+// BITMAP_THRESHOLD values that are dense enough for the bitmap to take less
+// memory. With config::multi_distinct_bitmap_state the bitmap state is
+// serialized as (type | BITMAP_FLAG):roaring64map, which makes merging across
+// exchanges a bitmap union, otherwise as the values like a set.
 template <typename T>
 class MultiDistinctNumericState {
 public:
+    typedef decltype(T::val) ValType;
 
     static void create(StringVal* dst) {
         dst->is_null = false;
@@ -1359,77 +1367,110 @@ public:
     }
 
     void update(T& t) {
-        _set.insert(t);
+        _insert(t.val);
     }
 
     // type:one byte  value:sizeof(T)
+    // or (type | BITMAP_FLAG):one byte  bitmap:roaring64map
     StringVal serialize(FunctionContext* ctx) {
-        size_t type_size = sizeof(((T*)0)->val);
-        const size_t serialized_set_length = sizeof(uint8_t) + type_size * _set.size();
+        if (_bitmap != nullptr && config::multi_distinct_bitmap_state) {
+            _bitmap->runOptimize();
+            StringVal result(ctx, sizeof(uint8_t) + _bitmap->getSizeInBytes());
+            *result.ptr = (uint8_t)_type | BITMAP_FLAG;
+            _bitmap->write((char*)result.ptr + 1);
+            return result;
+        }
+        const size_t type_size = sizeof(ValType);
+        const size_t serialized_set_length = sizeof(uint8_t) + type_size * _size();
         StringVal result(ctx, serialized_set_length);
         uint8_t* type_writer = result.ptr;
         // type
         *type_writer = (uint8_t)_type;
         type_writer++;
         // value
-        for (auto& value : _set) {
-            memcpy(type_writer, &value.val, type_size);
+        _for_each([&type_writer, type_size](const ValType& value) {
+            memcpy(type_writer, &value, type_size);
             type_writer += type_size;
-        }
+        });
         return result;
     }
 
+    // Values in 'src' are added to this state, so unserializing into a non
+    // empty state merges the two without building a temporary set.
     void unserialize(StringVal& src) {
-        size_t type_size = sizeof(((T*)0)->val);
+        const size_t type_size = sizeof(ValType);
         const uint8_t* type_reader = src.ptr;
         const uint8_t* end = src.ptr + src.len;
         // type
-        _type = (FunctionContext::Type)*type_reader;
+        const bool is_bitmap = (*type_reader & BITMAP_FLAG) != 0;
+        _type = (FunctionContext::Type)(*type_reader & ~BITMAP_FLAG);
         type_reader++;
+        if (is_bitmap) {
+            DCHECK(USE_BITMAP);
+            Roaring64Map bitmap = Roaring64Map::read((const char*)type_reader);
+            if (_bitmap == nullptr) {
+                _bitmap.reset(new Roaring64Map(std::move(bitmap)));
+                _set.for_each([this](const ValType& value) {
+                    _bitmap->add(_to_bitmap_value(value));
+                });
+                _set.clear();
+            } else {
+                *_bitmap |= bitmap;
+            }
+            return;
+        }
         // value
         while (type_reader < end) {
-            T value;
-            value.is_null = false;
-            memcpy(&value.val, type_reader, type_size);
-            _set.insert(value);
+            ValType value;
+            memcpy(&value, type_reader, type_size);
+            _insert(value);
             type_reader += type_size;
         }
     }
 
     // merge set
     void merge(MultiDistinctNumericState& state) {
-        _set.insert(state._set.begin(), state._set.end());
+        if (state._bitmap != nullptr) {
+            if (_bitmap == nullptr) {
+                _convert_to_bitmap();
+            }
+            *_bitmap |= *state._bitmap;
+        } else {
+            state._set.for_each([this](const ValType& value) {
+                _insert(value);
+            });
+        }
     }
 
     // count
     BigIntVal count_finalize() {
-        return BigIntVal(_set.size());
+        return BigIntVal(_size());
     }
 
     // sum for double, decimal
     DoubleVal sum_finalize_double() {
         double sum = 0;
-        for (auto& value : _set) {
-            sum += value.val;
-        }
+        _for_each([&sum](const ValType& value) {
+            sum += value;
+        });
         return DoubleVal(sum);
     }
 
     // sum for largeint
     LargeIntVal sum_finalize_largeint() {
         __int128 sum = 0;
-        for (auto& value : _set) {
-            sum += value.val;
-        }
+        _for_each([&sum](const ValType& value) {
+            sum += value;
+        });
         return LargeIntVal(sum);
     }
 
     // sum for tinyint, smallint, int, bigint
     BigIntVal sum_finalize_bigint() {
         int64_t sum = 0;
-        for (auto& value : _set) {
-            sum += value.val;
-        }
+        _for_each([&sum](const ValType& value) {
+            sum += value;
+        });
         return BigIntVal(sum);
     }
 
@@ -1438,19 +1479,89 @@ public:
     }
 
 private:
+    // Set in the serialized type byte when the payload is a Roaring64Map.
+    // FunctionContext::Type values are far below it.
+    static const uint8_t BITMAP_FLAG = 0x80;
+    static const size_t BITMAP_THRESHOLD = 8192;
+    // A roaring container holds 65536 values, the bitmap only takes less memory
+    // than the set if the values are at most this far apart on average.
+    static const uint64_t BITMAP_MAX_AVERAGE_GAP = 1024;
+    static const bool USE_BITMAP = std::is_integral<ValType>::value && sizeof(ValType) <= 8;
 
-    class NumericHashHelper {
-    public:
-        size_t operator()(const T& obj) const {
-            size_t result = AnyValUtil::hash64_murmur(obj, HashUtil::MURMUR_SEED);
-            return result;
+    // Negative values map to the upper half of the uint64 domain, the mapping
+    // is reversed by _from_bitmap_value.
+    static uint64_t _to_bitmap_value(const ValType& value) {
+        return static_cast<uint64_t>(static_cast<int64_t>(value));
+    }
+
+    static ValType _from_bitmap_value(uint64_t value) {
+        return static_cast<ValType>(static_cast<int64_t>(value));
+    }
+
+    void _insert(const ValType& value) {
+        if (_bitmap != nullptr) {
+            _bitmap->add(_to_bitmap_value(value));
+            return;
         }
-    };
+        if (USE_BITMAP) {
+            if (_set.empty()) {
+                _min = value;
+                _max = value;
+            } else if (value < _min) {
+                _min = value;
+            } else if (value > _max) {
+                _max = value;
+            }
+        }
+        _set.insert(value);
+        if (USE_BITMAP && _set.size() > _next_bitmap_check) {
+            if (_is_dense()) {
+                _convert_to_bitmap();
+            } else {
+                // sparse values, check again once the set has doubled
+                _next_bitmap_check = _set.size() * 2;
+            }
+        }
+    }
+
+    bool _is_dense() const {
+        // the difference of two int64 fits in a uint64
+        uint64_t range = _to_bitmap_value(_max) - _to_bitmap_value(_min);
+        return range / BITMAP_MAX_AVERAGE_GAP < _set.size();
+    }
+
+    size_t _size() const {
+        return _bitmap != nullptr ? _bitmap->cardinality() : _set.size();
+    }
+
+    void _convert_to_bitmap() {
+        DCHECK(USE_BITMAP);
+        _bitmap.reset(new Roaring64Map());
+        _set.for_each([this](const ValType& value) {
+            _bitmap->add(_to_bitmap_value(value));
+        });
+        _set.clear();
+    }
 
-    std::unordered_set<T, NumericHashHelper> _set;
-    // Because Anyval does not provide the hash function, in order
-    // to adopt the type different from the template, the pointer is used
-    // HybirdSetBase* _set;
+    template <typename Func>
+    void _for_each(Func func) {
+        if (_bitmap != nullptr) {
+            for (auto it = _bitmap->begin(); it != _bitmap->end(); ++it) {
+                func(_from_bitmap_value(*it));
+            }
+        } else {
+            _set.for_each(func);
+        }
+    }
+
+    FlatHashSet<ValType> _set;
+    // the smallest and largest value in _set, only kept for bitmap types
+    ValType _min = 0;
+    ValType _max = 0;
+    // the size of _set beyond which it's checked for a switch to bitmap
+    size_t _next_bitmap_check = BITMAP_THRESHOLD;
+    // not null once the state has switched to bitmap mode, _set is empty then
+    std::unique_ptr<Roaring64Map> _bitmap;
     // _type is serialized into buffer by one byte
     FunctionContext::Type _type;
 };
@@ -1475,40 +1586,34 @@ public:
     }
 
     inline void update(StringValue* sv) {
-        _set.insert(sv);
+        _set.insert(Slice(sv->ptr, sv->len));
     }
 
     StringVal serialize(FunctionContext* ctx) {
         // calculate total serialize buffer length
         int total_serialized_set_length = 1;
-        HybirdSetBase::IteratorBase* iterator = _set.begin();
-        while (iterator->has_next()) {
-            const StringValue* value =
-                        reinterpret_cast<const StringValue*>(iterator->get_value());
-            total_serialized_set_length += STRING_LENGTH_RECORD_LENGTH + value->len;
-            iterator->next();
-        }
+        _set.for_each([&total_serialized_set_length](const Slice& value) {
+            total_serialized_set_length += STRING_LENGTH_RECORD_LENGTH + value.size;
+        });
         StringVal result(ctx, total_serialized_set_length);
         uint8_t* writer = result.ptr;
         // type
         *writer = _type;
         writer ++;
-        iterator = _set.begin();
-        while (iterator->has_next()) {
-            const StringValue* value = reinterpret_cast<const StringValue*>
-            (iterator->get_value());
+        _set.for_each([&writer](const Slice& value) {
             // length, it is unnecessary to consider little or big endian for
             // all running in little-endian.
-            *(int*)writer = value->len;
+            *(int*)writer = value.size;
             writer += STRING_LENGTH_RECORD_LENGTH;
             // value
-            memcpy(writer, value->ptr, value->len);
-            writer += value->len;
-            iterator->next();
-        }
+            memcpy(writer, value.data, value.size);
+            writer += value.size;
+        });
         return result;
     }
 
+    // Values in 'src' are added to this state, so unserializing into a non
+    // empty state merges the two without building a temporary set.
     void unserialize(StringVal& src) {
         uint8_t* reader = src.ptr;
         // skip type ,no used now
@@ -1519,8 +1624,7 @@ public:
         while (reader < end) {
             const int length = *(int*)reader;
             reader += STRING_LENGTH_RECORD_LENGTH;
-            StringValue value((char*)reader, length);
-            _set.insert(&value);
+            _set.insert(Slice(reader, length));
             reader += length;
         }
         DCHECK(reader == end);
@@ -1528,7 +1632,9 @@ public:
 
     // merge set
     void merge(MultiDistinctStringCountState& state) {
-        _set.insert(&(state._set));
+        state._set.for_each([this](const Slice& value) {
+            _set.insert(value);
+        });
     }
 
     BigIntVal finalize() {
@@ -1542,7 +1648,7 @@ public:
     static const int STRING_LENGTH_RECORD_LENGTH = 4;
 private:
 
-    StringValueSet _set;
+    FlatStringSet _set;
     // _type is serialized into buffer by one byte
     FunctionContext::Type _type;
 };
@@ -1898,14 +2004,8 @@ void AggregateFunctions::count_or_sum_distinct_numeric_merge(FunctionContext* ct
    DCHECK(!dst->is_null);
    DCHECK(!src.is_null);
    MultiDistinctNumericState<T>* dst_state = reinterpret_cast<MultiDistinctNumericState<T>*>(dst->ptr);
-   // unserialize src
-   StringVal src_state_val;
-   MultiDistinctNumericState<T>::create(&src_state_val);
-   MultiDistinctNumericState<T>* src_state = reinterpret_cast<MultiDistinctNumericState<T>*>(src_state_val.ptr);
-   src_state->unserialize(src);
-   DCHECK(dst_state->set_type() == src_state->set_type());
-   dst_state->merge(*src_state);
-   MultiDistinctNumericState<T>::destory(src_state_val);
+   // unserialize src into dst, which merges them
+   dst_state->unserialize(src);
 }
 
 void AggregateFunctions::count_distinct_string_merge(FunctionContext* ctx, StringVal& src,
@@ -1913,14 +2013,8 @@ void AggregateFunctions::count_distinct_string_merge(FunctionContext* ctx, Strin
     DCHECK(!dst->is_null);
     DCHECK(!src.is_null);
     MultiDistinctStringCountState* dst_state = reinterpret_cast<MultiDistinctStringCountState*>(dst->ptr);
-    // unserialize src
-    StringVal src_state_val;
-    MultiDistinctStringCountState::create(&src_state_val);
-    MultiDistinctStringCountState* src_state = reinterpret_cast<MultiDistinctStringCountState*>(src_state_val.ptr);
-    src_state->unserialize(src);
-    DCHECK(dst_state->set_type() == src_state->set_type());
-    dst_state->merge(*src_state);
-    MultiDistinctStringCountState::destory(src_state_val);
+    // unserialize src into dst, which merges them
+    dst_state->unserialize(src);
 }
 
 
@@ -18,8 +18,12 @@
 #ifndef DORIS_BE_SRC_QUERY_EXPRS_HYBIRD_SET_H
 #define DORIS_BE_SRC_QUERY_EXPRS_HYBIRD_SET_H
 
+#include <algorithm>
 #include <cstring>
 #include <unordered_set>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 #include "common/status.h"
 #include "common/object_pool.h"
 #include "runtime/primitive_type.h"
@@ -27,6 +31,7 @@
 #include "runtime/datetime_value.h"
 #include "runtime/decimal_value.h"
 #include "runtime/decimalv2_value.h"
+#include "util/flat_hash_set.h"
 
 namespace doris {
 
@@ -133,6 +138,12 @@ private:
     ObjectPool _pool;
 };
 
+// Keys are copied into the arena of a FlatStringSet and probed as slices, so
+// find() never materializes a std::string. Lists of up to SMALL_SET_SIZE keys,
+// the usual "col IN ('a', 'b', 'c')" case, are probed by a linear scan instead:
+// the probe length is compared against all key lengths at once with SSE2, and
+// only keys of the same length are compared by their 8-byte prefix and then
+// bytewise, which is cheaper than hashing the probe.
 class StringValueSet : public HybirdSetBase {
 public:
     StringValueSet() {
@@ -143,65 +154,119 @@ public:
 
     virtual void insert(void* data) {
         StringValue* value = reinterpret_cast<StringValue*>(data);
-        std::string str_value(value->ptr, value->len);
-        _set.insert(str_value);
+        _insert(Slice(value->ptr, value->len));
     }
 
     void insert(HybirdSetBase* set) {
         StringValueSet* string_set =  reinterpret_cast<StringValueSet*>(set);
-        _set.insert(string_set->_set.begin(), string_set->_set.end());
+        string_set->_set.for_each([this](const Slice& value) {
+            _insert(value);
+        });
     }
 
     virtual int size() {
         return _set.size();
     }
+
     virtual bool find(void* data) {
         StringValue* value = reinterpret_cast<StringValue*>(data);
-        std::string str_value(value->ptr, value->len);
-        typename std::unordered_set<std::string>::iterator it = _set.find(str_value);
-
-        if (it == _set.end()) {
-            return false;
-        } else {
-            return true;
+        Slice key(value->ptr, value->len);
+        if (_set.size() <= SMALL_SET_SIZE) {
+            return _find_small(key);
         }
-
-        return false;
+        return _set.contains_with_hash(key, FlatStringSet::hash(key));
     }
 
     class Iterator : public IteratorBase {
     public:
-        Iterator(std::unordered_set<std::string>::iterator begin,
-                 std::unordered_set<std::string>::iterator end)
-            : _begin(begin),
-              _end(end) {
+        Iterator(FlatStringSet::Iterator iter) : _iter(iter) {
         }
         virtual ~Iterator() {
         }
         virtual bool has_next() const {
-            return !(_begin == _end);
+            return _iter.valid();
         }
         virtual const void* get_value() {
-            _value.ptr = const_cast<char*>(_begin->data());
-            _value.len = _begin->length();
+            Slice key = _iter.get();
+            _value.ptr = key.data;
+            _value.len = key.size;
             return &_value;
         }
         virtual void next() {
-            ++_begin;
+            _iter.next();
         }
     private:
-        typename std::unordered_set<std::string>::iterator _begin;
-        typename std::unordered_set<std::string>::iterator _end;
+        FlatStringSet::Iterator _iter;
         StringValue _value;
     };
 
     IteratorBase* begin() {
-        return _pool.add(new(std::nothrow) Iterator(_set.begin(), _set.end()));
+        return _pool.add(new(std::nothrow) Iterator(_set.begin()));
     }
 
 private:
+    static const size_t SMALL_SET_SIZE = 16;
+
+    // Up to 8 leading bytes of 'key', zero padded.
+    static uint64_t _prefix(const Slice& key) {
+        uint64_t prefix = 0;
+        memcpy(&prefix, key.data, std::min(key.size, sizeof(prefix)));
+        return prefix;
+    }
+
+    void _insert(const Slice& key) {
+        Slice stored;
+        if (!_set.insert_with_hash(key, FlatStringSet::hash(key), &stored)
+                || _set.size() > SMALL_SET_SIZE) {
+            return;
+        }
+        size_t idx = _set.size() - 1;
+        _small_keys[idx] = stored;
+        _small_lens[idx] = stored.size;
+        _small_prefixes[idx] = _prefix(stored);
+    }
+
+    bool _find_small(const Slice& key) const {
+        const size_t num_keys = _set.size();
+        const uint64_t prefix = _prefix(key);
+        for (size_t base = 0; base < num_keys; base += 4) {
+            uint32_t candidates = 0;
+#ifdef __SSE2__
+            __m128i lens = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&_small_lens[base]));
+            __m128i probe = _mm_set1_epi32(static_cast<int32_t>(key.size));
+            candidates = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(lens, probe)));
+#else
+            for (size_t i = 0; i < 4; ++i) {
+                candidates |= (_small_lens[base + i] == key.size) << i;
+            }
+#endif
+            // lanes past num_keys compare against stale lengths, mask them out
+            if (num_keys - base < 4) {
+                candidates &= (1U << (num_keys - base)) - 1;
+            }
+            while (candidates != 0) {
+                size_t idx = base + __builtin_ctz(candidates);
+                candidates &= candidates - 1;
+                if (_small_prefixes[idx] != prefix) {
+                    continue;
+                }
+                if (key.size <= sizeof(prefix)
+                        || strings::memeq(_small_keys[idx].data + sizeof(prefix),
+                                          key.data + sizeof(prefix),
+                                          key.size - sizeof(prefix))) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
 
-    std::unordered_set<std::string> _set;
+    FlatStringSet _set;
+    // the first SMALL_SET_SIZE keys in insertion order, only probed while the
+    // set holds no more than that
+    Slice _small_keys[SMALL_SET_SIZE];
+    uint32_t _small_lens[SMALL_SET_SIZE] = {0};
+    uint64_t _small_prefixes[SMALL_SET_SIZE] = {0};
     ObjectPool _pool;
 };
 
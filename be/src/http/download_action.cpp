@@ -38,6 +38,7 @@
 #include "util/defer_op.h"
 #include "util/file_utils.h"
 #include "util/filesystem_util.h"
+#include "util/md5.h"
 #include "runtime/exec_env.h"
 
 using boost::filesystem::canonical;
@@ -48,6 +49,8 @@ const std::string FILE_PARAMETER = "file";
 const std::string DB_PARAMETER = "db";
 const std::string LABEL_PARAMETER = "label";
 const std::string TOKEN_PARAMETER = "token";
+const std::string ACQUIRE_MD5_PARAMETER = "acquire_md5";
+const int64_t READ_BUF_SIZE = 1024 * 1024;
 
 DownloadAction::DownloadAction(ExecEnv* exec_env, const std::vector<std::string>& allow_dirs) :
     _exec_env(exec_env),
@@ -86,6 +89,8 @@ void DownloadAction::handle_normal(
 
     if (FileUtils::is_dir(file_param)) {
         do_dir_response(file_param, req);
+    } else if (req->param(ACQUIRE_MD5_PARAMETER) == "true") {
+        do_md5_response(file_param, req);
     } else {
         do_file_response(file_param, req);
     }
@@ -157,6 +162,33 @@ void DownloadAction::do_dir_response(
     return;
 }
 
+void DownloadAction::do_md5_response(const std::string& file_path, HttpRequest *req) {
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        LOG(WARNING) << "Failed to open file: " << file_path;
+        HttpChannel::send_error(req, HttpStatus::NOT_FOUND);
+        return;
+    }
+    DeferOp close_fd(std::bind<void>(&close, fd));
+
+    Md5Digest md5;
+    std::unique_ptr<char[]> buf(new char[READ_BUF_SIZE]);
+    while (true) {
+        ssize_t n = read(fd, buf.get(), READ_BUF_SIZE);
+        if (n < 0) {
+            LOG(WARNING) << "Failed to read file: " << file_path;
+            HttpChannel::send_error(req, HttpStatus::INTERNAL_SERVER_ERROR);
+            return;
+        }
+        if (n == 0) {
+            break;
+        }
+        md5.update(buf.get(), n);
+    }
+    md5.digest();
+    HttpChannel::send_reply(req, md5.hex());
+}
+
 void DownloadAction::do_file_response(const std::string& file_path, HttpRequest *req) {
     // read file content and send response
     int fd = open(file_path.c_str(), O_RDONLY);
@@ -60,6 +60,8 @@ private:
 
     void do_file_response(const std::string& dir_path, HttpRequest *req);
     void do_dir_response(const std::string& dir_path, HttpRequest *req);
+    // replies the md5 of the file in hex, for the downloader to check the file
+    void do_md5_response(const std::string& file_path, HttpRequest *req);
 
     Status get_file_content(
             FILE* fp, char* buffer, int32_t buffer_size,
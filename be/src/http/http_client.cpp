@@ -167,14 +167,17 @@ Status HttpClient::execute(const std::function<bool(const void* data, size_t len
     return Status::OK();
 }
 
-Status HttpClient::download(const std::string& local_path) {
+Status HttpClient::download(const std::string& local_path,
+                            const std::function<void(const void* data, size_t length)>& on_data) {
     // set method to GET
     set_method(GET);
 
     // TODO(zc) Move this download speed limit outside to limit download speed
     // at system level
     curl_easy_setopt(_curl, CURLOPT_LOW_SPEED_LIMIT,
-                     config::download_low_speed_limit_kbps * 1024);
+                     _low_speed_limit >= 0
+                         ? (long)_low_speed_limit
+                         : (long)config::download_low_speed_limit_kbps * 1024);
     curl_easy_setopt(_curl, CURLOPT_LOW_SPEED_TIME, config::download_low_speed_time);
     curl_easy_setopt(_curl, CURLOPT_MAX_RECV_SPEED_LARGE,
                      config::max_download_speed_kbps * 1024);
@@ -186,7 +189,7 @@ Status HttpClient::download(const std::string& local_path) {
         return Status::InternalError("open file failed");
     }
     Status status;
-    auto callback = [&status, &fp, &local_path] (const void* data, size_t length) {
+    auto callback = [&status, &fp, &local_path, &on_data] (const void* data, size_t length) {
         auto res = fwrite(data, length, 1, fp.get());
         if (res != 1) {
             LOG(WARNING) << "fail to write data to file, file=" << local_path
@@ -194,6 +197,9 @@ Status HttpClient::download(const std::string& local_path) {
             status = Status::InternalError("fail to write data when download");
             return false;
         }
+        if (on_data) {
+            on_data(data, length);
+        }
         return true;
     };
     RETURN_IF_ERROR(execute(callback));
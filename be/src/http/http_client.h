@@ -18,6 +18,7 @@
 #pragma once
 
 #include <cstdio>
+#include <functional>
 #include <string>
 
 #include <curl/curl.h>
@@ -109,9 +110,18 @@ public:
         return execute();
     }
 
+    // a download slower than 'bytes_per_second' for download_low_speed_time
+    // seconds is aborted, config::download_low_speed_limit_kbps by default
+    void set_low_speed_limit(int64_t bytes_per_second) {
+        _low_speed_limit = bytes_per_second;
+    }
+
     // helper function to download a file, you can call this function to downlaod
     // a file to local_path 
-    Status download(const std::string& local_path);
+    // 'on_data', if set, is called with every piece of data once it is written,
+    // e.g. to checksum or rate limit the download
+    Status download(const std::string& local_path,
+                    const std::function<void(const void* data, size_t length)>& on_data = {});
 
     Status execute_post_request(const std::string& payload, std::string* response);
 
@@ -134,6 +144,7 @@ private:
     const HttpCallback* _callback = nullptr;
     char _error_buf[CURL_ERROR_SIZE];
     curl_slist *_header_list = nullptr;
+    int64_t _low_speed_limit = -1;
 };
 
 }
@@ -52,6 +52,11 @@ OLAPStatus BaseCompaction::compact() {
     // 5. add metric to base compaction
     DorisMetrics::base_compaction_deltas_total.increment(_input_rowsets.size());
     DorisMetrics::base_compaction_bytes_total.increment(_input_rowsets_size);
+    if (_tablet->compaction_policy() == SIZE_TIERED_COMPACTION) {
+        DorisMetrics::size_tiered_compaction_write_bytes.increment(_output_rowset->data_disk_size());
+    } else {
+        DorisMetrics::num_based_compaction_write_bytes.increment(_output_rowset->data_disk_size());
+    }
 
     return OLAP_SUCCESS;
 }
@@ -0,0 +1,187 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "olap/collect_iterator.h"
+
+#include "olap/row.h"
+
+namespace doris {
+
+CollectIterator::~CollectIterator() {
+    for (auto child : _children) {
+        delete child;
+    }
+}
+
+OLAPStatus CollectIterator::init(Reader* reader) {
+    _reader = reader;
+    // when aggregate is enabled or key_type is DUP_KEYS, we don't merge
+    // multiple data to aggregate for performance in user fetch
+    if (_reader->_reader_type == READER_QUERY && !_reader->_need_ordered_result &&
+            (_reader->_aggregation ||
+             _reader->_tablet->keys_type() == KeysType::DUP_KEYS)) {
+        _merge = false;
+    }
+    return OLAP_SUCCESS;
+}
+
+OLAPStatus CollectIterator::add_child(RowsetReaderSharedPtr rs_reader) {
+    std::unique_ptr<ChildCtx> child(new ChildCtx(rs_reader, _reader));
+    RETURN_NOT_OK(child->init());
+    if (child->current_row() == nullptr) {
+        return OLAP_SUCCESS;
+    }
+
+    ChildCtx* child_ptr = child.release();
+    _children.push_back(child_ptr);
+    if (!_merge && _cur_child == nullptr) {
+        _cur_child = _children[_child_idx];
+    }
+    return OLAP_SUCCESS;
+}
+
+void CollectIterator::build_merge_tree() {
+    if (!_merge || _children.empty()) {
+        return;
+    }
+    _loser_tree.resize(_children.size());
+    _loser_tree[0] = _play(1);
+    _cur_child = _children[_loser_tree[0]];
+    _in_block_run = false;
+}
+
+int CollectIterator::_play(size_t node) {
+    size_t num_children = _children.size();
+    if (node >= num_children) {
+        return node - num_children;
+    }
+    int winner = _play(2 * node);
+    int loser = _play(2 * node + 1);
+    if (_less(loser, winner)) {
+        std::swap(winner, loser);
+    }
+    _loser_tree[node] = loser;
+    return winner;
+}
+
+inline bool CollectIterator::_less(int a, int b) const {
+    const RowCursor* first = _children[a]->current_row();
+    const RowCursor* second = _children[b]->current_row();
+    if (second == nullptr) {
+        return first != nullptr;
+    }
+    if (first == nullptr) {
+        return false;
+    }
+    int cmp_res = compare_row(*first, *second);
+    if (cmp_res != 0) {
+        return cmp_res < 0;
+    }
+    // if row cursors equal, compare data version.
+    return _children[a]->version() < _children[b]->version();
+}
+
+inline void CollectIterator::_replay(int child) {
+    int winner = child;
+    for (size_t node = (child + _children.size()) / 2; node > 0; node /= 2) {
+        if (_less(_loser_tree[node], winner)) {
+            std::swap(_loser_tree[node], winner);
+        }
+    }
+    _loser_tree[0] = winner;
+}
+
+bool CollectIterator::_winner_owns_block() {
+    int winner = _loser_tree[0];
+    // the runner-up only lost to the winner, so it's one of the losers on the
+    // winner's path
+    int runner_up = -1;
+    for (size_t node = (winner + _children.size()) / 2; node > 0; node /= 2) {
+        if (runner_up < 0 || _less(_loser_tree[node], runner_up)) {
+            runner_up = _loser_tree[node];
+        }
+    }
+    if (runner_up < 0 || _children[runner_up]->current_row() == nullptr) {
+        return true;
+    }
+    ChildCtx* child = _children[winner];
+    int cmp_res = compare_row(*child->block_last_row(), *_children[runner_up]->current_row());
+    return cmp_res < 0 || (cmp_res == 0 && child->version() < _children[runner_up]->version());
+}
+
+inline OLAPStatus CollectIterator::_merge_next(const RowCursor** row, bool* delete_flag) {
+    int winner = _loser_tree[0];
+    uint64_t block_seq = _cur_child->block_seq();
+    auto res = _cur_child->next(row, delete_flag);
+    if (UNLIKELY(res != OLAP_SUCCESS && res != OLAP_ERR_DATA_EOF)) {
+        LOG(WARNING) << "failed to get next from child, res=" << res;
+        return res;
+    }
+    if (_in_block_run && res == OLAP_SUCCESS && _cur_child->block_seq() == block_seq) {
+        return OLAP_SUCCESS;
+    }
+
+    _replay(winner);
+    _cur_child = _children[_loser_tree[0]];
+    if (_cur_child->current_row() == nullptr) {
+        // all children reach EOF
+        _cur_child = nullptr;
+        *row = nullptr;
+        return OLAP_ERR_DATA_EOF;
+    }
+    // only look for a run when a child wins twice in a row, as computing the
+    // runner-up costs about as much as a replay
+    _in_block_run = _loser_tree[0] == winner && _winner_owns_block();
+    *row = _cur_child->current_row(delete_flag);
+    return OLAP_SUCCESS;
+}
+
+inline OLAPStatus CollectIterator::_normal_next(const RowCursor** row, bool* delete_flag) {
+    auto res = _cur_child->next(row, delete_flag);
+    if (LIKELY(res == OLAP_SUCCESS)) {
+        return OLAP_SUCCESS;
+    } else if (res == OLAP_ERR_DATA_EOF) {
+        // this child has been read, to read next
+        _child_idx++;
+        if (_child_idx < _children.size()) {
+            _cur_child = _children[_child_idx];
+            *row = _cur_child->current_row(delete_flag);
+            return OLAP_SUCCESS;
+        } else {
+            _cur_child = nullptr;
+            return OLAP_ERR_DATA_EOF;
+        }
+    } else {
+        LOG(WARNING) << "failed to get next from child, res=" << res;
+        return res;
+    }
+}
+
+void CollectIterator::clear() {
+    _loser_tree.clear();
+    _in_block_run = false;
+    for (auto child : _children) {
+        delete child;
+    }
+    // _children.swap(std::vector<ChildCtx*>());
+    _children.clear();
+    _cur_child = nullptr;
+    _child_idx = 0;
+}
+
+}  // namespace doris
@@ -0,0 +1,213 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#ifndef DORIS_BE_SRC_OLAP_COLLECT_ITERATOR_H
+#define DORIS_BE_SRC_OLAP_COLLECT_ITERATOR_H
+
+#include <vector>
+
+#include "olap/olap_define.h"
+#include "olap/reader.h"
+#include "olap/row_block.h"
+#include "olap/row_cursor.h"
+#include "olap/rowset/rowset_reader.h"
+
+namespace doris {
+
+// Returns the rows of the rowset readers of a Reader, merged into the key order
+// unless the reader doesn't need ordered rows.
+class CollectIterator {
+public:
+    ~CollectIterator();
+
+    // Hold reader point to get reader params,
+    // set reverse to true if need read in reverse order.
+    OLAPStatus init(Reader* reader);
+
+    OLAPStatus add_child(RowsetReaderSharedPtr rs_reader);
+
+    // Called after all children are added, before reading any row.
+    void build_merge_tree();
+
+    // Get top row of the merge tree, NULL if reach end.
+    const RowCursor* current_row(bool* delete_flag) const {
+        if (_cur_child != nullptr) {
+            return _cur_child->current_row(delete_flag);
+        }
+        return nullptr;
+    }
+
+    // Read next row into *row.
+    // Returns
+    //      OLAP_SUCCESS when read successfully.
+    //      OLAP_ERR_DATA_EOF and set *row to nullptr when EOF is reached.
+    //      Others when error happens
+    OLAPStatus next(const RowCursor** row, bool* delete_flag) {
+        DCHECK(_cur_child != nullptr);
+        if (_merge) {
+            return _merge_next(row, delete_flag);
+        } else {
+            return _normal_next(row, delete_flag);
+        }
+    }
+
+    // Clear the MergeSet element and reset state.
+    void clear();
+
+private:
+    friend class CollectIteratorTest;
+
+    class ChildCtx {
+    public:
+        ChildCtx(RowsetReaderSharedPtr rs_reader, Reader* reader)
+                : _rs_reader(rs_reader),
+                  _is_delete(rs_reader->delete_flag()),
+                  _reader(reader) { }
+
+        OLAPStatus init() {
+            auto res = _row_cursor.init(_reader->_tablet->tablet_schema(), _reader->_seek_columns);
+            if (res != OLAP_SUCCESS) {
+                LOG(WARNING) << "failed to init row cursor, res=" << res;
+                return res;
+            }
+            res = _last_row_cursor.init(_reader->_tablet->tablet_schema(), _reader->_seek_columns);
+            if (res != OLAP_SUCCESS) {
+                LOG(WARNING) << "failed to init row cursor, res=" << res;
+                return res;
+            }
+            RETURN_NOT_OK(_refresh_current_row());
+            return OLAP_SUCCESS;
+        }
+
+        const RowCursor* current_row(bool* delete_flag) const {
+            *delete_flag = _is_delete;
+            return _current_row;
+        }
+
+        const RowCursor* current_row() const {
+            return _current_row;
+        }
+
+        int32_t version() const {
+            return _rs_reader->version().second;
+        }
+
+        // Changes whenever the child moves to another block.
+        uint64_t block_seq() const {
+            return _block_seq;
+        }
+
+        // The last row of the current block, no row of the block comes after it.
+        const RowCursor* block_last_row() {
+            _row_block->get_row(_row_block->limit() - 1, &_last_row_cursor);
+            return &_last_row_cursor;
+        }
+
+        OLAPStatus next(const RowCursor** row, bool* delete_flag) {
+            _row_block->pos_inc();
+            auto res = _refresh_current_row();
+            *row = _current_row;
+            *delete_flag = _is_delete;
+            return res;
+        }
+
+    private:
+        // refresh_current_row
+        OLAPStatus _refresh_current_row() {
+            do {
+                if (_row_block != nullptr && _row_block->has_remaining()) {
+                    size_t pos = _row_block->pos();
+                    _row_block->get_row(pos, &_row_cursor);
+                    if (_row_block->block_status() == DEL_PARTIAL_SATISFIED &&
+                        _reader->_delete_handler.is_filter_data(_rs_reader->version().second, _row_cursor)) {
+                        _reader->_stats.rows_del_filtered++;
+                        _row_block->pos_inc();
+                        continue;
+                    }
+                    _current_row = &_row_cursor;
+                    return OLAP_SUCCESS;
+                } else {
+                    auto res = _rs_reader->next_block(&_row_block);
+                    ++_block_seq;
+                    if (res != OLAP_SUCCESS) {
+                        _current_row = nullptr;
+                        return res;
+                    }
+                }
+            } while (_row_block != nullptr);
+            _current_row = nullptr;
+            return OLAP_ERR_DATA_EOF;
+        }
+
+        RowsetReaderSharedPtr _rs_reader;
+        const RowCursor* _current_row = nullptr;
+        bool _is_delete = false;
+        Reader* _reader;
+
+        RowCursor _row_cursor; // point to rows inside `_row_block`
+        RowCursor _last_row_cursor;
+        RowBlock* _row_block = nullptr;
+        uint64_t _block_seq = 0;
+    };
+
+    inline OLAPStatus _merge_next(const RowCursor** row, bool* delete_flag);
+    inline OLAPStatus _normal_next(const RowCursor** row, bool* delete_flag);
+
+    // Whether the row of child 'a' comes before the row of child 'b': the smaller
+    // key first, and the lower version first among equal keys. A child at EOF comes
+    // after all others.
+    inline bool _less(int a, int b) const;
+    // Plays the matches of the subtree at 'node' and returns its winner.
+    int _play(size_t node);
+    // Replays the matches from the leaf of child 'child' up to the root after its
+    // row changed.
+    inline void _replay(int child);
+    // Whether all the rows left in the current block of the winner come before the
+    // rows of all the other children.
+    bool _winner_owns_block();
+
+    // each ChildCtx corresponds to a rowset reader
+    std::vector<ChildCtx*> _children;
+    // point to the ChildCtx containing the next output row.
+    // null when CollectIterator hasn't been initialized or reaches EOF.
+    ChildCtx* _cur_child = nullptr;
+
+    // when `_merge == true`, rowset reader returns ordered rows and CollectIterator uses a loser tree to merge
+    // sort them. The output of CollectIterator is also ordered.
+    // When `_merge == false`, rowset reader returns *partial* ordered rows. CollectIterator simply returns all rows
+    // from the first rowset, the second rowset, .., the last rowset. The output of CollectorIterator is also
+    // *partially* ordered.
+    bool _merge = true;
+    // used when `_merge == true`. A loser tree over `_children`: _loser_tree[0] is the
+    // index of the child with the smallest row, each inner node 1..n-1 holds the loser
+    // of the match played there, and the child i is the leaf n + i. So taking a row
+    // from the winner replays one match per level instead of a heap pop and push.
+    std::vector<int> _loser_tree;
+    // when a block of the winner comes before all the other children, its rows are
+    // returned one by one without comparing, until the block is used up.
+    bool _in_block_run = false;
+    // used when `_merge == false`
+    int _child_idx = 0;
+
+    // Hold reader point to access read params, such as fetch conditions.
+    Reader* _reader = nullptr;
+};
+
+}  // namespace doris
+
+#endif // DORIS_BE_SRC_OLAP_COLLECT_ITERATOR_H
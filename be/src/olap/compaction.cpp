@@ -15,9 +15,16 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include "common/config.h"
 #include "gutil/strings/substitute.h"
 #include "olap/compaction.h"
+#include "olap/row_cursor.h"
 #include "olap/rowset/rowset_factory.h"
+#include "util/count_down_latch.hpp"
+#include "util/io_scheduler.h"
+#include "util/thread_pool.hpp"
+
+#include <algorithm>
 
 using std::vector;
 
@@ -36,6 +43,7 @@ OLAPStatus Compaction::do_compaction() {
     LOG(INFO) << "start " << compaction_name() << ". tablet=" << _tablet->full_name();
 
     OlapStopWatch watch;
+    ScopedIOClass io_class(_tablet->data_dir()->io_scheduler(), _io_class());
 
     // 1. prepare input and output parameters
     int64_t segments_num = 0;
@@ -52,7 +60,14 @@ OLAPStatus Compaction::do_compaction() {
 
     // 2. write merged rows to output rowset
     Merger::Statistics stats;
-    auto res = Merger::merge_rowsets(_tablet, compaction_type(), _input_rs_readers, _output_rs_writer.get(), &stats);
+    std::vector<OlapTuple> key_ranges;
+    _split_key_ranges(&key_ranges);
+    OLAPStatus res = OLAP_SUCCESS;
+    if (key_ranges.empty()) {
+        res = Merger::merge_rowsets(_tablet, compaction_type(), _input_rs_readers, _output_rs_writer.get(), &stats);
+    } else {
+        res = _merge_key_ranges(key_ranges, &stats);
+    }
     if (res != OLAP_SUCCESS) {
         LOG(WARNING) << "fail to do " << compaction_name()
                      << ". res=" << res
@@ -81,12 +96,17 @@ OLAPStatus Compaction::do_compaction() {
               << ", output_version=" << _output_version.first
               << "-" << _output_version.second
               << ", segments=" << segments_num
+              << ", key_ranges=" << std::max<size_t>(1, key_ranges.size() / 2)
               << ". elapsed time=" << watch.get_elapse_second() << "s.";
 
     return OLAP_SUCCESS;
 }
 
 OLAPStatus Compaction::construct_output_rowset_writer() {
+    return _construct_rowset_writer(&_output_rs_writer);
+}
+
+OLAPStatus Compaction::_construct_rowset_writer(std::unique_ptr<RowsetWriter>* rowset_writer) {
     RowsetWriterContext context;
     context.rowset_id = StorageEngine::instance()->next_rowset_id();
     context.tablet_uid = _tablet->tablet_uid();
@@ -99,10 +119,135 @@ OLAPStatus Compaction::construct_output_rowset_writer() {
     context.rowset_state = VISIBLE;
     context.version = _output_version;
     context.version_hash = _output_version_hash;
-    RETURN_NOT_OK(RowsetFactory::create_rowset_writer(context, &_output_rs_writer));
+    RETURN_NOT_OK(RowsetFactory::create_rowset_writer(context, rowset_writer));
     return OLAP_SUCCESS;
 }
 
+// A large compaction is split into ranges of about the same number of rows by the
+// short key index of its largest input rowset. The ranges are consecutive pairs of
+// `ranges`, which is left empty if the compaction merges on one thread.
+void Compaction::_split_key_ranges(std::vector<OlapTuple>* ranges) {
+    int num_ranges = config::compaction_parallel_merge_num_ranges;
+    // the segments of a singleton rowset may overlap, so the key ranges could not
+    // become the segments of the output rowset. An ALPHA rowset can't be built from
+    // others either, it would link the segment group 0 of every range to the same files.
+    if (num_ranges <= 1 || _input_rowsets_size < config::compaction_parallel_merge_min_bytes
+            || _output_version.first == _output_version.second
+            || StorageEngine::instance()->compaction_rowset_type() != BETA_ROWSET) {
+        return;
+    }
+
+    RowsetSharedPtr largest_rowset;
+    for (auto& rowset : _input_rowsets) {
+        if (largest_rowset == nullptr
+                || rowset->data_disk_size() > largest_rowset->data_disk_size()) {
+            largest_rowset = rowset;
+        }
+    }
+    RowCursor start_key;
+    RowCursor end_key;
+    if (start_key.init(_tablet->tablet_schema(), _tablet->num_short_key_columns()) != OLAP_SUCCESS
+            || end_key.init(_tablet->tablet_schema(), _tablet->num_short_key_columns()) != OLAP_SUCCESS) {
+        LOG(WARNING) << "fail to init key cursors. tablet=" << _tablet->full_name();
+        return;
+    }
+    start_key.allocate_memory_for_string_type(_tablet->tablet_schema());
+    start_key.build_min_key();
+    end_key.allocate_memory_for_string_type(_tablet->tablet_schema());
+    end_key.build_max_key();
+
+    std::vector<OlapTuple> split_ranges;
+    uint64_t rows_per_range = std::max<uint64_t>(1, largest_rowset->num_rows() / num_ranges);
+    OLAPStatus res = largest_rowset->split_range(start_key, end_key, rows_per_range, &split_ranges);
+    if (res != OLAP_SUCCESS) {
+        LOG(WARNING) << "fail to split key ranges, merge on one thread. res=" << res
+                     << ", tablet=" << _tablet->full_name();
+        return;
+    }
+    if (split_ranges.size() > 2) {
+        ranges->swap(split_ranges);
+    }
+}
+
+// Merges each key range into a rowset of its own on the compaction merge pool. The
+// range rowsets are then linked into the output rowset in key order, one after
+// another, so they become its segments and the compaction still commits one rowset.
+OLAPStatus Compaction::_merge_key_ranges(const std::vector<OlapTuple>& ranges,
+                                         Merger::Statistics* stats) {
+    size_t num_ranges = ranges.size() / 2;
+    std::vector<std::unique_ptr<RowsetWriter>> range_writers(num_ranges);
+    for (auto& range_writer : range_writers) {
+        RETURN_NOT_OK(_construct_rowset_writer(&range_writer));
+    }
+
+    std::vector<Merger::Statistics> range_stats(num_ranges);
+    std::vector<OLAPStatus> range_results(num_ranges, OLAP_SUCCESS);
+    CountDownLatch latch(num_ranges);
+    ThreadPool* thread_pool = StorageEngine::instance()->compaction_merge_thread_pool();
+    for (size_t i = 0; i < num_ranges; ++i) {
+        auto merge_range = [this, &ranges, &range_writers, &range_stats, &range_results,
+                            &latch, num_ranges, i] {
+            _merge_key_range(ranges[2 * i], ranges[2 * i + 1], i + 1 == num_ranges,
+                             range_writers[i].get(), &range_stats[i], &range_results[i]);
+            latch.count_down();
+        };
+        // the pool is only shut down with the engine
+        if (!thread_pool->offer(merge_range)) {
+            merge_range();
+        }
+    }
+    latch.await();
+
+    OLAPStatus res = OLAP_SUCCESS;
+    std::vector<RowsetSharedPtr> range_rowsets;
+    for (size_t i = 0; i < num_ranges; ++i) {
+        if (range_results[i] != OLAP_SUCCESS) {
+            LOG(WARNING) << "fail to merge key range " << i << " of " << compaction_name()
+                         << ". res=" << range_results[i] << ", tablet=" << _tablet->full_name();
+            res = range_results[i];
+            break;
+        }
+        RowsetSharedPtr range_rowset = range_writers[i]->build();
+        if (range_rowset == nullptr) {
+            LOG(WARNING) << "rowset writer build failed. key range " << i
+                         << ", tablet=" << _tablet->full_name();
+            res = OLAP_ERR_MALLOC_ERROR;
+            break;
+        }
+        range_rowsets.push_back(range_rowset);
+        stats->output_rows += range_stats[i].output_rows;
+        stats->merged_rows += range_stats[i].merged_rows;
+        stats->filtered_rows += range_stats[i].filtered_rows;
+    }
+
+    for (auto& range_rowset : range_rowsets) {
+        if (res == OLAP_SUCCESS) {
+            res = _output_rs_writer->add_rowset(range_rowset);
+        }
+        // the output rowset has links of its own to the files
+        StorageEngine::instance()->add_unused_rowset(range_rowset);
+    }
+    return res;
+}
+
+void Compaction::_merge_key_range(const OlapTuple& start_key, const OlapTuple& end_key,
+                                  bool end_key_included, RowsetWriter* rowset_writer,
+                                  Merger::Statistics* stats, OLAPStatus* res) {
+    ScopedIOClass io_class(_tablet->data_dir()->io_scheduler(), _io_class());
+    // rowset readers hold the read position, each range needs its own
+    std::vector<RowsetReaderSharedPtr> rs_readers;
+    for (auto& rowset : _input_rowsets) {
+        RowsetReaderSharedPtr rs_reader;
+        *res = rowset->create_reader(&rs_reader);
+        if (*res != OLAP_SUCCESS) {
+            return;
+        }
+        rs_readers.push_back(std::move(rs_reader));
+    }
+    *res = Merger::merge_rowsets(_tablet, compaction_type(), rs_readers, start_key, end_key,
+                                 end_key_included, rowset_writer, stats);
+}
+
 OLAPStatus Compaction::construct_input_rowset_readers() {
     for (auto& rowset : _input_rowsets) {
         RowsetReaderSharedPtr rs_reader;
@@ -150,6 +295,11 @@ OLAPStatus Compaction::gc_unused_rowsets() {
     return OLAP_SUCCESS;
 }
 
+IOScheduler::IOClass Compaction::_io_class() const {
+    return compaction_type() == READER_BASE_COMPACTION ? IOScheduler::IO_CLASS_BASE_COMPACTION
+                                                        : IOScheduler::IO_CLASS_CUMULATIVE_COMPACTION;
+}
+
 OLAPStatus Compaction::check_version_continuity(const vector<RowsetSharedPtr>& rowsets) {
     RowsetSharedPtr prev_rowset = rowsets.front();
     for (size_t i = 1; i < rowsets.size(); ++i) {
@@ -28,6 +28,7 @@
 #include "olap/tablet_meta.h"
 #include "olap/utils.h"
 #include "rowset/rowset_id_generator.h"
+#include "util/io_scheduler.h"
 
 namespace doris {
 
@@ -63,6 +64,16 @@ protected:
     OLAPStatus check_version_continuity(const std::vector<RowsetSharedPtr>& rowsets);
     OLAPStatus check_correctness(const Merger::Statistics& stats);
 
+private:
+    OLAPStatus _construct_rowset_writer(std::unique_ptr<RowsetWriter>* rowset_writer);
+    void _split_key_ranges(std::vector<OlapTuple>* ranges);
+    OLAPStatus _merge_key_ranges(const std::vector<OlapTuple>& ranges, Merger::Statistics* stats);
+    // merges the rows of the input rowsets in one key range, `res` is its result
+    void _merge_key_range(const OlapTuple& start_key, const OlapTuple& end_key,
+                          bool end_key_included, RowsetWriter* rowset_writer,
+                          Merger::Statistics* stats, OLAPStatus* res);
+    IOScheduler::IOClass _io_class() const;
+
 protected:
     TabletSharedPtr _tablet;
 
@@ -16,6 +16,7 @@
 // under the License.
 
 #include "olap/cumulative_compaction.h"
+#include "olap/size_tiered_compaction_policy.h"
 #include "util/doris_metrics.h"
 
 namespace doris {
@@ -51,14 +52,24 @@ OLAPStatus CumulativeCompaction::compact() {
     _state = CompactionState::SUCCESS;
 
     // 5. set cumulative point
-    _tablet->set_cumulative_layer_point(_input_rowsets.back()->end_version() + 1);
-    
+    if (_tablet->compaction_policy() == SIZE_TIERED_COMPACTION) {
+        // the output stays above the point until it grows big enough for base compaction
+        _update_size_tiered_cumulative_point();
+    } else {
+        _tablet->set_cumulative_layer_point(_input_rowsets.back()->end_version() + 1);
+    }
+
     // 6. garbage collect input rowsets after cumulative compaction 
     RETURN_NOT_OK(gc_unused_rowsets());
 
     // 7. add metric to cumulative compaction
     DorisMetrics::cumulative_compaction_deltas_total.increment(_input_rowsets.size());
     DorisMetrics::cumulative_compaction_bytes_total.increment(_input_rowsets_size);
+    if (_tablet->compaction_policy() == SIZE_TIERED_COMPACTION) {
+        DorisMetrics::size_tiered_compaction_write_bytes.increment(_output_rowset->data_disk_size());
+    } else {
+        DorisMetrics::num_based_compaction_write_bytes.increment(_output_rowset->data_disk_size());
+    }
 
     return OLAP_SUCCESS;
 }
@@ -74,6 +85,10 @@ OLAPStatus CumulativeCompaction::pick_rowsets_to_compact() {
     std::sort(candidate_rowsets.begin(), candidate_rowsets.end(), Rowset::comparator);
     RETURN_NOT_OK(check_version_continuity(candidate_rowsets));
 
+    if (_tablet->compaction_policy() == SIZE_TIERED_COMPACTION) {
+        return _pick_size_tiered_rowsets(candidate_rowsets);
+    }
+
     std::vector<RowsetSharedPtr> transient_rowsets;
     size_t num_overlapping_segments = 0;
     for (size_t i = 0; i < candidate_rowsets.size() - 1; ++i) {
@@ -120,5 +135,40 @@ OLAPStatus CumulativeCompaction::pick_rowsets_to_compact() {
     return OLAP_SUCCESS;
 }
 
+OLAPStatus CumulativeCompaction::_pick_size_tiered_rowsets(
+        const std::vector<RowsetSharedPtr>& candidate_rowsets) {
+    std::vector<RowsetMetaSharedPtr> rs_metas;
+    for (auto& rowset : candidate_rowsets) {
+        rs_metas.push_back(rowset->rowset_meta());
+    }
+    SizeTieredCompactionPolicy policy;
+    size_t start = 0;
+    size_t end = 0;
+    if (!policy.pick_rowsets(rs_metas, &start, &end)) {
+        // nothing to merge, but the big rowsets may still go to base compaction
+        _tablet->set_cumulative_layer_point(
+            policy.calc_cumulative_point(rs_metas, _tablet->cumulative_layer_point()));
+        return OLAP_ERR_CUMULATIVE_NO_SUITABLE_VERSIONS;
+    }
+    _input_rowsets.assign(candidate_rowsets.begin() + start, candidate_rowsets.begin() + end);
+    VLOG(3) << "pick size tiered rowsets. tablet=" << _tablet->full_name()
+            << ", level=" << policy.level(_input_rowsets.front()->data_disk_size())
+            << ", version=" << _input_rowsets.front()->start_version()
+            << "-" << _input_rowsets.back()->end_version();
+    return OLAP_SUCCESS;
+}
+
+void CumulativeCompaction::_update_size_tiered_cumulative_point() {
+    std::vector<RowsetSharedPtr> rowsets;
+    _tablet->pick_candicate_rowsets_to_cumulative_compaction(&rowsets);
+    std::sort(rowsets.begin(), rowsets.end(), Rowset::comparator);
+    std::vector<RowsetMetaSharedPtr> rs_metas;
+    for (auto& rowset : rowsets) {
+        rs_metas.push_back(rowset->rowset_meta());
+    }
+    _tablet->set_cumulative_layer_point(SizeTieredCompactionPolicy().calc_cumulative_point(
+        rs_metas, _tablet->cumulative_layer_point()));
+}
+
 }  // namespace doris
 
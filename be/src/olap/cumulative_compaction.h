@@ -19,6 +19,7 @@
 #define DORIS_BE_SRC_OLAP_CUMULATIVE_COMPACTION_H
 
 #include <string>
+#include <vector>
 
 #include "olap/compaction.h"
 
@@ -44,6 +45,10 @@ protected:
 
 
 private:
+    // 'candidate_rowsets' are sorted by version
+    OLAPStatus _pick_size_tiered_rowsets(const std::vector<RowsetSharedPtr>& candidate_rowsets);
+    void _update_size_tiered_cumulative_point();
+
     int64_t _cumulative_rowset_size_threshold;
 
     DISALLOW_COPY_AND_ASSIGN(CumulativeCompaction);
@@ -37,13 +37,16 @@
 #include <boost/filesystem.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
+#include "common/config.h"
 #include "env/env.h"
 #include "olap/file_helper.h"
 #include "olap/olap_define.h"
 #include "olap/olap_snapshot_converter.h"
 #include "olap/utils.h" // for check_dir_existed
 #include "service/backend_options.h"
+#include "util/doris_metrics.h"
 #include "util/file_utils.h"
+#include "util/stopwatch.hpp"
 #include "util/string_util.h"
 #include "olap/tablet_meta_manager.h"
 #include "olap/rowset/rowset_meta_manager.h"
@@ -54,6 +57,8 @@ namespace doris {
 
 static const char* const kMtabPath = "/etc/mtab";
 static const char* const kTestFilePath = "/.testfile";
+// the number of tablet metas created in parallel and added to the tablet map at once
+static const size_t LOAD_TABLET_BATCH_SIZE = 4096;
 
 DataDir::DataDir(const std::string& path, int64_t capacity_bytes,
         TabletManager* tablet_manager, TxnManager* txn_manager)
@@ -69,10 +74,17 @@ DataDir::DataDir(const std::string& path, int64_t capacity_bytes,
         _current_shard(0),
         _test_file_read_buf(nullptr),
         _test_file_write_buf(nullptr),
-        _meta(nullptr) {
+        _meta(nullptr),
+        _io_scheduler(new IOScheduler(path, config::storage_background_io_bytes_per_sec,
+                                      config::storage_io_auto_tune)) {
 }
 
 DataDir::~DataDir() {
+    if (_registry != nullptr) {
+        _registry->deregister_metric(&_load_rowset_metas_ms);
+        _registry->deregister_metric(&_load_tablets_ms);
+        _registry->deregister_metric(&_load_rowsets_ms);
+    }
     free(_test_file_read_buf);
     free(_test_file_write_buf);
     delete _id_generator;
@@ -108,6 +120,8 @@ Status DataDir::init() {
     RETURN_IF_ERROR(_init_extension_and_capacity());
     RETURN_IF_ERROR(_init_file_system());
     RETURN_IF_ERROR(_init_meta());
+    _io_scheduler->register_metrics(DorisMetrics::metrics());
+    _register_metrics(DorisMetrics::metrics());
 
     _is_used = true;
     return Status::OK();
@@ -417,6 +431,7 @@ OLAPStatus DataDir::deregister_tablet(Tablet* tablet) {
 
     TabletInfo tablet_info(tablet->tablet_id(), tablet->schema_hash(), tablet->tablet_uid());
     _tablet_set.erase(tablet_info);
+    _remove_compaction_candidate_unlock(tablet_info);
     return OLAP_SUCCESS;
 }
 
@@ -425,6 +440,54 @@ void DataDir::clear_tablets(std::vector<TabletInfo>* tablet_infos) {
         tablet_infos->push_back(tablet);
     }
     _tablet_set.clear();
+    _compaction_scores.clear();
+    _cumulative_candidates.clear();
+    _base_candidates.clear();
+}
+
+void DataDir::update_compaction_scores(const TabletInfo& tablet_info,
+                                       uint32_t cumulative_score, uint32_t base_score) {
+    std::lock_guard<std::mutex> l(_mutex);
+    // a tablet may still change after it is dropped
+    if (_tablet_set.count(tablet_info) == 0) {
+        return;
+    }
+    _remove_compaction_candidate_unlock(tablet_info);
+    if (cumulative_score == 0 && base_score == 0) {
+        return;
+    }
+    _compaction_scores.emplace(tablet_info, std::make_pair(cumulative_score, base_score));
+    if (cumulative_score > 0) {
+        _cumulative_candidates.emplace(cumulative_score, tablet_info);
+    }
+    if (base_score > 0) {
+        _base_candidates.emplace(base_score, tablet_info);
+    }
+}
+
+bool DataDir::next_compaction_candidate(CompactionType compaction_type,
+                                        const CompactionCandidate* prev,
+                                        CompactionCandidate* next) {
+    std::lock_guard<std::mutex> l(_mutex);
+    const std::set<CompactionCandidate>& candidates =
+        compaction_type == CompactionType::CUMULATIVE_COMPACTION
+            ? _cumulative_candidates : _base_candidates;
+    auto it = prev == nullptr ? candidates.begin() : candidates.upper_bound(*prev);
+    if (it == candidates.end()) {
+        return false;
+    }
+    *next = *it;
+    return true;
+}
+
+void DataDir::_remove_compaction_candidate_unlock(const TabletInfo& tablet_info) {
+    auto it = _compaction_scores.find(tablet_info);
+    if (it == _compaction_scores.end()) {
+        return;
+    }
+    _cumulative_candidates.erase(CompactionCandidate(it->second.first, tablet_info));
+    _base_candidates.erase(CompactionCandidate(it->second.second, tablet_info));
+    _compaction_scores.erase(it);
 }
 
 std::string DataDir::get_absolute_shard_path(const std::string& shard_string) {
@@ -680,6 +743,20 @@ OLAPStatus DataDir::set_convert_finished() {
     return OLAP_SUCCESS;
 }
 
+void DataDir::_register_metrics(MetricRegistry* registry) {
+    _registry = registry;
+    // the time each phase of load() took at startup
+    registry->register_metric("data_dir_load_duration_ms",
+                              MetricLabels().add("path", _path).add("phase", "rowset_metas"),
+                              &_load_rowset_metas_ms);
+    registry->register_metric("data_dir_load_duration_ms",
+                              MetricLabels().add("path", _path).add("phase", "tablets"),
+                              &_load_tablets_ms);
+    registry->register_metric("data_dir_load_duration_ms",
+                              MetricLabels().add("path", _path).add("phase", "rowsets"),
+                              &_load_rowsets_ms);
+}
+
 // TODO(ygl): deal with rowsets and tablets when load failed
 OLAPStatus DataDir::load() {
     LOG(INFO) << "start to load tablets from " << _path;
@@ -687,6 +764,8 @@ OLAPStatus DataDir::load() {
     // COMMITTED: add to txn manager
     // VISIBLE: add to tablet
     // if one rowset load failed, then the total data dir will not be loaded
+    MonotonicStopWatch watch;
+    watch.start();
     std::vector<RowsetMetaSharedPtr> dir_rowset_metas;
     LOG(INFO) << "begin loading rowset from meta";
     auto load_rowset_func = [this, &dir_rowset_metas](TabletUid tablet_uid, RowsetId rowset_id,
@@ -710,28 +789,33 @@ OLAPStatus DataDir::load() {
         LOG(INFO) << "load rowset from meta finished, data dir: " << _path;
     }
 
+    _load_rowset_metas_ms.set_value(watch.reset() / 1000 / 1000);
+
     // load tablet
     // create tablet from tablet meta and add it to tablet mgr
+    // The metas are read from the meta env in batches, the tablets of a batch are
+    // created in parallel, see TabletManager::load_tablets_from_meta().
     LOG(INFO) << "begin loading tablet from meta";
     std::set<int64_t> tablet_ids;
-    auto load_tablet_func = [this, &tablet_ids](int64_t tablet_id,
+    std::vector<TabletMetaBinary> tablet_metas;
+    auto load_tablet_func = [this, &tablet_ids, &tablet_metas](int64_t tablet_id,
         int32_t schema_hash, const std::string& value) -> bool {
-        OLAPStatus status = _tablet_manager->load_tablet_from_meta(
-                                this, tablet_id, schema_hash, value, false, false);
-        if (status != OLAP_SUCCESS) {
-            LOG(WARNING) << "load tablet from header failed. status:" << status
-                << ", tablet=" << tablet_id << "." << schema_hash;
-        } else {
-            tablet_ids.insert(tablet_id);
+        tablet_metas.push_back({tablet_id, schema_hash, value});
+        if (tablet_metas.size() >= LOAD_TABLET_BATCH_SIZE) {
+            _tablet_manager->load_tablets_from_meta(this, tablet_metas, &tablet_ids);
+            tablet_metas.clear();
         }
         return true;
     };
     OLAPStatus load_tablet_status = TabletMetaManager::traverse_headers(_meta, load_tablet_func);
+    _tablet_manager->load_tablets_from_meta(this, tablet_metas, &tablet_ids);
     if (load_tablet_status != OLAP_SUCCESS) {
         LOG(WARNING) << "there is failure when loading tablet headers, path:" << _path;
     } else {
-        LOG(INFO) << "load rowset from meta finished, data dir: " << _path;
+        LOG(INFO) << "load tablet from meta finished, data dir: " << _path
+                  << ", tablet num: " << tablet_ids.size();
     }
+    _load_tablets_ms.set_value(watch.reset() / 1000 / 1000);
 
     // tranverse rowset
     // 1. add committed rowset to txn map
@@ -795,6 +879,11 @@ OLAPStatus DataDir::load() {
                          << " current valid tablet uid: " << tablet->tablet_uid();
         }
     }
+    _load_rowsets_ms.set_value(watch.elapsed_time() / 1000 / 1000);
+    LOG(INFO) << "finish loading data dir " << _path
+              << ", rowset metas: " << _load_rowset_metas_ms.value() << " ms"
+              << ", tablets: " << _load_tablets_ms.value() << " ms"
+              << ", rowsets: " << _load_rowsets_ms.value() << " ms";
     return OLAP_SUCCESS;
 }
 
@@ -18,6 +18,8 @@
 #pragma once
 
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
 #include <mutex>
@@ -28,9 +30,28 @@
 #include "olap/olap_common.h"
 #include "olap/storage_engine.h"
 #include "olap/rowset/rowset_id_generator.h"
+#include "util/io_scheduler.h"
+#include "util/metrics.h"
 
 namespace doris {
 
+// A tablet waiting for compaction in a DataDir, ordered by decreasing score.
+struct CompactionCandidate {
+    CompactionCandidate() : score(0), tablet_info(0, 0, UniqueId(0, 0)) {}
+    CompactionCandidate(uint32_t in_score, const TabletInfo& in_tablet_info) :
+            score(in_score), tablet_info(in_tablet_info) {}
+
+    bool operator<(const CompactionCandidate& right) const {
+        if (score != right.score) {
+            return score > right.score;
+        }
+        return tablet_info < right.tablet_info;
+    }
+
+    uint32_t score;
+    TabletInfo tablet_info;
+};
+
 // A DataDir used to manange data in same path.
 // Now, After DataDir was created, it will never be deleted for easy implementation.
 class DataDir {
@@ -71,6 +92,9 @@ public:
 
     OlapMeta* get_meta() { return _meta; }
 
+    // shares the io bandwidth of this dir among the background tasks on it
+    IOScheduler* io_scheduler() { return _io_scheduler.get(); }
+
     bool is_ssd_disk() const {
         return _storage_medium == TStorageMedium::SSD;
     }
@@ -81,6 +105,17 @@ public:
     OLAPStatus deregister_tablet(Tablet* tablet);
     void clear_tablets(std::vector<TabletInfo>* tablet_infos);
 
+    // Called by a registered tablet whenever its compaction scores may have changed,
+    // i.e. its rowsets or cumulative point changed. A tablet is a candidate of the
+    // compaction types for which its score is above 0.
+    void update_compaction_scores(const TabletInfo& tablet_info,
+                                  uint32_t cumulative_score, uint32_t base_score);
+
+    // Sets 'next' to the candidate of 'compaction_type' with the highest score after
+    // 'prev', or the highest of all if 'prev' is nullptr. Returns false if there is none.
+    bool next_compaction_candidate(CompactionType compaction_type,
+                                   const CompactionCandidate* prev, CompactionCandidate* next);
+
     std::string get_absolute_tablet_path(TabletMeta* tablet_meta, bool with_schema_hash);
 
     std::string get_absolute_tablet_path(OLAPHeaderMessage& olap_header_msg, bool with_schema_hash);
@@ -132,6 +167,7 @@ private:
     Status _init_extension_and_capacity();
     Status _init_file_system();
     Status _init_meta();
+    void _register_metrics(MetricRegistry* registry);
 
     Status _check_disk();
     OLAPStatus _read_and_write_test_file();
@@ -148,6 +184,8 @@ private:
 
     bool _check_pending_ids(const std::string& id);
 
+    void _remove_compaction_candidate_unlock(const TabletInfo& tablet_info);
+
 private:
     std::string _path;
     int64_t _path_hash;
@@ -171,10 +209,14 @@ private:
     // This flag will be set true if this store was not in root path when reloading
     bool _to_be_deleted;
 
-    // used to protect _current_shard and _tablet_set
+    // used to protect _current_shard, _tablet_set and the compaction candidates
     std::mutex _mutex;
     uint64_t _current_shard;
     std::set<TabletInfo> _tablet_set;
+    // the cumulative and base compaction scores of the candidates
+    std::map<TabletInfo, std::pair<uint32_t, uint32_t>> _compaction_scores;
+    std::set<CompactionCandidate> _cumulative_candidates;
+    std::set<CompactionCandidate> _base_candidates;
 
     static const size_t TEST_FILE_BUF_SIZE = 4096;
     static const size_t DIRECT_IO_ALIGNMENT = 512;
@@ -183,6 +225,12 @@ private:
     char* _test_file_write_buf;
     OlapMeta* _meta = nullptr;
     RowsetIdGenerator* _id_generator = nullptr;
+    std::unique_ptr<IOScheduler> _io_scheduler;
+
+    MetricRegistry* _registry = nullptr;
+    IntGauge _load_rowset_metas_ms;
+    IntGauge _load_tablets_ms;
+    IntGauge _load_rowsets_ms;
 
     std::set<std::string> _all_check_paths;
     std::mutex _check_path_mutex;
@@ -208,7 +208,7 @@ int DeleteConditionHandler::_check_whether_condition_exist(const DelPredicateArr
     return -1;
 }
 
-bool DeleteHandler::_parse_condition(const std::string& condition_str, TCondition* condition) {
+bool DeleteHandler::parse_condition(const std::string& condition_str, TCondition* condition) {
     bool matched = true;
     smatch what;
 
@@ -275,7 +275,7 @@ OLAPStatus DeleteHandler::init(const TabletSchema& schema,
 
         for (int i = 0; i != it->sub_predicates_size(); ++i) {
             TCondition condition;
-            if (!_parse_condition(it->sub_predicates(i), &condition)) {
+            if (!parse_condition(it->sub_predicates(i), &condition)) {
                 OLAP_LOG_WARNING("fail to parse condition. [condition=%s]",
                                  it->sub_predicates(i).c_str());
                 return OLAP_ERR_DELETE_INVALID_PARAMETERS;
@@ -127,6 +127,10 @@ public:
     //     * false: 数据不符合删除条件
     bool is_filter_data(const int32_t data_version, const RowCursor& row) const;
 
+    // Use regular expression to extract 'column_name', 'op' and 'operands' of a
+    // sub predicate of DeletePredicatePB
+    static bool parse_condition(const std::string& condition_str, TCondition* condition);
+
     // 返回handler中有存有多少条删除条件
     cond_num_t conditions_num() const{
         return _del_conds.size();
@@ -151,9 +155,6 @@ public:
             std::vector<const Conditions*>* delete_conditions) const;
 
 private:
-    // Use regular expression to extract 'column_name', 'op' and 'operands'
-    bool _parse_condition(const std::string& condition_str, TCondition* condition);
-
     bool _is_inited;
     std::vector<DeleteConditions> _del_conds;
 };
@@ -29,6 +29,7 @@
 #include "olap/olap_define.h"
 #include "olap/utils.h"
 #include "util/debug_util.h"
+#include "util/io_scheduler.h"
 
 using std::string;
 
@@ -188,6 +189,7 @@ OLAPStatus FileHandler::close() {
 }
 
 OLAPStatus FileHandler::pread(void* buf, size_t size, size_t offset) {
+    IOScheduler::consume_current(size);
     char* ptr = reinterpret_cast<char*>(buf);
 
     while (size > 0) {
@@ -216,6 +218,7 @@ OLAPStatus FileHandler::pread(void* buf, size_t size, size_t offset) {
 }
 
 OLAPStatus FileHandler::write(const void* buf, size_t buf_size) {
+    IOScheduler::consume_current(buf_size);
 
     size_t org_buf_size = buf_size;
     const char* ptr = reinterpret_cast<const char*>(buf);
@@ -251,6 +254,7 @@ OLAPStatus FileHandler::write(const void* buf, size_t buf_size) {
 }
 
 OLAPStatus FileHandler::pwrite(const void* buf, size_t buf_size, size_t offset) {
+    IOScheduler::consume_current(buf_size);
     const char* ptr = reinterpret_cast<const char*>(buf);
 
     size_t org_buf_size = buf_size;
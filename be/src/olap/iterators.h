@@ -29,6 +29,8 @@ class RowBlockV2;
 class Schema;
 class Conditions;
 class ColumnPredicate;
+class TabletSchema;
+class TopNThreshold;
 
 class StorageReadOptions {
 public:
@@ -77,6 +79,13 @@ public:
     // to unify Conditions and ColumnPredicate
     const std::vector<ColumnPredicate*>* column_predicates = nullptr;
 
+    // bound of the TopN above the scan, nullptr if there is none.
+    // A segment snapshots it when it starts reading and skips the pages
+    // whose zone maps lie entirely beyond it.
+    const TopNThreshold* topn_threshold = nullptr;
+    // used to build conditions from `topn_threshold`
+    const TabletSchema* tablet_schema = nullptr;
+
     // reader statistics
     OlapReaderStatistics* stats = nullptr;
 };
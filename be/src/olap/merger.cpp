@@ -32,12 +32,39 @@ OLAPStatus Merger::merge_rowsets(TabletSharedPtr tablet,
                                  const std::vector<RowsetReaderSharedPtr>& src_rowset_readers,
                                  RowsetWriter* dst_rowset_writer,
                                  Merger::Statistics* stats_output) {
-    Reader reader;
     ReaderParams reader_params;
     reader_params.tablet = tablet;
     reader_params.reader_type = reader_type;
     reader_params.rs_readers = src_rowset_readers;
     reader_params.version = dst_rowset_writer->version();
+    return _merge(reader_params, dst_rowset_writer, stats_output);
+}
+
+OLAPStatus Merger::merge_rowsets(TabletSharedPtr tablet,
+                                 ReaderType reader_type,
+                                 const std::vector<RowsetReaderSharedPtr>& src_rowset_readers,
+                                 const OlapTuple& start_key,
+                                 const OlapTuple& end_key,
+                                 bool end_key_included,
+                                 RowsetWriter* dst_rowset_writer,
+                                 Merger::Statistics* stats_output) {
+    ReaderParams reader_params;
+    reader_params.tablet = tablet;
+    reader_params.reader_type = reader_type;
+    reader_params.rs_readers = src_rowset_readers;
+    reader_params.version = dst_rowset_writer->version();
+    reader_params.range = "ge";
+    reader_params.end_range = end_key_included ? "le" : "lt";
+    reader_params.start_key.push_back(start_key);
+    reader_params.end_key.push_back(end_key);
+    return _merge(reader_params, dst_rowset_writer, stats_output);
+}
+
+OLAPStatus Merger::_merge(const ReaderParams& reader_params,
+                          RowsetWriter* dst_rowset_writer,
+                          Merger::Statistics* stats_output) {
+    TabletSharedPtr tablet = reader_params.tablet;
+    Reader reader;
     RETURN_NOT_OK(reader.init(reader_params));
 
     RowCursor row_cursor;
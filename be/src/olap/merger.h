@@ -19,6 +19,7 @@
 #define DORIS_BE_SRC_OLAP_MERGER_H
 
 #include "olap/olap_define.h"
+#include "olap/reader.h"
 #include "olap/tablet.h"
 #include "olap/rowset/rowset_writer.h"
 
@@ -41,6 +42,22 @@ public:
                                     const std::vector<RowsetReaderSharedPtr>& src_rowset_readers,
                                     RowsetWriter* dst_rowset_writer,
                                     Statistics* stats_output);
+
+    // like merge_rowsets(), but only merges the rows whose keys are in
+    // [`start_key`, `end_key`), or [`start_key`, `end_key`] if `end_key_included`.
+    static OLAPStatus merge_rowsets(TabletSharedPtr tablet,
+                                    ReaderType reader_type,
+                                    const std::vector<RowsetReaderSharedPtr>& src_rowset_readers,
+                                    const OlapTuple& start_key,
+                                    const OlapTuple& end_key,
+                                    bool end_key_included,
+                                    RowsetWriter* dst_rowset_writer,
+                                    Statistics* stats_output);
+
+private:
+    static OLAPStatus _merge(const ReaderParams& reader_params,
+                             RowsetWriter* dst_rowset_writer,
+                             Statistics* stats_output);
 };
 
 }  // namespace doris
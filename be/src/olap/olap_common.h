@@ -248,6 +248,8 @@ struct OlapReaderStatistics {
 
     int64_t rows_stats_filtered = 0;
     int64_t rows_del_filtered = 0;
+    // rows skipped by the zone maps for the bound of a TopN
+    int64_t rows_topn_filtered = 0;
 
     int64_t index_load_ns = 0;
 
@@ -17,6 +17,7 @@
 
 #include "olap/reader.h"
 
+#include "olap/collect_iterator.h"
 #include "olap/rowset/column_data.h"
 #include "olap/tablet.h"
 #include "olap/row_block.h"
@@ -32,6 +33,7 @@
 #include "olap/null_predicate.h"
 #include "olap/storage_engine.h"
 #include "olap/row.h"
+#include "runtime/topn_threshold.h"
 
 using std::nothrow;
 using std::set;
@@ -39,254 +41,6 @@ using std::vector;
 
 namespace doris {
 
-class CollectIterator {
-public:
-    ~CollectIterator();
-
-    // Hold reader point to get reader params,
-    // set reverse to true if need read in reverse order.
-    OLAPStatus init(Reader* reader);
-
-    OLAPStatus add_child(RowsetReaderSharedPtr rs_reader);
-
-    // Get top row of the heap, NULL if reach end.
-    const RowCursor* current_row(bool* delete_flag) const {
-        if (_cur_child != nullptr) {
-            return _cur_child->current_row(delete_flag);
-        }
-        return nullptr;
-    }
-
-    // Read next row into *row.
-    // Returns
-    //      OLAP_SUCCESS when read successfully.
-    //      OLAP_ERR_DATA_EOF and set *row to nullptr when EOF is reached.
-    //      Others when error happens
-    OLAPStatus next(const RowCursor** row, bool* delete_flag) {
-        DCHECK(_cur_child != nullptr);
-        if (_merge) {
-            return _merge_next(row, delete_flag);
-        } else {
-            return _normal_next(row, delete_flag);
-        }
-    }
-
-    // Clear the MergeSet element and reset state.
-    void clear();
-
-private:
-    class ChildCtx {
-    public:
-        ChildCtx(RowsetReaderSharedPtr rs_reader, Reader* reader)
-                : _rs_reader(rs_reader),
-                  _is_delete(rs_reader->delete_flag()),
-                  _reader(reader) { }
-
-        OLAPStatus init() {
-            auto res = _row_cursor.init(_reader->_tablet->tablet_schema(), _reader->_seek_columns);
-            if (res != OLAP_SUCCESS) {
-                LOG(WARNING) << "failed to init row cursor, res=" << res;
-                return res;
-            }
-            RETURN_NOT_OK(_refresh_current_row());
-            return OLAP_SUCCESS;
-        }
-
-        const RowCursor* current_row(bool* delete_flag) const {
-            *delete_flag = _is_delete;
-            return _current_row;
-        }
-
-        const RowCursor* current_row() const {
-            return _current_row;
-        }
-
-        int32_t version() const {
-            return _rs_reader->version().second;
-        }
-
-        OLAPStatus next(const RowCursor** row, bool* delete_flag) {
-            _row_block->pos_inc();
-            auto res = _refresh_current_row();
-            *row = _current_row;
-            *delete_flag = _is_delete;
-            return res;
-        }
-
-    private:
-        // refresh_current_row
-        OLAPStatus _refresh_current_row() {
-            do {
-                if (_row_block != nullptr && _row_block->has_remaining()) {
-                    size_t pos = _row_block->pos();
-                    _row_block->get_row(pos, &_row_cursor);
-                    if (_row_block->block_status() == DEL_PARTIAL_SATISFIED &&
-                        _reader->_delete_handler.is_filter_data(_rs_reader->version().second, _row_cursor)) {
-                        _reader->_stats.rows_del_filtered++;
-                        _row_block->pos_inc();
-                        continue;
-                    }
-                    _current_row = &_row_cursor;
-                    return OLAP_SUCCESS;
-                } else {
-                    auto res = _rs_reader->next_block(&_row_block);
-                    if (res != OLAP_SUCCESS) {
-                        _current_row = nullptr;
-                        return res;
-                    }
-                }
-            } while (_row_block != nullptr);
-            _current_row = nullptr;
-            return OLAP_ERR_DATA_EOF;
-        }
-
-        RowsetReaderSharedPtr _rs_reader;
-        const RowCursor* _current_row = nullptr;
-        bool _is_delete = false;
-        Reader* _reader;
-
-        RowCursor _row_cursor; // point to rows inside `_row_block`
-        RowBlock* _row_block = nullptr;
-    };
-
-    // Compare row cursors between multiple merge elements,
-    // if row cursors equal, compare data version.
-    class ChildCtxComparator {
-    public:
-        bool operator()(const ChildCtx* a, const ChildCtx* b);
-    };
-
-    inline OLAPStatus _merge_next(const RowCursor** row, bool* delete_flag);
-    inline OLAPStatus _normal_next(const RowCursor** row, bool* delete_flag);
-
-    // each ChildCtx corresponds to a rowset reader
-    std::vector<ChildCtx*> _children;
-    // point to the ChildCtx containing the next output row.
-    // null when CollectIterator hasn't been initialized or reaches EOF.
-    ChildCtx* _cur_child = nullptr;
-
-    // when `_merge == true`, rowset reader returns ordered rows and CollectIterator uses a priority queue to merge
-    // sort them. The output of CollectIterator is also ordered.
-    // When `_merge == false`, rowset reader returns *partial* ordered rows. CollectIterator simply returns all rows
-    // from the first rowset, the second rowset, .., the last rowset. The output of CollectorIterator is also
-    // *partially* ordered.
-    bool _merge = true;
-    // used when `_merge == true`
-    typedef std::priority_queue<ChildCtx*, std::vector<ChildCtx*>, ChildCtxComparator> MergeHeap;
-    MergeHeap _heap;
-    // used when `_merge == false`
-    int _child_idx = 0;
-
-    // Hold reader point to access read params, such as fetch conditions.
-    Reader* _reader = nullptr;
-};
-
-
-CollectIterator::~CollectIterator() {
-    for (auto child : _children) {
-        delete child;
-    }
-}
-
-OLAPStatus CollectIterator::init(Reader* reader) {
-    _reader = reader;
-    // when aggregate is enabled or key_type is DUP_KEYS, we don't merge
-    // multiple data to aggregate for performance in user fetch
-    if (_reader->_reader_type == READER_QUERY &&
-            (_reader->_aggregation ||
-             _reader->_tablet->keys_type() == KeysType::DUP_KEYS)) {
-        _merge = false;
-    }
-    return OLAP_SUCCESS;
-}
-
-OLAPStatus CollectIterator::add_child(RowsetReaderSharedPtr rs_reader) {
-    std::unique_ptr<ChildCtx> child(new ChildCtx(rs_reader, _reader));
-    RETURN_NOT_OK(child->init());
-    if (child->current_row() == nullptr) {
-        return OLAP_SUCCESS;
-    }
-
-    ChildCtx* child_ptr = child.release();
-    _children.push_back(child_ptr);
-    if (_merge) {
-        _heap.push(child_ptr);
-        _cur_child = _heap.top();
-    } else {
-        if (_cur_child == nullptr) {
-            _cur_child = _children[_child_idx];
-        }
-    }
-    return OLAP_SUCCESS;
-}
-
-inline OLAPStatus CollectIterator::_merge_next(const RowCursor** row, bool* delete_flag) {
-    _heap.pop();
-    auto res = _cur_child->next(row, delete_flag);
-    if (res == OLAP_SUCCESS) {
-        _heap.push(_cur_child);
-        _cur_child = _heap.top();
-    } else if (res == OLAP_ERR_DATA_EOF) {
-        if (_heap.size() > 0) {
-            _cur_child = _heap.top();
-        } else {
-            _cur_child = nullptr;
-            return OLAP_ERR_DATA_EOF;
-        }
-    } else {
-        LOG(WARNING) << "failed to get next from child, res=" << res;
-        return res;
-    }
-    *row = _cur_child->current_row(delete_flag);
-    return OLAP_SUCCESS;
-}
-
-inline OLAPStatus CollectIterator::_normal_next(const RowCursor** row, bool* delete_flag) {
-    auto res = _cur_child->next(row, delete_flag);
-    if (LIKELY(res == OLAP_SUCCESS)) {
-        return OLAP_SUCCESS;
-    } else if (res == OLAP_ERR_DATA_EOF) {
-        // this child has been read, to read next
-        _child_idx++;
-        if (_child_idx < _children.size()) {
-            _cur_child = _children[_child_idx];
-            *row = _cur_child->current_row(delete_flag);
-            return OLAP_SUCCESS;
-        } else {
-            _cur_child = nullptr;
-            return OLAP_ERR_DATA_EOF;
-        }
-    } else {
-        LOG(WARNING) << "failed to get next from child, res=" << res;
-        return res;
-    }
-}
-
-bool CollectIterator::ChildCtxComparator::operator()(const ChildCtx* a, const ChildCtx* b) {
-    // First compare row cursor.
-    const RowCursor* first = a->current_row();
-    const RowCursor* second = b->current_row();
-    int cmp_res = compare_row(*first, *second);
-    if (cmp_res != 0) {
-        return cmp_res > 0;
-    }
-    // if row cursors equal, compare data version.
-    return a->version() > b->version();
-}
-
-void CollectIterator::clear() {
-    while (_heap.size() > 0) {
-        _heap.pop();
-    }
-    for (auto child : _children) {
-        delete child;
-    }
-    // _children.swap(std::vector<ChildCtx*>());
-    _children.clear();
-    _cur_child = nullptr;
-    _child_idx = 0;
-}
-
 Reader::Reader()
         : _next_key_index(0),
         _aggregation(false),
@@ -520,7 +274,7 @@ OLAPStatus Reader::_capture_rs_readers(const ReaderParams& read_params) {
     if (eof) { return OLAP_SUCCESS; }
 
     bool need_ordered_result = true;
-    if (read_params.reader_type == READER_QUERY) {
+    if (read_params.reader_type == READER_QUERY && !read_params.need_ordered_result) {
         if (_tablet->tablet_schema().keys_type() == DUP_KEYS) {
             // duplicated keys are allowed, no need to merge sort keys in rowset
             need_ordered_result = false;
@@ -547,6 +301,15 @@ OLAPStatus Reader::_capture_rs_readers(const ReaderParams& read_params) {
     _reader_context.delete_handler = &_delete_handler;
     _reader_context.stats = &_stats;
     _reader_context.runtime_state = read_params.runtime_state;
+    if (read_params.topn_threshold != nullptr) {
+        // value columns of AGG_KEYS and UNIQUE_KEYS tablets are only final
+        // after merging, so their pages can't be pruned by the bound
+        int32_t index = _tablet->field_index(read_params.topn_threshold->column_name());
+        if (index >= 0 && (_tablet->tablet_schema().column(index).is_key()
+                           || _tablet->keys_type() == KeysType::DUP_KEYS)) {
+            _reader_context.topn_threshold = read_params.topn_threshold;
+        }
+    }
     for (auto& rs_reader : *rs_readers) {
         rs_reader->init(&_reader_context);
         _rs_readers.push_back(rs_reader);
@@ -559,6 +322,7 @@ OLAPStatus Reader::_capture_rs_readers(const ReaderParams& read_params) {
             return res;
         }
     }
+    _collect_iter->build_merge_tree();
 
     _next_key = _collect_iter->current_row(&_next_delete_flag);
     return OLAP_SUCCESS;
@@ -569,6 +333,7 @@ OLAPStatus Reader::_init_params(const ReaderParams& read_params) {
     OLAPStatus res = OLAP_SUCCESS;
     _aggregation = read_params.aggregation;
     _need_agg_finalize = read_params.need_agg_finalize;
+    _need_ordered_result = read_params.need_ordered_result;
     _reader_type = read_params.reader_type;
     _tablet = read_params.tablet;
     _version = read_params.version;
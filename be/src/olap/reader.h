@@ -45,6 +45,7 @@ class Tablet;
 class RowCursor;
 class RowBlock;
 class CollectIterator;
+class TopNThreshold;
 class RuntimeState;
 
 // Params for Reader,
@@ -67,6 +68,11 @@ struct ReaderParams {
     std::vector<uint32_t> return_columns;
     RuntimeProfile* profile;
     RuntimeState* runtime_state;
+    // Return rows in key order even if the query does not require it,
+    // e.g. DUP_KEYS or pre-aggregated reads below a TopN on the key prefix.
+    bool need_ordered_result = false;
+    // Bound of the TopN above the scan, used to prune pages of segments.
+    const TopNThreshold* topn_threshold = nullptr;
 
     ReaderParams() :
             reader_type(READER_QUERY),
@@ -176,6 +182,7 @@ private:
     };
 
     friend class CollectIterator;
+    friend class CollectIteratorTest;
 
     OLAPStatus _init_params(const ReaderParams& read_params);
 
@@ -239,6 +246,7 @@ private:
     bool _aggregation;
     // for agg query, we don't need to finalize when scan agg object data
     bool _need_agg_finalize = true;
+    bool _need_ordered_result = false;
     bool _version_locked;
     ReaderType _reader_type;
     bool _next_delete_flag;
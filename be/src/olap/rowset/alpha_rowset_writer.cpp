@@ -131,6 +131,10 @@ OLAPStatus AlphaRowsetWriter::add_rowset_for_linked_schema_change(
         RETURN_NOT_OK(flush());
         _num_rows_written += segment_group->num_rows();
     }
+    // the delete predicate goes with the linked data, it is applied when reading
+    if (rowset->rowset_meta()->has_delete_predicate()) {
+        _current_rowset_meta->set_delete_predicate(rowset->rowset_meta()->delete_predicate());
+    }
     return OLAP_SUCCESS;
 }
 
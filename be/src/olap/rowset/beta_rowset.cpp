@@ -22,8 +22,12 @@
 #include <unistd.h> // for link()
 #include <util/file_utils.h>
 #include "gutil/strings/substitute.h"
+#include "olap/row_cursor.h"
 #include "olap/rowset/beta_rowset_reader.h"
+#include "olap/short_key_index.h"
 #include "olap/utils.h"
+#include "runtime/mem_pool.h"
+#include "runtime/mem_tracker.h"
 
 namespace doris {
 
@@ -64,11 +68,90 @@ OLAPStatus BetaRowset::create_reader(RowsetReaderSharedPtr* result) {
     return OLAP_SUCCESS;
 }
 
+// Decode a key of the segment short key index into 'row', which has the short key columns
+static OLAPStatus decode_short_key(Slice key, RowCursor* row, MemPool* pool) {
+    for (uint32_t cid = 0; cid < row->field_count(); ++cid) {
+        if (key.size == 0) {
+            return OLAP_ERR_INDEX_LOAD_ERROR;
+        }
+        uint8_t marker = key[0];
+        key.remove_prefix(1);
+        if (marker == KEY_NULL_FIRST_MARKER) {
+            row->set_null(cid);
+            continue;
+        }
+        if (marker != KEY_NORMAL_MARKER) {
+            return OLAP_ERR_INDEX_LOAD_ERROR;
+        }
+        row->set_not_null(cid);
+        if (!row->column_schema(cid)->decode_ascending(
+                    &key, reinterpret_cast<uint8_t*>(row->cell_ptr(cid)), pool).ok()) {
+            return OLAP_ERR_INDEX_LOAD_ERROR;
+        }
+    }
+    return OLAP_SUCCESS;
+}
+
+// Split by every expected_blocks-th key of the short key index of the largest segment.
+// The rows of the other segments fall into the sections by their keys, so the
+// sections are about even if the segments have the same key distribution.
 OLAPStatus BetaRowset::split_range(const RowCursor& start_key,
                                    const RowCursor& end_key,
                                    uint64_t request_block_row_count,
                                    std::vector<OlapTuple>* ranges) {
+    RETURN_NOT_OK(load());
+    segment_v2::Segment* largest_segment = nullptr;
+    for (auto& segment : _segments) {
+        if (largest_segment == nullptr || segment->num_rows() > largest_segment->num_rows()) {
+            largest_segment = segment.get();
+        }
+    }
     ranges->emplace_back(start_key.to_tuple());
+    if (largest_segment == nullptr || largest_segment->num_rows() == 0) {
+        ranges->emplace_back(end_key.to_tuple());
+        return OLAP_SUCCESS;
+    }
+    auto st = largest_segment->load_index();
+    if (!st.ok()) {
+        LOG(WARNING) << "failed to load short key index of rowset " << unique_id()
+                     << " : " << st.to_string();
+        return OLAP_ERR_INDEX_LOAD_ERROR;
+    }
+    uint64_t expected_blocks = std::max<uint64_t>(
+            1, request_block_row_count / largest_segment->num_rows_per_block());
+
+    std::string start_index_key;
+    encode_key_with_padding(&start_index_key, start_key, largest_segment->num_short_keys(), true);
+    std::string end_index_key;
+    encode_key_with_padding(&end_index_key, end_key, largest_segment->num_short_keys(), false);
+    uint64_t start_block = largest_segment->lower_bound(start_index_key).ordinal();
+    uint64_t end_block = largest_segment->upper_bound(end_index_key).ordinal();
+
+    RowCursor cur_start_key;
+    if (cur_start_key.init(*_schema, _schema->num_short_key_columns()) != OLAP_SUCCESS) {
+        LOG(WARNING) << "fail to init cursor";
+        return OLAP_ERR_INIT_FAILED;
+    }
+    std::unique_ptr<MemTracker> tracker(new MemTracker(-1));
+    std::unique_ptr<MemPool> mem_pool(new MemPool(tracker.get()));
+    Slice last_index_key;
+    for (uint64_t block = start_block + expected_blocks; block < end_block;
+            block += expected_blocks) {
+        Slice index_key = largest_segment->block_short_key(block);
+        // an empty section if the key spans the blocks
+        if (index_key.compare(last_index_key) == 0) {
+            continue;
+        }
+        last_index_key = index_key;
+        mem_pool->clear();
+        if (decode_short_key(index_key, &cur_start_key, mem_pool.get()) != OLAP_SUCCESS) {
+            LOG(WARNING) << "fail to decode short key of rowset " << unique_id();
+            return OLAP_ERR_INDEX_LOAD_ERROR;
+        }
+        ranges->emplace_back(cur_start_key.to_tuple()); // end of last section
+        ranges->emplace_back(cur_start_key.to_tuple()); // start a new section
+    }
+
     ranges->emplace_back(end_key.to_tuple());
     return OLAP_SUCCESS;
 }
@@ -95,8 +178,13 @@ OLAPStatus BetaRowset::remove() {
 }
 
 OLAPStatus BetaRowset::link_files_to(const std::string& dir, RowsetId new_rowset_id) {
+    return link_segments_to(dir, new_rowset_id, 0);
+}
+
+OLAPStatus BetaRowset::link_segments_to(const std::string& dir, RowsetId new_rowset_id,
+                                        int first_segment_id) {
     for (int i = 0; i < num_segments(); ++i) {
-        std::string dst_link_path = segment_file_path(dir, new_rowset_id, i);
+        std::string dst_link_path = segment_file_path(dir, new_rowset_id, first_segment_id + i);
         if (FileUtils::check_exist(dst_link_path)) {
             LOG(WARNING) << "failed to create hard link, file already exist: " << dst_link_path;
             return OLAP_ERR_FILE_ALREADY_EXIST;
@@ -49,6 +49,10 @@ public:
 
     OLAPStatus link_files_to(const std::string& dir, RowsetId new_rowset_id) override;
 
+    // links segment i to segment `first_segment_id` + i of rowset `new_rowset_id` in `dir`
+    OLAPStatus link_segments_to(const std::string& dir, RowsetId new_rowset_id,
+                                int first_segment_id);
+
     OLAPStatus copy_files_to(const std::string& dir) override;
 
     // only applicable to alpha rowset, no op here
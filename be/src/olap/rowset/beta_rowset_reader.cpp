@@ -59,6 +59,8 @@ OLAPStatus BetaRowsetReader::init(RowsetReaderContext* read_context) {
                 &read_options.delete_conditions);
     }
     read_options.column_predicates = read_context->predicates;
+    read_options.topn_threshold = read_context->topn_threshold;
+    read_options.tablet_schema = read_context->tablet_schema;
 
     // create iterator for each segment
     std::vector<std::unique_ptr<RowwiseIterator>> seg_iterators;
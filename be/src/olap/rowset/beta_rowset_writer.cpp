@@ -104,7 +104,11 @@ template OLAPStatus BetaRowsetWriter::_add_row(const ContiguousRow& row);
 
 OLAPStatus BetaRowsetWriter::add_rowset(RowsetSharedPtr rowset) {
     assert(rowset->rowset_meta()->rowset_type() == BETA_ROWSET);
-    RETURN_NOT_OK(rowset->link_files_to(_context.rowset_path_prefix, _context.rowset_id));
+    // the segments go after the ones already added, so that a rowset can be
+    // made up of several others, e.g. the key ranges of a parallel compaction
+    BetaRowsetSharedPtr beta_rowset = std::dynamic_pointer_cast<BetaRowset>(rowset);
+    RETURN_NOT_OK(beta_rowset->link_segments_to(_context.rowset_path_prefix,
+                                                _context.rowset_id, _num_segment));
     _num_rows_written += rowset->num_rows();
     _total_data_size += rowset->rowset_meta()->data_disk_size();
     _num_segment += rowset->num_segments();
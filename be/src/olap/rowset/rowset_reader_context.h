@@ -28,6 +28,7 @@ class RowCursor;
 class Conditions;
 class DeleteHandler;
 class TabletSchema;
+class TopNThreshold;
 
 struct RowsetReaderContext {
     ReaderType reader_type = READER_QUERY;
@@ -54,6 +55,8 @@ struct RowsetReaderContext {
     const DeleteHandler* delete_handler = nullptr;
     OlapReaderStatistics* stats = nullptr;
     RuntimeState* runtime_state = nullptr;
+    // bound of the TopN above the scan, nullptr if there is none
+    const TopNThreshold* topn_threshold = nullptr;
 };
 
 } // namespace doris
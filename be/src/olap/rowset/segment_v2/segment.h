@@ -91,6 +91,16 @@ public:
         return _sk_index_decoder->upper_bound(key);
     }
 
+    // Load and decode short key index, which the functions above and below need.
+    // Called by new_iterator() as well.
+    Status load_index() { return _load_index(); }
+
+    // Return the encoded short key of the first row of the block.
+    Slice block_short_key(uint32_t block_id) const {
+        DCHECK(_load_index_once.has_called() && _load_index_once.stored_result().ok());
+        return _sk_index_decoder->key(block_id);
+    }
+
     // This will return the last row block in this segment.
     // NOTE: Before call this function , client should assure that
     // this segment is not empty.
@@ -28,6 +28,7 @@
 #include "olap/short_key_index.h"
 #include "olap/column_predicate.h"
 #include "olap/row.h"
+#include "runtime/topn_threshold.h"
 
 using strings::Substitute;
 
@@ -144,6 +145,12 @@ Status SegmentIterator::_get_row_ranges_by_column_conditions() {
         RowRanges::ranges_intersection(_row_ranges, condition_row_ranges, &_row_ranges);
     }
 
+    if (_opts.topn_threshold != nullptr && _opts.tablet_schema != nullptr) {
+        RowRanges topn_row_ranges;
+        RETURN_IF_ERROR(_get_row_ranges_from_topn_threshold(&topn_row_ranges));
+        RowRanges::ranges_intersection(_row_ranges, topn_row_ranges, &_row_ranges);
+    }
+
     // TODO(hkp): calculate filter rate to decide whether to
     // use zone map/bloom filter/secondary index or not.
     return Status::OK();
@@ -185,6 +192,41 @@ Status SegmentIterator::_get_row_ranges_from_conditions(RowRanges* condition_row
     return Status::OK();
 }
 
+// The TopN bound is snapshotted here, segments opened later in the scan see
+// a tighter one.
+Status SegmentIterator::_get_row_ranges_from_topn_threshold(RowRanges* topn_row_ranges) {
+    *topn_row_ranges = RowRanges::create_single(num_rows());
+    TCondition tcond;
+    if (!_opts.topn_threshold->get_condition(&tcond)) {
+        return Status::OK();
+    }
+    Conditions conditions;
+    conditions.set_tablet_schema(_opts.tablet_schema);
+    if (conditions.append_condition(tcond) != OLAP_SUCCESS) {
+        conditions.finalize();
+        return Status::OK();
+    }
+    Status st;
+    for (auto& column_condition : conditions.columns()) {
+        int32_t cid = column_condition.first;
+        if (_column_iterators[cid] == nullptr) {
+            continue;
+        }
+        RowRanges column_row_ranges = RowRanges::create_single(num_rows());
+        st = _column_iterators[cid]->get_row_ranges_by_conditions(
+            column_condition.second, std::vector<CondColumn*>(), &column_row_ranges);
+        if (!st.ok()) {
+            break;
+        }
+        RowRanges::ranges_intersection(*topn_row_ranges, column_row_ranges, topn_row_ranges);
+    }
+    conditions.finalize();
+    if (st.ok()) {
+        _opts.stats->rows_topn_filtered += num_rows() - topn_row_ranges->count();
+    }
+    return st;
+}
+
 Status SegmentIterator::_init_column_iterators() {
     if (_cur_rowid >= num_rows()) {
         return Status::OK();
@@ -64,6 +64,8 @@ private:
 
     Status _get_row_ranges_from_conditions(RowRanges* condition_row_ranges);
 
+    Status _get_row_ranges_from_topn_threshold(RowRanges* topn_row_ranges);
+
     Status _init_column_iterators();
 
     Status _next_batch(RowBlockV2* block, size_t* rows_read);
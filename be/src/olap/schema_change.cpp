@@ -21,6 +21,8 @@
 #include <signal.h>
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <vector>
 
 #include "olap/merger.h"
@@ -32,9 +34,13 @@
 #include "olap/row.h"
 #include "olap/rowset/rowset_factory.h"
 #include "olap/rowset/rowset_id_generator.h"
+#include "olap/short_key_index.h"
 #include "runtime/mem_pool.h"
 #include "runtime/mem_tracker.h"
 #include "common/resource_tls.h"
+#include "util/count_down_latch.hpp"
+#include "util/io_scheduler.h"
+#include "util/thread_pool.hpp"
 #include "agent/cgroups_mgr.h"
 
 using std::deque;
@@ -47,22 +53,6 @@ using std::vector;
 
 namespace doris {
 
-class RowBlockSorter {
-public:
-    explicit RowBlockSorter(RowBlockAllocator* allocator);
-    virtual ~RowBlockSorter();
-
-    bool sort(RowBlock** row_block);
-
-private:
-    static bool _row_cursor_comparator(const RowCursor* a, const RowCursor* b) {
-        return compare_row(*a, *b) < 0;
-    }
-
-    RowBlockAllocator* _row_block_allocator;
-    RowBlock* _swap_row_block;
-};
-
 class RowBlockMerger {
 public:
     explicit RowBlockMerger(TabletSharedPtr tablet);
@@ -415,6 +405,41 @@ RowBlockSorter::~RowBlockSorter() {
     }
 }
 
+// The short key encoding keeps the order of the key columns up to the first CHAR or
+// VARCHAR one, hence so does any prefix of it. A string may be cut to its index size,
+// or be a prefix of the string it's compared to, so the encoding stops after it. Rows
+// with the same prefix are compared by compare_row().
+uint64_t RowBlockSorter::_encode_key_prefix(const RowCursor& row, size_t num_short_key_columns,
+                                            std::string* buf) {
+    buf->clear();
+    for (size_t cid = 0; cid < num_short_key_columns && buf->size() < sizeof(uint64_t); ++cid) {
+        auto cell = row.cell(cid);
+        if (cell.is_null()) {
+            buf->push_back(KEY_NULL_FIRST_MARKER);
+            continue;
+        }
+        buf->push_back(KEY_NORMAL_MARKER);
+        const Field* field = row.column_schema(cid);
+        field->encode_ascending(cell.cell_ptr(), buf);
+        if (field->type() == OLAP_FIELD_TYPE_CHAR || field->type() == OLAP_FIELD_TYPE_VARCHAR) {
+            break;
+        }
+    }
+    uint64_t prefix = 0;
+    size_t len = std::min<size_t>(buf->size(), sizeof(prefix));
+    for (size_t i = 0; i < len; ++i) {
+        prefix |= static_cast<uint64_t>(static_cast<uint8_t>((*buf)[i])) << (56 - 8 * i);
+    }
+    return prefix;
+}
+
+bool RowBlockSorter::_sort_entry_comparator(const SortEntry& a, const SortEntry& b) {
+    if (a.key_prefix != b.key_prefix) {
+        return a.key_prefix < b.key_prefix;
+    }
+    return compare_row(*a.row_cursor, *b.row_cursor) < 0;
+}
+
 bool RowBlockSorter::sort(RowBlock** row_block) {
     uint32_t row_num = (*row_block)->row_block_info().row_num;
     bool null_supported = (*row_block)->row_block_info().null_supported;
@@ -441,6 +466,9 @@ bool RowBlockSorter::sort(RowBlock** row_block) {
 
     RowBlock* temp = nullptr;
     vector<RowCursor*> row_cursor_list((*row_block)->row_block_info().row_num, nullptr);
+    vector<SortEntry> sort_entries((*row_block)->row_block_info().row_num);
+    size_t num_short_key_columns = (*row_block)->tablet_schema().num_short_key_columns();
+    std::string key_buf;
 
     // create an list of row cursor as long as the number of rows in data block.
     for (size_t i = 0; i < (*row_block)->row_block_info().row_num; ++i) {
@@ -454,19 +482,22 @@ bool RowBlockSorter::sort(RowBlock** row_block) {
         }
 
         (*row_block)->get_row(i, row_cursor_list[i]);
+        sort_entries[i].key_prefix = _encode_key_prefix(
+                *row_cursor_list[i], num_short_key_columns, &key_buf);
+        sort_entries[i].row_cursor = row_cursor_list[i];
     }
 
     // Must use 'std::' because this class has a function whose name is sort too
-    std::stable_sort(row_cursor_list.begin(), row_cursor_list.end(), _row_cursor_comparator);
+    std::stable_sort(sort_entries.begin(), sort_entries.end(), _sort_entry_comparator);
 
     // copy the results sorted to temp row block.
     _swap_row_block->clear();
-    for (size_t i = 0; i < row_cursor_list.size(); ++i) {
+    for (size_t i = 0; i < sort_entries.size(); ++i) {
         _swap_row_block->get_row(i, &helper_row);
-        copy_row(&helper_row, *row_cursor_list[i], _swap_row_block->mem_pool());
+        copy_row(&helper_row, *sort_entries[i].row_cursor, _swap_row_block->mem_pool());
     }
 
-    _swap_row_block->finalize(row_cursor_list.size());
+    _swap_row_block->finalize(sort_entries.size());
 
     for (size_t i = 0; i < (*row_block)->row_block_info().row_num; ++i) {
         SAFE_DELETE(row_cursor_list[i]);
@@ -1624,7 +1655,12 @@ OLAPStatus SchemaChangeHandler::_convert_historical_rowsets(const SchemaChangePa
 
     bool sc_sorting = false;
     bool sc_directly = false;
-    SchemaChange* sc_procedure = nullptr;
+    // The rowsets are independent of each other, they are converted by up to
+    // schema_change_convert_num_threads workers. A SchemaChange keeps the state of
+    // one conversion, so every worker has its own.
+    size_t num_threads = std::max<size_t>(1, std::min<size_t>(
+            config::schema_change_convert_num_threads, sc_params.ref_rowset_readers.size()));
+    std::vector<std::unique_ptr<SchemaChange>> sc_procedures;
 
     // a. 解析Alter请求，转换成内部的表示形式
     OLAPStatus res = _parse_request(sc_params.base_tablet, sc_params.new_tablet,
@@ -1636,113 +1672,57 @@ OLAPStatus SchemaChangeHandler::_convert_historical_rowsets(const SchemaChangePa
 
     // b. 生成历史数据转换器
     if (sc_sorting) {
-        size_t memory_limitation = config::memory_limitation_per_thread_for_schema_change;
-        LOG(INFO) << "doing schema change with sorting.";
-        sc_procedure = new(nothrow) SchemaChangeWithSorting(rb_changer,
-                                                            memory_limitation * 1024 * 1024 * 1024);
+        LOG(INFO) << "doing schema change with sorting. num_threads=" << num_threads;
     } else if (sc_directly) {
-        LOG(INFO) << "doing schema change directly.";
-        sc_procedure = new(nothrow) SchemaChangeDirectly(rb_changer);
+        LOG(INFO) << "doing schema change directly. num_threads=" << num_threads;
     } else {
-        LOG(INFO) << "doing linked schema change.";
-        sc_procedure = new(nothrow) LinkedSchemaChange(rb_changer);
-    }
-
-    if (sc_procedure == nullptr) {
-        LOG(WARNING) << "failed to malloc SchemaChange. "
-                     << "malloc_size=" << sizeof(SchemaChangeWithSorting);
-        res = OLAP_ERR_MALLOC_ERROR;
-        goto PROCESS_ALTER_EXIT;
-    }
-
-    // c. 转换历史数据
-    for (auto& rs_reader : sc_params.ref_rowset_readers) {
-        VLOG(10) << "begin to convert a history rowset. version="
-                 << rs_reader->version().first << "-" << rs_reader->version().second;
-
-        // set status for monitor
-        // 只要有一个new_table为running，ref table就设置为running
-        // NOTE 如果第一个sub_table先fail，这里会继续按正常走
-        TabletSharedPtr new_tablet = sc_params.new_tablet;
-
-        RowsetWriterContext writer_context;
-        writer_context.rowset_id = StorageEngine::instance()->next_rowset_id();
-        writer_context.tablet_uid = new_tablet->tablet_uid();
-        writer_context.tablet_id = new_tablet->tablet_id();
-        writer_context.partition_id = new_tablet->partition_id();
-        writer_context.tablet_schema_hash = new_tablet->schema_hash();
-        // linked schema change can't change rowset type, therefore we preserve rowset type in schema change now
-        writer_context.rowset_type = rs_reader->rowset()->rowset_meta()->rowset_type();
-        writer_context.rowset_path_prefix = new_tablet->tablet_path();
-        writer_context.tablet_schema = &(new_tablet->tablet_schema());
-        writer_context.rowset_state = VISIBLE;
-        writer_context.version = rs_reader->version();
-        writer_context.version_hash = rs_reader->version_hash();
-
-        std::unique_ptr<RowsetWriter> rowset_writer;
-        OLAPStatus status = RowsetFactory::create_rowset_writer(writer_context, &rowset_writer);
-        if (status != OLAP_SUCCESS) {
-            res = OLAP_ERR_ROWSET_BUILDER_INIT;
-            goto PROCESS_ALTER_EXIT;
+        LOG(INFO) << "doing linked schema change. num_threads=" << num_threads;
+    }
+    for (size_t i = 0; i < num_threads; ++i) {
+        SchemaChange* sc_procedure = nullptr;
+        if (sc_sorting) {
+            size_t memory_limitation = config::memory_limitation_per_thread_for_schema_change;
+            sc_procedure = new(nothrow) SchemaChangeWithSorting(
+                    rb_changer, memory_limitation * 1024 * 1024 * 1024);
+        } else if (sc_directly) {
+            sc_procedure = new(nothrow) SchemaChangeDirectly(rb_changer);
+        } else {
+            sc_procedure = new(nothrow) LinkedSchemaChange(rb_changer);
         }
 
-        if (!sc_procedure->process(rs_reader, rowset_writer.get(), sc_params.new_tablet, sc_params.base_tablet)) {
-            LOG(WARNING) << "failed to process the version."
-                         << " version=" << rs_reader->version().first
-                         << "-" << rs_reader->version().second;
-            res = OLAP_ERR_INPUT_PARAMETER_ERROR;
-            new_tablet->data_dir()->remove_pending_ids(ROWSET_ID_PREFIX + rowset_writer->rowset_id().to_string());
+        if (sc_procedure == nullptr) {
+            LOG(WARNING) << "failed to malloc SchemaChange. "
+                         << "malloc_size=" << sizeof(SchemaChangeWithSorting);
+            res = OLAP_ERR_MALLOC_ERROR;
             goto PROCESS_ALTER_EXIT;
         }
-        new_tablet->data_dir()->remove_pending_ids(ROWSET_ID_PREFIX + rowset_writer->rowset_id().to_string());
-        // 将新版本的数据加入header
-        // 为了防止死锁的出现，一定要先锁住旧表，再锁住新表
-        sc_params.new_tablet->obtain_push_lock();
-        RowsetSharedPtr new_rowset = rowset_writer->build();
-        if (new_rowset == nullptr) {
-            LOG(WARNING) << "failed to build rowset, exit alter process";
-            sc_params.new_tablet->release_push_lock();
-            goto PROCESS_ALTER_EXIT;
-        }
-        res = sc_params.new_tablet->add_rowset(new_rowset, false);
-        if (res == OLAP_ERR_PUSH_VERSION_ALREADY_EXIST) {
-            LOG(WARNING) << "version already exist, version revert occured. "
-                         << "tablet=" << sc_params.new_tablet->full_name()
-                         << ", version='" << rs_reader->version().first
-                         << "-" << rs_reader->version().second;
-            StorageEngine::instance()->add_unused_rowset(new_rowset);
-            res = OLAP_SUCCESS;
-        } else if (res != OLAP_SUCCESS) {
-            LOG(WARNING) << "failed to register new version. "
-                         << " tablet=" << sc_params.new_tablet->full_name()
-                         << ", version=" << rs_reader->version().first
-                         << "-" << rs_reader->version().second;
-            StorageEngine::instance()->add_unused_rowset(new_rowset);
-            sc_params.new_tablet->release_push_lock();
-            goto PROCESS_ALTER_EXIT;
-        } else {
-            VLOG(3) << "register new version. tablet=" << sc_params.new_tablet->full_name()
-                    << ", version=" << rs_reader->version().first
-                    << "-" << rs_reader->version().second;
-        }
-        sc_params.new_tablet->release_push_lock();
-
-        VLOG(10) << "succeed to convert a history version."
-                 << " version=" << rs_reader->version().first
-                 << "-" << rs_reader->version().second;
+        sc_procedures.emplace_back(sc_procedure);
     }
+
+    // c. 转换历史数据
+    res = _convert_in_parallel(
+            StorageEngine::instance()->schema_change_thread_pool(), num_threads,
+            sc_params.ref_rowset_readers.size(),
+            [&sc_params, &sc_procedures](size_t worker, size_t rowset_idx) {
+                ScopedIOClass io_class(sc_params.new_tablet->data_dir()->io_scheduler(),
+                                       IOScheduler::IO_CLASS_SCHEMA_CHANGE);
+                return _convert_historical_rowset(sc_params, sc_procedures[worker].get(),
+                                                  sc_params.ref_rowset_readers[rowset_idx]);
+            });
     // XXX: 此时应该不取消SchemaChange状态，因为新Delta还要转换成新旧Schema的版本
 PROCESS_ALTER_EXIT:
     {
         // save tablet meta here because rowset meta is not saved during add rowset
         WriteLock new_wlock(sc_params.new_tablet->get_header_lock_ptr());
-        res = sc_params.new_tablet->save_meta();    
+        OLAPStatus save_res = sc_params.new_tablet->save_meta();
+        if (res == OLAP_SUCCESS) {
+            res = save_res;
+        }
     }
     if (res == OLAP_SUCCESS) {
         Version test_version(0, end_version);
         res = sc_params.new_tablet->check_version_integrity(test_version);
     }
-    SAFE_DELETE(sc_procedure);
 
     LOG(INFO) << "finish converting rowsets for new_tablet from base_tablet. "
               << "base_tablet=" << sc_params.base_tablet->full_name()
@@ -1750,6 +1730,121 @@ PROCESS_ALTER_EXIT:
     return res;
 }
 
+OLAPStatus SchemaChangeHandler::_convert_in_parallel(
+        ThreadPool* thread_pool, size_t num_workers, size_t num_rowsets,
+        const std::function<OLAPStatus(size_t, size_t)>& convert) {
+    std::atomic<size_t> next_rowset(0);
+    std::mutex status_lock;
+    OLAPStatus res = OLAP_SUCCESS;
+    CountDownLatch latch(num_workers);
+    for (size_t i = 0; i < num_workers; ++i) {
+        auto worker = [&convert, &next_rowset, &status_lock, &res, &latch, num_rowsets, i] {
+            while (true) {
+                {
+                    // stop at the first failure
+                    std::lock_guard<std::mutex> l(status_lock);
+                    if (res != OLAP_SUCCESS) {
+                        break;
+                    }
+                }
+                size_t rowset_idx = next_rowset.fetch_add(1);
+                if (rowset_idx >= num_rowsets) {
+                    break;
+                }
+                OLAPStatus st = convert(i, rowset_idx);
+                if (st != OLAP_SUCCESS) {
+                    std::lock_guard<std::mutex> l(status_lock);
+                    if (res == OLAP_SUCCESS) {
+                        res = st;
+                    }
+                    break;
+                }
+            }
+            latch.count_down();
+        };
+        // the pool is only shut down with the engine
+        if (!thread_pool->offer(worker)) {
+            worker();
+        }
+    }
+    latch.await();
+    return res;
+}
+
+OLAPStatus SchemaChangeHandler::_convert_historical_rowset(const SchemaChangeParams& sc_params,
+                                                           SchemaChange* sc_procedure,
+                                                           const RowsetReaderSharedPtr& rs_reader) {
+    VLOG(10) << "begin to convert a history rowset. version="
+             << rs_reader->version().first << "-" << rs_reader->version().second;
+
+    TabletSharedPtr new_tablet = sc_params.new_tablet;
+
+    RowsetWriterContext writer_context;
+    writer_context.rowset_id = StorageEngine::instance()->next_rowset_id();
+    writer_context.tablet_uid = new_tablet->tablet_uid();
+    writer_context.tablet_id = new_tablet->tablet_id();
+    writer_context.partition_id = new_tablet->partition_id();
+    writer_context.tablet_schema_hash = new_tablet->schema_hash();
+    // linked schema change can't change rowset type, therefore we preserve rowset type in schema change now
+    writer_context.rowset_type = rs_reader->rowset()->rowset_meta()->rowset_type();
+    writer_context.rowset_path_prefix = new_tablet->tablet_path();
+    writer_context.tablet_schema = &(new_tablet->tablet_schema());
+    writer_context.rowset_state = VISIBLE;
+    writer_context.version = rs_reader->version();
+    writer_context.version_hash = rs_reader->version_hash();
+
+    std::unique_ptr<RowsetWriter> rowset_writer;
+    OLAPStatus res = RowsetFactory::create_rowset_writer(writer_context, &rowset_writer);
+    if (res != OLAP_SUCCESS) {
+        return OLAP_ERR_ROWSET_BUILDER_INIT;
+    }
+
+    if (!sc_procedure->process(rs_reader, rowset_writer.get(), new_tablet, sc_params.base_tablet)) {
+        LOG(WARNING) << "failed to process the version."
+                     << " version=" << rs_reader->version().first
+                     << "-" << rs_reader->version().second;
+        new_tablet->data_dir()->remove_pending_ids(ROWSET_ID_PREFIX + rowset_writer->rowset_id().to_string());
+        return OLAP_ERR_INPUT_PARAMETER_ERROR;
+    }
+    new_tablet->data_dir()->remove_pending_ids(ROWSET_ID_PREFIX + rowset_writer->rowset_id().to_string());
+    // 将新版本的数据加入header
+    // 为了防止死锁的出现，一定要先锁住旧表，再锁住新表
+    new_tablet->obtain_push_lock();
+    RowsetSharedPtr new_rowset = rowset_writer->build();
+    if (new_rowset == nullptr) {
+        LOG(WARNING) << "failed to build rowset, exit alter process";
+        new_tablet->release_push_lock();
+        return OLAP_ERR_MALLOC_ERROR;
+    }
+    res = new_tablet->add_rowset(new_rowset, false);
+    if (res == OLAP_ERR_PUSH_VERSION_ALREADY_EXIST) {
+        LOG(WARNING) << "version already exist, version revert occured. "
+                     << "tablet=" << new_tablet->full_name()
+                     << ", version='" << rs_reader->version().first
+                     << "-" << rs_reader->version().second;
+        StorageEngine::instance()->add_unused_rowset(new_rowset);
+        res = OLAP_SUCCESS;
+    } else if (res != OLAP_SUCCESS) {
+        LOG(WARNING) << "failed to register new version. "
+                     << " tablet=" << new_tablet->full_name()
+                     << ", version=" << rs_reader->version().first
+                     << "-" << rs_reader->version().second;
+        StorageEngine::instance()->add_unused_rowset(new_rowset);
+        new_tablet->release_push_lock();
+        return res;
+    } else {
+        VLOG(3) << "register new version. tablet=" << new_tablet->full_name()
+                << ", version=" << rs_reader->version().first
+                << "-" << rs_reader->version().second;
+    }
+    new_tablet->release_push_lock();
+
+    VLOG(10) << "succeed to convert a history version."
+             << " version=" << rs_reader->version().first
+             << "-" << rs_reader->version().second;
+    return OLAP_SUCCESS;
+}
+
 // @static
 // 分析column的mapping以及filter key的mapping
 OLAPStatus SchemaChangeHandler::_parse_request(TabletSharedPtr base_tablet,
@@ -1877,14 +1972,45 @@ OLAPStatus SchemaChangeHandler::_parse_request(TabletSharedPtr base_tablet,
         }
     }
 
-    if (base_tablet->delete_predicates().size() != 0){
-        //there exists delete condition in header, can't do linked schema change
+    if (!_delete_predicates_can_be_linked(base_tablet, new_tablet)) {
+        // the delete conditions can't be applied to the new schema, the deleted
+        // rows have to be filtered out while rewriting the data
         *sc_directly = true;
     }
 
     return OLAP_SUCCESS;
 }
 
+// Adding a column or dropping a value column doesn't touch the data: the linked
+// segments are read with the new schema, a column absent in a segment is read
+// as its default value (DefaultValueColumnIterator for segment_v2) and a column
+// absent in the schema is never read. The delete predicates of the base tablet
+// go with the linked rowsets and are applied when reading, which is fine as long
+// as the columns they refer to are still in the new schema.
+bool SchemaChangeHandler::_delete_predicates_can_be_linked(TabletSharedPtr base_tablet,
+                                                           TabletSharedPtr new_tablet) {
+    const TabletSchema& base_schema = base_tablet->tablet_schema();
+    const TabletSchema& new_schema = new_tablet->tablet_schema();
+    for (const DeletePredicatePB& delete_predicate : base_tablet->delete_predicates()) {
+        for (const string& sub_predicate : delete_predicate.sub_predicates()) {
+            TCondition condition;
+            if (!DeleteHandler::parse_condition(sub_predicate, &condition)) {
+                return false;
+            }
+            int32_t base_index = base_schema.field_index(condition.column_name);
+            int32_t new_index = new_schema.field_index(condition.column_name);
+            if (base_index < 0 || new_index < 0
+                    || base_schema.column(base_index).unique_id()
+                            != new_schema.column(new_index).unique_id()) {
+                VLOG(3) << "delete condition refers to a changed column. condition="
+                        << sub_predicate;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 OLAPStatus SchemaChangeHandler::_init_column_mapping(ColumnMapping* column_mapping,
                                                      const TabletColumn& column_schema,
                                                      const std::string& value) {
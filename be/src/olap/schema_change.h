@@ -19,6 +19,7 @@
 #define DORIS_BE_SRC_OLAP_SCHEMA_CHANGE_H
 
 #include <deque>
+#include <functional>
 #include <queue>
 #include <vector>
 
@@ -39,6 +40,7 @@ class Tablet;
 class RowBlock;
 // defined in 'row_cursor.h'
 class RowCursor;
+class ThreadPool;
 
 class RowBlockChanger {
 public:
@@ -89,6 +91,32 @@ private:
     size_t _memory_limitation;
 };
 
+class RowBlockSorter {
+public:
+    explicit RowBlockSorter(RowBlockAllocator* allocator);
+    virtual ~RowBlockSorter();
+
+    bool sort(RowBlock** row_block);
+
+private:
+    friend class SchemaChangeTest;
+
+    // A row and the first bytes of its encoded short key, big endian, so that most
+    // comparisons of the sort are one integer comparison.
+    struct SortEntry {
+        uint64_t key_prefix;
+        RowCursor* row_cursor;
+    };
+
+    static uint64_t _encode_key_prefix(const RowCursor& row, size_t num_short_key_columns,
+                                       std::string* buf);
+
+    static bool _sort_entry_comparator(const SortEntry& a, const SortEntry& b);
+
+    RowBlockAllocator* _row_block_allocator;
+    RowBlock* _swap_row_block;
+};
+
 class SchemaChange {
 public:
     SchemaChange() : _filtered_rows(0), _merged_rows(0) {}
@@ -219,6 +247,8 @@ public:
     OLAPStatus process_alter_tablet_v2(const TAlterTabletReqV2& request);
 
 private:
+    friend class SchemaChangeTest;
+
     // 检查schema_change相关的状态:清理"一对"schema_change table间的信息
     // 由于A->B的A的schema_change信息会在后续处理过程中覆盖（这里就没有额外清除）
     // Returns:
@@ -254,12 +284,29 @@ private:
 
     static OLAPStatus _convert_historical_rowsets(const SchemaChangeParams& sc_params);
 
+    // Calls 'convert'(worker, rowset) for the rowsets 0 to 'num_rowsets' - 1 on
+    // 'num_workers' tasks of 'thread_pool', each worker taking the next rowset left.
+    // The workers stop at the first failure, which is returned.
+    static OLAPStatus _convert_in_parallel(
+            ThreadPool* thread_pool, size_t num_workers, size_t num_rowsets,
+            const std::function<OLAPStatus(size_t, size_t)>& convert);
+
+    // converts one historical rowset by 'sc_procedure' and adds it to the new tablet
+    static OLAPStatus _convert_historical_rowset(const SchemaChangeParams& sc_params,
+                                                 SchemaChange* sc_procedure,
+                                                 const RowsetReaderSharedPtr& rs_reader);
+
     static OLAPStatus _parse_request(TabletSharedPtr base_tablet,
                                      TabletSharedPtr new_tablet,
                                      RowBlockChanger* rb_changer,
                                      bool* sc_sorting,
                                      bool* sc_directly);
 
+    // Whether the delete predicates of 'base_tablet' still hold for the schema of
+    // 'new_tablet', so that its rowsets can be linked instead of rewritten.
+    static bool _delete_predicates_can_be_linked(TabletSharedPtr base_tablet,
+                                                 TabletSharedPtr new_tablet);
+
     // 需要新建default_value时的初始化设置
     static OLAPStatus _init_column_mapping(ColumnMapping* column_mapping,
                                            const TabletColumn& column_schema,
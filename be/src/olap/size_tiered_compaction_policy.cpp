@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "olap/size_tiered_compaction_policy.h"
+
+#include <algorithm>
+
+#include "common/config.h"
+
+namespace doris {
+
+// the weight of a rowset in its level
+static int64_t rowset_weight(const RowsetMeta& rs_meta) {
+    if (rs_meta.start_version() == rs_meta.end_version()) {
+        return std::max<int64_t>(1, rs_meta.num_segments());
+    }
+    return 1;
+}
+
+SizeTieredCompactionPolicy::SizeTieredCompactionPolicy() :
+        SizeTieredCompactionPolicy(config::size_tiered_compaction_min_bytes,
+                                   config::size_tiered_compaction_fanout,
+                                   config::cumulative_compaction_budgeted_bytes,
+                                   config::max_cumulative_compaction_num_singleton_deltas) {
+}
+
+SizeTieredCompactionPolicy::SizeTieredCompactionPolicy(
+        int64_t min_bytes, int64_t fanout, int64_t promote_bytes, int64_t max_rowsets) :
+        _min_bytes(std::max<int64_t>(min_bytes, 1)),
+        _fanout(std::max<int64_t>(fanout, 2)),
+        _promote_bytes(promote_bytes),
+        _max_rowsets(std::max<int64_t>(max_rowsets, 2)) {
+}
+
+int SizeTieredCompactionPolicy::level(int64_t bytes) const {
+    int level = 0;
+    int64_t upper = _min_bytes;
+    while (bytes >= upper) {
+        ++level;
+        if (upper > INT64_MAX / _fanout) {
+            break;
+        }
+        upper *= _fanout;
+    }
+    return level;
+}
+
+void SizeTieredCompactionPolicy::_full_runs(const std::vector<RowsetMetaSharedPtr>& rs_metas,
+                                            std::vector<Run>* runs) const {
+    if (rs_metas.empty()) {
+        return;
+    }
+    size_t i = 0;
+    while (i < rs_metas.size() - 1) {
+        if (rs_metas[i]->has_delete_predicate()) {
+            ++i;
+            continue;
+        }
+        Run run;
+        run.start = i;
+        run.level = level(rs_metas[i]->data_disk_size());
+        run.weight = 0;
+        while (i < rs_metas.size() - 1 && !rs_metas[i]->has_delete_predicate()
+                && level(rs_metas[i]->data_disk_size()) == run.level
+                && static_cast<int64_t>(i - run.start) < _max_rowsets) {
+            run.weight += rowset_weight(*rs_metas[i]);
+            ++i;
+        }
+        run.end = i;
+        // merging one rowset wouldn't get rid of its overlapping segments
+        if (run.weight >= _fanout && run.end - run.start > 1) {
+            runs->push_back(run);
+        }
+    }
+}
+
+uint32_t SizeTieredCompactionPolicy::calc_score(
+        const std::vector<RowsetMetaSharedPtr>& rs_metas) const {
+    std::vector<Run> runs;
+    _full_runs(rs_metas, &runs);
+    int64_t score = 0;
+    for (auto& run : runs) {
+        score += run.weight;
+    }
+    return std::min<int64_t>(score, UINT32_MAX);
+}
+
+bool SizeTieredCompactionPolicy::pick_rowsets(const std::vector<RowsetMetaSharedPtr>& rs_metas,
+                                              size_t* start, size_t* end) const {
+    std::vector<Run> runs;
+    _full_runs(rs_metas, &runs);
+    if (runs.empty()) {
+        return false;
+    }
+    auto run = std::min_element(runs.begin(), runs.end(), [](const Run& a, const Run& b) {
+        return a.level < b.level;
+    });
+    *start = run->start;
+    *end = run->end;
+    return true;
+}
+
+int64_t SizeTieredCompactionPolicy::calc_cumulative_point(
+        const std::vector<RowsetMetaSharedPtr>& rs_metas, int64_t point) const {
+    if (rs_metas.empty()) {
+        return point;
+    }
+    for (size_t i = 0; i < rs_metas.size() - 1; ++i) {
+        const RowsetMeta& rs_meta = *rs_metas[i];
+        if (rs_meta.start_version() < point) {
+            continue;
+        }
+        // only base compaction merges the rowsets with a delete predicate
+        if (rs_meta.start_version() != point
+                || (rs_meta.data_disk_size() < _promote_bytes && !rs_meta.has_delete_predicate())) {
+            break;
+        }
+        point = rs_meta.end_version() + 1;
+    }
+    return point;
+}
+
+}  // namespace doris
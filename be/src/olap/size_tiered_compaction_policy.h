@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_OLAP_SIZE_TIERED_COMPACTION_POLICY_H
+#define DORIS_BE_SRC_OLAP_SIZE_TIERED_COMPACTION_POLICY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "olap/rowset/rowset_meta.h"
+
+namespace doris {
+
+// Size-tiered policy of cumulative compaction.
+//
+// The rowsets above the cumulative point are put into levels by size: level 0
+// holds the rowsets smaller than 'min_bytes', level n the ones from
+// min_bytes * fanout^(n-1) up to min_bytes * fanout^n. Once 'fanout' neighbouring
+// rowsets are in the same level they are merged into about one rowset of the
+// next level. So a row is rewritten once per level, instead of every time the
+// growing cumulative rowset absorbs a few more small loads.
+//
+// The segments of a load rowset overlap each other, reading it costs as much as
+// reading that many rowsets. Such a rowset fills its level by its number of
+// segments.
+//
+// The rowsets reaching 'promote_bytes', and the ones with a delete predicate, are
+// left to base compaction by moving the cumulative point past them.
+class SizeTieredCompactionPolicy {
+public:
+    // Takes the parameters from the configs.
+    SizeTieredCompactionPolicy();
+    SizeTieredCompactionPolicy(int64_t min_bytes, int64_t fanout,
+                               int64_t promote_bytes, int64_t max_rowsets);
+
+    int level(int64_t bytes) const;
+
+    // 'rs_metas' are the rowsets from the cumulative point on, sorted by version
+    // and without holes. The last one is never compacted, as its version hash is
+    // what the FE knows, and neither are the rowsets with a delete predicate.
+
+    // Returns how much the full levels cost to read, 0 if no level is full.
+    uint32_t calc_score(const std::vector<RowsetMetaSharedPtr>& rs_metas) const;
+
+    // Picks the full level with the smallest rowsets and sets [*start, *end) to its
+    // rowsets in 'rs_metas'. Returns false if no level is full.
+    bool pick_rowsets(const std::vector<RowsetMetaSharedPtr>& rs_metas,
+                      size_t* start, size_t* end) const;
+
+    // Returns the cumulative point after the rowsets from 'point' on which are left
+    // to base compaction.
+    int64_t calc_cumulative_point(const std::vector<RowsetMetaSharedPtr>& rs_metas,
+                                  int64_t point) const;
+
+private:
+    struct Run {
+        size_t start;
+        size_t end;
+        int level;
+        int64_t weight;
+    };
+
+    // The full runs of neighbouring rowsets of the same level.
+    void _full_runs(const std::vector<RowsetMetaSharedPtr>& rs_metas,
+                    std::vector<Run>* runs) const;
+
+    const int64_t _min_bytes;
+    const int64_t _fanout;
+    const int64_t _promote_bytes;
+    const int64_t _max_rowsets;
+};
+
+}  // namespace doris
+
+#endif // DORIS_BE_SRC_OLAP_SIZE_TIERED_COMPACTION_POLICY_H
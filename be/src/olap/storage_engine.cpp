@@ -50,6 +50,7 @@
 #include "olap/rowset/column_data_writer.h"
 #include "olap/olap_snapshot_converter.h"
 #include "olap/rowset/unique_rowset_id_generator.h"
+#include "util/thread_pool.hpp"
 #include "util/time.h"
 #include "util/doris_metrics.h"
 #include "util/pretty_printer.h"
@@ -116,8 +117,12 @@ StorageEngine::StorageEngine(const EngineOptions& options)
         _tablet_manager(new TabletManager()),
         _txn_manager(new TxnManager()),
         _rowset_id_generator(new UniqueRowsetIdGenerator(options.backend_uid)),
+        _compaction_merge_thread_pool(nullptr),
+        _schema_change_thread_pool(nullptr),
+        _clone_download_thread_pool(nullptr),
         _default_rowset_type(ALPHA_ROWSET),
-        _compaction_rowset_type(ALPHA_ROWSET) {
+        _compaction_rowset_type(ALPHA_ROWSET),
+        _default_compaction_policy(NUM_BASED_COMPACTION) {
     if (_s_instance == nullptr) {
         _s_instance = this;
     }
@@ -202,7 +207,18 @@ OLAPStatus StorageEngine::open() {
     _memtable_flush_executor = new MemTableFlushExecutor();
     _memtable_flush_executor->init(dirs);
 
+    _compaction_merge_thread_pool = new ThreadPool(
+            config::compaction_merge_thread_pool_size,
+            config::compaction_merge_thread_pool_queue_size);
+    _schema_change_thread_pool = new ThreadPool(
+            config::schema_change_thread_pool_size,
+            config::schema_change_thread_pool_queue_size);
+    _clone_download_thread_pool = new ThreadPool(
+            config::clone_download_thread_pool_size,
+            config::clone_download_thread_pool_queue_size);
+
     _parse_default_rowset_type();
+    _parse_default_compaction_policy();
 
     return OLAP_SUCCESS;
 }
@@ -316,6 +332,7 @@ OLAPStatus StorageEngine::get_all_data_dir_info(vector<DataDirInfo>* data_dir_in
 void StorageEngine::start_disk_stat_monitor() {
     for (auto& it : _store_map) {
         it.second->health_check();
+        it.second->io_scheduler()->tune();
     }
     _update_storage_medium_type_count();
     _delete_tablets_on_unused_root_path();
@@ -461,6 +478,10 @@ void StorageEngine::_delete_tablets_on_unused_root_path() {
 }
 
 OLAPStatus StorageEngine::clear() {
+    // the running merges, conversions and clone downloads use the stores
+    SAFE_DELETE(_compaction_merge_thread_pool);
+    SAFE_DELETE(_schema_change_thread_pool);
+    SAFE_DELETE(_clone_download_thread_pool);
     // 删除lru中所有内容,其实进程退出这么做本身意义不大,但对单测和更容易发现问题还是有很大意义的
     delete FileHandler::get_fd_cache();
     FileHandler::set_fd_cache(nullptr);
@@ -539,6 +560,8 @@ void StorageEngine::perform_cumulative_compaction(DataDir* data_dir) {
     CumulativeCompaction cumulative_compaction(best_tablet);
 
     OLAPStatus res = cumulative_compaction.compact();
+    // the cumulative point may have moved even if nothing was compacted
+    best_tablet->update_compaction_scores();
     if (res != OLAP_SUCCESS) {
         best_tablet->set_last_compaction_failure_time(UnixMillis());
         if (res != OLAP_ERR_CUMULATIVE_NO_SUITABLE_VERSIONS) {
@@ -559,6 +582,7 @@ void StorageEngine::perform_base_compaction(DataDir* data_dir) {
     DorisMetrics::base_compaction_request_total.increment(1);
     BaseCompaction base_compaction(best_tablet);
     OLAPStatus res = base_compaction.compact();
+    best_tablet->update_compaction_scores();
     if (res != OLAP_SUCCESS) {
         best_tablet->set_last_compaction_failure_time(UnixMillis());
         if (res != OLAP_ERR_CUMULATIVE_NO_SUITABLE_VERSIONS) {
@@ -763,6 +787,17 @@ void StorageEngine::_parse_default_rowset_type() {
     }
 }
 
+// invalid compaction policy config will return NUM_BASED_COMPACTION
+void StorageEngine::_parse_default_compaction_policy() {
+    std::string compaction_policy_config = config::default_cumulative_compaction_policy;
+    boost::to_upper(compaction_policy_config);
+    if (compaction_policy_config == "SIZE_TIERED") {
+        _default_compaction_policy = SIZE_TIERED_COMPACTION;
+    } else {
+        _default_compaction_policy = NUM_BASED_COMPACTION;
+    }
+}
+
 void StorageEngine::start_delete_unused_rowset() {
     _gc_mutex.lock();
     for (auto it = _unused_rowsets.begin(); it != _unused_rowsets.end();) {
@@ -54,6 +54,7 @@ namespace doris {
 class DataDir;
 class EngineTask;
 class MemTableFlushExecutor;
+class ThreadPool;
 class Tablet;
 
 // StorageEngine singleton to manage all Table pointers.
@@ -207,11 +208,23 @@ public:
 
     MemTableFlushExecutor* memtable_flush_executor() { return _memtable_flush_executor; }
 
+    // merges the key ranges of the compactions merging in parallel
+    ThreadPool* compaction_merge_thread_pool() { return _compaction_merge_thread_pool; }
+
+    // converts the historical rowsets of the schema changes
+    ThreadPool* schema_change_thread_pool() { return _schema_change_thread_pool; }
+
+    // downloads the files of the clone tasks
+    ThreadPool* clone_download_thread_pool() { return _clone_download_thread_pool; }
+
     RowsetTypePB default_rowset_type() const { return _default_rowset_type; }
 
     RowsetTypePB compaction_rowset_type() const { return _compaction_rowset_type; }
 
+    CompactionPolicyPB default_compaction_policy() const { return _default_compaction_policy; }
+
 private:
+    friend class CompactionTest;
 
     OLAPStatus _check_file_descriptor_number();
 
@@ -267,6 +280,9 @@ private:
     // parse the default rowset type config to RowsetTypePB
     void _parse_default_rowset_type();
 
+    // parse the default cumulative compaction policy config to CompactionPolicyPB
+    void _parse_default_compaction_policy();
+
 private:
 
     struct CompactionCandidate {
@@ -365,12 +381,18 @@ private:
 
     MemTableFlushExecutor* _memtable_flush_executor;
 
+    ThreadPool* _compaction_merge_thread_pool;
+    ThreadPool* _schema_change_thread_pool;
+    ThreadPool* _clone_download_thread_pool;
+
     // default rowset type for load
     // used to decide the type of new loaded data
     RowsetTypePB _default_rowset_type;
     // default rowset type for compaction.
     // used to control the the process of converting old data
     RowsetTypePB _compaction_rowset_type;
+    // cumulative compaction policy of the new tablets which don't specify one
+    CompactionPolicyPB _default_compaction_policy;
 
     DISALLOW_COPY_AND_ASSIGN(StorageEngine);
 };
@@ -33,6 +33,7 @@
 #include "olap/storage_engine.h"
 #include "olap/reader.h"
 #include "olap/row_cursor.h"
+#include "olap/size_tiered_compaction_policy.h"
 #include "olap/rowset/rowset_meta_manager.h"
 #include "olap/rowset/rowset_factory.h"
 #include "olap/tablet_meta_manager.h"
@@ -235,6 +236,7 @@ OLAPStatus Tablet::revise_tablet_meta(
     }
 
     _rs_graph.reconstruct_rowset_graph(_tablet_meta->all_rs_metas());
+    _update_compaction_scores();
 
     LOG(INFO) << "finish to clone data to tablet. res=" << res << ", "
               << "table=" << full_name() << ", "
@@ -243,7 +245,9 @@ OLAPStatus Tablet::revise_tablet_meta(
 }
 
 OLAPStatus Tablet::register_tablet_into_dir() {
-    return _data_dir->register_tablet(this);
+    RETURN_NOT_OK(_data_dir->register_tablet(this));
+    update_compaction_scores();
+    return OLAP_SUCCESS;
 }
 
 OLAPStatus Tablet::deregister_tablet_from_dir() {
@@ -321,6 +325,7 @@ OLAPStatus Tablet::modify_rowsets(const vector<RowsetSharedPtr>& to_add,
     }
 
     _rs_graph.reconstruct_rowset_graph(_tablet_meta->all_rs_metas());
+    _update_compaction_scores();
 
     return OLAP_SUCCESS;
 }
@@ -412,6 +417,7 @@ OLAPStatus Tablet::add_inc_rowset(const RowsetSharedPtr& rowset) {
     RETURN_NOT_OK(_rs_graph.add_version_to_graph(rowset->version()));
     RETURN_NOT_OK(_tablet_meta->add_inc_rs_meta(rowset->rowset_meta()));
     ++_newly_created_rowset_num;
+    _update_compaction_scores();
     return OLAP_SUCCESS;
 }
 
@@ -668,6 +674,9 @@ bool Tablet::can_do_compaction() {
 }
 
 const uint32_t Tablet::calc_cumulative_compaction_score() const {
+    if (compaction_policy() == SIZE_TIERED_COMPACTION) {
+        return _calc_size_tiered_compaction_score();
+    }
     uint32_t score = 0;
     bool base_rowset_exist = false;
     const int64_t point = cumulative_layer_point();
@@ -687,6 +696,28 @@ const uint32_t Tablet::calc_cumulative_compaction_score() const {
     return base_rowset_exist ? score : 0;
 }
 
+uint32_t Tablet::_calc_size_tiered_compaction_score() const {
+    std::vector<RowsetMetaSharedPtr> rs_metas;
+    bool base_rowset_exist = false;
+    const int64_t point = cumulative_layer_point();
+    for (auto& rs_meta : _tablet_meta->all_rs_metas()) {
+        if (rs_meta->start_version() >= point) {
+            rs_metas.push_back(rs_meta);
+        }
+        if (rs_meta->start_version() == 0) {
+            base_rowset_exist = true;
+        }
+    }
+    if (!base_rowset_exist) {
+        return 0;
+    }
+    std::sort(rs_metas.begin(), rs_metas.end(),
+              [](const RowsetMetaSharedPtr& a, const RowsetMetaSharedPtr& b) {
+        return a->start_version() < b->start_version();
+    });
+    return SizeTieredCompactionPolicy().calc_score(rs_metas);
+}
+
 const uint32_t Tablet::calc_base_compaction_score() const {
     uint32_t score = 0;
     const int64_t point = cumulative_layer_point();
@@ -705,6 +736,20 @@ const uint32_t Tablet::calc_base_compaction_score() const {
     return base_rowset_exist ? score : 0;
 }
 
+void Tablet::update_compaction_scores() {
+    ReadLock rdlock(&_meta_lock);
+    _update_compaction_scores();
+}
+
+void Tablet::_update_compaction_scores() {
+    if (_data_dir == nullptr) {
+        return;
+    }
+    TabletInfo tablet_info(tablet_id(), schema_hash(), tablet_uid());
+    _data_dir->update_compaction_scores(tablet_info, calc_cumulative_compaction_score(),
+                                        calc_base_compaction_score());
+}
+
 OLAPStatus Tablet::compute_all_versions_hash(const vector<Version>& versions,
                                              VersionHash* version_hash) const {
     DCHECK(version_hash != nullptr) << "invalid parameter, version_hash is nullptr";
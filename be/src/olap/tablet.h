@@ -86,6 +86,7 @@ public:
     inline void set_creation_time(int64_t creation_time);
     inline const int64_t cumulative_layer_point() const;
     inline void set_cumulative_layer_point(const int64_t new_point);
+    inline CompactionPolicyPB compaction_policy() const;
 
     inline bool equal(int64_t tablet_id, int32_t schema_hash);
     inline size_t tablet_footprint(); // disk space occupied by tablet
@@ -182,6 +183,10 @@ public:
     bool can_do_compaction();
     const uint32_t calc_cumulative_compaction_score() const;
     const uint32_t calc_base_compaction_score() const;
+    // Recalculates the compaction scores of the tablet in its DataDir. Called when
+    // the scores change outside of the rowset operations of the tablet, e.g. after
+    // the cumulative point moved, it must not hold the header lock.
+    void update_compaction_scores();
     OLAPStatus compute_all_versions_hash(const std::vector<Version>& versions,
                                          VersionHash* version_hash) const;
     void compute_version_hash_from_rowsets(const std::vector<RowsetSharedPtr>& rowsets,
@@ -254,6 +259,9 @@ private:
     void _print_missed_versions(const std::vector<Version>& missed_versions) const;
     OLAPStatus _check_added_rowset(const RowsetSharedPtr& rowset);
     OLAPStatus _max_continuous_version_from_begining(Version* version, VersionHash* v_hash);
+    // same as update_compaction_scores(), but the caller holds the header lock
+    void _update_compaction_scores();
+    uint32_t _calc_size_tiered_compaction_score() const;
 
 private:
     TabletState _state;
@@ -341,6 +349,10 @@ void inline Tablet::set_cumulative_layer_point(const int64_t new_point) {
     _cumulative_point = new_point;
 }
 
+inline CompactionPolicyPB Tablet::compaction_policy() const {
+    return _tablet_meta->compaction_policy();
+}
+
 inline bool Tablet::equal(int64_t tablet_id, int32_t schema_hash) {
     return (_tablet_meta->tablet_id() == tablet_id) && (_tablet_meta->schema_hash() == schema_hash);
 }
@@ -20,7 +20,9 @@
 #include <signal.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <memory>
 #include <new>
 #include <queue>
 #include <set>
@@ -79,9 +81,84 @@ bool _sort_tablet_by_creation_time(const TabletSharedPtr& a, const TabletSharedP
     return a->creation_time() < b->creation_time();
 }
 
+// Like ReadLock and WriteLock, but the time spent waiting for a tablets shard lock
+// held by another thread is added to the tablet map lock metrics.
+static void lock_tablets_shard(RWMutex* lock, bool exclusive) {
+    if ((exclusive ? lock->trywrlock() : lock->tryrdlock()) == OLAP_SUCCESS) {
+        return;
+    }
+    int64_t start_ns = MonotonicNanos();
+    if (exclusive) {
+        lock->wrlock();
+    } else {
+        lock->rdlock();
+    }
+    DorisMetrics::tablet_map_lock_contended_total.increment(1);
+    DorisMetrics::tablet_map_lock_wait_us.increment((MonotonicNanos() - start_ns) / 1000);
+}
+
+class TabletsShardReadLock {
+public:
+    explicit TabletsShardReadLock(RWMutex* lock) : _lock(lock) {
+        lock_tablets_shard(_lock, false);
+    }
+    ~TabletsShardReadLock() {
+        _lock->unlock();
+    }
+
+private:
+    RWMutex* _lock;
+    DISALLOW_COPY_AND_ASSIGN(TabletsShardReadLock);
+};
+
+class TabletsShardWriteLock {
+public:
+    explicit TabletsShardWriteLock(RWMutex* lock) : _lock(lock) {
+        lock_tablets_shard(_lock, true);
+    }
+    ~TabletsShardWriteLock() {
+        _lock->unlock();
+    }
+
+private:
+    RWMutex* _lock;
+    DISALLOW_COPY_AND_ASSIGN(TabletsShardWriteLock);
+};
+
+// Write locks the shard of a tablet and read locks the shard of the tablet related
+// to it, if that is another one. The shards are locked in their order in
+// _tablets_shards, so two threads doing this for the two tablets of a schema change
+// don't deadlock.
+class TabletManager::RelatedShardsLock {
+public:
+    RelatedShardsLock(TabletManager* tablet_manager, TTabletId tablet_id,
+                      TTabletId related_tablet_id) {
+        RWMutex* lock = &tablet_manager->_get_tablets_shard_lock(tablet_id);
+        RWMutex* related_lock = &tablet_manager->_get_tablets_shard_lock(related_tablet_id);
+        if (related_lock < lock) {
+            _related_lock.reset(new TabletsShardReadLock(related_lock));
+        }
+        _lock.reset(new TabletsShardWriteLock(lock));
+        if (related_lock > lock) {
+            _related_lock.reset(new TabletsShardReadLock(related_lock));
+        }
+    }
+
+private:
+    std::unique_ptr<TabletsShardReadLock> _related_lock;
+    std::unique_ptr<TabletsShardWriteLock> _lock;
+    DISALLOW_COPY_AND_ASSIGN(RelatedShardsLock);
+};
+
 TabletManager::TabletManager()
-    : _tablet_stat_cache_update_time_ms(0),
-      _available_storage_medium_type_count(0) { }
+    : _tablets_shards(config::tablet_map_shard_size),
+      _tablets_shards_mask(config::tablet_map_shard_size - 1),
+      _tablet_stat_cache_update_time_ms(0),
+      _available_storage_medium_type_count(0) {
+    CHECK_GT(config::tablet_map_shard_size, 0);
+    CHECK_EQ(config::tablet_map_shard_size & _tablets_shards_mask, 0)
+            << "tablet_map_shard_size must be a power of 2";
+}
 
 OLAPStatus TabletManager::_add_tablet_unlock(TTabletId tablet_id, SchemaHash schema_hash,
                                  const TabletSharedPtr& tablet, bool update_meta, bool force) {
@@ -91,7 +168,7 @@ OLAPStatus TabletManager::_add_tablet_unlock(TTabletId tablet_id, SchemaHash sch
             << ", force=" << force;
 
     TabletSharedPtr table_item = nullptr;
-    for (TabletSharedPtr item : _tablet_map[tablet_id].table_arr) {
+    for (TabletSharedPtr item : _get_tablet_map(tablet_id)[tablet_id].table_arr) {
         if (item->equal(tablet_id, schema_hash)) {
             table_item = item;
             break;
@@ -141,7 +218,7 @@ OLAPStatus TabletManager::_add_tablet_unlock(TTabletId tablet_id, SchemaHash sch
     /*
      * In restore process, we replace all origin files in tablet dir with
      * the downloaded snapshot files. Than we try to reload tablet header.
-     * force == true means we forcibly replace the Tablet in _tablet_map
+     * force == true means we forcibly replace the Tablet in the tablet map
      * with the new one. But if we do so, the files in the tablet dir will be
      * dropped when the origin Tablet deconstruct.
      * So we set keep_files == true to not delete files when the
@@ -200,11 +277,15 @@ OLAPStatus TabletManager::_add_tablet_to_map(TTabletId tablet_id, SchemaHash sch
                         << ", data_dir=" << tablet->data_dir()->path();
         return res;
     }
-    _tablet_map[tablet_id].table_arr.push_back(tablet);
-    _tablet_map[tablet_id].table_arr.sort(_sort_tablet_by_creation_time);
+    tablet_map_t& tablet_map = _get_tablet_map(tablet_id);
+    tablet_map[tablet_id].table_arr.push_back(tablet);
+    tablet_map[tablet_id].table_arr.sort(_sort_tablet_by_creation_time);
 
     // add the tablet id to partition map
-    _partition_tablet_map[tablet->partition_id()].insert(tablet->get_tablet_info());
+    {
+        WriteLock wlock(&_partition_tablet_map_lock);
+        _partition_tablet_map[tablet->partition_id()].insert(tablet->get_tablet_info());
+    }
 
     VLOG(3) << "add tablet to map successfully" 
             << " tablet_id = " << tablet_id
@@ -213,28 +294,34 @@ OLAPStatus TabletManager::_add_tablet_to_map(TTabletId tablet_id, SchemaHash sch
 }
 
 bool TabletManager::check_tablet_id_exist(TTabletId tablet_id) {
-    ReadLock rlock(&_tablet_map_lock);
+    TabletsShardReadLock rlock(&_get_tablets_shard_lock(tablet_id));
     return _check_tablet_id_exist_unlock(tablet_id);
 } // check_tablet_id_exist
 
 bool TabletManager::_check_tablet_id_exist_unlock(TTabletId tablet_id) {
     bool is_exist = false;
 
-    tablet_map_t::iterator it = _tablet_map.find(tablet_id);
-    if (it != _tablet_map.end() && it->second.table_arr.size() != 0) {
+    tablet_map_t& tablet_map = _get_tablet_map(tablet_id);
+    tablet_map_t::iterator it = tablet_map.find(tablet_id);
+    if (it != tablet_map.end() && it->second.table_arr.size() != 0) {
         is_exist = true;
     }
     return is_exist;
 } // check_tablet_id_exist
 
 void TabletManager::clear() {
-    _tablet_map.clear();
+    for (auto& shard : _tablets_shards) {
+        shard.tablet_map.clear();
+    }
     _shutdown_tablets.clear();
 } // clear
 
 OLAPStatus TabletManager::create_tablet(const TCreateTabletReq& request,
     std::vector<DataDir*> stores) {
-    WriteLock wrlock(&_tablet_map_lock);
+    // the base tablet of an alter tablet request is looked up in its shard
+    bool has_base_tablet = request.__isset.base_tablet_id && request.base_tablet_id > 0;
+    RelatedShardsLock lock(this, request.tablet_id,
+                           has_base_tablet ? request.base_tablet_id : request.tablet_id);
     LOG(INFO) << "begin to process create tablet. tablet=" << request.tablet_id
               << ", schema_hash=" << request.tablet_schema.schema_hash;
     OLAPStatus res = OLAP_SUCCESS;
@@ -260,7 +347,7 @@ OLAPStatus TabletManager::create_tablet(const TCreateTabletReq& request,
     TabletSharedPtr ref_tablet = nullptr;
     bool is_schema_change_tablet = false;
     // if the CreateTabletReq has base_tablet_id then it is a alter tablet request
-    if (request.__isset.base_tablet_id && request.base_tablet_id > 0) {
+    if (has_base_tablet) {
         is_schema_change_tablet = true;
         ref_tablet = _get_tablet_with_no_lock(request.base_tablet_id, request.base_schema_hash);
         if (ref_tablet == nullptr) {
@@ -290,7 +377,7 @@ TabletSharedPtr TabletManager::create_tablet(const AlterTabletType alter_type,
         const TCreateTabletReq& request, const bool is_schema_change_tablet,
         const TabletSharedPtr ref_tablet, std::vector<DataDir*> data_dirs) {
     DCHECK(is_schema_change_tablet && ref_tablet != nullptr);
-    WriteLock wrlock(&_tablet_map_lock);
+    RelatedShardsLock lock(this, request.tablet_id, ref_tablet->tablet_id());
     return _internal_create_tablet(alter_type, request, is_schema_change_tablet,
         ref_tablet, data_dirs);
 }
@@ -473,10 +560,37 @@ TabletSharedPtr TabletManager::_create_tablet_meta_and_dir(
 //          drop specified tablet and clear schema change info.
 OLAPStatus TabletManager::drop_tablet(
         TTabletId tablet_id, SchemaHash schema_hash, bool keep_files) {
-    WriteLock wlock(&_tablet_map_lock);
-    return _drop_tablet_unlock(tablet_id, schema_hash, keep_files);
+    return _run_with_related_shards_locked(tablet_id, schema_hash, [&] {
+        return _drop_tablet_unlock(tablet_id, schema_hash, keep_files);
+    });
 } // drop_tablet
 
+TTabletId TabletManager::_get_related_tablet_id_unlock(TTabletId tablet_id,
+                                                       SchemaHash schema_hash) {
+    TabletSharedPtr tablet = _get_tablet_with_no_lock(tablet_id, schema_hash);
+    if (tablet == nullptr) {
+        return tablet_id;
+    }
+    AlterTabletTaskSharedPtr alter_task = tablet->alter_task();
+    return alter_task == nullptr ? tablet_id : alter_task->related_tablet_id();
+}
+
+OLAPStatus TabletManager::_run_with_related_shards_locked(
+        TTabletId tablet_id, SchemaHash schema_hash, const std::function<OLAPStatus()>& func) {
+    while (true) {
+        TTabletId related_tablet_id;
+        {
+            TabletsShardReadLock rlock(&_get_tablets_shard_lock(tablet_id));
+            related_tablet_id = _get_related_tablet_id_unlock(tablet_id, schema_hash);
+        }
+        RelatedShardsLock lock(this, tablet_id, related_tablet_id);
+        // the alter task may have changed before the shards were locked
+        if (_get_related_tablet_id_unlock(tablet_id, schema_hash) == related_tablet_id) {
+            return func();
+        }
+    }
+}
+
 
 // Drop tablet specified, the main logical is as follows:
 // 1. tablet not in schema change:
@@ -571,13 +685,13 @@ OLAPStatus TabletManager::_drop_tablet_unlock(
 OLAPStatus TabletManager::drop_tablets_on_error_root_path(
         const vector<TabletInfo>& tablet_info_vec) {
     OLAPStatus res = OLAP_SUCCESS;
-    WriteLock wlock(&_tablet_map_lock);
 
     for (const TabletInfo& tablet_info : tablet_info_vec) {
         TTabletId tablet_id = tablet_info.tablet_id;
         TSchemaHash schema_hash = tablet_info.schema_hash;
         VLOG(3) << "drop_tablet begin. tablet_id=" << tablet_id
                 << ", schema_hash=" << schema_hash;
+        TabletsShardWriteLock wlock(&_get_tablets_shard_lock(tablet_id));
         TabletSharedPtr dropped_tablet = _get_tablet_with_no_lock(tablet_id, schema_hash);
         if (dropped_tablet == nullptr) {
             LOG(WARNING) << "dropping tablet not exist. " 
@@ -585,14 +699,15 @@ OLAPStatus TabletManager::drop_tablets_on_error_root_path(
                          << " schema_hash=" << schema_hash;
             continue;
         } else {
-            for (list<TabletSharedPtr>::iterator it = _tablet_map[tablet_id].table_arr.begin();
-                    it != _tablet_map[tablet_id].table_arr.end();) {
+            list<TabletSharedPtr>& table_arr = _get_tablet_map(tablet_id)[tablet_id].table_arr;
+            for (list<TabletSharedPtr>::iterator it = table_arr.begin(); it != table_arr.end();) {
                 if ((*it)->equal(tablet_id, schema_hash)) {
-                    it = _tablet_map[tablet_id].table_arr.erase(it);
+                    WriteLock partition_wlock(&_partition_tablet_map_lock);
                     _partition_tablet_map[(*it)->partition_id()].erase((*it)->get_tablet_info());
                     if (_partition_tablet_map[(*it)->partition_id()].empty()) {
                         _partition_tablet_map.erase((*it)->partition_id());
                     } 
+                    it = table_arr.erase(it);
                 } else {
                     ++it;
                 }
@@ -605,7 +720,7 @@ OLAPStatus TabletManager::drop_tablets_on_error_root_path(
 
 TabletSharedPtr TabletManager::get_tablet(TTabletId tablet_id, SchemaHash schema_hash,
                                           bool include_deleted, std::string* err) {
-    ReadLock rlock(&_tablet_map_lock);
+    TabletsShardReadLock rlock(&_get_tablets_shard_lock(tablet_id));
     return _get_tablet(tablet_id, schema_hash, include_deleted, err);
 } // get_tablet
 
@@ -614,6 +729,7 @@ TabletSharedPtr TabletManager::_get_tablet(TTabletId tablet_id, SchemaHash schem
     TabletSharedPtr tablet;
     tablet = _get_tablet_with_no_lock(tablet_id, schema_hash);
     if (tablet == nullptr && include_deleted) {
+        std::lock_guard<std::mutex> l(_shutdown_tablets_lock);
         for (auto& deleted_tablet : _shutdown_tablets) {
             CHECK(deleted_tablet != nullptr) << "deleted tablet in nullptr";
             if (deleted_tablet->tablet_id() == tablet_id && deleted_tablet->schema_hash() == schema_hash) {
@@ -639,7 +755,7 @@ TabletSharedPtr TabletManager::_get_tablet(TTabletId tablet_id, SchemaHash schem
 TabletSharedPtr TabletManager::get_tablet(TTabletId tablet_id, SchemaHash schema_hash,
                                           TabletUid tablet_uid, bool include_deleted,
                                           std::string* err) {
-    ReadLock rlock(&_tablet_map_lock);
+    TabletsShardReadLock rlock(&_get_tablets_shard_lock(tablet_id));
     TabletSharedPtr tablet = _get_tablet(tablet_id, schema_hash, include_deleted, err);
     if (tablet != nullptr && tablet->tablet_uid() == tablet_uid) {
         return tablet;
@@ -697,75 +813,157 @@ void TabletManager::get_tablet_stat(TTabletStatResult& result) {
 
 TabletSharedPtr TabletManager::find_best_tablet_to_compaction(
             CompactionType compaction_type, DataDir* data_dir) {
-    ReadLock tablet_map_rdlock(&_tablet_map_lock);
-    uint32_t highest_score = 0;
-    TabletSharedPtr best_tablet;
     int64_t now = UnixMillis();
-    for (tablet_map_t::value_type& table_ins : _tablet_map){
-        for (TabletSharedPtr& table_ptr : table_ins.second.table_arr) {
-            AlterTabletTaskSharedPtr cur_alter_task = table_ptr->alter_task();
-            if (cur_alter_task != nullptr && cur_alter_task->alter_state() != ALTER_FINISHED 
-                && cur_alter_task->alter_state() != ALTER_FAILED) {
-                    TabletSharedPtr related_tablet = _get_tablet_with_no_lock(cur_alter_task->related_tablet_id(), 
+    // the data dir keeps the candidates ordered by score as their rowsets change,
+    // take the first one which can do compaction now
+    CompactionCandidate candidate;
+    const CompactionCandidate* prev = nullptr;
+    while (data_dir->next_compaction_candidate(compaction_type, prev, &candidate)) {
+        prev = &candidate;
+        TabletSharedPtr table_ptr;
+        {
+            TabletsShardReadLock rlock(&_get_tablets_shard_lock(candidate.tablet_info.tablet_id));
+            table_ptr = _get_tablet_with_no_lock(
+                candidate.tablet_info.tablet_id, candidate.tablet_info.schema_hash);
+        }
+        if (table_ptr == nullptr || table_ptr->tablet_uid() != candidate.tablet_info.tablet_uid) {
+            continue;
+        }
+
+        AlterTabletTaskSharedPtr cur_alter_task = table_ptr->alter_task();
+        if (cur_alter_task != nullptr && cur_alter_task->alter_state() != ALTER_FINISHED 
+            && cur_alter_task->alter_state() != ALTER_FAILED) {
+                TabletSharedPtr related_tablet;
+                {
+                    TabletsShardReadLock rlock(
+                        &_get_tablets_shard_lock(cur_alter_task->related_tablet_id()));
+                    related_tablet = _get_tablet_with_no_lock(cur_alter_task->related_tablet_id(),
                         cur_alter_task->related_schema_hash());
-                    if (related_tablet != nullptr && table_ptr->creation_time() > related_tablet->creation_time()) {
-                        // it means cur tablet is a new tablet during schema change or rollup, skip compaction
-                        continue;
-                    }
-            }
-            // if tablet is not ready, it maybe a new tablet under schema change, not do compaction
-            if (table_ptr->tablet_state() == TABLET_NOTREADY) {
-                continue;
-            }
+                }
+                if (related_tablet != nullptr && table_ptr->creation_time() > related_tablet->creation_time()) {
+                    // it means cur tablet is a new tablet during schema change or rollup, skip compaction
+                    continue;
+                }
+        }
+        // if tablet is not ready, it maybe a new tablet under schema change, not do compaction
+        if (table_ptr->tablet_state() == TABLET_NOTREADY) {
+            continue;
+        }
+
+        if (table_ptr->data_dir()->path_hash() != data_dir->path_hash()
+                || !table_ptr->is_used() || !table_ptr->init_succeeded() || !table_ptr->can_do_compaction()) {
+            continue;
+        }
 
-            if (table_ptr->data_dir()->path_hash() != data_dir->path_hash()
-                    || !table_ptr->is_used() || !table_ptr->init_succeeded() || !table_ptr->can_do_compaction()) {
+        if (now - table_ptr->last_compaction_failure_time() <= config::min_compaction_failure_interval_sec * 1000) {
+            continue;
+        }
+
+        if (compaction_type == CompactionType::CUMULATIVE_COMPACTION) {
+            MutexLock lock(table_ptr->get_cumulative_lock(), TRY_LOCK);
+            if (!lock.own_lock()) {
                 continue;
             }
+        }
 
-            if (now - table_ptr->last_compaction_failure_time() <= config::min_compaction_failure_interval_sec * 1000) {
+        if (compaction_type == CompactionType::BASE_COMPACTION) {
+            MutexLock lock(table_ptr->get_base_lock(), TRY_LOCK);
+            if (!lock.own_lock()) {
                 continue;
             }
+        }
 
-            if (compaction_type == CompactionType::CUMULATIVE_COMPACTION) {
-                MutexLock lock(table_ptr->get_cumulative_lock(), TRY_LOCK);
-                if (!lock.own_lock()) {
-                    continue;
-                }
-            }
+        LOG(INFO) << "find best tablet to do compaction."
+            << " type: " << (compaction_type == CompactionType::CUMULATIVE_COMPACTION ? "cumulative" : "base")
+            << ", tablet id: " << table_ptr->tablet_id() << ", score: " << candidate.score;
+        return table_ptr;
+    }
+    return nullptr;
+}
 
-            if (compaction_type == CompactionType::BASE_COMPACTION) {
-                MutexLock lock(table_ptr->get_base_lock(), TRY_LOCK);
-                if (!lock.own_lock()) {
-                    continue;
-                }
-            }
+OLAPStatus TabletManager::load_tablet_from_meta(DataDir* data_dir, TTabletId tablet_id,
+        TSchemaHash schema_hash, const std::string& meta_binary, bool update_meta, bool force) {
+    TabletSharedPtr tablet;
+    OLAPStatus res = _create_tablet_from_meta(data_dir, tablet_id, schema_hash,
+                                              meta_binary, &tablet);
+    // the tablet may replace one under schema change, which is dropped like by drop_tablet()
+    return _run_with_related_shards_locked(tablet_id, schema_hash, [&] {
+        return _add_loaded_tablet_unlock(tablet_id, schema_hash, tablet, res, update_meta, force);
+    });
+} // load_tablet_from_meta
 
-            ReadLock rdlock(table_ptr->get_header_lock_ptr());
-            uint32_t table_score = 0;
-            if (compaction_type == CompactionType::BASE_COMPACTION) {
-                table_score = table_ptr->calc_base_compaction_score();
-            } else if (compaction_type == CompactionType::CUMULATIVE_COMPACTION) {
-                table_score = table_ptr->calc_cumulative_compaction_score();
-            }
-            if (table_score > highest_score) {
-                highest_score = table_score;
-                best_tablet = table_ptr;
+void TabletManager::load_tablets_from_meta(DataDir* data_dir,
+                                           const std::vector<TabletMetaBinary>& metas,
+                                           std::set<int64_t>* tablet_ids) {
+    std::vector<TabletSharedPtr> tablets(metas.size());
+    std::vector<OLAPStatus> statuses(metas.size(), OLAP_SUCCESS);
+    std::atomic<size_t> next_meta(0);
+    auto create_tablets = [&] {
+        while (true) {
+            size_t meta_idx = next_meta.fetch_add(1);
+            if (meta_idx >= metas.size()) {
+                return;
             }
+            const TabletMetaBinary& meta = metas[meta_idx];
+            statuses[meta_idx] = _create_tablet_from_meta(
+                    data_dir, meta.tablet_id, meta.schema_hash, meta.meta_binary,
+                    &tablets[meta_idx]);
         }
+    };
+    size_t num_threads = std::max<size_t>(1, std::min<size_t>(
+            config::load_tablet_num_threads_per_data_dir, metas.size()));
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < num_threads; ++i) {
+        threads.emplace_back(create_tablets);
+    }
+    create_tablets();
+    for (auto& thread : threads) {
+        thread.join();
     }
 
-    if (best_tablet != nullptr) {
-        LOG(INFO) << "find best tablet to do compaction."
-            << " type: " << (compaction_type == CompactionType::CUMULATIVE_COMPACTION ? "cumulative" : "base")
-            << ", tablet id: " << best_tablet->tablet_id() << ", score: " << highest_score;
+    auto add_tablet = [&](size_t meta_idx) {
+        const TabletMetaBinary& meta = metas[meta_idx];
+        return _add_loaded_tablet_unlock(meta.tablet_id, meta.schema_hash, tablets[meta_idx],
+                                         statuses[meta_idx], false, false);
+    };
+    auto check_added = [&](size_t meta_idx, OLAPStatus res) {
+        if (res != OLAP_SUCCESS) {
+            LOG(WARNING) << "load tablet from header failed. status:" << res
+                << ", tablet=" << metas[meta_idx].tablet_id << "." << metas[meta_idx].schema_hash;
+        } else {
+            tablet_ids->insert(metas[meta_idx].tablet_id);
+        }
+    };
+    std::vector<std::vector<size_t>> shard_metas(_tablets_shards.size());
+    for (size_t i = 0; i < metas.size(); ++i) {
+        shard_metas[metas[i].tablet_id & _tablets_shards_mask].push_back(i);
+    }
+    // a tablet replacing one under schema change whose related tablet is in another
+    // shard needs that shard too, it's added on its own afterwards
+    std::vector<size_t> related_metas;
+    for (size_t shard_idx = 0; shard_idx < shard_metas.size(); ++shard_idx) {
+        if (shard_metas[shard_idx].empty()) {
+            continue;
+        }
+        TabletsShardWriteLock wlock(&_tablets_shards[shard_idx].lock);
+        for (size_t i : shard_metas[shard_idx]) {
+            TTabletId related_tablet_id = _get_related_tablet_id_unlock(
+                    metas[i].tablet_id, metas[i].schema_hash);
+            if (static_cast<size_t>(related_tablet_id & _tablets_shards_mask) != shard_idx) {
+                related_metas.push_back(i);
+                continue;
+            }
+            check_added(i, add_tablet(i));
+        }
+    }
+    for (size_t i : related_metas) {
+        check_added(i, _run_with_related_shards_locked(metas[i].tablet_id, metas[i].schema_hash,
+                                                       [&] { return add_tablet(i); }));
     }
-    return best_tablet;
 }
 
-OLAPStatus TabletManager::load_tablet_from_meta(DataDir* data_dir, TTabletId tablet_id,
-        TSchemaHash schema_hash, const std::string& meta_binary, bool update_meta, bool force) {
-    WriteLock wlock(&_tablet_map_lock);
+OLAPStatus TabletManager::_create_tablet_from_meta(DataDir* data_dir, TTabletId tablet_id,
+        TSchemaHash schema_hash, const std::string& meta_binary, TabletSharedPtr* tablet) {
     TabletMetaSharedPtr tablet_meta(new TabletMeta());
     OLAPStatus status = tablet_meta->deserialize(meta_binary);
     if (status != OLAP_SUCCESS) {
@@ -788,8 +986,8 @@ OLAPStatus TabletManager::load_tablet_from_meta(DataDir* data_dir, TTabletId tab
     }
 
     // init must be called
-    TabletSharedPtr tablet = Tablet::create_tablet_from_meta(tablet_meta, data_dir);
-    if (tablet == nullptr) {
+    *tablet = Tablet::create_tablet_from_meta(tablet_meta, data_dir);
+    if (*tablet == nullptr) {
         LOG(WARNING) << "fail to new tablet. tablet_id=" << tablet_id << ", schema_hash:" << schema_hash;
         return OLAP_ERR_TABLE_CREATE_FROM_HEADER_ERROR;
     }
@@ -798,23 +996,38 @@ OLAPStatus TabletManager::load_tablet_from_meta(DataDir* data_dir, TTabletId tab
         LOG(INFO) << "tablet is to be deleted, skip load it"
                   << " tablet id = " << tablet_meta->tablet_id()
                   << " schema hash = " << tablet_meta->schema_hash();
-        _shutdown_tablets.push_back(tablet);
         return OLAP_ERR_TABLE_ALREADY_DELETED_ERROR;
     }
     // not check tablet init version because when be restarts during alter task the new tablet may be empty
-    if (tablet->max_version().first == -1 && tablet->tablet_state() == TABLET_RUNNING) {	
-        LOG(WARNING) << "tablet is in running state without delta is invalid."	
-                     << "tablet=" << tablet->full_name();	
-        // tablet state is invalid, drop tablet	
-        return OLAP_ERR_TABLE_INDEX_VALIDATE_ERROR;	
+    if ((*tablet)->max_version().first == -1 && (*tablet)->tablet_state() == TABLET_RUNNING) {
+        LOG(WARNING) << "tablet is in running state without delta is invalid."
+                     << "tablet=" << (*tablet)->full_name();
+        // tablet state is invalid, drop tablet
+        return OLAP_ERR_TABLE_INDEX_VALIDATE_ERROR;
     }
 
-    OLAPStatus res = tablet->init();
+    // the rowsets are created here, their segments are opened on first read
+    OLAPStatus res = (*tablet)->init();
     if (res != OLAP_SUCCESS) {
-        LOG(WARNING) << "tablet init failed. tablet:" << tablet->full_name();
+        LOG(WARNING) << "tablet init failed. tablet:" << (*tablet)->full_name();
         return res;
     }
-    res = _add_tablet_unlock(tablet_id, schema_hash, tablet, update_meta, force);
+    return OLAP_SUCCESS;
+}
+
+OLAPStatus TabletManager::_add_loaded_tablet_unlock(TTabletId tablet_id, SchemaHash schema_hash,
+                                                    const TabletSharedPtr& tablet,
+                                                    OLAPStatus create_status,
+                                                    bool update_meta, bool force) {
+    if (create_status == OLAP_ERR_TABLE_ALREADY_DELETED_ERROR) {
+        std::lock_guard<std::mutex> l(_shutdown_tablets_lock);
+        _shutdown_tablets.push_back(tablet);
+        return create_status;
+    }
+    if (create_status != OLAP_SUCCESS) {
+        return create_status;
+    }
+    OLAPStatus res = _add_tablet_unlock(tablet_id, schema_hash, tablet, update_meta, force);
     if (res != OLAP_SUCCESS) {
         // insert existed tablet return OLAP_SUCCESS
         if (res == OLAP_ERR_ENGINE_INSERT_EXISTS_TABLE) {
@@ -826,7 +1039,7 @@ OLAPStatus TabletManager::load_tablet_from_meta(DataDir* data_dir, TTabletId tab
     }
 
     return OLAP_SUCCESS;
-} // load_tablet_from_meta
+}
 
 OLAPStatus TabletManager::load_tablet_from_dir(
         DataDir* store, TTabletId tablet_id, SchemaHash schema_hash,
@@ -885,10 +1098,11 @@ OLAPStatus TabletManager::load_tablet_from_dir(
 
 void TabletManager::release_schema_change_lock(TTabletId tablet_id) {
     VLOG(3) << "release_schema_change_lock begin. tablet_id=" << tablet_id;
-    ReadLock rlock(&_tablet_map_lock);
+    TabletsShardReadLock rlock(&_get_tablets_shard_lock(tablet_id));
 
-    tablet_map_t::iterator it = _tablet_map.find(tablet_id);
-    if (it == _tablet_map.end()) {
+    tablet_map_t& tablet_map = _get_tablet_map(tablet_id);
+    tablet_map_t::iterator it = tablet_map.find(tablet_id);
+    if (it == tablet_map.end()) {
         LOG(WARNING) << "tablet does not exists. tablet=" << tablet_id;
     } else {
         it->second.schema_change_lock.unlock();
@@ -920,39 +1134,41 @@ OLAPStatus TabletManager::report_tablet_info(TTabletInfo* tablet_info) {
 
 OLAPStatus TabletManager::report_all_tablets_info(std::map<TTabletId, TTablet>* tablets_info) {
     LOG(INFO) << "begin to process report all tablets info.";
-    ReadLock rlock(&_tablet_map_lock);
     DorisMetrics::report_all_tablets_requests_total.increment(1);
 
     if (tablets_info == nullptr) {
         return OLAP_ERR_INPUT_PARAMETER_ERROR;
     }
 
-    for (const auto& item : _tablet_map) {
-        if (item.second.table_arr.size() == 0) {
-            continue;
-        }
-
-        TTablet tablet;
-        for (TabletSharedPtr tablet_ptr : item.second.table_arr) {
-            if (tablet_ptr == nullptr) {
+    for (auto& shard : _tablets_shards) {
+        TabletsShardReadLock rlock(&shard.lock);
+        for (const auto& item : shard.tablet_map) {
+            if (item.second.table_arr.size() == 0) {
                 continue;
             }
 
-            TTabletInfo tablet_info;
-            tablet_ptr->build_tablet_report_info(&tablet_info);
+            TTablet tablet;
+            for (TabletSharedPtr tablet_ptr : item.second.table_arr) {
+                if (tablet_ptr == nullptr) {
+                    continue;
+                }
 
-            // report expire transaction
-            vector<int64_t> transaction_ids;
-            // TODO(ygl): tablet manager and txn manager may be dead lock
-            StorageEngine::instance()->txn_manager()->get_expire_txns(tablet_ptr->tablet_id(), 
-                tablet_ptr->schema_hash(), tablet_ptr->tablet_uid(), &transaction_ids);
-            tablet_info.__set_transaction_ids(transaction_ids);
+                TTabletInfo tablet_info;
+                tablet_ptr->build_tablet_report_info(&tablet_info);
 
-            tablet.tablet_infos.push_back(tablet_info);
-        }
+                // report expire transaction
+                vector<int64_t> transaction_ids;
+                // TODO(ygl): tablet manager and txn manager may be dead lock
+                StorageEngine::instance()->txn_manager()->get_expire_txns(tablet_ptr->tablet_id(), 
+                    tablet_ptr->schema_hash(), tablet_ptr->tablet_uid(), &transaction_ids);
+                tablet_info.__set_transaction_ids(transaction_ids);
 
-        if (tablet.tablet_infos.size() != 0) {
-            tablets_info->insert(pair<TTabletId, TTablet>(tablet.tablet_infos[0].tablet_id, tablet));
+                tablet.tablet_infos.push_back(tablet_info);
+            }
+
+            if (tablet.tablet_infos.size() != 0) {
+                tablets_info->insert(pair<TTabletId, TTablet>(tablet.tablet_infos[0].tablet_id, tablet));
+            }
         }
     }
 
@@ -961,31 +1177,38 @@ OLAPStatus TabletManager::report_all_tablets_info(std::map<TTabletId, TTablet>*
 } // report_all_tablets_info
 
 OLAPStatus TabletManager::start_trash_sweep() {
-    {
-        ReadLock rlock(&_tablet_map_lock);
+    for (auto& shard : _tablets_shards) {
         std::vector<int64_t> tablets_to_clean;
-        for (auto& item : _tablet_map) {
-            // try to clean empty item
-            if (item.second.table_arr.empty()) {
-                // try to get schema change lock if could get schema change lock, then nobody 
-                // own the lock could remove the item
-                // it will core if schema change thread may hold the lock and this thread will deconstruct lock
-                if (item.second.schema_change_lock.trylock() == OLAP_SUCCESS) {
-                    item.second.schema_change_lock.unlock();
+        {
+            TabletsShardReadLock rlock(&shard.lock);
+            for (auto& item : shard.tablet_map) {
+                if (item.second.table_arr.empty()) {
                     tablets_to_clean.push_back(item.first);
                 }
-            }
-            for (TabletSharedPtr tablet : item.second.table_arr) {
-                if (tablet == nullptr) {
-                    continue;
+                for (TabletSharedPtr tablet : item.second.table_arr) {
+                    if (tablet == nullptr) {
+                        continue;
+                    }
+                    tablet->delete_expired_inc_rowsets();
                 }
-                tablet->delete_expired_inc_rowsets();
             }
         }
+        if (tablets_to_clean.empty()) {
+            continue;
+        }
         // clean empty tablet id item
+        TabletsShardWriteLock wlock(&shard.lock);
         for (const auto& tablet_id_to_clean : tablets_to_clean) {
-            if (_tablet_map[tablet_id_to_clean].table_arr.empty()) {
-                _tablet_map.erase(tablet_id_to_clean);
+            auto it = shard.tablet_map.find(tablet_id_to_clean);
+            if (it == shard.tablet_map.end() || !it->second.table_arr.empty()) {
+                continue;
+            }
+            // try to get schema change lock if could get schema change lock, then nobody 
+            // own the lock could remove the item
+            // it will core if schema change thread may hold the lock and this thread will deconstruct lock
+            if (it->second.schema_change_lock.trylock() == OLAP_SUCCESS) {
+                it->second.schema_change_lock.unlock();
+                shard.tablet_map.erase(it);
             }
         }
     }
@@ -994,9 +1217,9 @@ OLAPStatus TabletManager::start_trash_sweep() {
     do {
         sleep(1);
         clean_num = 0;
-        // should get write lock here, because it will remove tablet from shut_down_tablets
+        // should get the lock here, because it will remove tablet from shut_down_tablets
         // and get tablet will access shut_down_tablets
-        WriteLock wlock(&_tablet_map_lock);
+        std::lock_guard<std::mutex> l(_shutdown_tablets_lock);
         auto it = _shutdown_tablets.begin();
         for (; it != _shutdown_tablets.end();) { 
             // check if the meta has the tablet info and its state is shutdown
@@ -1074,10 +1297,11 @@ OLAPStatus TabletManager::start_trash_sweep() {
 bool TabletManager::try_schema_change_lock(TTabletId tablet_id) {
     bool res = false;
     VLOG(3) << "try_schema_change_lock begin. tablet_id=" << tablet_id;
-    ReadLock rlock(&_tablet_map_lock);
+    TabletsShardReadLock rlock(&_get_tablets_shard_lock(tablet_id));
 
-    tablet_map_t::iterator it = _tablet_map.find(tablet_id);
-    if (it == _tablet_map.end()) {
+    tablet_map_t& tablet_map = _get_tablet_map(tablet_id);
+    tablet_map_t::iterator it = tablet_map.find(tablet_id);
+    if (it == tablet_map.end()) {
         LOG(WARNING) << "tablet does not exists. tablet_id=" << tablet_id;
     } else {
         res = (it->second.schema_change_lock.trylock() == OLAP_SUCCESS);
@@ -1088,27 +1312,30 @@ bool TabletManager::try_schema_change_lock(TTabletId tablet_id) {
 
 void TabletManager::update_root_path_info(std::map<std::string, DataDirInfo>* path_map,
     int* tablet_counter) {
-    ReadLock rlock(&_tablet_map_lock);
-    for (auto& entry : _tablet_map) {
-        TableInstances& instance = entry.second;
-        for (auto& tablet : instance.table_arr) {
-            (*tablet_counter) ++ ;
-            int64_t data_size = tablet->tablet_footprint();
-            auto find = path_map->find(tablet->data_dir()->path());
-            if (find == path_map->end()) {
-                continue;
-            }
-            if (find->second.is_used) {
-                find->second.data_used_capacity += data_size;
+    for (auto& shard : _tablets_shards) {
+        TabletsShardReadLock rlock(&shard.lock);
+        for (auto& entry : shard.tablet_map) {
+            TableInstances& instance = entry.second;
+            for (auto& tablet : instance.table_arr) {
+                (*tablet_counter) ++ ;
+                int64_t data_size = tablet->tablet_footprint();
+                auto find = path_map->find(tablet->data_dir()->path());
+                if (find == path_map->end()) {
+                    continue;
+                }
+                if (find->second.is_used) {
+                    find->second.data_used_capacity += data_size;
+                }
             }
         }
     }
 } // update_root_path_info
 
 void TabletManager::get_partition_related_tablets(int64_t partition_id, std::set<TabletInfo>* tablet_infos) {
-    ReadLock rlock(&_tablet_map_lock);
-    if (_partition_tablet_map.find(partition_id) != _partition_tablet_map.end()) {
-        for (auto& tablet_info : _partition_tablet_map[partition_id]) {
+    ReadLock rlock(&_partition_tablet_map_lock);
+    auto it = _partition_tablet_map.find(partition_id);
+    if (it != _partition_tablet_map.end()) {
+        for (auto& tablet_info : it->second) {
             tablet_infos->insert(tablet_info);
         }
     }
@@ -1116,9 +1343,9 @@ void TabletManager::get_partition_related_tablets(int64_t partition_id, std::set
 
 void TabletManager::do_tablet_meta_checkpoint(DataDir* data_dir) {
     vector<TabletSharedPtr> related_tablets;
-    {
-        ReadLock tablet_map_rdlock(&_tablet_map_lock);
-        for (tablet_map_t::value_type& table_ins : _tablet_map){
+    for (auto& shard : _tablets_shards) {
+        TabletsShardReadLock rlock(&shard.lock);
+        for (tablet_map_t::value_type& table_ins : shard.tablet_map){
             for (TabletSharedPtr& table_ptr : table_ins.second.table_arr) {
                 // if tablet is not ready, it maybe a new tablet under schema change, not do compaction
                 if (table_ptr->tablet_state() != TABLET_RUNNING) {
@@ -1142,28 +1369,30 @@ void TabletManager::do_tablet_meta_checkpoint(DataDir* data_dir) {
 void TabletManager::_build_tablet_stat() {
     _tablet_stat_cache.clear();
 
-    ReadLock rdlock(&_tablet_map_lock);
-    for (const auto& item : _tablet_map) {
-        if (item.second.table_arr.size() == 0) {
-            continue;
-        }
-
-        TTabletStat stat;
-        stat.tablet_id = item.first;
-        for (TabletSharedPtr tablet : item.second.table_arr) {
-            if (tablet == nullptr) {
+    for (auto& shard : _tablets_shards) {
+        TabletsShardReadLock rlock(&shard.lock);
+        for (const auto& item : shard.tablet_map) {
+            if (item.second.table_arr.size() == 0) {
                 continue;
             }
-            // we only get base tablet's stat
-            stat.__set_data_size(tablet->tablet_footprint());
-            stat.__set_row_num(tablet->num_rows());
-            VLOG(3) << "tablet_id=" << item.first
-                    << ", data_size=" << tablet->tablet_footprint()
-                    << ", row_num:" << tablet->num_rows();
-            break;
-        }
 
-        _tablet_stat_cache.emplace(item.first, stat);
+            TTabletStat stat;
+            stat.tablet_id = item.first;
+            for (TabletSharedPtr tablet : item.second.table_arr) {
+                if (tablet == nullptr) {
+                    continue;
+                }
+                // we only get base tablet's stat
+                stat.__set_data_size(tablet->tablet_footprint());
+                stat.__set_row_num(tablet->num_rows());
+                VLOG(3) << "tablet_id=" << item.first
+                        << ", data_size=" << tablet->tablet_footprint()
+                        << ", row_num:" << tablet->num_rows();
+                break;
+            }
+
+            _tablet_stat_cache.emplace(item.first, stat);
+        }
     }
 
     _tablet_stat_cache_update_time_ms = UnixMillis();
@@ -1298,6 +1527,17 @@ OLAPStatus TabletManager::_create_tablet_meta(
                        shard_id, request.tablet_schema,
                        next_unique_id, col_ordinal_to_unique_id,
                        tablet_meta, tablet_uid);
+    if (res != OLAP_SUCCESS) {
+        return res;
+    }
+    CompactionPolicyPB compaction_policy = StorageEngine::instance()->default_compaction_policy();
+    if (request.__isset.compaction_policy) {
+        compaction_policy = request.compaction_policy == TCompactionPolicy::SIZE_TIERED
+            ? SIZE_TIERED_COMPACTION : NUM_BASED_COMPACTION;
+    } else if (is_schema_change_tablet && ref_tablet != nullptr) {
+        compaction_policy = ref_tablet->compaction_policy();
+    }
+    (*tablet_meta)->set_compaction_policy(compaction_policy);
     return res;
 }
 
@@ -1313,15 +1553,18 @@ OLAPStatus TabletManager::_drop_tablet_directly_unlocked(
         return OLAP_ERR_TABLE_NOT_FOUND;
     }
 
-    for (list<TabletSharedPtr>::iterator it = _tablet_map[tablet_id].table_arr.begin();
-            it != _tablet_map[tablet_id].table_arr.end();) {
+    list<TabletSharedPtr>& table_arr = _get_tablet_map(tablet_id)[tablet_id].table_arr;
+    for (list<TabletSharedPtr>::iterator it = table_arr.begin(); it != table_arr.end();) {
         if ((*it)->equal(tablet_id, schema_hash)) {
             TabletSharedPtr tablet = *it;
-            _partition_tablet_map[(*it)->partition_id()].erase((*it)->get_tablet_info());
-            if (_partition_tablet_map[(*it)->partition_id()].empty()) {
-                _partition_tablet_map.erase((*it)->partition_id());
-            } 
-            it = _tablet_map[tablet_id].table_arr.erase(it);
+            {
+                WriteLock partition_wlock(&_partition_tablet_map_lock);
+                _partition_tablet_map[(*it)->partition_id()].erase((*it)->get_tablet_info());
+                if (_partition_tablet_map[(*it)->partition_id()].empty()) {
+                    _partition_tablet_map.erase((*it)->partition_id());
+                } 
+            }
+            it = table_arr.erase(it);
             if (!keep_files) {
                 // drop tablet will update tablet meta, should lock
                 WriteLock wrlock(tablet->get_header_lock_ptr()); 
@@ -1341,6 +1584,7 @@ OLAPStatus TabletManager::_drop_tablet_directly_unlocked(
                                  << " schema_hash=" << schema_hash;
                     return res;
                 }
+                std::lock_guard<std::mutex> l(_shutdown_tablets_lock);
                 _shutdown_tablets.push_back(tablet);
             }
         } else {
@@ -1361,8 +1605,9 @@ OLAPStatus TabletManager::_drop_tablet_directly_unlocked(
 TabletSharedPtr TabletManager::_get_tablet_with_no_lock(TTabletId tablet_id, SchemaHash schema_hash) {
     VLOG(3) << "begin to get tablet. tablet_id=" << tablet_id
             << ", schema_hash=" << schema_hash;
-    tablet_map_t::iterator it = _tablet_map.find(tablet_id);
-    if (it != _tablet_map.end()) {
+    tablet_map_t& tablet_map = _get_tablet_map(tablet_id);
+    tablet_map_t::iterator it = tablet_map.find(tablet_id);
+    if (it != tablet_map.end()) {
         for (TabletSharedPtr tablet : it->second.table_arr) {
             CHECK(tablet != nullptr) << "tablet is nullptr:" << tablet;
             if (tablet->equal(tablet_id, schema_hash)) {
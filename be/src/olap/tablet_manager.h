@@ -19,6 +19,7 @@
 #define DORIS_BE_SRC_OLAP_TABLET_MANAGER_H
 
 #include <ctime>
+#include <functional>
 #include <list>
 #include <map>
 #include <mutex>
@@ -49,13 +50,22 @@ namespace doris {
 class Tablet;
 class DataDir;
 
+// A serialized tablet meta, as stored in the OlapMeta of a data dir.
+struct TabletMetaBinary {
+    TTabletId tablet_id;
+    TSchemaHash schema_hash;
+    std::string meta_binary;
+};
+
 // TabletManager provides get,add, delete tablet method for storage engine
 class TabletManager {
 public:
     TabletManager();
 
     ~TabletManager() {
-        _tablet_map.clear();
+        for (auto& shard : _tablets_shards) {
+            shard.tablet_map.clear();
+        }
     }
 
     bool check_tablet_id_exist(TTabletId tablet_id);
@@ -116,6 +126,14 @@ public:
                 TSchemaHash schema_hash, const std::string& header, bool update_meta, 
                 bool force = false);
 
+    // Loads the tablets of 'data_dir' at startup like load_tablet_from_meta(), but
+    // the metas are parsed and the tablets initialized by up to
+    // config::load_tablet_num_threads_per_data_dir threads outside of the tablet
+    // map locks, then the lock of each shard is taken once for the tablets of the
+    // batch in it. The ids of the tablets loaded are added to 'tablet_ids'.
+    void load_tablets_from_meta(DataDir* data_dir, const std::vector<TabletMetaBinary>& metas,
+                                std::set<int64_t>* tablet_ids);
+
     OLAPStatus load_tablet_from_dir(DataDir* data_dir,
                                TTabletId tablet_id,
                                SchemaHash schema_hash,
@@ -152,6 +170,18 @@ private:
     OLAPStatus _add_tablet_unlock(TTabletId tablet_id, SchemaHash schema_hash,
                          const TabletSharedPtr& tablet, bool update_meta, bool force);
     
+    // parses 'meta_binary' and creates and initializes the tablet, doesn't touch
+    // the tablet map. 'tablet' is also set for OLAP_ERR_TABLE_ALREADY_DELETED_ERROR.
+    OLAPStatus _create_tablet_from_meta(DataDir* data_dir, TTabletId tablet_id,
+                                        TSchemaHash schema_hash, const std::string& meta_binary,
+                                        TabletSharedPtr* tablet);
+
+    // adds a tablet made by _create_tablet_from_meta(), which returned 'create_status'
+    OLAPStatus _add_loaded_tablet_unlock(TTabletId tablet_id, SchemaHash schema_hash,
+                                         const TabletSharedPtr& tablet,
+                                         OLAPStatus create_status,
+                                         bool update_meta, bool force);
+
     OLAPStatus _add_tablet_to_map(TTabletId tablet_id, SchemaHash schema_hash,
                                  const TabletSharedPtr& tablet, bool update_meta, 
                                  bool keep_files, bool drop_old);
@@ -169,8 +199,18 @@ private:
     
     OLAPStatus _drop_tablet_directly_unlocked(TTabletId tablet_id, TSchemaHash schema_hash, bool keep_files = false);
 
+    // the caller holds the write lock of the shard of 'tablet_id' and, if the tablet
+    // is under schema change, the read lock of the shard of the related tablet
     OLAPStatus _drop_tablet_unlock(TTabletId tablet_id, SchemaHash schema_hash, bool keep_files);
 
+    // returns the id of the tablet related to the tablet by schema change, or
+    // 'tablet_id' itself if there is none
+    TTabletId _get_related_tablet_id_unlock(TTabletId tablet_id, SchemaHash schema_hash);
+
+    // runs 'func' holding the locks _drop_tablet_unlock() needs for the tablet
+    OLAPStatus _run_with_related_shards_locked(TTabletId tablet_id, SchemaHash schema_hash,
+                                               const std::function<OLAPStatus()>& func);
+
     TabletSharedPtr _get_tablet_with_no_lock(TTabletId tablet_id, SchemaHash schema_hash);
 
     TabletSharedPtr _get_tablet(TTabletId tablet_id, SchemaHash schema_hash,
@@ -188,9 +228,31 @@ private:
         std::list<TabletSharedPtr> table_arr;
     };
     typedef std::map<int64_t, TableInstances> tablet_map_t;
-    RWMutex _tablet_map_lock;
-    RWMutex _create_tablet_lock;
-    tablet_map_t _tablet_map;
+
+    // The tablets are split into shards by tablet id, the lookups of tablets in
+    // different shards don't contend. A thread holds the lock of one shard at a
+    // time, except RelatedShardsLock which takes two in the order of the shards.
+    struct TabletsShard {
+        RWMutex lock;
+        tablet_map_t tablet_map;
+    };
+
+    class RelatedShardsLock;
+
+    TabletsShard& _get_tablets_shard(TTabletId tablet_id) {
+        return _tablets_shards[tablet_id & _tablets_shards_mask];
+    }
+
+    RWMutex& _get_tablets_shard_lock(TTabletId tablet_id) {
+        return _get_tablets_shard(tablet_id).lock;
+    }
+
+    tablet_map_t& _get_tablet_map(TTabletId tablet_id) {
+        return _get_tablets_shard(tablet_id).tablet_map;
+    }
+
+    std::vector<TabletsShard> _tablets_shards;
+    int64_t _tablets_shards_mask;
     std::map<std::string, DataDir*> _store_map;
 
     // cache to save tablets' statistics, such as data size and row
@@ -203,9 +265,11 @@ private:
 
     uint32_t _available_storage_medium_type_count;
 
+    std::mutex _shutdown_tablets_lock;
     std::vector<TabletSharedPtr> _shutdown_tablets;
 
     // map from partition id to tablet_id
+    RWMutex _partition_tablet_map_lock;
     std::map<int64_t, std::set<TabletInfo>> _partition_tablet_map;
 
     DISALLOW_COPY_AND_ASSIGN(TabletManager);
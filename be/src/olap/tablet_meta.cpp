@@ -365,6 +365,7 @@ OLAPStatus TabletMeta::init_from_pb(const TabletMetaPB& tablet_meta_pb) {
     if (tablet_meta_pb.has_in_restore_mode()) {
         _in_restore_mode = tablet_meta_pb.in_restore_mode();
     }
+    _compaction_policy = tablet_meta_pb.compaction_policy();
     return OLAP_SUCCESS;
 }
 
@@ -407,6 +408,7 @@ OLAPStatus TabletMeta::to_meta_pb(TabletMetaPB* tablet_meta_pb) {
     }
 
     tablet_meta_pb->set_in_restore_mode(in_restore_mode());
+    tablet_meta_pb->set_compaction_policy(compaction_policy());
     return OLAP_SUCCESS;
 }
 
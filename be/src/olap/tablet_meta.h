@@ -154,6 +154,9 @@ public:
     inline const bool in_restore_mode() const;
     inline OLAPStatus set_in_restore_mode(bool in_restore_mode);
 
+    inline CompactionPolicyPB compaction_policy() const;
+    inline void set_compaction_policy(CompactionPolicyPB compaction_policy);
+
     inline const TabletSchema& tablet_schema() const;
 
     inline const vector<RowsetMetaSharedPtr>& all_rs_metas() const;
@@ -203,6 +206,7 @@ private:
     DelPredicateArray _del_pred_array;
     AlterTabletTaskSharedPtr _alter_task;
     bool _in_restore_mode = false;
+    CompactionPolicyPB _compaction_policy = NUM_BASED_COMPACTION;
 
     RWMutex _meta_lock;
 };
@@ -285,6 +289,14 @@ inline OLAPStatus TabletMeta::set_in_restore_mode(bool in_restore_mode) {
     return OLAP_SUCCESS;
 }
 
+inline CompactionPolicyPB TabletMeta::compaction_policy() const {
+    return _compaction_policy;
+}
+
+inline void TabletMeta::set_compaction_policy(CompactionPolicyPB compaction_policy) {
+    _compaction_policy = compaction_policy;
+}
+
 inline const TabletSchema& TabletMeta::tablet_schema() const {
     return _schema;
 }
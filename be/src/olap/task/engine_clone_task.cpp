@@ -17,6 +17,9 @@
 
 #include "olap/task/engine_clone_task.h"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <set>
 
 #include "http/http_client.h"
@@ -24,6 +27,12 @@
 #include "olap/snapshot_manager.h"
 #include "olap/rowset/rowset.h"
 #include "olap/rowset/rowset_factory.h"
+#include "util/count_down_latch.hpp"
+#include "util/doris_metrics.h"
+#include "util/io_scheduler.h"
+#include "util/md5.h"
+#include "util/thread_pool.hpp"
+#include "util/token_bucket.h"
 
 #include "env/env.h"
 
@@ -38,6 +47,9 @@ const std::string HTTP_REQUEST_FILE_PARAM = "&file=";
 const uint32_t DOWNLOAD_FILE_MAX_RETRY = 3;
 const uint32_t LIST_REMOTE_FILE_TIMEOUT = 15;
 const uint32_t GET_LENGTH_TIMEOUT = 10;
+const std::string HTTP_REQUEST_MD5_PARAM = "&acquire_md5=true";
+const uint32_t GET_MD5_TIMEOUT = 300;
+const size_t MD5_HEX_LENGTH = 32;
 
 EngineCloneTask::EngineCloneTask(const TCloneReq& clone_req, 
                     const TMasterInfo& master_info,  
@@ -295,6 +307,7 @@ AgentStatus EngineCloneTask::_clone_copy(
         const vector<Version>* missed_versions,
         bool* allow_incremental_clone, 
         TabletSharedPtr tablet) {
+    ScopedIOClass io_class(data_dir.io_scheduler(), IOScheduler::IO_CLASS_CLONE);
     AgentStatus status = DORIS_SUCCESS;
     std::string token = _master_info.token;
     for (auto src_backend : clone_req.src_backends) {
@@ -443,75 +456,14 @@ AgentStatus EngineCloneTask::_clone_copy(
         uint64_t total_file_size = 0;
         MonotonicStopWatch watch;
         watch.start();
-        for (auto& file_name : file_name_list) {
-            remote_file_path = http_host + HTTP_REQUEST_PREFIX
-                + HTTP_REQUEST_TOKEN_PARAM + token
-                + HTTP_REQUEST_FILE_PARAM + src_file_full_path + file_name;
-
-            // get file length
-            uint64_t file_size = 0;
-            auto get_file_size_cb = [&remote_file_path, &file_size] (HttpClient* client) {
-                RETURN_IF_ERROR(client->init(remote_file_path));
-                client->set_timeout_ms(GET_LENGTH_TIMEOUT * 1000);
-                RETURN_IF_ERROR(client->head());
-                file_size = client->get_content_length();
-                return Status::OK();
-            };
-            download_status = HttpClient::execute_with_retry(
-                DOWNLOAD_FILE_MAX_RETRY, 1, get_file_size_cb);
-            if (!download_status.ok()) {
-                LOG(WARNING) << "clone copy get file length failed over max time. remote_path="
-                    << remote_file_path
-                    << ", signature=" << signature;
-                status = DORIS_ERROR;
-                break;
-            }
-
-            // check disk capacity
-            if (data_dir.reach_capacity_limit(file_size)) {
-                status = DORIS_DISK_REACH_CAPACITY_LIMIT;
-                break;
-            }
-
-            total_file_size += file_size;
-            uint64_t estimate_timeout = file_size / config::download_low_speed_limit_kbps / 1024;
-            if (estimate_timeout < config::download_low_speed_time) {
-                estimate_timeout = config::download_low_speed_time;
-            }
-
-            std::string local_file_path = local_file_full_path + file_name;
-
-            auto download_cb = [&remote_file_path,
-                                estimate_timeout,
-                                &local_file_path,
-                                file_size] (HttpClient* client) {
-                RETURN_IF_ERROR(client->init(remote_file_path));
-                client->set_timeout_ms(estimate_timeout * 1000);
-                RETURN_IF_ERROR(client->download(local_file_path));
-
-                // Check file length
-                uint64_t local_file_size = boost::filesystem::file_size(local_file_path);
-                if (local_file_size != file_size) {
-                    LOG(WARNING) << "download file length error"
-                        << ", remote_path=" << remote_file_path
-                        << ", file_size=" << file_size
-                        << ", local_file_size=" << local_file_size;
-                    return Status::InternalError("downloaded file size is not equal");
-                }
-                chmod(local_file_path.c_str(), S_IRUSR | S_IWUSR);
-                return Status::OK();
-            };
-            download_status = HttpClient::execute_with_retry(
-                DOWNLOAD_FILE_MAX_RETRY, 1, download_cb);
-            if (!download_status.ok()) {
-                LOG(WARNING) << "download file failed over max retry."
-                    << ", remote_path=" << remote_file_path
-                    << ", signature=" << signature
-                    << ", errormsg=" << download_status.get_error_msg();
-                status = DORIS_ERROR;
-                break;
-            }
-        } // Clone files from remote backend
+        AgentStatus copy_status = _download_files(
+                StorageEngine::instance()->clone_download_thread_pool(), data_dir,
+                http_host + HTTP_REQUEST_PREFIX + HTTP_REQUEST_TOKEN_PARAM + token
+                    + HTTP_REQUEST_FILE_PARAM + src_file_full_path,
+                local_file_full_path, file_name_list, &total_file_size);
+        if (copy_status != DORIS_SUCCESS) {
+            status = copy_status;
+        }
 
         uint64_t total_time_ms = watch.elapsed_time() / 1000 / 1000;
         total_time_ms = total_time_ms > 0 ? total_time_ms : 0;
@@ -556,6 +508,231 @@ AgentStatus EngineCloneTask::_clone_copy(
     return status;
 }
 
+static bool is_header_file(const std::string& file_name) {
+    return file_name.size() > 4 && file_name.substr(file_name.size() - 4, 4) == ".hdr";
+}
+
+// all clone tasks share config::clone_download_bytes_per_sec
+static TokenBucket* clone_download_bucket() {
+    static TokenBucket bucket(0, 0);
+    return &bucket;
+}
+
+AgentStatus EngineCloneTask::_download_files(ThreadPool* thread_pool,
+                                             DataDir& data_dir,
+                                             const std::string& remote_url_prefix,
+                                             const std::string& local_path,
+                                             const std::vector<std::string>& file_names,
+                                             uint64_t* total_file_size) {
+    // allows a burst of one second
+    clone_download_bucket()->set_rate(config::clone_download_bytes_per_sec,
+                                      config::clone_download_bytes_per_sec);
+
+    // The header files go last: the tablet can't be loaded without its header,
+    // so once the header is there, all the data files are.
+    std::vector<std::string> data_files;
+    std::vector<std::string> header_files;
+    for (auto& file_name : file_names) {
+        if (is_header_file(file_name)) {
+            header_files.push_back(file_name);
+        } else {
+            data_files.push_back(file_name);
+        }
+    }
+
+    std::atomic<size_t> next_file(0);
+    std::atomic<uint64_t> copied_size(0);
+    std::mutex status_lock;
+    AgentStatus status = DORIS_SUCCESS;
+    size_t num_workers = std::max<size_t>(1, std::min<size_t>(
+            config::clone_download_num_threads, data_files.size()));
+    CountDownLatch latch(num_workers);
+    auto download_data_files = [&] {
+        ScopedIOClass io_class(data_dir.io_scheduler(), IOScheduler::IO_CLASS_CLONE);
+        while (true) {
+            {
+                // stop at the first failure
+                std::lock_guard<std::mutex> l(status_lock);
+                if (status != DORIS_SUCCESS) {
+                    break;
+                }
+            }
+            size_t file_idx = next_file.fetch_add(1);
+            if (file_idx >= data_files.size()) {
+                break;
+            }
+            uint64_t file_size = 0;
+            AgentStatus st = _download_file(data_dir, remote_url_prefix + data_files[file_idx],
+                                            local_path + data_files[file_idx], &file_size);
+            if (st != DORIS_SUCCESS) {
+                std::lock_guard<std::mutex> l(status_lock);
+                if (status == DORIS_SUCCESS) {
+                    status = st;
+                }
+                break;
+            }
+            copied_size += file_size;
+            VLOG(3) << "clone copied " << file_idx + 1 << "/" << data_files.size()
+                    << " files, " << copied_size.load() << " B. signature=" << _signature;
+        }
+        latch.count_down();
+    };
+    for (size_t i = 0; i < num_workers; ++i) {
+        // the pool is only shut down with the engine
+        if (!thread_pool->offer(download_data_files)) {
+            download_data_files();
+        }
+    }
+    latch.await();
+
+    // the headers are clone io too
+    ScopedIOClass io_class(data_dir.io_scheduler(), IOScheduler::IO_CLASS_CLONE);
+    for (auto& file_name : header_files) {
+        if (status != DORIS_SUCCESS) {
+            break;
+        }
+        uint64_t file_size = 0;
+        status = _download_file(data_dir, remote_url_prefix + file_name,
+                                local_path + file_name, &file_size);
+        copied_size += file_size;
+    }
+    *total_file_size = copied_size.load();
+    return status;
+}
+
+int64_t EngineCloneTask::_download_low_speed_limit(DataDir& data_dir) {
+    // All the downloads the pool runs at once may share the budget of all
+    // clones and the io scheduler of the same disk, which may be tuned down to
+    // its min rate. Half of a download's share leaves room for the bursts of
+    // the others.
+    int64_t low_speed_limit = config::download_low_speed_limit_kbps * 1024;
+    int64_t num_streams = std::max(1, config::clone_download_thread_pool_size);
+    int64_t budgets[] = {config::clone_download_bytes_per_sec,
+                         data_dir.io_scheduler()->min_rate()};
+    for (int64_t budget : budgets) {
+        if (budget > 0) {
+            low_speed_limit = std::min(low_speed_limit, budget / num_streams / 2);
+        }
+    }
+    return std::max<int64_t>(1, low_speed_limit);
+}
+
+AgentStatus EngineCloneTask::_download_file(DataDir& data_dir,
+                                            const std::string& remote_file_path,
+                                            const std::string& local_file_path,
+                                            uint64_t* file_size) {
+    // get file length
+    auto get_file_size_cb = [&remote_file_path, file_size] (HttpClient* client) {
+        RETURN_IF_ERROR(client->init(remote_file_path));
+        client->set_timeout_ms(GET_LENGTH_TIMEOUT * 1000);
+        RETURN_IF_ERROR(client->head());
+        *file_size = client->get_content_length();
+        return Status::OK();
+    };
+    Status download_status = HttpClient::execute_with_retry(
+        DOWNLOAD_FILE_MAX_RETRY, 1, get_file_size_cb);
+    if (!download_status.ok()) {
+        LOG(WARNING) << "clone copy get file length failed over max time. remote_path="
+            << remote_file_path
+            << ", signature=" << _signature;
+        return DORIS_ERROR;
+    }
+
+    // check disk capacity
+    if (data_dir.reach_capacity_limit(*file_size)) {
+        return DORIS_DISK_REACH_CAPACITY_LIMIT;
+    }
+
+    // A source of an older version replies the file itself instead of its md5,
+    // the file is not checked then.
+    std::string remote_md5;
+    if (config::clone_download_verify_md5) {
+        bool md5_unsupported = false;
+        auto get_md5_cb = [&remote_file_path, &remote_md5, &md5_unsupported] (HttpClient* client) {
+            remote_md5.clear();
+            RETURN_IF_ERROR(client->init(remote_file_path + HTTP_REQUEST_MD5_PARAM));
+            client->set_timeout_ms(GET_MD5_TIMEOUT * 1000);
+            Status st = client->execute([&remote_md5, &md5_unsupported] (const void* data,
+                                                                         size_t length) {
+                remote_md5.append((const char*)data, length);
+                md5_unsupported = remote_md5.size() > MD5_HEX_LENGTH;
+                return !md5_unsupported;
+            });
+            return md5_unsupported ? Status::OK() : st;
+        };
+        download_status = HttpClient::execute_with_retry(
+            DOWNLOAD_FILE_MAX_RETRY, 1, get_md5_cb);
+        if (!download_status.ok()) {
+            LOG(WARNING) << "clone copy get file md5 failed over max time. remote_path="
+                << remote_file_path
+                << ", signature=" << _signature;
+            return DORIS_ERROR;
+        }
+        if (md5_unsupported || remote_md5.size() != MD5_HEX_LENGTH
+                || remote_md5.find_first_not_of("0123456789abcdef") != std::string::npos) {
+            remote_md5.clear();
+        }
+    }
+
+    // The throttling below sleeps while curl receives the file, a low speed
+    // limit above what it leaves to the download would abort every attempt.
+    int64_t low_speed_limit = _download_low_speed_limit(data_dir);
+    uint64_t estimate_timeout = *file_size / low_speed_limit;
+    if (estimate_timeout < config::download_low_speed_time) {
+        estimate_timeout = config::download_low_speed_time;
+    }
+
+    auto download_cb = [&remote_file_path,
+                        estimate_timeout,
+                        low_speed_limit,
+                        &local_file_path,
+                        &remote_md5,
+                        file_size] (HttpClient* client) {
+        RETURN_IF_ERROR(client->init(remote_file_path));
+        client->set_timeout_ms(estimate_timeout * 1000);
+        client->set_low_speed_limit(low_speed_limit);
+        Md5Digest md5;
+        RETURN_IF_ERROR(client->download(local_file_path, [&md5] (const void* data,
+                                                                  size_t length) {
+            md5.update(data, length);
+            DorisMetrics::clone_download_bytes.increment(length);
+            // the download doesn't go through the file helpers, charge it here
+            IOScheduler::consume_current(length);
+            clone_download_bucket()->consume(length);
+        }));
+
+        // Check file length
+        uint64_t local_file_size = boost::filesystem::file_size(local_file_path);
+        if (local_file_size != *file_size) {
+            LOG(WARNING) << "download file length error"
+                << ", remote_path=" << remote_file_path
+                << ", file_size=" << *file_size
+                << ", local_file_size=" << local_file_size;
+            return Status::InternalError("downloaded file size is not equal");
+        }
+        md5.digest();
+        if (!remote_md5.empty() && md5.hex() != remote_md5) {
+            LOG(WARNING) << "download file md5 error"
+                << ", remote_path=" << remote_file_path
+                << ", remote_md5=" << remote_md5
+                << ", local_md5=" << md5.hex();
+            return Status::InternalError("downloaded file md5 is not equal");
+        }
+        chmod(local_file_path.c_str(), S_IRUSR | S_IWUSR);
+        return Status::OK();
+    };
+    download_status = HttpClient::execute_with_retry(
+        DOWNLOAD_FILE_MAX_RETRY, 1, download_cb);
+    if (!download_status.ok()) {
+        LOG(WARNING) << "download file failed over max retry."
+            << ", remote_path=" << remote_file_path
+            << ", signature=" << _signature
+            << ", errormsg=" << download_status.get_error_msg();
+        return DORIS_ERROR;
+    }
+    return DORIS_SUCCESS;
+}
+
 OLAPStatus EngineCloneTask::_convert_to_new_snapshot(const string& clone_dir, int64_t tablet_id) {
     OLAPStatus res = OLAP_SUCCESS;
     // check clone dir existed
@@ -722,6 +899,9 @@ OLAPStatus EngineCloneTask::_finish_clone(TabletSharedPtr tablet, const string&
     tablet->release_cumulative_lock();
     tablet->release_base_compaction_lock();
 
+    // a full clone resets the cumulative point
+    tablet->update_compaction_scores();
+
     // clear clone dir
     boost::filesystem::path clone_dir_path(clone_dir);
     boost::filesystem::remove_all(clone_dir_path);
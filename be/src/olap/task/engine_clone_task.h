@@ -44,7 +44,8 @@ public:
     ~EngineCloneTask() {}
 
 private:
-    
+    friend class EngineCloneTaskTest;
+
     virtual OLAPStatus _finish_clone(TabletSharedPtr tablet, const std::string& clone_dir,
                                     int64_t committed_version, bool is_incremental_clone);
     
@@ -64,6 +65,25 @@ private:
         bool* allow_incremental_clone, 
         TabletSharedPtr tablet);
         
+    // Downloads 'file_names' from 'remote_url_prefix' into 'local_path', the data
+    // files by up to config::clone_download_num_threads workers of 'thread_pool',
+    // the header files last.
+    AgentStatus _download_files(ThreadPool* thread_pool,
+                                DataDir& data_dir,
+                                const std::string& remote_url_prefix,
+                                const std::string& local_path,
+                                const std::vector<std::string>& file_names,
+                                uint64_t* total_file_size);
+
+    // The low speed limit of a download to 'data_dir', below the share of the
+    // clone download budgets the download can count on.
+    static int64_t _download_low_speed_limit(DataDir& data_dir);
+
+    AgentStatus _download_file(DataDir& data_dir,
+                               const std::string& remote_file_path,
+                               const std::string& local_file_path,
+                               uint64_t* file_size);
+
     OLAPStatus _convert_to_new_snapshot(const string& clone_dir, int64_t tablet_id);
 
     void _set_tablet_info(AgentStatus status, bool is_new_tablet);
@@ -19,6 +19,7 @@
 #include "olap/data_dir.h"
 #include "olap/rowset/rowset_meta_manager.h"
 #include "olap/tablet_manager.h"
+#include "util/doris_metrics.h"
 #include <map>
 
 namespace doris {
@@ -112,6 +113,13 @@ OLAPStatus EnginePublishVersionTask::finish() {
                 res = publish_status;
                 continue;
             }
+            if (publish_status == OLAP_SUCCESS) {
+                if (tablet->compaction_policy() == SIZE_TIERED_COMPACTION) {
+                    DorisMetrics::size_tiered_load_bytes.increment(rowset->data_disk_size());
+                } else {
+                    DorisMetrics::num_based_load_bytes.increment(rowset->data_disk_size());
+                }
+            }
             partition_related_tablet_infos.erase(tablet_info);
             LOG(INFO) << "publish version successfully on tablet. tablet=" << tablet->full_name()
                       << ", transaction_id=" << transaction_id << ", version=" << version.first
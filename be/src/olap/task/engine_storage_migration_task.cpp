@@ -19,6 +19,7 @@
 
 #include "olap/snapshot_manager.h"
 #include "olap/tablet_meta_manager.h"
+#include "util/io_scheduler.h"
 
 namespace doris {
 
@@ -164,8 +165,12 @@ OLAPStatus EngineStorageMigrationTask::_storage_medium_migrate(
         }
 
 
-        // migrate all index and data files but header file
-        res = _copy_index_and_data_files(schema_hash_path, tablet, consistent_rowsets);
+        // migrate all index and data files but header file, the copy is charged
+        // to the destination dir
+        {
+            ScopedIOClass io_class(stores[0]->io_scheduler(), IOScheduler::IO_CLASS_STORAGE_MIGRATION);
+            res = _copy_index_and_data_files(schema_hash_path, tablet, consistent_rowsets);
+        }
         if (res != OLAP_SUCCESS) {
             LOG(WARNING) << "fail to copy index and data files when migrate. res=" << res;
             break;
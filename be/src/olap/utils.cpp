@@ -41,6 +41,7 @@
 #include "common/logging.h"
 #include "common/status.h"
 #include "util/errno.h"
+#include "util/io_scheduler.h"
 #include "gutil/strings/substitute.h"
 #include "olap/olap_common.h"
 #include "olap/olap_define.h"
@@ -1193,6 +1194,7 @@ OLAPStatus copy_file(const string& src, const string& dest) {
         } else if (0 == rd_size) {
             break;
         }
+        IOScheduler::consume_current(rd_size);
 
         ssize_t wr_size = ::write(dest_fd, buf, rd_size);
         if (wr_size != rd_size) {
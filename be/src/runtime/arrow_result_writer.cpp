@@ -0,0 +1,236 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/arrow_result_writer.h"
+
+#include <arrow/array.h>
+#include <arrow/builder.h>
+#include <arrow/memory_pool.h>
+#include <arrow/record_batch.h>
+#include <arrow/type.h>
+
+#include "exprs/expr.h"
+#include "runtime/buffer_control_block.h"
+#include "runtime/row_batch.h"
+#include "runtime/tuple_row.h"
+#include "util/arrow/row_batch.h"
+#include "util/arrow/utils.h"
+#include "util/types.h"
+
+#include "gen_cpp/PaloInternalService_types.h"
+
+namespace doris {
+
+template<typename BuilderType, typename CType>
+static arrow::Status append_values(ExprContext* ctx, RowBatch* batch, BuilderType* builder) {
+    ARROW_RETURN_NOT_OK(builder->Reserve(batch->num_rows()));
+    for (int i = 0; i < batch->num_rows(); ++i) {
+        void* item = ctx->get_value(batch->get_row(i));
+        if (item == nullptr) {
+            ARROW_RETURN_NOT_OK(builder->AppendNull());
+            continue;
+        }
+        ARROW_RETURN_NOT_OK(builder->Append(*static_cast<CType*>(item)));
+    }
+    return arrow::Status::OK();
+}
+
+// the types which convert_to_arrow_type() turns into utf8
+static arrow::Status append_strings(ExprContext* ctx, RowBatch* batch,
+                                    arrow::StringBuilder* builder) {
+    ARROW_RETURN_NOT_OK(builder->Reserve(batch->num_rows()));
+    PrimitiveType type = ctx->root()->type().type;
+    for (int i = 0; i < batch->num_rows(); ++i) {
+        void* item = ctx->get_value(batch->get_row(i));
+        if (item == nullptr) {
+            ARROW_RETURN_NOT_OK(builder->AppendNull());
+            continue;
+        }
+        switch (type) {
+        case TYPE_VARCHAR:
+        case TYPE_CHAR:
+        case TYPE_HLL: {
+            const StringValue* string_val = static_cast<const StringValue*>(item);
+            ARROW_RETURN_NOT_OK(builder->Append(
+                    reinterpret_cast<const uint8_t*>(string_val->ptr), string_val->len));
+            break;
+        }
+        case TYPE_DATE:
+        case TYPE_DATETIME: {
+            char buf[64];
+            const DateTimeValue* time_val = static_cast<const DateTimeValue*>(item);
+            char* pos = time_val->to_string(buf);
+            ARROW_RETURN_NOT_OK(builder->Append(buf, pos - buf - 1));
+            break;
+        }
+        case TYPE_LARGEINT: {
+            char buf[48];
+            int len = 48;
+            char* v = LargeIntValue::to_string(
+                reinterpret_cast<const PackedInt128*>(item)->value, buf, &len);
+            ARROW_RETURN_NOT_OK(builder->Append(v, len));
+            break;
+        }
+        case TYPE_DECIMAL: {
+            const DecimalValue* decimal_val = static_cast<const DecimalValue*>(item);
+            int output_scale = ctx->root()->output_scale();
+            std::string decimal_str = (output_scale > 0 && output_scale <= 30)
+                    ? decimal_val->to_string(output_scale) : decimal_val->to_string();
+            ARROW_RETURN_NOT_OK(builder->Append(decimal_str));
+            break;
+        }
+        default:
+            return arrow::Status::TypeError("unsupported column type");
+        }
+    }
+    return arrow::Status::OK();
+}
+
+static arrow::Status append_decimals(ExprContext* ctx, RowBatch* batch,
+                                     arrow::Decimal128Builder* builder) {
+    ARROW_RETURN_NOT_OK(builder->Reserve(batch->num_rows()));
+    for (int i = 0; i < batch->num_rows(); ++i) {
+        void* item = ctx->get_value(batch->get_row(i));
+        if (item == nullptr) {
+            ARROW_RETURN_NOT_OK(builder->AppendNull());
+            continue;
+        }
+        __int128 value = reinterpret_cast<const PackedInt128*>(item)->value;
+        ARROW_RETURN_NOT_OK(builder->Append(
+                arrow::Decimal128((int64_t)(value >> 64), (uint64_t)value)));
+    }
+    return arrow::Status::OK();
+}
+
+ArrowResultWriter::ArrowResultWriter(
+        BufferControlBlock* sinker,
+        const std::vector<ExprContext*>& output_expr_ctxs) :
+            ResultWriter(sinker, output_expr_ctxs) {
+}
+
+ArrowResultWriter::~ArrowResultWriter() {
+}
+
+Status ArrowResultWriter::init(RuntimeState* state) {
+    if (NULL == _sinker) {
+        return Status::InternalError("sinker is NULL pointer.");
+    }
+    std::vector<std::shared_ptr<arrow::Field>> fields;
+    for (int i = 0; i < _output_expr_ctxs.size(); ++i) {
+        const TypeDescriptor& type = _output_expr_ctxs[i]->root()->type();
+        std::shared_ptr<arrow::DataType> arrow_type;
+        if (type.type == TYPE_BOOLEAN) {
+            arrow_type = arrow::boolean();
+        } else if (type.type == TYPE_NULL) {
+            arrow_type = arrow::null();
+        } else {
+            RETURN_IF_ERROR(convert_to_arrow_type(type, &arrow_type));
+        }
+        fields.push_back(arrow::field("c" + std::to_string(i), arrow_type, true));
+    }
+    _schema = arrow::schema(std::move(fields));
+    return Status::OK();
+}
+
+Status ArrowResultWriter::_convert_column(int column, RowBatch* batch,
+                                          std::shared_ptr<arrow::Array>* out) {
+    ExprContext* ctx = _output_expr_ctxs[column];
+    arrow::MemoryPool* pool = arrow::default_memory_pool();
+    const std::shared_ptr<arrow::DataType>& arrow_type = _schema->field(column)->type();
+    arrow::Status st;
+    switch (arrow_type->id()) {
+    case arrow::Type::NA: {
+        arrow::NullBuilder builder(pool);
+        for (int i = 0; st.ok() && i < batch->num_rows(); ++i) {
+            st = builder.AppendNull();
+        }
+        if (st.ok()) {
+            st = builder.Finish(out);
+        }
+        break;
+    }
+    case arrow::Type::BOOL: {
+        arrow::BooleanBuilder builder(pool);
+        st = append_values<arrow::BooleanBuilder, bool>(ctx, batch, &builder);
+        if (st.ok()) {
+            st = builder.Finish(out);
+        }
+        break;
+    }
+#define APPEND_NUMERIC(TYPE_ID, BUILDER, CTYPE) \
+    case arrow::Type::TYPE_ID: { \
+        arrow::BUILDER builder(pool); \
+        st = append_values<arrow::BUILDER, CTYPE>(ctx, batch, &builder); \
+        if (st.ok()) { \
+            st = builder.Finish(out); \
+        } \
+        break; \
+    }
+    APPEND_NUMERIC(INT8, Int8Builder, int8_t)
+    APPEND_NUMERIC(INT16, Int16Builder, int16_t)
+    APPEND_NUMERIC(INT32, Int32Builder, int32_t)
+    APPEND_NUMERIC(INT64, Int64Builder, int64_t)
+    APPEND_NUMERIC(FLOAT, FloatBuilder, float)
+    APPEND_NUMERIC(DOUBLE, DoubleBuilder, double)
+#undef APPEND_NUMERIC
+    case arrow::Type::STRING: {
+        arrow::StringBuilder builder(pool);
+        st = append_strings(ctx, batch, &builder);
+        if (st.ok()) {
+            st = builder.Finish(out);
+        }
+        break;
+    }
+    case arrow::Type::DECIMAL: {
+        arrow::Decimal128Builder builder(arrow_type, pool);
+        st = append_decimals(ctx, batch, &builder);
+        if (st.ok()) {
+            st = builder.Finish(out);
+        }
+        break;
+    }
+    default:
+        return Status::InternalError("unsupported arrow type " + arrow_type->ToString());
+    }
+    return to_status(st);
+}
+
+Status ArrowResultWriter::append_row_batch(RowBatch* batch) {
+    if (NULL == batch || 0 == batch->num_rows()) {
+        return Status::OK();
+    }
+
+    std::vector<std::shared_ptr<arrow::Array>> arrays(_output_expr_ctxs.size());
+    for (int i = 0; i < _output_expr_ctxs.size(); ++i) {
+        RETURN_IF_ERROR(_convert_column(i, batch, &arrays[i]));
+    }
+    std::shared_ptr<arrow::RecordBatch> record_batch = arrow::RecordBatch::Make(
+            _schema, batch->num_rows(), std::move(arrays));
+
+    std::unique_ptr<TFetchDataResult> result(new TFetchDataResult());
+    result->result_batch.rows.resize(1);
+    RETURN_IF_ERROR(serialize_record_batch(*record_batch, &result->result_batch.rows[0]));
+    Status status = _sinker->add_batch(result.get());
+    if (status.ok()) {
+        result.release();
+    } else {
+        LOG(WARNING) << "append result batch to sink failed.";
+    }
+    return status;
+}
+
+}
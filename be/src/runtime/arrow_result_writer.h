@@ -0,0 +1,56 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_RUNTIME_ARROW_RESULT_WRITER_H
+#define DORIS_BE_RUNTIME_ARROW_RESULT_WRITER_H
+
+#include <memory>
+#include <vector>
+
+#include "runtime/result_writer.h"
+
+namespace arrow {
+
+class Array;
+class Schema;
+
+}
+
+namespace doris {
+
+// Converts the output of a row batch to an Arrow record batch and appends it to the
+// result sink as one row of a TFetchDataResult, which holds the batch as an Arrow IPC
+// stream. The column i of the record batch is the value of the output expr i, named
+// "c<i>". The client fetches the batches from the BE by fetch_data() and reads each
+// of them with an arrow::ipc::RecordBatchStreamReader.
+class ArrowResultWriter : public ResultWriter {
+public:
+    ArrowResultWriter(BufferControlBlock* sinker, const std::vector<ExprContext*>& output_expr_ctxs);
+    ~ArrowResultWriter() override;
+
+    Status init(RuntimeState* state) override;
+    Status append_row_batch(RowBatch* batch) override;
+
+private:
+    Status _convert_column(int column, RowBatch* batch, std::shared_ptr<arrow::Array>* out);
+
+    std::shared_ptr<arrow::Schema> _schema;
+};
+
+}
+
+#endif
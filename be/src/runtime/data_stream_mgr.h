@@ -85,6 +85,14 @@ public:
     // Closes all receivers registered for fragment_instance_id immediately.
     void cancel(const TUniqueId& fragment_instance_id);
 
+    // Return the receiver for given fragment_instance_id/node_id,
+    // or NULL if not found. If 'acquire_lock' is false, assumes _lock is already being
+    // held and won't try to acquire it.
+    // Senders in the same process use it to hand batches to the receiver directly.
+    boost::shared_ptr<DataStreamRecvr> find_recvr(
+            const TUniqueId& fragment_instance_id, PlanNodeId node_id,
+            bool acquire_lock = true);
+
 private:
     friend class DataStreamRecvr;
 
@@ -121,13 +129,6 @@ private:
     typedef std::set<std::pair<TUniqueId, PlanNodeId>, ComparisonOp > FragmentStreamSet;
     FragmentStreamSet _fragment_stream_set;
 
-    // Return the receiver for given fragment_instance_id/node_id,
-    // or NULL if not found. If 'acquire_lock' is false, assumes _lock is already being
-    // held and won't try to acquire it.
-    boost::shared_ptr<DataStreamRecvr> find_recvr(
-            const TUniqueId& fragment_instance_id, PlanNodeId node_id,
-            bool acquire_lock = true);
-
     // Remove receiver block for fragment_instance_id/node_id from the map.
     Status deregister_recvr(const TUniqueId& fragment_instance_id, PlanNodeId node_id);
 
@@ -20,6 +20,7 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <deque>
+#include <map>
 
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -70,11 +71,18 @@ public:
     // blocks if this will make the stream exceed its buffer limit.
     // If the total size of the batches in this queue would exceed the allowed buffer size,
     // the queue is considered full and the call blocks until a batch is dequeued.
-    void add_batch(
+    // Returns an error if the batch can't be deserialized.
+    Status add_batch(
         const PRowBatch& pb_batch,
         int be_number, int64_t packet_seq,
         ::google::protobuf::Closure** done);
 
+    // Adds a batch from a sender in the same process, see DataStreamRecvr::add_batch().
+    void add_batch(RowBatch* batch, bool use_move, bool wait_for_space);
+
+    // See DataStreamRecvr::has_batch_or_eos().
+    bool has_batch_or_eos();
+
     // Decrement the number of remaining senders for this queue and signal eos ("new data")
     // if the count drops to 0. The number of senders will be 1 for a merging
     // DataStreamRecvr.
@@ -129,6 +137,23 @@ private:
     std::unordered_map<int, int64_t> _packet_seq_map; // be_number => packet_seq
 
     std::deque<google::protobuf::Closure*> _pending_closures;
+
+    // A packet that arrived before an earlier packet of the same sender. The response
+    // is sent once the batch is enqueued.
+    struct HeldBatch {
+        int batch_size;
+        RowBatch* batch;
+        google::protobuf::Closure* done;
+    };
+    // be_number => packet_seq => batch
+    std::unordered_map<int, std::map<int64_t, HeldBatch>> _held_batches;
+
+    // Appends a batch to _batch_queue. The response is withheld if the buffer
+    // limit is exceeded, see add_batch().
+    void enqueue_batch(int batch_size, RowBatch* batch, ::google::protobuf::Closure** done);
+
+    // Runs the withheld responses of the held back batches.
+    void run_held_closures();
 };
 
 DataStreamRecvr::SenderQueue::SenderQueue(
@@ -172,7 +197,7 @@ Status DataStreamRecvr::SenderQueue::get_batch(RowBatch** next_batch) {
     _recvr->_num_buffered_bytes -= _batch_queue.front().first;
     VLOG_ROW << "fetched #rows=" << result->num_rows();
     _batch_queue.pop_front();
-    // _data_removal_cv.notify_one();
+    _data_removal_cv.notify_all();
     _current_batch.reset(result);
     *next_batch = _current_batch.get();
 
@@ -185,24 +210,22 @@ Status DataStreamRecvr::SenderQueue::get_batch(RowBatch** next_batch) {
     return Status::OK();
 }
 
-void DataStreamRecvr::SenderQueue::add_batch(
+Status DataStreamRecvr::SenderQueue::add_batch(
         const PRowBatch& pb_batch,
         int be_number, int64_t packet_seq,
         ::google::protobuf::Closure** done) {
     unique_lock<mutex> l(_lock);
     if (_is_cancelled) {
-        return;
+        return Status::OK();
     }
-    auto iter = _packet_seq_map.find(be_number);
-    if (iter != _packet_seq_map.end()) {
-        if (iter->second >= packet_seq) {
-            LOG(WARNING) << "packet already exist [cur_packet_id= " << iter->second
-                         << " receive_packet_id=" << packet_seq << "]";
-            return;
-        }
-        iter->second = packet_seq;
-    } else {
-        _packet_seq_map.emplace(be_number, packet_seq);
+    // A sender has several rpcs in flight, so its packets may arrive out of order
+    int64_t& last_packet_seq = _packet_seq_map.emplace(be_number, -1).first->second;
+    auto held_iter = _held_batches.find(be_number);
+    if (last_packet_seq >= packet_seq
+            || (held_iter != _held_batches.end() && held_iter->second.count(packet_seq) > 0)) {
+        LOG(WARNING) << "packet already exist [cur_packet_id= " << last_packet_seq
+                     << " receive_packet_id=" << packet_seq << "]";
+        return Status::OK();
     }
 
     int batch_size = RowBatch::get_batch_size(pb_batch);
@@ -216,7 +239,7 @@ void DataStreamRecvr::SenderQueue::add_batch(
     // DCHECK_GT(_num_remaining_senders, 0);
     if (_num_remaining_senders <= 0) {
         DCHECK(_sender_eos_set.end() != _sender_eos_set.find(be_number));
-        return;
+        return Status::OK();
     }
 
     // We always accept the batch regardless of buffer limit, to avoid rpc pipeline stall.
@@ -231,7 +254,7 @@ void DataStreamRecvr::SenderQueue::add_batch(
     //  if the merger is waiting for data from an empty queue that cannot be filled
     //  because the limit has been reached.
     if (_is_cancelled) {
-        return;
+        return Status::OK();
     }
 
     RowBatch* batch = NULL;
@@ -240,9 +263,45 @@ void DataStreamRecvr::SenderQueue::add_batch(
         // Note: if this function makes a row batch, the batch *must* be added
         // to _batch_queue. It is not valid to create the row batch and destroy
         // it in this thread.
-        batch = new RowBatch(_recvr->row_desc(), pb_batch, _recvr->mem_tracker());
+        RETURN_IF_ERROR(RowBatch::create(
+                _recvr->row_desc(), pb_batch, _recvr->mem_tracker(), &batch));
     }
-   
+
+    if (packet_seq > last_packet_seq + 1) {
+        // An earlier packet of this sender is still in flight. Hold this one back with
+        // its response, which keeps the slot of the sender's rpc window occupied.
+        HeldBatch held {batch_size, batch, nullptr};
+        if (done != nullptr) {
+            held.done = *done;
+            *done = nullptr;
+        }
+        _held_batches[be_number].emplace(packet_seq, held);
+        return Status::OK();
+    }
+
+    last_packet_seq = packet_seq;
+    enqueue_batch(batch_size, batch, done);
+
+    // Deliver the held back packets that are in order now
+    if (held_iter == _held_batches.end()) {
+        return Status::OK();
+    }
+    std::map<int64_t, HeldBatch>& held_batches = held_iter->second;
+    while (!held_batches.empty() && held_batches.begin()->first == last_packet_seq + 1) {
+        HeldBatch& held = held_batches.begin()->second;
+        last_packet_seq = held_batches.begin()->first;
+        google::protobuf::Closure* held_done = held.done;
+        enqueue_batch(held.batch_size, held.batch, held_done != nullptr ? &held_done : nullptr);
+        if (held_done != nullptr) {
+            held_done->Run();
+        }
+        held_batches.erase(held_batches.begin());
+    }
+    return Status::OK();
+}
+
+void DataStreamRecvr::SenderQueue::enqueue_batch(
+        int batch_size, RowBatch* batch, ::google::protobuf::Closure** done) {
     VLOG_ROW << "added #rows=" << batch->num_rows()
         << " batch_size=" << batch_size << "\n";
     _batch_queue.emplace_back(batch_size, batch);
@@ -256,6 +315,49 @@ void DataStreamRecvr::SenderQueue::add_batch(
     _data_arrival_cv.notify_one();
 }
 
+void DataStreamRecvr::SenderQueue::add_batch(RowBatch* batch, bool use_move,
+                                             bool wait_for_space) {
+    int batch_size = batch->total_byte_size();
+    unique_lock<mutex> l(_lock);
+    // Always accept a batch into an empty queue, a merging receiver may be waiting for it
+    while (wait_for_space && !_is_cancelled && !_batch_queue.empty()
+            && _recvr->exceeds_limit(batch_size)) {
+        SCOPED_TIMER(_recvr->_buffer_full_total_timer);
+        _data_removal_cv.wait(l);
+    }
+    if (_is_cancelled || _num_remaining_senders <= 0) {
+        return;
+    }
+    COUNTER_UPDATE(_recvr->_bytes_received_counter, batch_size);
+    COUNTER_UPDATE(_recvr->_local_bytes_received_counter, batch_size);
+
+    // Note: as in the rpc path, the row batch is created under the lock and must be
+    // added to _batch_queue.
+    RowBatch* local_batch = new RowBatch(
+            _recvr->row_desc(), batch->capacity(), _recvr->mem_tracker());
+    if (use_move) {
+        local_batch->acquire_state(batch);
+    } else {
+        const std::vector<TupleDescriptor*>& descs = _recvr->row_desc().tuple_descriptors();
+        for (int i = 0; i < batch->num_rows(); ++i) {
+            TupleRow* dest = local_batch->get_row(local_batch->add_row());
+            batch->get_row(i)->deep_copy(dest, descs, local_batch->tuple_data_pool(), false);
+            local_batch->commit_last_row();
+        }
+    }
+
+    VLOG_ROW << "added local #rows=" << local_batch->num_rows()
+        << " batch_size=" << batch_size << "\n";
+    _batch_queue.emplace_back(batch_size, local_batch);
+    _recvr->_num_buffered_bytes += batch_size;
+    _data_arrival_cv.notify_one();
+}
+
+bool DataStreamRecvr::SenderQueue::has_batch_or_eos() {
+    lock_guard<mutex> l(_lock);
+    return _is_cancelled || !_batch_queue.empty() || _num_remaining_senders <= 0;
+}
+
 void DataStreamRecvr::SenderQueue::decrement_senders(int be_number) {
     lock_guard<mutex> l(_lock);
     if (_sender_eos_set.end() != _sender_eos_set.find(be_number)) {
@@ -287,7 +389,7 @@ void DataStreamRecvr::SenderQueue::cancel() {
     // Wake up all threads waiting to produce/consume batches.  They will all
     // notice that the stream is cancelled and handle it.
     _data_arrival_cv.notify_all();
-    // _data_removal_cv.notify_all();
+    _data_removal_cv.notify_all();
     // PeriodicCounterUpdater::StopTimeSeriesCounter(
     //         _recvr->_bytes_received_time_series_counter);
 
@@ -297,6 +399,18 @@ void DataStreamRecvr::SenderQueue::cancel() {
             done->Run();
         }
         _pending_closures.clear();
+        run_held_closures();
+    }
+}
+
+void DataStreamRecvr::SenderQueue::run_held_closures() {
+    for (auto& sender : _held_batches) {
+        for (auto& packet : sender.second) {
+            if (packet.second.done != nullptr) {
+                packet.second.done->Run();
+                packet.second.done = nullptr;
+            }
+        }
     }
 }
 
@@ -312,13 +426,21 @@ void DataStreamRecvr::SenderQueue::close() {
             done->Run();
         }
         _pending_closures.clear();
+        run_held_closures();
     }
+    _data_removal_cv.notify_all();
 
     // Delete any batches queued in _batch_queue
     for (RowBatchQueue::iterator it = _batch_queue.begin();
             it != _batch_queue.end(); ++it) {
         delete it->second;
     }
+    for (auto& sender : _held_batches) {
+        for (auto& packet : sender.second) {
+            delete packet.second.batch;
+        }
+    }
+    _held_batches.clear();
 
     _current_batch.reset();
 }
@@ -377,6 +499,8 @@ DataStreamRecvr::DataStreamRecvr(
     // Initialize the counters
     _bytes_received_counter =
         ADD_COUNTER(_profile, "BytesReceived", TUnit::BYTES);
+    _local_bytes_received_counter =
+        ADD_COUNTER(_profile, "LocalBytesReceived", TUnit::BYTES);
     // _bytes_received_time_series_counter =
     //     ADD_TIME_SERIES_COUNTER(_profile, "BytesReceived", _bytes_received_counter);
     _deserialize_row_batch_timer =
@@ -392,13 +516,29 @@ Status DataStreamRecvr::get_next(RowBatch* output_batch, bool* eos) {
     return _merger->get_next(output_batch, eos);
 }
 
-void DataStreamRecvr::add_batch(
+Status DataStreamRecvr::add_batch(
         const PRowBatch& batch, int sender_id,
         int be_number, int64_t packet_seq,
         ::google::protobuf::Closure** done) {
     int use_sender_id = _is_merging ? sender_id : 0;
     // Add all batches to the same queue if _is_merging is false.
-    _sender_queues[use_sender_id]->add_batch(batch, be_number, packet_seq, done);
+    Status status = _sender_queues[use_sender_id]->add_batch(
+            batch, be_number, packet_seq, done);
+    if (!status.ok()) {
+        LOG(WARNING) << "failed to deserialize row batch, cancel the stream. "
+                     << "fragment_instance_id=" << _fragment_instance_id
+                     << ", node=" << _dest_node_id << ", sender=" << sender_id
+                     << ", be_number=" << be_number << ", packet_seq=" << packet_seq
+                     << ": " << status.get_error_msg();
+        cancel_stream();
+    }
+    return status;
+}
+
+void DataStreamRecvr::add_batch(RowBatch* batch, int sender_id, bool use_move,
+                                bool wait_for_space) {
+    int use_sender_id = _is_merging ? sender_id : 0;
+    _sender_queues[use_sender_id]->add_batch(batch, use_move, wait_for_space);
 }
 
 void DataStreamRecvr::remove_sender(int sender_id, int be_number) {
@@ -436,4 +576,10 @@ Status DataStreamRecvr::get_batch(RowBatch** next_batch) {
     return _sender_queues[0]->get_batch(next_batch);
 }
 
+bool DataStreamRecvr::has_batch_or_eos() {
+    DCHECK(!_is_merging);
+    DCHECK_EQ(_sender_queues.size(), 1);
+    return _sender_queues[0]->has_batch_or_eos();
+}
+
 }
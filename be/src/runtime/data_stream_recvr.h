@@ -79,6 +79,15 @@ public:
     // Refactor so both merging and non-merging exchange use get_next(RowBatch*, bool* eos).
     Status get_batch(RowBatch** next_batch);
 
+    // Returns true if get_batch() won't block: a batch is queued, all senders are done
+    // or the stream is cancelled. Must only be called if _is_merging is false.
+    bool has_batch_or_eos();
+
+    // Returns true if the buffered batches exceed the buffer limit.
+    bool is_full() {
+        return exceeds_limit(0);
+    }
+
     // Deregister from DataStreamMgr instance, which shares ownership of this instance.
     void close();
 
@@ -104,6 +113,17 @@ public:
         _sub_plan_query_statistics_recvr->insert(statistics, sender_id);
     }
 
+    // Adds the rows of 'batch' from a sender in the same process. If 'use_move' is true,
+    // the tuple data of 'batch' is taken over and 'batch' must be reset before it is
+    // reused, otherwise the rows are deep copied. Blocks while the buffer limit is
+    // exceeded, instead of withholding the rpc response as for remote senders, unless
+    // 'wait_for_space' is false.
+    void add_batch(RowBatch* batch, int sender_id, bool use_move, bool wait_for_space = true);
+
+    // Indicate that a particular sender is done. Delegated to the appropriate
+    // sender queue. Called from DataStreamMgr, or by a sender in the same process.
+    void remove_sender(int sender_id, int be_number);
+
 private:
     friend class DataStreamMgr;
     class SenderQueue;
@@ -115,14 +135,11 @@ private:
             std::shared_ptr<QueryStatisticsRecvr> sub_plan_query_statistics_recvr);
 
     // If receive queue is full, done is enqueue pending, and return with *done is nullptr
-    void add_batch(const PRowBatch& batch, int sender_id,
+    // If the batch can't be deserialized, the stream is cancelled and the error returned.
+    Status add_batch(const PRowBatch& batch, int sender_id,
                    int be_number, int64_t packet_seq,
                    ::google::protobuf::Closure** done);
 
-    // Indicate that a particular sender is done. Delegated to the appropriate
-    // sender queue. Called from DataStreamMgr.
-    void remove_sender(int sender_id, int be_number);
-
     // Empties the sender queues and notifies all waiting consumers of cancellation.
     void cancel_stream();
 
@@ -175,6 +192,10 @@ private:
     // Number of bytes received
     RuntimeProfile::Counter* _bytes_received_counter;
 
+    // Number of bytes received from senders in the same process, included in
+    // _bytes_received_counter
+    RuntimeProfile::Counter* _local_bytes_received_counter;
+
     // Time series of number of bytes received, samples _bytes_received_counter
     // RuntimeProfile::TimeSeriesCounter* _bytes_received_time_series_counter;
 
@@ -17,13 +17,18 @@
 
 #include "runtime/data_stream_sender.h"
 
+#include <deque>
 #include <iostream>
+#include <boost/algorithm/string.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread/thread.hpp>
 #include <thrift/protocol/TDebugProtocol.h>
 
+#include "common/config.h"
 #include "common/logging.h"
 #include "exprs/expr.h"
+#include "runtime/data_stream_mgr.h"
+#include "runtime/data_stream_recvr.h"
 #include "runtime/descriptors.h"
 #include "runtime/exec_env.h"
 #include "runtime/tuple_row.h"
@@ -46,6 +51,7 @@
 
 #include <arpa/inet.h>
 
+#include "service/backend_options.h"
 #include "service/brpc.h"
 
 #include "util/thrift_util.h"
@@ -58,9 +64,14 @@ namespace doris {
 // to a single destination ipaddress/node.
 // It has a fixed-capacity buffer and allows the caller either to add rows to
 // that buffer individually (AddRow()), or circumvent the buffer altogether and send
-// TRowBatches directly (SendBatch()). Either way, there can only be one in-flight RPC
-// at any one time (ie, sending will block if the most recent rpc hasn't finished,
-// which allows the receiver node to throttle the sender by withholding acks).
+// TRowBatches directly (SendBatch()). Either way, there can be at most
+// config::exchange_rpc_window_size in-flight RPCs at any one time (ie, sending will block
+// if the oldest rpc of a full window hasn't finished, which allows the receiver node to
+// throttle the sender by withholding acks). The receiver restores the order of the
+// batches by their packet_seq. brpc serializes the request before transmit_data()
+// returns, so only the closure of an rpc has to live until it finishes.
+// If the destination fragment instance runs in this process, batches are handed to
+// its DataStreamRecvr directly instead, without serialization or rpc.
 // *Not* thread-safe.
 class DataStreamSender::Channel {
 public:
@@ -89,8 +100,13 @@ public:
     }
 
     virtual ~Channel() {
-        if (_closure != nullptr && _closure->unref()) {
-            delete _closure;
+        for (auto closure : _in_flight_closures) {
+            if (closure->unref()) {
+                delete closure;
+            }
+        }
+        for (auto closure : _free_closures) {
+            delete closure;
         }
         // release this before request desctruct
         _brpc_request.release_finst_id();
@@ -105,12 +121,40 @@ public:
     // Returns error status if any of the preceding rpcs failed, OK otherwise.
     Status add_row(TupleRow* row);
 
+    // Copies the rows of 'batch' at 'row_idxs' like add_row().
+    Status add_rows(RowBatch* batch, const std::vector<int>& row_idxs);
+
     // Asynchronously sends a row batch.
     // Returns the status of the most recently finished transmit_data
     // rpc (or OK if there wasn't one that hasn't been reported yet).
     // if batch is nullptr, send the eof packet
     Status send_batch(PRowBatch* batch, bool eos = false);
 
+    // Hands a row batch to the receiver in this process. If 'use_move' is true, the
+    // tuple data of 'batch' is moved to the receiver and 'batch' must be reset,
+    // otherwise the rows are deep copied. Only valid if is_local() is true.
+    Status send_local_batch(RowBatch* batch, bool use_move);
+
+    // Returns true if a batch can be sent without waiting: the local receiver isn't
+    // full, or an rpc slot is free.
+    bool is_ready() {
+        if (is_local()) {
+            return !_local_recvr->is_full();
+        }
+        size_t window_size = std::max(1, config::exchange_rpc_window_size);
+        return _num_unfinished_brpcs() < window_size;
+    }
+
+    // Returns true if no rpc is in flight, so that close() only waits for its own.
+    bool is_idle() {
+        return is_local() || _num_unfinished_brpcs() == 0;
+    }
+
+    // Returns true if the destination runs in this process and its receiver is
+    // registered. The receiver is looked up on the first call; if it isn't registered
+    // by then, the channel keeps using rpc.
+    bool is_local();
+
     // Flush buffered rows and close channel. This function don't wait the response
     // of close operation, client should call close_wait() to finish channel's close.
     // We split one close operation into two phases in order to make multiple channels
@@ -129,15 +173,57 @@ public:
     }
 
 private:
-    inline Status _wait_last_brpc() {
-        auto cntl = &_closure->cntl;
+    // Wait for the oldest in-flight rpc and recycle its closure.
+    inline Status _wait_first_brpc() {
+        DCHECK(!_in_flight_closures.empty());
+        auto closure = _in_flight_closures.front();
+        _in_flight_closures.pop_front();
+        auto cntl = &closure->cntl;
         brpc::Join(cntl->call_id());
+        Status status = Status::OK();
         if (cntl->Failed()) {
             LOG(WARNING) << "failed to send brpc batch, error=" << berror(cntl->ErrorCode())
                 << ", error_text=" << cntl->ErrorText();
-            return Status::ThriftRpcError("failed to send batch");
+            status = Status::ThriftRpcError("failed to send batch");
         }
-        return Status::OK();
+        cntl->Reset();
+        _free_closures.push_back(closure);
+        return status;
+    }
+
+    // Recycle the closures of the finished rpcs at the front of the window, without
+    // waiting for the others.
+    inline Status _reap_finished_brpcs() {
+        Status status = Status::OK();
+        while (!_in_flight_closures.empty() && _in_flight_closures.front()->refs() == 1) {
+            Status st = _wait_first_brpc();
+            if (status.ok()) {
+                status = st;
+            }
+        }
+        return status;
+    }
+
+    // The closure of a finished rpc is held by this channel only.
+    size_t _num_unfinished_brpcs() const {
+        size_t num_unfinished = 0;
+        for (auto closure : _in_flight_closures) {
+            if (closure->refs() > 1) {
+                ++num_unfinished;
+            }
+        }
+        return num_unfinished;
+    }
+
+    inline Status _wait_all_brpc() {
+        Status status = Status::OK();
+        while (!_in_flight_closures.empty()) {
+            Status st = _wait_first_brpc();
+            if (status.ok()) {
+                status = st;
+            }
+        }
+        return status;
     }
 
 
@@ -147,6 +233,8 @@ private:
     Status send_current_batch(bool eos = false);
     Status close_internal();
 
+    void add_local_query_statistics();
+
     DataStreamSender* _parent;
     int _buffer_size;
 
@@ -171,11 +259,19 @@ private:
     PRowBatch _pb_batch;
     PTransmitDataParams _brpc_request;
     palo::PInternalService_Stub* _brpc_stub = nullptr;
-    RefCountClosure<PTransmitDataResult>* _closure = nullptr;
+    // closures of the in-flight rpcs, oldest first; each holds one ref for this
+    // channel and one for the rpc
+    std::deque<RefCountClosure<PTransmitDataResult>*> _in_flight_closures;
+    // closures of finished rpcs, held by this channel only
+    std::vector<RefCountClosure<PTransmitDataResult>*> _free_closures;
     int32_t _brpc_timeout_ms = 500;
     // whether the dest can be treated as query statistics transfer chain.
     bool _is_transfer_chain;
     bool _send_query_statistics_with_every_batch;
+
+    // true if the destination may be in this process, see is_local()
+    bool _is_local = false;
+    boost::shared_ptr<DataStreamRecvr> _local_recvr;
 };
 
 Status DataStreamSender::Channel::init(RuntimeState* state) {
@@ -202,17 +298,34 @@ Status DataStreamSender::Channel::init(RuntimeState* state) {
     _brpc_timeout_ms = std::min(3600, state->query_options().query_timeout) * 1000;
     _brpc_stub = state->exec_env()->brpc_stub_cache()->get_stub(_brpc_dest_addr);
 
+    _is_local = config::enable_local_exchange
+        && _brpc_dest_addr.hostname == BackendOptions::get_localhost()
+        && _brpc_dest_addr.port == config::brpc_port;
+
     _need_close = true;
     return Status::OK();
 }
 
 Status DataStreamSender::Channel::send_batch(PRowBatch* batch, bool eos) {
-    if (_closure == nullptr) {
-        _closure = new RefCountClosure<PTransmitDataResult>();
-        _closure->ref();
+    // The receiver removes the sender on eos, so eos must not overtake any batch.
+    if (_parent->_is_pipeline_sink && !eos) {
+        // A pipeline sink checked is_ready() before, but one send() may flush several
+        // batches to this channel; overshoot the window rather than block a pipeline
+        // worker. The driver waits for is_idle() before close(), so eos doesn't wait.
+        RETURN_IF_ERROR(_reap_finished_brpcs());
     } else {
-        RETURN_IF_ERROR(_wait_last_brpc());
-        _closure->cntl.Reset();
+        size_t window_size = eos ? 1 : std::max(1, config::exchange_rpc_window_size);
+        while (_in_flight_closures.size() >= window_size) {
+            RETURN_IF_ERROR(_wait_first_brpc());
+        }
+    }
+    RefCountClosure<PTransmitDataResult>* closure = nullptr;
+    if (_free_closures.empty()) {
+        closure = new RefCountClosure<PTransmitDataResult>();
+        closure->ref();
+    } else {
+        closure = _free_closures.back();
+        _free_closures.pop_back();
     }
     VLOG_ROW << "Channel::send_batch() instance_id=" << _fragment_instance_id
              << " dest_node=" << _dest_node_id;
@@ -227,15 +340,51 @@ Status DataStreamSender::Channel::send_batch(PRowBatch* batch, bool eos) {
     }
     _brpc_request.set_packet_seq(_packet_seq++);
 
-    _closure->ref();
-    _closure->cntl.set_timeout_ms(_brpc_timeout_ms);
-    _brpc_stub->transmit_data(&_closure->cntl, &_brpc_request, &_closure->result, _closure);
+    closure->ref();
+    closure->cntl.set_timeout_ms(_brpc_timeout_ms);
+    _in_flight_closures.push_back(closure);
+    _brpc_stub->transmit_data(&closure->cntl, &_brpc_request, &closure->result, closure);
     if (batch != nullptr) {
         _brpc_request.release_row_batch();
     }
     return Status::OK();
 }
 
+bool DataStreamSender::Channel::is_local() {
+    if (_is_local && _local_recvr == nullptr) {
+        _local_recvr = _parent->_state->exec_env()->stream_mgr()->find_recvr(
+            _fragment_instance_id, _dest_node_id);
+        if (_local_recvr == nullptr) {
+            // Don't switch later, the batches of a sender must arrive in order
+            _is_local = false;
+        }
+    }
+    return _is_local;
+}
+
+void DataStreamSender::Channel::add_local_query_statistics() {
+    PQueryStatistics statistics;
+    _parent->_query_statistics->to_pb(&statistics);
+    _local_recvr->add_sub_plan_statistics(statistics, _parent->_sender_id);
+}
+
+Status DataStreamSender::Channel::send_local_batch(RowBatch* batch, bool use_move) {
+    DCHECK(_local_recvr != nullptr);
+    VLOG_ROW << "Channel::send_local_batch() instance_id=" << _fragment_instance_id
+             << " dest_node=" << _dest_node_id;
+    if (_is_transfer_chain && _send_query_statistics_with_every_batch) {
+        add_local_query_statistics();
+    }
+    if (batch->num_rows() > 0) {
+        COUNTER_UPDATE(_parent->_local_bytes_sent_counter, batch->total_byte_size());
+        // a pipeline sink checked is_ready() before, so it may overshoot the buffer
+        // limit by the batches of one send() rather than block a pipeline worker
+        _local_recvr->add_batch(batch, _parent->_sender_id, use_move,
+                                !_parent->_is_pipeline_sink);
+    }
+    return Status::OK();
+}
+
 Status DataStreamSender::Channel::add_row(TupleRow* row) {
     int row_num = _batch->add_row();
 
@@ -264,13 +413,20 @@ Status DataStreamSender::Channel::add_row(TupleRow* row) {
     return Status::OK();
 }
 
+Status DataStreamSender::Channel::add_rows(RowBatch* batch, const std::vector<int>& row_idxs) {
+    for (int idx : row_idxs) {
+        RETURN_IF_ERROR(add_row(batch->get_row(idx)));
+    }
+    return Status::OK();
+}
+
 Status DataStreamSender::Channel::send_current_batch(bool eos) {
-    {
-        SCOPED_TIMER(_parent->_serialize_batch_timer);
-        int uncompressed_bytes = _batch->serialize(&_pb_batch);
-        COUNTER_UPDATE(_parent->_bytes_sent_counter, RowBatch::get_batch_size(_pb_batch));
-        COUNTER_UPDATE(_parent->_uncompressed_bytes_counter, uncompressed_bytes);
+    if (is_local()) {
+        RETURN_IF_ERROR(send_local_batch(_batch.get(), true));
+        _batch->reset();
+        return Status::OK();
     }
+    RETURN_IF_ERROR(_parent->serialize_batch(_batch.get(), &_pb_batch));
     _batch->reset();
     RETURN_IF_ERROR(send_batch(&_pb_batch, eos));
     return Status::OK();
@@ -283,6 +439,18 @@ Status DataStreamSender::Channel::close_internal() {
     VLOG_RPC << "Channel::close() instance_id=" << _fragment_instance_id
              << " dest_node=" << _dest_node_id
              << " #rows= " << ((_batch == nullptr) ? 0 : _batch->num_rows());
+    if (is_local()) {
+        if (_batch != NULL && _batch->num_rows() > 0) {
+            RETURN_IF_ERROR(send_local_batch(_batch.get(), true));
+        }
+        if (_is_transfer_chain) {
+            add_local_query_statistics();
+        }
+        _local_recvr->remove_sender(_parent->_sender_id, _be_number);
+        // nothing to wait for in close_wait()
+        _need_close = false;
+        return Status::OK();
+    }
     if (_batch != NULL && _batch->num_rows() > 0) {
         RETURN_IF_ERROR(send_current_batch(true));
     } else {
@@ -298,7 +466,7 @@ void DataStreamSender::Channel::close(RuntimeState* state) {
 
 void DataStreamSender::Channel::close_wait(RuntimeState* state) {
     if (_need_close) {
-        state->log_error(_wait_last_brpc().get_error_msg());
+        state->log_error(_wait_all_brpc().get_error_msg());
         _need_close = false;
     }
     _batch.reset();
@@ -317,10 +485,12 @@ DataStreamSender::DataStreamSender(
         _part_type(sink.output_partition.type),
         _ignore_not_found(sink.__isset.ignore_not_found ? sink.ignore_not_found : true),
         _current_pb_batch(&_pb_batch1),
+        _compression_type(segment_v2::CompressionTypePB::SNAPPY),
         _profile(NULL),
         _serialize_batch_timer(NULL),
         _thrift_transmit_timer(NULL),
         _bytes_sent_counter(NULL),
+        _local_bytes_sent_counter(NULL),
         _dest_node_id(sink.dest_node_id) {
     DCHECK_GT(destinations.size(), 0);
     DCHECK(sink.output_partition.type == TPartitionType::UNPARTITIONED
@@ -341,6 +511,25 @@ DataStreamSender::DataStreamSender(
     }
 }
 
+const int DataStreamSender::MAX_COMPRESSION_BACKOFF;
+
+static bool get_exchange_compression_type(const std::string& codec,
+                                          segment_v2::CompressionTypePB* type) {
+    std::string lower_codec = boost::algorithm::to_lower_copy(codec);
+    if (lower_codec == "none") {
+        *type = segment_v2::CompressionTypePB::NO_COMPRESSION;
+    } else if (lower_codec == "snappy") {
+        *type = segment_v2::CompressionTypePB::SNAPPY;
+    } else if (lower_codec == "lz4") {
+        *type = segment_v2::CompressionTypePB::LZ4;
+    } else if (lower_codec == "zstd") {
+        *type = segment_v2::CompressionTypePB::ZSTD;
+    } else {
+        return false;
+    }
+    return true;
+}
+
 // We use the ParttitionRange to compare here. It should not be a member function of PartitionInfo
 // class becaurce there are some other member in it.
 static bool compare_part_use_range(const PartitionInfo* v1, const PartitionInfo* v2) {
@@ -386,6 +575,12 @@ Status DataStreamSender::prepare(RuntimeState* state) {
     SCOPED_TIMER(_profile->total_time_counter());
     _mem_tracker.reset(
             new MemTracker(-1, "DataStreamSender", state->instance_mem_tracker()));
+    if (!get_exchange_compression_type(state->exchange_compression_codec(),
+                                       &_compression_type)) {
+        LOG(WARNING) << "unknown exchange compression codec "
+                     << state->exchange_compression_codec() << ", use snappy instead";
+        _compression_type = segment_v2::CompressionTypePB::SNAPPY;
+    }
 
     if (_part_type == TPartitionType::UNPARTITIONED 
             || _part_type == TPartitionType::RANDOM) {
@@ -405,8 +600,12 @@ Status DataStreamSender::prepare(RuntimeState* state) {
 
     _bytes_sent_counter =
         ADD_COUNTER(profile(), "BytesSent", TUnit::BYTES);
+    _local_bytes_sent_counter =
+        ADD_COUNTER(profile(), "LocalBytesSent", TUnit::BYTES);
     _uncompressed_bytes_counter =
         ADD_COUNTER(profile(), "UncompressedRowBatchSize", TUnit::BYTES);
+    _compression_skipped_counter =
+        ADD_COUNTER(profile(), "CompressionSkippedBatches", TUnit::UNIT);
     _ignore_rows =
         ADD_COUNTER(profile(), "IgnoreRows", TUnit::UNIT);
     _serialize_batch_timer =
@@ -447,36 +646,65 @@ Status DataStreamSender::send(RuntimeState* state, RowBatch* batch) {
 
     // Unpartition or _channel size
     if (_part_type == TPartitionType::UNPARTITIONED || _channels.size() == 1) {
-        RETURN_IF_ERROR(serialize_batch(batch, _current_pb_batch, _channels.size()));
+        // 'batch' is not ours, local receivers get a copy
+        int num_remote_channels = 0;
         for (auto channel : _channels) {
-            RETURN_IF_ERROR(channel->send_batch(_current_pb_batch));
+            if (channel->is_local()) {
+                RETURN_IF_ERROR(channel->send_local_batch(batch, false));
+            } else {
+                ++num_remote_channels;
+            }
+        }
+        if (num_remote_channels > 0) {
+            RETURN_IF_ERROR(serialize_batch(batch, _current_pb_batch, num_remote_channels));
+            for (auto channel : _channels) {
+                if (!channel->is_local()) {
+                    RETURN_IF_ERROR(channel->send_batch(_current_pb_batch));
+                }
+            }
+            _current_pb_batch = (_current_pb_batch == &_pb_batch1 ? &_pb_batch2 : &_pb_batch1);
         }
-        _current_pb_batch = (_current_pb_batch == &_pb_batch1 ? &_pb_batch2 : &_pb_batch1);
     } else if (_part_type == TPartitionType::RANDOM) {
         // Round-robin batches among channels. Wait for the current channel to finish its
         // rpc before overwriting its batch.
         Channel* current_channel = _channels[_current_channel_idx];
-        RETURN_IF_ERROR(serialize_batch(batch, current_channel->pb_batch()));
-        RETURN_IF_ERROR(current_channel->send_batch(current_channel->pb_batch()));
+        if (current_channel->is_local()) {
+            RETURN_IF_ERROR(current_channel->send_local_batch(batch, false));
+        } else {
+            RETURN_IF_ERROR(serialize_batch(batch, current_channel->pb_batch()));
+            RETURN_IF_ERROR(current_channel->send_batch(current_channel->pb_batch()));
+        }
         _current_channel_idx = (_current_channel_idx + 1) % _channels.size();
     } else if (_part_type == TPartitionType::HASH_PARTITIONED) {
-        // hash-partition batch's rows across channels
+        // hash-partition batch's rows across channels: hash all rows one partition
+        // expr at a time, then scatter the rows channel by channel
         int num_channels = _channels.size();
-
-        for (int i = 0; i < batch->num_rows(); ++i) {
-            TupleRow* row = batch->get_row(i);
-            size_t hash_val = 0;
-
-            for (auto ctx : _partition_expr_ctxs) {
-                void* partition_val = ctx->get_value(row);
+        int num_rows = batch->num_rows();
+        _partition_hash_vals.assign(num_rows, 0);
+        for (auto ctx : _partition_expr_ctxs) {
+            const PrimitiveType type = ctx->root()->type().type;
+            for (int i = 0; i < num_rows; ++i) {
+                void* partition_val = ctx->get_value(batch->get_row(i));
                 // We can't use the crc hash function here because it does not result
                 // in uncorrelated hashes with different seeds.  Instead we must use
                 // fvn hash.
                 // TODO: fix crc hash/GetHashValue()
-                hash_val = RawValue::get_hash_value_fvn(
-                    partition_val, ctx->root()->type(), hash_val);
+                _partition_hash_vals[i] = RawValue::get_hash_value_fvn(
+                    partition_val, type, _partition_hash_vals[i]);
+            }
+        }
+
+        _channel_row_idxs.resize(num_channels);
+        for (auto& row_idxs : _channel_row_idxs) {
+            row_idxs.clear();
+        }
+        for (int i = 0; i < num_rows; ++i) {
+            _channel_row_idxs[_partition_hash_vals[i] % num_channels].push_back(i);
+        }
+        for (int i = 0; i < num_channels; ++i) {
+            if (!_channel_row_idxs[i].empty()) {
+                RETURN_IF_ERROR(_channels[i]->add_rows(batch, _channel_row_idxs[i]));
             }
-            RETURN_IF_ERROR(_channels[hash_val % num_channels]->add_row(row));
         }
     } else {
         // Range partition
@@ -618,19 +846,33 @@ Status DataStreamSender::close(RuntimeState* state, Status exec_status) {
     return Status::OK();
 }
 
-template<typename T>
-Status DataStreamSender::serialize_batch(RowBatch* src, T* dest, int num_receivers) {
+Status DataStreamSender::serialize_batch(RowBatch* src, PRowBatch* dest, int num_receivers) {
     VLOG_ROW << "serializing " << src->num_rows() << " rows";
     {
         // TODO(zc)
         // SCOPED_TIMER(_profile->total_time_counter());
         SCOPED_TIMER(_serialize_batch_timer);
-        // TODO(zc)
-        // RETURN_IF_ERROR(src->serialize(dest));
-        int uncompressed_bytes = src->serialize(dest);
+        segment_v2::CompressionTypePB compression_type = _compression_type;
+        if (_num_batches_to_skip_compression > 0) {
+            --_num_batches_to_skip_compression;
+            compression_type = segment_v2::CompressionTypePB::NO_COMPRESSION;
+            COUNTER_UPDATE(_compression_skipped_counter, 1);
+        }
+        int uncompressed_bytes = src->serialize(dest, compression_type);
         int bytes = RowBatch::get_batch_size(*dest);
-        // TODO(zc)
-        // int uncompressed_bytes = bytes - dest->tuple_data.size() + dest->uncompressed_size;
+        if (compression_type != segment_v2::CompressionTypePB::NO_COMPRESSION
+                && dest->tuple_data().size() > 0) {
+            int64_t tuple_data_size = dest->tuple_data().size();
+            int64_t raw_tuple_data_size = uncompressed_bytes - bytes + tuple_data_size;
+            if (tuple_data_size * 100
+                    > raw_tuple_data_size * config::exchange_incompressible_ratio_percent) {
+                _compression_backoff = std::min(std::max(_compression_backoff * 2, 1),
+                                                MAX_COMPRESSION_BACKOFF);
+                _num_batches_to_skip_compression = _compression_backoff;
+            } else {
+                _compression_backoff = 0;
+            }
+        }
         // The size output_batch would be if we didn't compress tuple_data (will be equal to
         // actual batch size if tuple_data isn't compressed)
         COUNTER_UPDATE(_bytes_sent_counter, bytes * num_receivers);
@@ -640,6 +882,24 @@ Status DataStreamSender::serialize_batch(RowBatch* src, T* dest, int num_receive
     return Status::OK();
 }
 
+bool DataStreamSender::is_ready() {
+    for (auto channel : _channels) {
+        if (!channel->is_ready()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DataStreamSender::is_idle() {
+    for (auto channel : _channels) {
+        if (!channel->is_idle()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 int64_t DataStreamSender::get_num_data_bytes_sent() const {
     // TODO: do we need synchronization here or are reads & writes to 8-byte ints
     // atomic?
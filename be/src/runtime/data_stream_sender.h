@@ -27,6 +27,7 @@
 #include "common/status.h"
 #include "util/runtime_profile.h"
 #include "gen_cpp/data.pb.h"  // for PRowBatch
+#include "gen_cpp/segment_v2.pb.h"
 
 namespace doris {
 
@@ -86,8 +87,18 @@ public:
     /// Serializes the src batch into the dest thrift batch. Maintains metrics.
     /// num_receivers is the number of receivers this batch will be sent to. Only
     /// used to maintain metrics.
-    template<class T>
-    Status serialize_batch(RowBatch* src, T* dest, int num_receivers = 1);
+    /// Tuple data is compressed by the codec of the query option
+    /// exchange_compression_codec, unless recent batches didn't compress well.
+    Status serialize_batch(RowBatch* src, PRowBatch* dest, int num_receivers = 1);
+
+    bool can_be_pipeline_sink() const override {
+        return true;
+    }
+    // True if every channel can take a batch without waiting for an rpc or for its
+    // local receiver.
+    bool is_ready() override;
+    // True if no channel has an rpc in flight.
+    bool is_idle() override;
 
     // Return total number of bytes sent in TRowBatch.data. If batches are
     // broadcast to multiple receivers, they are counted once per receiver.
@@ -136,8 +147,23 @@ private:
     PRowBatch _pb_batch2;
     PRowBatch* _current_pb_batch = nullptr;
 
+    // codec of the serialized batches
+    segment_v2::CompressionTypePB _compression_type;
+    // Batches whose tuple data doesn't shrink are likely followed by more of them,
+    // e.g. of already encoded strings, so compression is skipped for the next
+    // _num_batches_to_skip_compression batches. The skip length doubles on every
+    // poorly compressed batch up to MAX_COMPRESSION_BACKOFF and is reset by a good one.
+    static const int MAX_COMPRESSION_BACKOFF = 64;
+    int _compression_backoff = 0;
+    int _num_batches_to_skip_compression = 0;
+
     std::vector<ExprContext*> _partition_expr_ctxs;  // compute per-row partition values
 
+    // hash partitioning: the hash of every row of the current batch, and the rows
+    // going to each channel
+    std::vector<uint32_t> _partition_hash_vals;
+    std::vector<std::vector<int>> _channel_row_idxs;
+
     std::vector<Channel*> _channels;
     std::vector<std::shared_ptr<Channel>> _channel_shared_ptrs;
 
@@ -148,8 +174,12 @@ private:
     RuntimeProfile* _profile; // Allocated from _pool
     RuntimeProfile::Counter* _serialize_batch_timer;
     RuntimeProfile::Counter* _thrift_transmit_timer;
+    // bytes sent via rpc
     RuntimeProfile::Counter* _bytes_sent_counter;
+    // bytes handed to receivers in this process
+    RuntimeProfile::Counter* _local_bytes_sent_counter;
     RuntimeProfile::Counter* _uncompressed_bytes_counter;
+    RuntimeProfile::Counter* _compression_skipped_counter;
     RuntimeProfile::Counter* _ignore_rows;
 
     std::unique_ptr<MemTracker> _mem_tracker;
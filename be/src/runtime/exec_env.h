@@ -40,7 +40,8 @@ class MemTracker;
 class MetricRegistry;
 class StorageEngine;
 class PoolMemTrackerRegistry;
-class PriorityThreadPool;
+class ResourceGroupMgr;
+class ScannerScheduler;
 class ReservationTracker;
 class ResultBufferMgr;
 class ResultQueueMgr;
@@ -104,8 +105,10 @@ public:
     MemTracker* process_mem_tracker() { return _mem_tracker; }
     PoolMemTrackerRegistry* pool_mem_trackers() { return _pool_mem_trackers; }
     ThreadResourceMgr* thread_mgr() { return _thread_mgr; }
-    PriorityThreadPool* thread_pool() { return _thread_pool; }
+    ScannerScheduler* scanner_scheduler() { return _scanner_scheduler; }
+    ResourceGroupMgr* resource_group_mgr() { return _resource_group_mgr; }
     ThreadPool* etl_thread_pool() { return _etl_thread_pool; }
+    ThreadPool* sort_thread_pool() { return _sort_thread_pool; }
     CgroupsMgr* cgroups_mgr() { return _cgroups_mgr; }
     FragmentMgr* fragment_mgr() { return _fragment_mgr; }
     TMasterInfo* master_info() { return _master_info; }
@@ -154,8 +157,10 @@ private:
     MemTracker* _mem_tracker = nullptr;
     PoolMemTrackerRegistry* _pool_mem_trackers = nullptr;
     ThreadResourceMgr* _thread_mgr = nullptr;
-    PriorityThreadPool* _thread_pool = nullptr;
+    ScannerScheduler* _scanner_scheduler = nullptr;
+    ResourceGroupMgr* _resource_group_mgr = nullptr;
     ThreadPool* _etl_thread_pool = nullptr;
+    ThreadPool* _sort_thread_pool = nullptr;
     CgroupsMgr* _cgroups_mgr = nullptr;
     FragmentMgr* _fragment_mgr = nullptr;
     TMasterInfo* _master_info = nullptr;
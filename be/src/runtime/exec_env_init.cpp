@@ -28,7 +28,9 @@
 #include "runtime/disk_io_mgr.h"
 #include "runtime/external_scan_context_mgr.h"
 #include "runtime/result_buffer_mgr.h"
+#include "runtime/resource_group.h"
 #include "runtime/result_queue_mgr.h"
+#include "runtime/scanner_scheduler.h"
 #include "runtime/mem_tracker.h"
 #include "runtime/thread_resource_mgr.h"
 #include "runtime/fragment_mgr.h"
@@ -53,7 +55,6 @@
 #include "util/pretty_printer.h"
 #include "util/doris_metrics.h"
 #include "util/brpc_stub_cache.h"
-#include "util/priority_thread_pool.hpp"
 #include "agent/cgroups_mgr.h"
 #include "util/thread_pool.hpp"
 #include "gen_cpp/BackendService.h"
@@ -82,12 +83,15 @@ Status ExecEnv::_init(const std::vector<StorePath>& store_paths) {
     _mem_tracker = nullptr;
     _pool_mem_trackers = new PoolMemTrackerRegistry();
     _thread_mgr = new ThreadResourceMgr();
-    _thread_pool = new PriorityThreadPool(
+    _scanner_scheduler = new ScannerScheduler(
         config::doris_scanner_thread_pool_thread_num,
         config::doris_scanner_thread_pool_queue_size);
     _etl_thread_pool = new ThreadPool(
         config::etl_thread_pool_size,
         config::etl_thread_pool_queue_size);
+    _sort_thread_pool = new ThreadPool(
+        config::sort_thread_pool_size,
+        config::sort_thread_pool_queue_size);
     _cgroups_mgr = new CgroupsMgr(this, config::doris_cgroups);
     _fragment_mgr = new FragmentMgr(this);
     _master_info = new TMasterInfo();
@@ -120,6 +124,8 @@ Status ExecEnv::_init(const std::vector<StorePath>& store_paths) {
     _small_file_mgr->init();
     _init_mem_tracker();
 
+    _resource_group_mgr = new ResourceGroupMgr();
+    RETURN_IF_ERROR(_resource_group_mgr->init(config::resource_groups, _mem_tracker));
     RETURN_IF_ERROR(_load_channel_mgr->init(_mem_tracker->limit()));
 
     return Status::OK();
@@ -214,10 +220,12 @@ void ExecEnv::_destory() {
     delete _master_info;
     delete _fragment_mgr;
     delete _cgroups_mgr;
+    delete _sort_thread_pool;
     delete _etl_thread_pool;
-    delete _thread_pool;
+    delete _scanner_scheduler;
     delete _thread_mgr;
     delete _pool_mem_trackers;
+    delete _resource_group_mgr;
     delete _mem_tracker;
     delete _broker_client_cache;
     delete _extdatasource_client_cache;
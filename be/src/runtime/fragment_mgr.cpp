@@ -27,6 +27,8 @@
 #include "common/object_pool.h"
 #include "common/resource_tls.h"
 #include "service/backend_options.h"
+#include "runtime/pipeline_driver.h"
+#include "runtime/pipeline_task_scheduler.h"
 #include "runtime/plan_fragment_executor.h"
 #include "runtime/exec_env.h"
 #include "runtime/datetime_value.h"
@@ -85,6 +87,9 @@ public:
 
     Status execute();
 
+    // Closes the executor after its PipelineDriver finished, which took 'duration_ns'.
+    void close_pipeline(int64_t duration_ns);
+
     Status cancel(const PPlanFragmentCancelReason& reason);
 
     TUniqueId fragment_instance_id() const {
@@ -214,6 +219,15 @@ Status FragmentExecState::execute() {
     return Status::OK();
 }
 
+void FragmentExecState::close_pipeline(int64_t duration_ns) {
+    {
+        SCOPED_RAW_TIMER(&duration_ns);
+        _executor.close();
+    }
+    DorisMetrics::fragment_requests_total.increment(1);
+    DorisMetrics::fragment_request_duration_us.increment(duration_ns / 1000);
+}
+
 Status FragmentExecState::cancel(const PPlanFragmentCancelReason& reason) {
     std::lock_guard<std::mutex> l(_status_lock);
     RETURN_IF_ERROR(_exec_status);
@@ -362,7 +376,9 @@ FragmentMgr::FragmentMgr(ExecEnv* exec_env) :
         _cancel_thread(std::bind<void>(&FragmentMgr::cancel_worker, this)),
         // TODO(zc): we need a better thread-pool
         // now one user can use all the thread pool, others have no resource.
-        _thread_pool(config::fragment_pool_thread_num, config::fragment_pool_queue_size) {
+        _thread_pool(config::fragment_pool_thread_num, config::fragment_pool_queue_size),
+        _pipeline_scheduler(new PipelineTaskScheduler(
+                config::pipeline_executor_threads, config::pipeline_time_slice_ms)) {
 }
 
 FragmentMgr::~FragmentMgr() {
@@ -371,6 +387,7 @@ FragmentMgr::~FragmentMgr() {
     _cancel_thread.join();
     // Stop all the worker
     _thread_pool.drain_and_shutdown();
+    _pipeline_scheduler.reset();
 
     // Only me can delete
     {
@@ -386,7 +403,20 @@ void FragmentMgr::exec_actual(
         std::shared_ptr<FragmentExecState> exec_state,
         FinishCallback cb) {
     exec_state->execute();
+    remove_and_callback(exec_state, cb);
+}
 
+void FragmentMgr::finish_pipeline(
+        std::shared_ptr<FragmentExecState> exec_state,
+        FinishCallback cb,
+        PipelineDriver* driver) {
+    exec_state->close_pipeline(driver->elapsed_time_ns());
+    remove_and_callback(exec_state, cb);
+}
+
+void FragmentMgr::remove_and_callback(
+        std::shared_ptr<FragmentExecState> exec_state,
+        FinishCallback cb) {
     {
         std::lock_guard<std::mutex> lock(_lock);
         auto iter = _fragment_map.find(exec_state->fragment_instance_id());
@@ -452,6 +482,25 @@ Status FragmentMgr::exec_plan_fragment(
         }
     }
 
+    // Run on the workers of the pipeline engine if the plan allows it, the driver
+    // doesn't need a thread of its own
+    std::unique_ptr<PipelineDriver> driver;
+    if (exec_state->executor()->runtime_state()->enable_pipeline_engine()) {
+        Status status = PipelineDriver::create(exec_state->executor(), &driver);
+        if (!status.ok()) {
+            VLOG(1) << "fragment " << print_id(fragment_instance_id)
+                    << " isn't run on the pipeline engine: " << status.get_error_msg();
+            driver.reset();
+        }
+    }
+    if (driver != nullptr) {
+        exec_state->executor()->start_pipeline();
+        driver->set_finish_callback(std::bind<void>(&FragmentMgr::finish_pipeline,
+                this, exec_state, cb, std::placeholders::_1));
+        _pipeline_scheduler->submit(std::move(driver));
+        return Status::OK();
+    }
+
     if (use_pool) {
         if (!_thread_pool.offer(
                 boost::bind<void>(&FragmentMgr::exec_actual, this, exec_state, cb))) {
@@ -39,6 +39,8 @@ class ExecEnv;
 class FragmentExecState;
 class TExecPlanFragmentParams;
 class TUniqueId;
+class PipelineDriver;
+class PipelineTaskScheduler;
 class PlanFragmentExecutor;
 
 std::string to_load_error_http_path(const std::string& file_name);
@@ -78,6 +80,14 @@ private:
     void exec_actual(std::shared_ptr<FragmentExecState> exec_state,
                      FinishCallback cb);
 
+    // finish callback of the PipelineDriver of 'exec_state'
+    void finish_pipeline(std::shared_ptr<FragmentExecState> exec_state,
+                         FinishCallback cb,
+                         PipelineDriver* driver);
+
+    void remove_and_callback(std::shared_ptr<FragmentExecState> exec_state,
+                             FinishCallback cb);
+
     // This is input params
     ExecEnv* _exec_env;
 
@@ -91,6 +101,8 @@ private:
     std::thread _cancel_thread;
     // every job is a pool
     ThreadPool _thread_pool;
+    // runs the fragments with pipeline execution enabled
+    std::unique_ptr<PipelineTaskScheduler> _pipeline_scheduler;
 
 };
 
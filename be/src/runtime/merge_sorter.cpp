@@ -16,11 +16,16 @@
 // under the License.
 
 #include "runtime/merge_sorter.h"
+#include "common/config.h"
 #include "runtime/buffered_block_mgr.h"
 #include "runtime/row_batch.h"
 #include "runtime/runtime_state.h"
+#include "runtime/sorted_run_merger.h"
 #include "util/runtime_profile.h"
+#include "util/sort_key_normalizer.h"
+#include <memory>
 #include <string>
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include "runtime/mem_tracker.h"
 
@@ -130,11 +135,15 @@ private:
 
     // Offset into the current fixed length data block being processed.
     int _fixed_len_block_offset;
+
+    // Batch returned by get_next_batch(), created by prepare_read().
+    boost::scoped_ptr<RowBatch> _buffered_batch;
 }; // class MergeSorter::Run
 
 // Sorts a sequence of tuples from a run in place using a provided tuple comparator.
-// Quick sort is used for sequences of tuples larger that 16 elements, and
-// insertion sort is used for smaller sequences.
+// If the first sort expr can be normalized into a memcomparable prefix, the tuples
+// are sorted by SortKeyNormalizer. Otherwise quick sort is used for sequences of
+// tuples larger that 16 elements, and insertion sort is used for smaller sequences.
 // The TupleSorter is initialized with a RuntimeState instance to check for
 // cancellation during an in-memory sort.
 class MergeSorter::TupleSorter {
@@ -154,7 +163,16 @@ public:
 
     void sort(Run* run) {
         _run = run;
-        sort_helper(TupleIterator(this, 0), TupleIterator(this, _run->_num_tuples));
+        if (_normalizer.is_supported() && _run->_num_tuples > INSERTION_THRESHOLD) {
+            std::vector<uint8_t*> blocks;
+            for (auto block : _run->_fixed_len_blocks) {
+                blocks.push_back(block->buffer());
+            }
+            _normalizer.sort_tuples(blocks, _block_capacity, _tuple_size,
+                                    _run->_num_tuples, _state);
+        } else {
+            sort_helper(TupleIterator(this, 0), TupleIterator(this, _run->_num_tuples));
+        }
         run->_is_sorted = true;
     }
 
@@ -249,6 +267,9 @@ private:
     // Tuple comparator that returns true if lhs < rhs.
     const TupleRowComparator _less_than_comp;
 
+    // Normalized key sorter built from _less_than_comp.
+    const SortKeyNormalizer _normalizer;
+
     // Runtime state instance to check for cancellation. Not owned.
     RuntimeState* const _state;
 
@@ -280,6 +301,45 @@ private:
     void swap(uint8_t* left, uint8_t* right);
 }; // class TupleSorter
 
+// The state a worker thread needs to sort and merge runs: ExprContext is not
+// thread safe, so every worker compares tuples with its own clones of the ordering
+// exprs.
+class MergeSorter::SortWorker {
+public:
+    SortWorker(RuntimeState* state) : _state(state) {}
+
+    ~SortWorker() {
+        Expr::close(_lhs_expr_ctxs, _state);
+        Expr::close(_rhs_expr_ctxs, _state);
+    }
+
+    Status init(const TupleRowComparator& less_than, int64_t block_size, int tuple_size) {
+        RETURN_IF_ERROR(Expr::clone_if_not_exists(
+                less_than.key_expr_ctxs(), _state, &_lhs_expr_ctxs));
+        RETURN_IF_ERROR(Expr::clone_if_not_exists(
+                less_than.key_expr_ctxs(), _state, &_rhs_expr_ctxs));
+        std::vector<bool> nulls_first;
+        for (int8_t n : less_than.nulls_first()) {
+            nulls_first.push_back(n < 0);
+        }
+        _less_than.reset(new TupleRowComparator(
+                _lhs_expr_ctxs, _rhs_expr_ctxs, less_than.is_asc(), nulls_first));
+        _tuple_sorter.reset(new TupleSorter(*_less_than, block_size, tuple_size, _state));
+        return Status::OK();
+    }
+
+    const TupleRowComparator& less_than() const { return *_less_than; }
+
+    TupleSorter* tuple_sorter() { return _tuple_sorter.get(); }
+
+private:
+    RuntimeState* _state;
+    std::vector<ExprContext*> _lhs_expr_ctxs;
+    std::vector<ExprContext*> _rhs_expr_ctxs;
+    boost::scoped_ptr<TupleRowComparator> _less_than;
+    boost::scoped_ptr<TupleSorter> _tuple_sorter;
+};
+
 // MergeSorter::Run methods
 MergeSorter::Run::Run(MergeSorter* parent, TupleDescriptor* sort_tuple_desc,
                  bool materialize_slots)
@@ -405,6 +465,21 @@ Status MergeSorter::Run::prepare_read() {
     //var_len_blocks_index_ = 0;
     _num_tuples_returned = 0;
 
+    _buffered_batch.reset(new RowBatch(*_sorter->_output_row_desc,
+                                       _sorter->_state->batch_size(),
+                                       _sorter->_state->instance_mem_tracker()));
+    return Status::OK();
+}
+
+Status MergeSorter::Run::get_next_batch(RowBatch** output_batch) {
+    DCHECK(_buffered_batch != NULL);
+    _buffered_batch->reset();
+    // get_next() stops at block boundaries, fill the whole batch
+    bool eos = false;
+    while (!_buffered_batch->is_full() && !eos) {
+        RETURN_IF_ERROR(get_next<false>(_buffered_batch.get(), &eos));
+    }
+    *output_batch = _buffered_batch->num_rows() > 0 ? _buffered_batch.get() : NULL;
     return Status::OK();
 }
 
@@ -475,6 +550,7 @@ MergeSorter::TupleSorter::TupleSorter(const TupleRowComparator& comp, int64_t bl
       _block_capacity(block_size / tuple_size),
       _last_tuple_block_offset(tuple_size * ((block_size / tuple_size) - 1)),
       _less_than_comp(comp),
+      _normalizer(_less_than_comp),
       _state(state) {
     _temp_tuple_buffer = new uint8_t[tuple_size];
     _temp_tuple_row = reinterpret_cast<TupleRow*>(&_temp_tuple_buffer);
@@ -574,8 +650,13 @@ inline void MergeSorter::TupleSorter::swap(uint8_t* left, uint8_t* right) {
 MergeSorter::MergeSorter(const TupleRowComparator& compare_less_than,
                const std::vector<ExprContext*>& slot_materialize_expr_ctxs,
                RowDescriptor* output_row_desc,
-               RuntimeProfile* profile, RuntimeState* state)
+               RuntimeProfile* profile, RuntimeState* state, int num_threads,
+               ThreadPool* thread_pool)
     : _state(state),
+      _num_threads(thread_pool == NULL ? 1 : std::max(1, num_threads)),
+      _thread_pool(thread_pool),
+      _num_pending_sorts(0),
+      _merge_shutdown(false),
       _compare_less_than(compare_less_than),
       _block_mgr(state->block_mgr()),
       _output_row_desc(output_row_desc),
@@ -590,12 +671,46 @@ MergeSorter::MergeSorter(const TupleRowComparator& compare_less_than,
     _num_merges_counter = ADD_COUNTER(_profile, "TotalMergesPerformed", TUnit::UNIT);
     _in_mem_sort_timer = ADD_TIMER(_profile, "InMemorySortTime");
     _sorted_data_size = ADD_COUNTER(_profile, "SortDataSize", TUnit::BYTES);
+    _parallel_degree_counter = ADD_COUNTER(_profile, "ParallelSortDegree", TUnit::UNIT);
+    _merge_groups_counter = ADD_COUNTER(_profile, "ParallelMergeGroups", TUnit::UNIT);
+    COUNTER_SET(_parallel_degree_counter, (int64_t)_num_threads);
 
     _unsorted_run = _obj_pool.add(new Run(this, sort_tuple_desc, true));
     _unsorted_run->init();
 }
 
 MergeSorter::~MergeSorter() {
+    if (_idle_workers == NULL) {
+        return;
+    }
+    wait_for_sorted_runs();
+    {
+        // The merge tasks still queued or running return after at most one batch
+        boost::unique_lock<boost::mutex> l(_merge_lock);
+        _merge_shutdown = true;
+        for (auto& group : _merge_groups) {
+            while (group.scheduled) {
+                _merge_cv.wait(l);
+            }
+        }
+    }
+    for (auto& group : _merge_groups) {
+        for (RowBatch* batch : group.batches) {
+            delete batch;
+        }
+    }
+}
+
+Status MergeSorter::init_workers() {
+    TupleDescriptor* sort_tuple_desc = _output_row_desc->tuple_descriptors()[0];
+    _idle_workers.reset(new BlockingQueue<SortWorker*>(_num_threads));
+    for (int i = 0; i < _num_threads; ++i) {
+        SortWorker* worker = _obj_pool.add(new SortWorker(_state));
+        RETURN_IF_ERROR(worker->init(_compare_less_than, _block_mgr->max_block_size(),
+                                     sort_tuple_desc->byte_size()));
+        _idle_workers->blocking_put(worker);
+    }
+    return Status::OK();
 }
 
 Status MergeSorter::add_batch(RowBatch* batch) {
@@ -614,6 +729,17 @@ Status MergeSorter::add_batch(RowBatch* batch) {
             return Status::InternalError("run is full");
         }
     }
+
+    // Hand the full run to a worker thread and collect the next one meanwhile.
+    if (_num_threads > 1 && _unsorted_run->_num_tuples >= config::parallel_sort_run_rows) {
+        if (_idle_workers == NULL) {
+            RETURN_IF_ERROR(init_workers());
+        }
+        RETURN_IF_ERROR(sort_run());
+        _unsorted_run = _obj_pool.add(
+            new Run(this, _output_row_desc->tuple_descriptors()[0], true));
+        RETURN_IF_ERROR(_unsorted_run->init());
+    }
     return Status::OK();
 }
 
@@ -621,16 +747,22 @@ Status MergeSorter::input_done() {
 // Sort the tuples accumulated so far in the current run.
     RETURN_IF_ERROR(sort_run());
 
-    DCHECK(_sorted_runs.size() == 1);
-
+    if (_sorted_runs.size() == 1) {
 // The entire input fit in one run. Read sorted rows in get_next() directly
 // from the sorted run.
-    _sorted_runs.back()->prepare_read();
+        _sorted_runs.back()->prepare_read();
+        return Status::OK();
+    }
 
-    return Status::OK();
+    wait_for_sorted_runs();
+    RETURN_IF_CANCELLED(_state);
+    return create_merger();
 }
 
 Status MergeSorter::get_next(RowBatch* output_batch, bool* eos) {
+    if (_merger != NULL) {
+        return _merger->get_next(output_batch, eos);
+    }
     DCHECK(_sorted_runs.size() == 1);
 
     // In this case, only TupleRows are copied into output_batch. Sorted tuples are left
@@ -657,7 +789,23 @@ Status MergeSorter::sort_run() {
             _unsorted_run->_var_len_blocks.pop_back();
         }
     }
-    {
+    if (_idle_workers != NULL) {
+        {
+            // At most one run per worker is being sorted, which bounds the memory of the
+            // collected runs and lets every task take a worker without waiting.
+            boost::unique_lock<boost::mutex> l(_sort_lock);
+            while (_num_pending_sorts >= _num_threads) {
+                _sort_done_cv.wait(l);
+            }
+            ++_num_pending_sorts;
+        }
+        if (!_thread_pool->offer(boost::bind<void>(
+                    boost::mem_fn(&MergeSorter::sort_run_in_worker), this, _unsorted_run))) {
+            boost::lock_guard<boost::mutex> l(_sort_lock);
+            --_num_pending_sorts;
+            return Status::InternalError("failed to offer sort task to the sort thread pool");
+        }
+    } else {
         SCOPED_TIMER(_in_mem_sort_timer);
         _in_mem_tuple_sorter->sort(_unsorted_run);
         RETURN_IF_CANCELLED(_state);
@@ -666,4 +814,147 @@ Status MergeSorter::sort_run() {
     _unsorted_run = NULL;
     return Status::OK();
 }
+
+void MergeSorter::sort_run_in_worker(Run* run) {
+    SortWorker* worker = NULL;
+    if (_idle_workers->blocking_get(&worker)) {
+        SCOPED_TIMER(_in_mem_sort_timer);
+        worker->tuple_sorter()->sort(run);
+        _idle_workers->blocking_put(worker);
+    }
+    boost::lock_guard<boost::mutex> l(_sort_lock);
+    --_num_pending_sorts;
+    _sort_done_cv.notify_all();
+}
+
+void MergeSorter::wait_for_sorted_runs() {
+    boost::unique_lock<boost::mutex> l(_sort_lock);
+    while (_num_pending_sorts > 0) {
+        _sort_done_cv.wait(l);
+    }
+}
+
+Status MergeSorter::create_merger() {
+    std::vector<SortedRunMerger::RunBatchSupplier> runs;
+    for (Run* run : _sorted_runs) {
+        DCHECK(run->_is_sorted);
+        RETURN_IF_ERROR(run->prepare_read());
+        runs.push_back(boost::bind<Status>(boost::mem_fn(&Run::get_next_batch), run, _1));
+    }
+    _merger.reset(new SortedRunMerger(_compare_less_than, _output_row_desc, _profile, false));
+
+    int num_groups = std::min<int>(_num_threads, _sorted_runs.size() / 2);
+    if (_idle_workers == NULL || num_groups < 2) {
+        return _merger->prepare(runs);
+    }
+
+    // Every group merges a contiguous range of the runs on the thread pool, with the
+    // comparator of the worker it took. All runs are sorted, so all workers are idle.
+    COUNTER_SET(_merge_groups_counter, (int64_t)num_groups);
+    _merge_groups.resize(num_groups);
+    std::vector<SortedRunMerger::RunBatchSupplier> groups;
+    for (int g = 0; g < num_groups; ++g) {
+        SortWorker* worker = NULL;
+        if (!_idle_workers->blocking_get(&worker)) {
+            return Status::Cancelled("sort workers are shut down");
+        }
+        SortedRunMerger* group_merger = _obj_pool.add(new SortedRunMerger(
+                worker->less_than(), _output_row_desc, _profile, false));
+        int begin = runs.size() * g / num_groups;
+        int end = runs.size() * (g + 1) / num_groups;
+        RETURN_IF_ERROR(group_merger->prepare(std::vector<SortedRunMerger::RunBatchSupplier>(
+                runs.begin() + begin, runs.begin() + end)));
+        _merge_groups[g].merger = group_merger;
+        groups.push_back(boost::bind<Status>(
+                boost::mem_fn(&MergeSorter::get_next_merged_batch), this, g, _1));
+    }
+    {
+        boost::unique_lock<boost::mutex> l(_merge_lock);
+        for (int g = 0; g < num_groups; ++g) {
+            RETURN_IF_ERROR(schedule_merge_group(g, &l));
+        }
+    }
+    return _merger->prepare(groups);
+}
+
+void MergeSorter::merge_group(int group) {
+    MergeGroup* merge_group = &_merge_groups[group];
+    while (true) {
+        {
+            boost::lock_guard<boost::mutex> l(_merge_lock);
+            if (_merge_shutdown || merge_group->batches.size() >= MERGE_QUEUE_SIZE) {
+                merge_group->scheduled = false;
+                _merge_cv.notify_all();
+                return;
+            }
+        }
+
+        Status status = Status::OK();
+        bool eos = false;
+        std::unique_ptr<RowBatch> batch;
+        if (_state->is_cancelled()) {
+            status = Status::Cancelled("Cancelled");
+        } else {
+            batch.reset(new RowBatch(
+                    *_output_row_desc, _state->batch_size(), _state->instance_mem_tracker()));
+            status = merge_group->merger->get_next(batch.get(), &eos);
+        }
+
+        boost::lock_guard<boost::mutex> l(_merge_lock);
+        if (!status.ok()) {
+            if (_merge_status.ok()) {
+                _merge_status = status;
+            }
+            eos = true;
+        } else if (batch->num_rows() > 0) {
+            merge_group->batches.push_back(batch.release());
+        }
+        _merge_cv.notify_all();
+        if (eos) {
+            merge_group->eos = true;
+            merge_group->scheduled = false;
+            return;
+        }
+    }
+}
+
+Status MergeSorter::schedule_merge_group(int group, boost::unique_lock<boost::mutex>* lock) {
+    _merge_groups[group].scheduled = true;
+    lock->unlock();
+    bool offered = _thread_pool->offer(boost::bind<void>(
+            boost::mem_fn(&MergeSorter::merge_group), this, group));
+    lock->lock();
+    if (!offered) {
+        _merge_groups[group].scheduled = false;
+        _merge_cv.notify_all();
+        return Status::InternalError("failed to offer merge task to the sort thread pool");
+    }
+    return Status::OK();
+}
+
+Status MergeSorter::get_next_merged_batch(int group, RowBatch** batch) {
+    MergeGroup* merge_group = &_merge_groups[group];
+    // The merger has transferred the resources of the previous batch already
+    merge_group->current.reset();
+    boost::unique_lock<boost::mutex> l(_merge_lock);
+    while (merge_group->batches.empty() && !merge_group->eos) {
+        if (!merge_group->scheduled) {
+            RETURN_IF_ERROR(schedule_merge_group(group, &l));
+        }
+        _merge_cv.wait(l);
+    }
+    RETURN_IF_ERROR(_merge_status);
+    if (merge_group->batches.empty()) {
+        *batch = NULL;
+        return Status::OK();
+    }
+    merge_group->current.reset(merge_group->batches.front());
+    merge_group->batches.pop_front();
+    *batch = merge_group->current.get();
+    // Merge the next batches while the final merger consumes this one
+    if (!merge_group->scheduled && !merge_group->eos) {
+        RETURN_IF_ERROR(schedule_merge_group(group, &l));
+    }
+    return Status::OK();
+}
 } // namespace doris
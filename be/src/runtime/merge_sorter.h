@@ -18,14 +18,23 @@
 #ifndef DORIS_BE_SRC_QUERY_RUNTIME_SORTER_H
 #define DORIS_BE_SRC_QUERY_RUNTIME_SORTER_H
 
+#include <deque>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
 #include "runtime/buffered_block_mgr.h"
+#include "util/blocking_queue.hpp"
 #include "util/tuple_row_compare.h"
 #include "common/object_pool.h"
 #include "util/runtime_profile.h"
+#include "util/thread_pool.hpp"
 
 namespace doris {
 class RuntimeProfile;
 class RowBatch;
+class SortedRunMerger;
 struct BufferDescriptor;
 
 // Sorter contains the external sort implementation. Its purpose is to sort arbitrarily
@@ -78,6 +87,13 @@ struct BufferDescriptor;
 // for these batches have already been accounted for in the memory budget for the sort.
 // That is, the memory for these batches does not come out of the block buffer manager.
 //
+// If the sorter is created with more than one thread, the input is cut into runs of
+// config::parallel_sort_run_rows rows, and every run is sorted on a worker thread as
+// soon as it is full, while the next one is being collected. The sorted runs are
+// merged with SortedRunMerger: the runs are split into one group per thread, each
+// group is merged on a worker thread, and the merged streams of the groups are merged
+// again on the calling thread. Workers evaluate the ordering exprs on their own clones.
+//
 // TODO: Not necessary to actually copy var-len data - instead take ownership of the
 // var-length data in the input batch. Copying can be deferred until a run is unpinned.
 // TODO: When the first run is constructed, create a sequence of pointers to materialized
@@ -89,10 +105,14 @@ public:
     // compare_less_than is a comparator for the sort tuples (returns true if lhs < rhs).
     // merge_batch_size_ is the size of the batches created to provide rows to the merger
     // and retrieve rows from an intermediate merger.
+    // num_threads is the number of runs sorted or merged at the same time on
+    // thread_pool, the pool shared by all sorters of the process. If num_threads is 1 or
+    // thread_pool is NULL, everything is done on the calling thread.
     MergeSorter(const TupleRowComparator& compare_less_than,
            const std::vector<ExprContext*>& sort_tuple_slot_expr_ctxs,
            RowDescriptor* output_row_desc,
-           RuntimeProfile* profile, RuntimeState* state);
+           RuntimeProfile* profile, RuntimeState* state, int num_threads = 1,
+           ThreadPool* thread_pool = NULL);
 
     ~MergeSorter();
 
@@ -109,14 +129,81 @@ public:
 private:
     class Run;
     class TupleSorter;
+    class SortWorker;
 
     // Runtime state instance used to check for cancellation. Not owned.
     RuntimeState* const _state;
 
     // Sorts _unsorted_run and appends it to the list of sorted runs. Deletes any empty
     // blocks at the end of the run. Updates the sort bytes counter if necessary.
+    // If the sorter has worker threads, the run is sorted asynchronously.
     Status sort_run();
 
+    // Creates the SortWorker of each thread.
+    Status init_workers();
+
+    // Sorts 'run' on a worker thread.
+    void sort_run_in_worker(Run* run);
+
+    // Waits until all runs handed to worker threads are sorted.
+    void wait_for_sorted_runs();
+
+    // Creates _merger to merge _sorted_runs, with one merge group per worker thread.
+    Status create_merger();
+
+    // Task of merge group 'group': merges batches of the group's runs until its queue
+    // is full or the runs are exhausted.
+    void merge_group(int group);
+
+    // Offers the next task of merge group 'group' to the thread pool. 'lock' holds
+    // _merge_lock, it is released while offering as the pool's queue may be full.
+    Status schedule_merge_group(int group, boost::unique_lock<boost::mutex>* lock);
+
+    // RunBatchSupplier of the merged stream of group 'group'.
+    Status get_next_merged_batch(int group, RowBatch** batch);
+
+    // Number of runs sorted or merged at the same time, 1 if the sort runs on the
+    // calling thread only.
+    const int _num_threads;
+
+    // Shared by all sorters, not owned.
+    ThreadPool* const _thread_pool;
+
+    // One per worker thread, taken by a task while it runs. Owned by _obj_pool. NULL
+    // until the first run is handed to the thread pool.
+    boost::scoped_ptr<BlockingQueue<SortWorker*> > _idle_workers;
+
+    // Runs handed to worker threads and not sorted yet.
+    boost::mutex _sort_lock;
+    boost::condition_variable _sort_done_cv;
+    int _num_pending_sorts;
+
+    // Merger of the sorted runs if there is more than one.
+    boost::scoped_ptr<SortedRunMerger> _merger;
+
+    // A contiguous range of the sorted runs merged by tasks on the thread pool. A task
+    // never blocks a pool thread: it returns once MERGE_QUEUE_SIZE batches are queued,
+    // and get_next_merged_batch() schedules the next one after taking a batch.
+    struct MergeGroup {
+        SortedRunMerger* merger = NULL;
+        // Owned until taken by get_next_merged_batch()
+        std::deque<RowBatch*> batches;
+        // The batch last returned to _merger
+        boost::shared_ptr<RowBatch> current;
+        // A task of the group is queued or running
+        bool scheduled = false;
+        bool eos = false;
+    };
+    static const int MERGE_QUEUE_SIZE = 2;
+
+    // Protects all fields of the groups except 'merger' and 'current'.
+    boost::mutex _merge_lock;
+    boost::condition_variable _merge_cv;
+    std::vector<MergeGroup> _merge_groups;
+    Status _merge_status;
+    // Set by the destructor, the tasks stop merging
+    bool _merge_shutdown;
+
 
     // In memory sorter and less-than comparator.
     TupleRowComparator _compare_less_than;
@@ -159,6 +246,8 @@ private:
     RuntimeProfile::Counter* _num_merges_counter;
     RuntimeProfile::Counter* _in_mem_sort_timer;
     RuntimeProfile::Counter* _sorted_data_size;
+    RuntimeProfile::Counter* _parallel_degree_counter;
+    RuntimeProfile::Counter* _merge_groups_counter;
 };
 
 } // namespace doris
@@ -0,0 +1,227 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/pipeline_driver.h"
+
+#include <algorithm>
+
+#include "exec/data_sink.h"
+#include "exec/exec_node.h"
+#include "exec/select_node.h"
+#include "runtime/plan_fragment_executor.h"
+#include "runtime/row_batch.h"
+#include "runtime/runtime_state.h"
+#include "util/debug_util.h"
+
+namespace doris {
+
+PipelineDriver::PipelineDriver(PlanFragmentExecutor* executor) :
+        _executor(executor),
+        _state(executor->runtime_state()),
+        _sink(executor->get_sink()) {
+}
+
+PipelineDriver::~PipelineDriver() {
+}
+
+Status PipelineDriver::create(PlanFragmentExecutor* executor,
+                              std::unique_ptr<PipelineDriver>* driver) {
+    DataSink* sink = executor->get_sink();
+    if (sink == nullptr || !sink->can_be_pipeline_sink()) {
+        return Status::NotSupported("the sink of the fragment can't be a pipeline sink");
+    }
+
+    std::unique_ptr<PipelineDriver> result(new PipelineDriver(executor));
+    // Walk down from the root, the pipelines are collected from the last to the first
+    std::vector<Pipeline> pipelines(1);
+    ExecNode* node = executor->plan();
+    while (true) {
+        Pipeline& pipeline = pipelines.back();
+        if (node->type() == TPlanNodeType::SELECT_NODE) {
+            pipeline.operators.push_back(static_cast<SelectNode*>(node));
+            node = node->children()[0];
+            continue;
+        }
+        if (node->is_pipeline_breaker()) {
+            if (pipelines.size() > 1) {
+                return Status::NotSupported("more than one pipeline breaker");
+            }
+            pipeline.source = node;
+            Pipeline input;
+            input.breaker = node;
+            pipelines.push_back(std::move(input));
+            node = node->children()[0];
+            continue;
+        }
+        if (node->children().empty() && node->can_be_pipeline_source()) {
+            pipeline.source = node;
+            break;
+        }
+        return Status::NotSupported("pipeline execution is not supported by "
+                                    + print_plan_node_type(node->type()));
+    }
+
+    std::reverse(pipelines.begin(), pipelines.end());
+    for (auto& pipeline : pipelines) {
+        std::reverse(pipeline.operators.begin(), pipeline.operators.end());
+        if (!pipeline.source->is_pipeline_breaker()) {
+            pipeline.source->set_pipeline_source();
+        }
+    }
+    sink->set_pipeline_sink();
+    result->_pipelines = std::move(pipelines);
+    *driver = std::move(result);
+    return Status::OK();
+}
+
+Status PipelineDriver::_open_pipeline(Pipeline* pipeline) {
+    if (_pipeline_idx == 0) {
+        // opens the source and the operators as well
+        if (pipeline->breaker != nullptr) {
+            RETURN_IF_ERROR(pipeline->breaker->open_sink(_state));
+        } else {
+            RETURN_IF_ERROR(_executor->plan()->open(_state));
+        }
+    } else {
+        for (SelectNode* op : pipeline->operators) {
+            RETURN_IF_ERROR(op->open_operator(_state));
+        }
+    }
+    if (pipeline->breaker == nullptr) {
+        RETURN_IF_ERROR(_sink->open(_state));
+    }
+
+    _source_batch.reset(new RowBatch(pipeline->source->row_desc(), _state->batch_size(),
+                                     _state->instance_mem_tracker()));
+    pipeline->operator_batches.clear();
+    for (SelectNode* op : pipeline->operators) {
+        pipeline->operator_batches.emplace_back(new RowBatch(
+                op->row_desc(), _state->batch_size(), _state->instance_mem_tracker()));
+    }
+    pipeline->is_opened = true;
+    return Status::OK();
+}
+
+Status PipelineDriver::_step(bool* blocked, bool* done) {
+    Pipeline& pipeline = _pipelines[_pipeline_idx];
+    if (!pipeline.is_opened) {
+        RETURN_IF_ERROR(_open_pipeline(&pipeline));
+    }
+
+    if (pipeline.source_eos) {
+        // only the last pipeline waits, for the sink to get its last batches out
+        if (!_sink->is_idle()) {
+            *blocked = true;
+            return Status::OK();
+        }
+        *done = true;
+        return Status::OK();
+    }
+
+    if ((pipeline.breaker == nullptr && !_sink->is_ready()) || !pipeline.source->has_output()) {
+        *blocked = true;
+        return Status::OK();
+    }
+
+    _source_batch->reset();
+    bool eos = false;
+    RETURN_IF_ERROR(pipeline.source->get_next(_state, _source_batch.get(), &eos));
+    RowBatch* batch = _source_batch.get();
+    for (int i = 0; i < pipeline.operators.size(); ++i) {
+        RowBatch* output = pipeline.operator_batches[i].get();
+        output->reset();
+        bool reached_limit = false;
+        RETURN_IF_ERROR(pipeline.operators[i]->push(_state, batch, output, &reached_limit));
+        eos |= reached_limit;
+        batch = output;
+    }
+    if (batch->num_rows() > 0) {
+        if (pipeline.breaker != nullptr) {
+            RETURN_IF_ERROR(pipeline.breaker->sink(_state, batch));
+        } else {
+            RETURN_IF_ERROR(_executor->send_pipeline_batch(batch));
+        }
+    }
+
+    if (eos) {
+        pipeline.source_eos = true;
+        if (pipeline.breaker != nullptr) {
+            RETURN_IF_ERROR(pipeline.breaker->close_sink(_state));
+            ++_pipeline_idx;
+        }
+    }
+    return Status::OK();
+}
+
+PipelineDriver::State PipelineDriver::process(int64_t time_slice_ns) {
+    if (!_started) {
+        _watch.start();
+        _started = true;
+    }
+    MonotonicStopWatch slice_watch;
+    slice_watch.start();
+    while (true) {
+        if (_state->is_cancelled()) {
+            _status = Status::Cancelled("Cancelled");
+            return FINISHED;
+        }
+        _status = _state->check_query_state("pipeline driver");
+        if (!_status.ok()) {
+            return FINISHED;
+        }
+
+        bool blocked = false;
+        bool done = false;
+        _status = _step(&blocked, &done);
+        if (!_status.ok() || done) {
+            return FINISHED;
+        }
+        if (blocked) {
+            return BLOCKED;
+        }
+        if (slice_watch.elapsed_time() >= time_slice_ns) {
+            return READY;
+        }
+    }
+}
+
+bool PipelineDriver::is_ready() {
+    if (_state->is_cancelled()) {
+        return true;
+    }
+    const Pipeline& pipeline = _pipelines[_pipeline_idx];
+    if (!pipeline.is_opened) {
+        return true;
+    }
+    if (pipeline.source_eos) {
+        return _sink->is_idle();
+    }
+    if (pipeline.breaker == nullptr && !_sink->is_ready()) {
+        return false;
+    }
+    return pipeline.source->has_output();
+}
+
+void PipelineDriver::finish() {
+    _watch.stop();
+    _status = _executor->finish_pipeline(_status);
+    if (_finish_cb) {
+        _finish_cb(this);
+    }
+}
+
+}
@@ -0,0 +1,141 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_RUNTIME_PIPELINE_DRIVER_H
+#define DORIS_BE_SRC_RUNTIME_PIPELINE_DRIVER_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common/status.h"
+#include "util/stopwatch.hpp"
+
+namespace doris {
+
+class DataSink;
+class ExecNode;
+class PlanFragmentExecutor;
+class RowBatch;
+class RuntimeState;
+class SelectNode;
+
+// Drives the execution of one fragment instance on the workers of a
+// PipelineTaskScheduler instead of a thread of its own.
+//
+// The plan is split at its pipeline breaker, an aggregation, into at most two
+// pipelines which run one after the other:
+//
+//   scan/exchange -> select* -> aggregation (sink side)
+//   aggregation (output side) -> select* -> data stream sender
+//
+// A plan without an aggregation is a single pipeline from the source to the sender.
+// A driver step pulls one batch from the pipeline's source, pushes it through the
+// select nodes and hands it to the aggregation or the sender. Before a step the
+// driver polls whether the source has a batch and whether the sender can take one;
+// if not, process() returns BLOCKED and the scheduler parks the driver instead of
+// letting it wait on a worker. After the last batch the driver waits the same way
+// for the sender to have no rpc in flight before it's closed.
+//
+// Plans of any other shape aren't supported and run by PlanFragmentExecutor::open()
+// on a thread of their own as before.
+class PipelineDriver {
+public:
+    enum State {
+        // can go on at once, its time slice is used up
+        READY,
+        // waits for the source or the sink, see is_ready()
+        BLOCKED,
+        // done, with an error or not
+        FINISHED
+    };
+
+    // Called once the driver is finished and the fragment's final report was sent.
+    typedef std::function<void (PipelineDriver*)> FinishCallback;
+
+    ~PipelineDriver();
+
+    // Creates the driver of the prepared fragment executed by 'executor', returns
+    // NotSupported if the plan can't be run as pipelines.
+    static Status create(PlanFragmentExecutor* executor,
+                         std::unique_ptr<PipelineDriver>* driver);
+
+    void set_finish_callback(const FinishCallback& cb) {
+        _finish_cb = cb;
+    }
+
+    // Run steps until the driver has to wait, its time slice is used up or it's
+    // finished. Not thread safe, the scheduler runs a driver on one worker at a time.
+    State process(int64_t time_slice_ns);
+
+    // True if the next step of a BLOCKED driver can make progress.
+    bool is_ready();
+
+    // Calls the finish callback.
+    void finish();
+
+    const Status& status() const {
+        return _status;
+    }
+
+    PlanFragmentExecutor* executor() {
+        return _executor;
+    }
+
+    // wall time since the first call to process()
+    int64_t elapsed_time_ns() const {
+        return _watch.elapsed_time();
+    }
+
+private:
+    struct Pipeline {
+        ExecNode* source = nullptr;
+        // applied in order to the batches of the source
+        std::vector<SelectNode*> operators;
+        std::vector<std::unique_ptr<RowBatch>> operator_batches;
+        // the breaker consuming the output, nullptr for the fragment's sink
+        ExecNode* breaker = nullptr;
+        bool is_opened = false;
+        bool source_eos = false;
+    };
+
+    explicit PipelineDriver(PlanFragmentExecutor* executor);
+
+    Status _open_pipeline(Pipeline* pipeline);
+
+    // Pushes one batch through the current pipeline, or finishes the pipeline if its
+    // source is exhausted. Sets 'blocked' if the source or the sink isn't ready, and
+    // 'done' after the last pipeline.
+    Status _step(bool* blocked, bool* done);
+
+    PlanFragmentExecutor* _executor;
+    RuntimeState* _state;
+    DataSink* _sink;
+
+    std::vector<Pipeline> _pipelines;
+    size_t _pipeline_idx = 0;
+    std::unique_ptr<RowBatch> _source_batch;
+
+    bool _started = false;
+    Status _status;
+    MonotonicStopWatch _watch;
+    FinishCallback _finish_cb;
+};
+
+}
+
+#endif // DORIS_BE_SRC_RUNTIME_PIPELINE_DRIVER_H
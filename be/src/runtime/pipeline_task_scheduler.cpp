@@ -0,0 +1,146 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/pipeline_task_scheduler.h"
+
+#include <chrono>
+
+#include "common/logging.h"
+#include "runtime/pipeline_driver.h"
+#include "util/cpu_info.h"
+
+namespace doris {
+
+// how often the poller looks at the blocked drivers
+static const int64_t POLL_INTERVAL_US = 1000;
+
+PipelineTaskScheduler::PipelineTaskScheduler(int num_threads, int64_t time_slice_ms) :
+        _time_slice_ns(time_slice_ms * 1000L * 1000L) {
+    if (num_threads <= 0) {
+        num_threads = CpuInfo::num_cores();
+    }
+    for (int i = 0; i < num_threads; ++i) {
+        _workers.emplace_back(&PipelineTaskScheduler::_work, this);
+    }
+    _poller = std::thread(&PipelineTaskScheduler::_poll, this);
+}
+
+PipelineTaskScheduler::~PipelineTaskScheduler() {
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        _shutdown = true;
+    }
+    _ready_cv.notify_all();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _poller.join();
+    // the fragments still running are cancelled with the process
+    for (PipelineDriver* driver : _ready_drivers) {
+        delete driver;
+    }
+    for (PipelineDriver* driver : _blocked_drivers) {
+        delete driver;
+    }
+}
+
+void PipelineTaskScheduler::submit(std::unique_ptr<PipelineDriver> driver) {
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        _ready_drivers.push_back(driver.release());
+    }
+    _ready_cv.notify_one();
+}
+
+void PipelineTaskScheduler::_work() {
+    while (true) {
+        PipelineDriver* driver = nullptr;
+        {
+            std::unique_lock<std::mutex> l(_lock);
+            _ready_cv.wait(l, [this] { return _shutdown || !_ready_drivers.empty(); });
+            if (_shutdown) {
+                return;
+            }
+            driver = _ready_drivers.front();
+            _ready_drivers.pop_front();
+        }
+
+        switch (driver->process(_time_slice_ns)) {
+        case PipelineDriver::READY: {
+            std::lock_guard<std::mutex> l(_lock);
+            // to the back, behind the drivers which waited for a worker
+            _ready_drivers.push_back(driver);
+            break;
+        }
+        case PipelineDriver::BLOCKED: {
+            std::lock_guard<std::mutex> l(_lock);
+            _blocked_drivers.push_back(driver);
+            break;
+        }
+        case PipelineDriver::FINISHED:
+            _finish(driver);
+            break;
+        }
+    }
+}
+
+void PipelineTaskScheduler::_poll() {
+    std::vector<PipelineDriver*> blocked_drivers;
+    std::vector<PipelineDriver*> still_blocked;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            if (_shutdown) {
+                return;
+            }
+            blocked_drivers.swap(_blocked_drivers);
+        }
+
+        // is_ready() takes the locks of the sources and the sinks, don't hold _lock
+        int num_ready = 0;
+        still_blocked.clear();
+        for (PipelineDriver* driver : blocked_drivers) {
+            if (driver->is_ready()) {
+                std::lock_guard<std::mutex> l(_lock);
+                _ready_drivers.push_back(driver);
+                ++num_ready;
+            } else {
+                still_blocked.push_back(driver);
+            }
+        }
+        blocked_drivers.clear();
+        {
+            std::lock_guard<std::mutex> l(_lock);
+            _blocked_drivers.insert(_blocked_drivers.end(),
+                                    still_blocked.begin(), still_blocked.end());
+        }
+        if (num_ready > 0) {
+            _ready_cv.notify_all();
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(POLL_INTERVAL_US));
+    }
+}
+
+void PipelineTaskScheduler::_finish(PipelineDriver* driver) {
+    driver->finish();
+    VLOG(1) << "pipeline driver finished, status=" << driver->status().get_error_msg()
+            << ", elapsed_time_ns=" << driver->elapsed_time_ns();
+    delete driver;
+}
+
+}
@@ -0,0 +1,64 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_RUNTIME_PIPELINE_TASK_SCHEDULER_H
+#define DORIS_BE_SRC_RUNTIME_PIPELINE_TASK_SCHEDULER_H
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace doris {
+
+class PipelineDriver;
+
+// Runs PipelineDrivers on a fixed number of worker threads, by default one per core.
+// A worker takes a ready driver and processes it for a time slice. A driver which
+// has to wait for its source or its sink is parked on the blocked list, which a
+// poller thread scans for drivers which can go on again.
+class PipelineTaskScheduler {
+public:
+    // 'num_threads' <= 0 means the number of cores
+    PipelineTaskScheduler(int num_threads, int64_t time_slice_ms);
+    ~PipelineTaskScheduler();
+
+    // Takes the ownership of 'driver', which is deleted after its finish callback ran.
+    void submit(std::unique_ptr<PipelineDriver> driver);
+
+private:
+    void _work();
+    void _poll();
+    void _finish(PipelineDriver* driver);
+
+    const int64_t _time_slice_ns;
+
+    std::mutex _lock;
+    std::condition_variable _ready_cv;
+    std::deque<PipelineDriver*> _ready_drivers;
+    std::vector<PipelineDriver*> _blocked_drivers;
+    bool _shutdown = false;
+
+    std::vector<std::thread> _workers;
+    std::thread _poller;
+};
+
+}
+
+#endif // DORIS_BE_SRC_RUNTIME_PIPELINE_TASK_SCHEDULER_H
@@ -270,6 +270,17 @@ Status PlanFragmentExecutor::open() {
     // may block
     // TODO: if no report thread is started, make sure to send a final profile
     // at end, otherwise the coordinator hangs in case we finish w/ an error
+    start_report_thread();
+
+    optimize_llvm_module();
+
+    Status status = open_internal();
+
+    finish_open(status);
+    return status;
+}
+
+void PlanFragmentExecutor::start_report_thread() {
     if (!_report_status_cb.empty() && config::status_report_interval > 0) {
         boost::unique_lock<boost::mutex> l(_report_thread_lock);
         _report_thread = boost::thread(&PlanFragmentExecutor::report_profile, this);
@@ -278,11 +289,9 @@ Status PlanFragmentExecutor::open() {
         _report_thread_started_cv.wait(l);
         _report_thread_active = true;
     }
+}
 
-    optimize_llvm_module();
-
-    Status status = open_internal();
-
+void PlanFragmentExecutor::finish_open(const Status& status) {
     if (!status.ok() && !status.is_cancelled() && _runtime_state->log_has_space()) {
         // Log error message in addition to returning in Status. Queries that do not
         // fetch results (e.g. insert) may not receive the message directly and can
@@ -291,6 +300,26 @@ Status PlanFragmentExecutor::open() {
     }
 
     update_status(status);
+}
+
+void PlanFragmentExecutor::start_pipeline() {
+    LOG(INFO) << "start_pipeline(): fragment_instance_id="
+              << print_id(_runtime_state->fragment_instance_id());
+    start_report_thread();
+    optimize_llvm_module();
+}
+
+Status PlanFragmentExecutor::send_pipeline_batch(RowBatch* batch) {
+    COUNTER_UPDATE(_rows_produced_counter, batch->num_rows());
+    return send_to_sink(batch);
+}
+
+Status PlanFragmentExecutor::finish_pipeline(const Status& exec_status) {
+    Status status = exec_status;
+    if (status.ok()) {
+        status = close_sink();
+    }
+    finish_open(status);
     return status;
 }
 
@@ -316,24 +345,32 @@ Status PlanFragmentExecutor::open_internal() {
             break;
         }
 
-        if (VLOG_ROW_IS_ON) {
-            VLOG_ROW << "open_internal: #rows=" << batch->num_rows()
-                << " desc=" << row_desc().debug_string();
+        RETURN_IF_ERROR(send_to_sink(batch));
+    }
 
-            for (int i = 0; i < batch->num_rows(); ++i) {
-                TupleRow* row = batch->get_row(i);
-                VLOG_ROW << row->to_string(row_desc());
-            }
-        }
-     
-        SCOPED_TIMER(profile()->total_time_counter());
-        // Collect this plan and sub plan statisticss, and send to parent plan.
-        if (_collect_query_statistics_with_every_batch) {
-            collect_query_statistics();
+    return close_sink();
+}
+
+Status PlanFragmentExecutor::send_to_sink(RowBatch* batch) {
+    if (VLOG_ROW_IS_ON) {
+        VLOG_ROW << "open_internal: #rows=" << batch->num_rows()
+            << " desc=" << row_desc().debug_string();
+
+        for (int i = 0; i < batch->num_rows(); ++i) {
+            TupleRow* row = batch->get_row(i);
+            VLOG_ROW << row->to_string(row_desc());
         }
-        RETURN_IF_ERROR(_sink->send(runtime_state(), batch));
     }
 
+    SCOPED_TIMER(profile()->total_time_counter());
+    // Collect this plan and sub plan statisticss, and send to parent plan.
+    if (_collect_query_statistics_with_every_batch) {
+        collect_query_statistics();
+    }
+    return _sink->send(runtime_state(), batch);
+}
+
+Status PlanFragmentExecutor::close_sink() {
     // Close the sink *before* stopping the report thread. Close may
     // need to add some important information to the last report that
     // gets sent. (e.g. table sinks record the files they have written
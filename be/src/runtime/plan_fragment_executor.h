@@ -103,6 +103,19 @@ public:
     // time when open() returns, and the status-reporting thread will have been stopped.
     Status open();
 
+    // Pipeline execution (see runtime/pipeline_driver.h) replaces open() for the
+    // fragments a PipelineDriver can run. start_pipeline() starts the report thread,
+    // the driver then opens the plan and the sink itself, hands the output batches to
+    // send_pipeline_batch(), and passes its final status to finish_pipeline(), which
+    // closes the sink and sends the final report like open() does.
+    void start_pipeline();
+    Status send_pipeline_batch(RowBatch* batch);
+    Status finish_pipeline(const Status& exec_status);
+
+    ExecNode* plan() {
+        return _plan;
+    }
+
     // Return results through 'batch'. Sets '*batch' to NULL if no more results.
     // '*batch' is owned by PlanFragmentExecutor and must not be deleted.
     // When *batch == NULL, get_next() should not be called anymore. Also, report_status_cb
@@ -257,6 +270,17 @@ private:
     // have been stopped. _sink will be set to NULL after successful execution.
     Status open_internal();
 
+    void start_report_thread();
+
+    // Logs the error of open() and updates _status.
+    void finish_open(const Status& status);
+
+    // Sends 'batch' to _sink, with the query statistics if requested.
+    Status send_to_sink(RowBatch* batch);
+
+    // Closes _sink after the last batch was sent and sends the final report.
+    Status close_sink();
+
     // Executes get_next() logic and returns resulting status.
     Status get_next_internal(RowBatch** batch);
 
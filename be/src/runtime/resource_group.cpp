@@ -0,0 +1,154 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/resource_group.h"
+
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+
+#include "runtime/mem_tracker.h"
+#include "util/doris_metrics.h"
+#include "util/parse_util.h"
+#include "util/string_parser.hpp"
+
+namespace doris {
+
+static const std::string RESOURCE_GROUP_HOOK_NAME = "resource_groups";
+
+ResourceGroup::ResourceGroup(const std::string& name, int scanner_share,
+                             int64_t scan_bytes_per_second, int64_t mem_limit,
+                             MemTracker* parent_mem_tracker) :
+        _name(name),
+        _scanner_share(new ScannerScheduler::QueryShare(scanner_share)),
+        // allows a burst of one second
+        _scan_bytes_bucket(scan_bytes_per_second, scan_bytes_per_second),
+        _mem_tracker(new MemTracker(mem_limit > 0 ? mem_limit : -1,
+                                    "ResourceGroup:" + name, parent_mem_tracker)) {
+}
+
+ResourceGroup::~ResourceGroup() {
+    if (_registry != nullptr) {
+        _registry->deregister_metric(&_scan_bytes);
+        _registry->deregister_metric(&_scan_throttle_us);
+        _registry->deregister_metric(&_scanner_time_us);
+        _registry->deregister_metric(&_mem_consumption);
+    }
+    if (_mem_tracker->parent() != nullptr) {
+        _mem_tracker->unregister_from_parent();
+    }
+}
+
+int64_t ResourceGroup::consume_scan_bytes(int64_t bytes) {
+    if (bytes <= 0) {
+        return 0;
+    }
+    _scan_bytes.increment(bytes);
+    if (!_scan_bytes_bucket.is_limited()) {
+        return 0;
+    }
+    int64_t wait_ns = _scan_bytes_bucket.acquire(bytes);
+    if (wait_ns > 0) {
+        _scan_throttle_us.increment(wait_ns / 1000);
+    }
+    return wait_ns;
+}
+
+void ResourceGroup::register_metrics(MetricRegistry* registry) {
+    _registry = registry;
+    MetricLabels labels = MetricLabels().add("group", _name);
+    registry->register_metric("resource_group_scan_bytes", labels, &_scan_bytes);
+    registry->register_metric("resource_group_scan_throttle_us", labels, &_scan_throttle_us);
+    registry->register_metric("resource_group_scanner_time_us", labels, &_scanner_time_us);
+    registry->register_metric("resource_group_mem_consumption", labels, &_mem_consumption);
+}
+
+void ResourceGroup::update_metrics() {
+    _scanner_time_us.set_value(_scanner_share->run_time_ns() / 1000);
+    _mem_consumption.set_value(_mem_tracker->consumption());
+}
+
+ResourceGroupMgr::ResourceGroupMgr() {
+}
+
+ResourceGroupMgr::~ResourceGroupMgr() {
+    if (!_groups.empty()) {
+        DorisMetrics::metrics()->deregister_hook(RESOURCE_GROUP_HOOK_NAME);
+    }
+}
+
+Status ResourceGroupMgr::init(const std::string& groups, MemTracker* process_mem_tracker) {
+    std::vector<std::string> group_specs;
+    boost::split(group_specs, groups, boost::is_any_of(";"));
+    for (auto& group_spec : group_specs) {
+        boost::trim(group_spec);
+        if (group_spec.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        boost::split(fields, group_spec, boost::is_any_of(":"));
+        if (fields.size() != 4 || fields[0].empty()) {
+            return Status::InvalidArgument("invalid resource group: " + group_spec);
+        }
+
+        StringParser::ParseResult share_result;
+        int32_t share = StringParser::string_to_int<int32_t>(
+                fields[1].data(), fields[1].size(), &share_result);
+        StringParser::ParseResult rate_result;
+        int64_t scan_bytes_per_second = StringParser::string_to_int<int64_t>(
+                fields[2].data(), fields[2].size(), &rate_result);
+        bool is_percent = false;
+        int64_t mem_limit = ParseUtil::parse_mem_spec(fields[3], &is_percent);
+        if (share_result != StringParser::PARSE_SUCCESS || share <= 0
+                || rate_result != StringParser::PARSE_SUCCESS || mem_limit < 0) {
+            return Status::InvalidArgument("invalid resource group: " + group_spec);
+        }
+        if (_groups.count(fields[0]) > 0) {
+            return Status::InvalidArgument("duplicated resource group: " + fields[0]);
+        }
+
+        std::unique_ptr<ResourceGroup> group(new ResourceGroup(
+                fields[0], share, scan_bytes_per_second, mem_limit, process_mem_tracker));
+        group->register_metrics(DorisMetrics::metrics());
+        LOG(INFO) << "resource group " << fields[0] << ": scanner_share=" << share
+                  << ", scan_bytes_per_second=" << scan_bytes_per_second
+                  << ", mem_limit=" << mem_limit;
+        _groups.emplace(fields[0], std::move(group));
+    }
+
+    if (!_groups.empty()) {
+        DorisMetrics::metrics()->register_hook(
+                RESOURCE_GROUP_HOOK_NAME, std::bind(&ResourceGroupMgr::_update_metrics, this));
+    }
+    return Status::OK();
+}
+
+ResourceGroup* ResourceGroupMgr::get(const std::string& name) {
+    auto it = _groups.find(name);
+    if (it == _groups.end()) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+void ResourceGroupMgr::_update_metrics() {
+    for (auto& it : _groups) {
+        it.second->update_metrics();
+    }
+}
+
+}
@@ -0,0 +1,105 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_RUNTIME_RESOURCE_GROUP_H
+#define DORIS_BE_SRC_RUNTIME_RESOURCE_GROUP_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "common/status.h"
+#include "runtime/scanner_scheduler.h"
+#include "util/metrics.h"
+#include "util/token_bucket.h"
+
+namespace doris {
+
+class MemTracker;
+
+// The queries tagged with the same resource group (query option resource_group)
+// share the quotas of the group on this backend:
+//  - the scanner threads: the scanner tasks of all queries of the group are
+//    scheduled as one share of ScannerScheduler, weighted by 'scanner_share'. A
+//    query without a group has a share of weight 1 of its own.
+//  - the scan bandwidth: the scanners of the group read at most
+//    'scan_bytes_per_second' compressed bytes per second.
+//  - the memory: the query mem trackers of the group are children of the group's
+//    tracker, which is limited to 'mem_limit' bytes.
+class ResourceGroup {
+public:
+    // 'scan_bytes_per_second' and 'mem_limit' <= 0 mean no limit.
+    ResourceGroup(const std::string& name, int scanner_share, int64_t scan_bytes_per_second,
+                  int64_t mem_limit, MemTracker* parent_mem_tracker);
+    ~ResourceGroup();
+
+    const std::string& name() const {
+        return _name;
+    }
+
+    const std::shared_ptr<ScannerScheduler::QueryShare>& scanner_share() const {
+        return _scanner_share;
+    }
+
+    MemTracker* mem_tracker() {
+        return _mem_tracker.get();
+    }
+
+    // Called by the scanners of the group's queries after they read 'bytes'. Returns
+    // how long in nanoseconds the scanner has to wait before it reads on, 0 if the
+    // group isn't over its scan bandwidth. Doesn't wait itself.
+    int64_t consume_scan_bytes(int64_t bytes);
+
+    void register_metrics(MetricRegistry* registry);
+    void update_metrics();
+
+private:
+    std::string _name;
+    std::shared_ptr<ScannerScheduler::QueryShare> _scanner_share;
+    TokenBucket _scan_bytes_bucket;
+    std::unique_ptr<MemTracker> _mem_tracker;
+
+    MetricRegistry* _registry = nullptr;
+    IntCounter _scan_bytes;
+    IntCounter _scan_throttle_us;
+    IntGauge _scanner_time_us;
+    IntGauge _mem_consumption;
+};
+
+// Holds the resource groups defined by config::resource_groups.
+class ResourceGroupMgr {
+public:
+    ResourceGroupMgr();
+    ~ResourceGroupMgr();
+
+    // Parses 'groups', a ';' separated list of
+    //   name:scanner_share:scan_bytes_per_second:mem_limit
+    // where mem_limit is a memory spec like "8G" or "20%".
+    Status init(const std::string& groups, MemTracker* process_mem_tracker);
+
+    // Returns nullptr if there is no group of that name.
+    ResourceGroup* get(const std::string& name);
+
+private:
+    void _update_metrics();
+
+    std::map<std::string, std::unique_ptr<ResourceGroup>> _groups;
+};
+
+}
+
+#endif // DORIS_BE_SRC_RUNTIME_RESOURCE_GROUP_H
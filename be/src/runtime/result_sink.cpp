@@ -26,6 +26,7 @@
 #include "runtime/result_buffer_mgr.h"
 #include "runtime/buffer_control_block.h"
 #include "runtime/result_writer.h"
+#include "runtime/arrow_result_writer.h"
 #include "runtime/mem_tracker.h"
 
 namespace doris {
@@ -35,6 +36,7 @@ ResultSink::ResultSink(const RowDescriptor& row_desc, const std::vector<TExpr>&
     : _row_desc(row_desc),
       _t_output_expr(t_output_expr),
       _buf_size(buffer_size) {
+    _sink_type = sink.__isset.type ? sink.type : TResultSinkType::MYSQL_PROTOCAL;
 }
 
 ResultSink::~ResultSink() {
@@ -59,10 +61,19 @@ Status ResultSink::prepare(RuntimeState* state) {
     // prepare output_expr
     RETURN_IF_ERROR(prepare_exprs(state));
     // create sender
+    int buf_size = _buf_size;
+    if (_sink_type == TResultSinkType::ARROW) {
+        // the buffer counts the rows of TResultBatch, an arrow batch is one row
+        buf_size = std::max(4, _buf_size / state->batch_size());
+    }
     RETURN_IF_ERROR(state->exec_env()->result_mgr()->create_sender(
-                        state->fragment_instance_id(), _buf_size, &_sender));
+                        state->fragment_instance_id(), buf_size, &_sender));
     // create writer
-    _writer.reset(new(std::nothrow) ResultWriter(_sender.get(), _output_expr_ctxs));
+    if (_sink_type == TResultSinkType::ARROW) {
+        _writer.reset(new(std::nothrow) ArrowResultWriter(_sender.get(), _output_expr_ctxs));
+    } else {
+        _writer.reset(new(std::nothrow) ResultWriter(_sender.get(), _output_expr_ctxs));
+    }
     RETURN_IF_ERROR(_writer->init(state));
 
     return Status::OK();
@@ -70,6 +70,7 @@ private:
     std::vector<ExprContext*> _output_expr_ctxs;
 
     boost::shared_ptr<BufferControlBlock> _sender;
+    TResultSinkType::type _sink_type;
     boost::shared_ptr<ResultWriter> _writer;
     RuntimeProfile* _profile; // Allocated from _pool
     int _buf_size; // Allocated from _pool
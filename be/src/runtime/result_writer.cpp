@@ -113,14 +113,9 @@ Status ResultWriter::add_one_row(TupleRow* row) {
         }
 
         case TYPE_DATE:
-        case TYPE_DATETIME: {
-            char buf[64];
-            const DateTimeValue* time_val = (const DateTimeValue*)(item);
-            // TODO(zhaochun), this function has core risk
-            char* pos = time_val->to_string(buf);
-            buf_ret = _row_buffer->push_string(buf, pos - buf - 1);
+        case TYPE_DATETIME:
+            buf_ret = _row_buffer->push_datetime(*static_cast<DateTimeValue*>(item));
             break;
-        }
 
         case TYPE_VARCHAR:
         case TYPE_HLL:
@@ -35,20 +35,22 @@ class RuntimeState;
 class ResultWriter {
 public:
     ResultWriter(BufferControlBlock* sinker, const std::vector<ExprContext*>& output_expr_ctxs);
-    ~ResultWriter();
+    virtual ~ResultWriter();
 
-    Status init(RuntimeState* state);
+    virtual Status init(RuntimeState* state);
     // convert one row batch to mysql result and
     // append this batch to the result sink
-    Status append_row_batch(RowBatch* batch);
+    virtual Status append_row_batch(RowBatch* batch);
+
+protected:
+    // The expressions that are run to create tuples to be written to hbase.
+    BufferControlBlock* _sinker;
+    const std::vector<ExprContext*>& _output_expr_ctxs;
 
 private:
     // convert one tuple row
     Status add_one_row(TupleRow* row);
 
-    // The expressions that are run to create tuples to be written to hbase.
-    BufferControlBlock* _sinker;
-    const std::vector<ExprContext*>& _output_expr_ctxs;
     MysqlRowBuffer* _row_buffer;
 };
 
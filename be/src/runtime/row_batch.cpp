@@ -18,6 +18,8 @@
 #include "runtime/row_batch.h"
 
 #include <stdint.h>  // for intptr_t
+#include <memory>
+#include <sstream>
 #include <snappy/snappy.h>
 
 #include "runtime/exec_env.h"
@@ -28,6 +30,7 @@
 //#include "runtime/mem_tracker.h"
 #include "gen_cpp/Data_types.h"
 #include "gen_cpp/data.pb.h"
+#include "util/block_compression.h"
 #include "util/debug_util.h"
 
 using std::vector;
@@ -96,20 +99,63 @@ RowBatch::RowBatch(const RowDescriptor& row_desc,
     } else {
         _tuple_ptrs = reinterpret_cast<Tuple**>(_tuple_data_pool->allocate(_tuple_ptrs_size));
     }
+}
+
+Status RowBatch::create(const RowDescriptor& row_desc, const PRowBatch& input_batch,
+                        MemTracker* tracker, RowBatch** batch) {
+    std::unique_ptr<RowBatch> row_batch(new RowBatch(row_desc, input_batch, tracker));
+    RETURN_IF_ERROR(row_batch->deserialize(input_batch));
+    *batch = row_batch.release();
+    return Status::OK();
+}
 
+Status RowBatch::deserialize(const PRowBatch& input_batch) {
     uint8_t* tuple_data = nullptr;
-    if (input_batch.is_compressed()) {
+    if (input_batch.is_compressed() && input_batch.has_compression_type()
+            && input_batch.compression_type() != segment_v2::CompressionTypePB::SNAPPY) {
+        // Decompress tuple data into data pool by the codec the sender chose
+        const BlockCompressionCodec* codec = nullptr;
+        Status st = get_block_compression_codec(
+                static_cast<segment_v2::CompressionTypePB>(input_batch.compression_type()),
+                &codec);
+        if (!st.ok() || codec == nullptr) {
+            std::stringstream ss;
+            ss << "unknown row batch compression type " << input_batch.compression_type();
+            return Status::InternalError(ss.str());
+        }
+        if (!input_batch.has_uncompressed_size()) {
+            return Status::InternalError("compressed row batch without uncompressed size");
+        }
+        size_t uncompressed_size = input_batch.uncompressed_size();
+        tuple_data = _tuple_data_pool->allocate(uncompressed_size);
+        Slice uncompressed(tuple_data, uncompressed_size);
+        st = codec->decompress(Slice(input_batch.tuple_data()), &uncompressed);
+        if (!st.ok()) {
+            return Status::InternalError(
+                    "failed to decompress row batch: " + st.get_error_msg());
+        }
+        if (uncompressed.size != uncompressed_size) {
+            std::stringstream ss;
+            ss << "row batch decompressed to " << uncompressed.size
+               << " bytes, expected " << uncompressed_size;
+            return Status::InternalError(ss.str());
+        }
+    } else if (input_batch.is_compressed()) {
         // Decompress tuple data into data pool
         const char* compressed_data = input_batch.tuple_data().c_str();
         size_t compressed_size = input_batch.tuple_data().size();
         size_t uncompressed_size = 0;
         bool success = snappy::GetUncompressedLength(compressed_data, compressed_size,
                        &uncompressed_size);
-        DCHECK(success) << "snappy::GetUncompressedLength failed";
+        if (!success) {
+            return Status::InternalError("snappy::GetUncompressedLength failed");
+        }
         tuple_data = reinterpret_cast<uint8_t*>(_tuple_data_pool->allocate(uncompressed_size));
         success = snappy::RawUncompress(
                 compressed_data, compressed_size, reinterpret_cast<char*>(tuple_data));
-        DCHECK(success) << "snappy::RawUncompress failed";
+        if (!success) {
+            return Status::InternalError("snappy::RawUncompress failed");
+        }
     } else {
         // Tuple data uncompressed, copy directly into data pool
         tuple_data = _tuple_data_pool->allocate(input_batch.tuple_data().size());
@@ -128,7 +174,7 @@ RowBatch::RowBatch(const RowDescriptor& row_desc,
 
     // Check whether we have slots that require offset-to-pointer conversion.
     if (!_row_desc.has_varlen_slots()) {
-        return;
+        return Status::OK();
     }
     const vector<TupleDescriptor*>& tuple_descs = _row_desc.tuple_descriptors();
 
@@ -162,6 +208,7 @@ RowBatch::RowBatch(const RowDescriptor& row_desc,
             }
         }
     }
+    return Status::OK();
 }
 
 // TODO: we want our input_batch's tuple_data to come from our (not yet implemented)
@@ -368,7 +415,8 @@ int RowBatch::serialize(TRowBatch* output_batch) {
     return get_batch_size(*output_batch) - output_batch->tuple_data.size() + size;
 }
 
-int RowBatch::serialize(PRowBatch* output_batch) {
+int RowBatch::serialize(PRowBatch* output_batch,
+                        segment_v2::CompressionTypePB compression_type) {
     // num_rows
     output_batch->set_num_rows(_num_rows);
     // row_tuples
@@ -378,6 +426,8 @@ int RowBatch::serialize(PRowBatch* output_batch) {
     output_batch->mutable_tuple_offsets()->Reserve(_num_rows * _num_tuples_per_row);
     // is_compressed
     output_batch->set_is_compressed(false);
+    output_batch->clear_compression_type();
+    output_batch->clear_uncompressed_size();
     // tuple data
     int size = total_byte_size();
     auto mutable_tuple_data = output_batch->mutable_tuple_data();
@@ -406,27 +456,38 @@ int RowBatch::serialize(PRowBatch* output_batch) {
 
     DCHECK_EQ(offset, size);
 
-    if (config::compress_rowbatches && size > 0) {
+    const BlockCompressionCodec* codec = nullptr;
+    if (config::compress_rowbatches && size > 0
+            && compression_type != segment_v2::CompressionTypePB::NO_COMPRESSION) {
+        Status st = get_block_compression_codec(compression_type, &codec);
+        if (!st.ok()) {
+            LOG(WARNING) << "unsupported row batch compression type " << compression_type
+                         << ", send it uncompressed";
+            codec = nullptr;
+        }
+    }
+    if (codec != nullptr) {
         // Try compressing tuple_data to _compression_scratch, swap if compressed data is
         // smaller
-        int max_compressed_size = snappy::MaxCompressedLength(size);
+        size_t max_compressed_size = codec->max_compressed_len(size);
 
         if (_compression_scratch.size() < max_compressed_size) {
             _compression_scratch.resize(max_compressed_size);
         }
 
-        size_t compressed_size = 0;
-        char* compressed_output = const_cast<char*>(_compression_scratch.c_str());
-        snappy::RawCompress(mutable_tuple_data->data(), size,
-                            compressed_output, &compressed_size);
+        Slice compressed(const_cast<char*>(_compression_scratch.data()),
+                         _compression_scratch.size());
+        Status st = codec->compress(Slice(mutable_tuple_data->data(), size), &compressed);
 
-        if (LIKELY(compressed_size < size)) {
-            _compression_scratch.resize(compressed_size);
+        if (LIKELY(st.ok() && compressed.size < size)) {
+            _compression_scratch.resize(compressed.size);
             mutable_tuple_data->swap(_compression_scratch);
             output_batch->set_is_compressed(true);
+            output_batch->set_compression_type(compression_type);
+            output_batch->set_uncompressed_size(size);
         }
 
-        VLOG_ROW << "uncompressed size: " << size << ", compressed size: " << compressed_size;
+        VLOG_ROW << "uncompressed size: " << size << ", compressed size: " << compressed.size;
     }
 
     // The size output_batch would be if we didn't compress tuple_data (will be equal to
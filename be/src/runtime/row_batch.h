@@ -24,6 +24,7 @@
 
 #include "common/logging.h"
 #include "codegen/doris_ir.h"
+#include "gen_cpp/segment_v2.pb.h"
 #include "runtime/buffered_block_mgr2.h" // for BufferedBlockMgr2::Block
 // #include "runtime/buffered_tuple_stream2.inline.h"
 #include "runtime/bufferpool/buffer_pool.h"
@@ -92,7 +93,10 @@ public:
     // (so that we don't need to make yet another copy)
     RowBatch(const RowDescriptor& row_desc, const TRowBatch& input_batch, MemTracker* tracker);
 
-    RowBatch(const RowDescriptor& row_desc, const PRowBatch& input_batch, MemTracker* tracker);
+    // Populate a row batch from input_batch, as above. Returns an error if the tuple
+    // data of input_batch can't be decompressed, '*batch' is not set then.
+    static Status create(const RowDescriptor& row_desc, const PRowBatch& input_batch,
+                         MemTracker* tracker, RowBatch** batch);
 
     // Releases all resources accumulated at this row batch.  This includes
     //  - tuple_ptrs
@@ -372,7 +376,12 @@ public:
     // Returns the uncompressed serialized size (this will be the true size of output_batch
     // if tuple_data is actually uncompressed).
     int serialize(TRowBatch* output_batch);
-    int serialize(PRowBatch* output_batch);
+    // PRowBatch's tuple_data is compressed by 'compression_type' instead of snappy,
+    // which is recorded in output_batch.compression_type. NO_COMPRESSION leaves the
+    // tuple data as is.
+    int serialize(PRowBatch* output_batch,
+                  segment_v2::CompressionTypePB compression_type =
+                      segment_v2::CompressionTypePB::SNAPPY);
 
     // Utility function: returns total size of batch.
     static int get_batch_size(const TRowBatch& batch);
@@ -431,6 +440,13 @@ private:
     // Close owned tuple streams and delete if needed.
     void close_tuple_streams();
 
+    // Allocates the tuple pointers for the rows of input_batch, deserialize() fills them.
+    RowBatch(const RowDescriptor& row_desc, const PRowBatch& input_batch, MemTracker* tracker);
+
+    // Decompresses the tuple data of input_batch into the data pool and converts the
+    // offsets into pointers.
+    Status deserialize(const PRowBatch& input_batch);
+
     // All members need to be handled in RowBatch::swap()
 
     bool _has_in_flight_row;  // if true, last row hasn't been committed yet
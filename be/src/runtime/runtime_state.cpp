@@ -34,6 +34,7 @@
 #include "runtime/descriptors.h"
 #include "runtime/exec_env.h"
 #include "runtime/initial_reservations.h"
+#include "runtime/resource_group.h"
 #include "runtime/runtime_state.h"
 #include "runtime/load_path_mgr.h"
 #include "util/cpu_info.h"
@@ -216,6 +217,13 @@ Status RuntimeState::init(
     if (exec_env != NULL) {
         _resource_pool = exec_env->thread_mgr()->register_pool();
         DCHECK(_resource_pool != NULL);
+        if (!_query_options.resource_group.empty()) {
+            _resource_group = exec_env->resource_group_mgr()->get(_query_options.resource_group);
+            if (_resource_group == nullptr) {
+                LOG(WARNING) << "unknown resource group " << _query_options.resource_group
+                             << ", fragment_instance_id=" << print_id(fragment_instance_id);
+            }
+        }
     }
     _db_name = "insert_stmt";
     _import_label = print_id(fragment_instance_id);
@@ -233,8 +241,11 @@ Status RuntimeState::init_mem_trackers(const TUniqueId& query_id) {
 
     // _query_mem_tracker = MemTracker::get_query_mem_tracker(
     //         query_id, bytes_limit, _exec_env->process_mem_tracker());
+    // the queries of a resource group are limited by the group's tracker as well
+    MemTracker* parent_mem_tracker = _resource_group != nullptr
+        ? _resource_group->mem_tracker() : _exec_env->process_mem_tracker();
     _query_mem_tracker.reset(
-            new MemTracker(bytes_limit, runtime_profile()->name(), _exec_env->process_mem_tracker()));
+            new MemTracker(bytes_limit, runtime_profile()->name(), parent_mem_tracker));
     _instance_mem_tracker.reset(
             new MemTracker(-1, runtime_profile()->name(), _query_mem_tracker.get()));
 
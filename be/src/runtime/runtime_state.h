@@ -59,6 +59,7 @@ class BufferedBlockMgr2;
 class LoadErrorHub;
 class ReservationTracker;
 class InitialReservations;
+class ResourceGroup;
 class RowDescriptor;
 
 // A collection of items that are part of the global state of a
@@ -139,6 +140,19 @@ public:
     int num_scanner_threads() const {
         return _query_options.num_scanner_threads;
     }
+    int parallel_sort_degree() const {
+        return _query_options.parallel_sort_degree;
+    }
+    const std::string& exchange_compression_codec() const {
+        return _query_options.exchange_compression_codec;
+    }
+    bool enable_pipeline_engine() const {
+        return _query_options.enable_pipeline_engine;
+    }
+    // nullptr if the query isn't tagged with a resource group
+    ResourceGroup* resource_group() const {
+        return _resource_group;
+    }
     int64_t timestamp_ms() const {
         return _timestamp_ms;
     }
@@ -504,6 +518,7 @@ public:
 private:
     // Allow TestEnv to set block_mgr manually for testing.
     friend class TestEnv;
+    friend class MergeSorterTest;
 
     // Use a custom block manager for the query for testing purposes.
     void set_block_mgr(const boost::shared_ptr<BufferedBlockMgr>& block_mgr) {
@@ -557,6 +572,8 @@ private:
     // state is responsible for returning this pool to the thread mgr.
     ThreadResourceMgr::ResourcePool* _resource_pool;
 
+    ResourceGroup* _resource_group = nullptr;
+
     RuntimeProfile _profile;
 
     // all mem limits that apply to this query
@@ -0,0 +1,235 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/scanner_scheduler.h"
+
+#include <chrono>
+
+#include "common/logging.h"
+#include "util/time.h"
+
+namespace doris {
+
+const int64_t ScannerScheduler::QueryShare::INITIAL_TASK_NS;
+
+ScannerScheduler::ScannerScheduler(int num_threads, int max_queued_tasks) :
+        _num_threads(std::max(1, num_threads)),
+        _max_queued_tasks(std::max(1, max_queued_tasks)) {
+    for (int i = 0; i < _num_threads; ++i) {
+        _queues.emplace_back(new WorkerQueue());
+    }
+    for (int i = 0; i < _num_threads; ++i) {
+        _workers.emplace_back(&ScannerScheduler::_work, this, i);
+    }
+    _timer = std::thread(&ScannerScheduler::_submit_due_tasks, this);
+}
+
+ScannerScheduler::~ScannerScheduler() {
+    shutdown();
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+    _timer.join();
+}
+
+std::shared_ptr<ScannerScheduler::QueryShare> ScannerScheduler::register_query(
+        const TUniqueId& query_id) {
+    std::lock_guard<std::mutex> l(_queries_lock);
+    std::shared_ptr<QueryShare> share = _queries[query_id].lock();
+    if (share != nullptr) {
+        return share;
+    }
+    // drop the shares of the finished queries while we're at it
+    for (auto it = _queries.begin(); it != _queries.end();) {
+        if (it->second.expired()) {
+            it = _queries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    share.reset(new QueryShare());
+    _queries[query_id] = share;
+    return share;
+}
+
+bool ScannerScheduler::submit(const std::shared_ptr<QueryShare>& query,
+                              const WorkFunction& work,
+                              RuntimeProfile::Counter* wait_timer) {
+    if (_num_queued.load() >= _max_queued_tasks) {
+        std::unique_lock<std::mutex> l(_lock);
+        _space_cv.wait(l, [this] {
+            return _shutdown || _num_queued.load() < _max_queued_tasks;
+        });
+    }
+
+    Task task;
+    task.query = query;
+    {
+        std::lock_guard<SpinLock> l(query->_lock);
+        task.start_vtime = std::max(query->_finish_vtime, _vtime.load());
+        query->_finish_vtime = task.start_vtime + query->_avg_task_ns / query->_weight;
+    }
+    task.seq = _next_seq.fetch_add(1);
+    task.submit_time_ns = MonotonicNanos();
+    task.work = work;
+    task.wait_timer = wait_timer;
+
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        if (_shutdown) {
+            return false;
+        }
+    }
+    WorkerQueue* queue = _queues[_next_queue.fetch_add(1) % _num_threads].get();
+    {
+        std::lock_guard<SpinLock> l(queue->lock);
+        queue->tasks.push_back(std::move(task));
+        std::push_heap(queue->tasks.begin(), queue->tasks.end());
+    }
+    // Pairs with the idle check of _work(): either the worker sees the task, or
+    // we see the idle worker and wake it up
+    _num_queued.fetch_add(1);
+    if (_num_idle.load() > 0) {
+        std::lock_guard<std::mutex> l(_lock);
+        _work_cv.notify_one();
+    }
+    return true;
+}
+
+bool ScannerScheduler::submit_delayed(const std::shared_ptr<QueryShare>& query,
+                                      const WorkFunction& work, int64_t delay_ns,
+                                      RuntimeProfile::Counter* wait_timer) {
+    if (delay_ns <= 0) {
+        return submit(query, work, wait_timer);
+    }
+    DelayedTask task;
+    task.due_ns = MonotonicNanos() + delay_ns;
+    task.query = query;
+    task.work = work;
+    task.wait_timer = wait_timer;
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        if (_shutdown) {
+            return false;
+        }
+        _delayed_tasks.push_back(std::move(task));
+        std::push_heap(_delayed_tasks.begin(), _delayed_tasks.end());
+    }
+    _delayed_cv.notify_one();
+    return true;
+}
+
+void ScannerScheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> l(_lock);
+        _shutdown = true;
+    }
+    _work_cv.notify_all();
+    _space_cv.notify_all();
+    _delayed_cv.notify_all();
+}
+
+void ScannerScheduler::_submit_due_tasks() {
+    std::unique_lock<std::mutex> l(_lock);
+    while (!_shutdown) {
+        if (_delayed_tasks.empty()) {
+            _delayed_cv.wait(l);
+            continue;
+        }
+        int64_t wait_ns = _delayed_tasks.front().due_ns - MonotonicNanos();
+        if (wait_ns > 0) {
+            _delayed_cv.wait_for(l, std::chrono::nanoseconds(wait_ns));
+            continue;
+        }
+        std::pop_heap(_delayed_tasks.begin(), _delayed_tasks.end());
+        DelayedTask task = std::move(_delayed_tasks.back());
+        _delayed_tasks.pop_back();
+        // submit() takes _lock and may wait for space in the queues
+        l.unlock();
+        submit(task.query, task.work, task.wait_timer);
+        l.lock();
+    }
+}
+
+bool ScannerScheduler::_pop(int queue_id, Task* task) {
+    WorkerQueue* queue = _queues[queue_id].get();
+    std::lock_guard<SpinLock> l(queue->lock);
+    if (queue->tasks.empty()) {
+        return false;
+    }
+    std::pop_heap(queue->tasks.begin(), queue->tasks.end());
+    *task = std::move(queue->tasks.back());
+    queue->tasks.pop_back();
+    return true;
+}
+
+bool ScannerScheduler::_take(int worker_id, Task* task) {
+    for (int i = 0; i < _num_threads; ++i) {
+        if (_pop((worker_id + i) % _num_threads, task)) {
+            if (_num_queued.fetch_sub(1) == _max_queued_tasks) {
+                std::lock_guard<std::mutex> l(_lock);
+                _space_cv.notify_all();
+            }
+            // the virtual time only moves forward
+            int64_t vtime = _vtime.load();
+            while (vtime < task->start_vtime
+                    && !_vtime.compare_exchange_weak(vtime, task->start_vtime)) {
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScannerScheduler::_work(int worker_id) {
+    while (true) {
+        Task task;
+        if (_take(worker_id, &task)) {
+            _run(&task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> l(_lock);
+        _num_idle.fetch_add(1);
+        while (!_shutdown && _num_queued.load() == 0) {
+            _work_cv.wait(l);
+        }
+        _num_idle.fetch_sub(1);
+        if (_shutdown) {
+            return;
+        }
+    }
+}
+
+void ScannerScheduler::_run(Task* task) {
+    int64_t start_ns = MonotonicNanos();
+    if (task->wait_timer != nullptr) {
+        COUNTER_UPDATE(task->wait_timer, start_ns - task->submit_time_ns);
+    }
+
+    task->work();
+
+    int64_t run_ns = MonotonicNanos() - start_ns;
+    QueryShare* query = task->query.get();
+    query->_run_time_ns.fetch_add(run_ns);
+    {
+        std::lock_guard<SpinLock> l(query->_lock);
+        query->_avg_task_ns = (query->_avg_task_ns * 7 + run_ns) / 8;
+    }
+}
+
+}
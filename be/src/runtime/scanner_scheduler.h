@@ -0,0 +1,180 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_RUNTIME_SCANNER_SCHEDULER_H
+#define DORIS_BE_SRC_RUNTIME_SCANNER_SCHEDULER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "gen_cpp/Types_types.h"
+#include "util/hash_util.hpp"
+#include "util/runtime_profile.h"
+#include "util/spinlock.h"
+
+namespace doris {
+
+// Runs the scanner tasks of all queries on a fixed set of worker threads.
+//
+// Every worker has a queue of its own, tasks are spread over the queues round robin
+// and an idle worker steals from the queues of the others, so there is no lock all
+// workers contend on.
+//
+// Queries get an equal share of the workers by start-time fair queuing: every query
+// advances a virtual clock by the expected run time of each task it queues, and the
+// workers run the task with the smallest virtual start time first. A query which
+// didn't queue anything for a while starts at the current virtual time instead of
+// the time it stopped at, so a short query gets its share at once but can't build up
+// credit while it's idle.
+class ScannerScheduler {
+public:
+    typedef std::function<void ()> WorkFunction;
+
+    // The scan share of a query, shared by all its scan nodes on this backend, or
+    // of a resource group, shared by all its queries. A share of weight 2 gets twice
+    // the scan time of a share of weight 1.
+    class QueryShare {
+    public:
+        explicit QueryShare(int weight = 1) : _weight(std::max(1, weight)) {}
+
+        // total time the tasks of the query ran
+        int64_t run_time_ns() const {
+            return _run_time_ns.load();
+        }
+
+    private:
+        friend class ScannerScheduler;
+
+        const int _weight;
+        SpinLock _lock;
+        // virtual finish time of the task queued last
+        int64_t _finish_vtime = 0;
+        // moving average of the run time of the query's tasks
+        int64_t _avg_task_ns = INITIAL_TASK_NS;
+        std::atomic<int64_t> _run_time_ns {0};
+
+        static const int64_t INITIAL_TASK_NS = 1000L * 1000L;
+    };
+
+    ScannerScheduler(int num_threads, int max_queued_tasks);
+    ~ScannerScheduler();
+
+    // Returns the share of the query, which is created with the first call.
+    std::shared_ptr<QueryShare> register_query(const TUniqueId& query_id);
+
+    // Queue 'work' on behalf of 'query'. Blocks while 'max_queued_tasks' are queued.
+    // 'wait_timer', if not null, is updated with the time the task was queued.
+    // Returns false if the scheduler is shut down.
+    bool submit(const std::shared_ptr<QueryShare>& query, const WorkFunction& work,
+                RuntimeProfile::Counter* wait_timer);
+
+    // Like submit(), but 'work' is queued after 'delay_ns' by a timer thread, so a task
+    // which has to wait, e.g. for the scan bandwidth of its resource group, doesn't
+    // hold a worker meanwhile. Doesn't block.
+    bool submit_delayed(const std::shared_ptr<QueryShare>& query, const WorkFunction& work,
+                        int64_t delay_ns, RuntimeProfile::Counter* wait_timer);
+
+    // Stops the workers once they finished their current tasks, tasks still queued
+    // or delayed are dropped.
+    void shutdown();
+
+    int64_t num_queued_tasks() const {
+        return _num_queued.load();
+    }
+
+private:
+    struct Task {
+        std::shared_ptr<QueryShare> query;
+        int64_t start_vtime;
+        // breaks ties of the start time in the order of submission
+        int64_t seq;
+        int64_t submit_time_ns;
+        WorkFunction work;
+        RuntimeProfile::Counter* wait_timer;
+
+        // for a min heap on the start time
+        bool operator<(const Task& o) const {
+            if (start_vtime != o.start_vtime) {
+                return start_vtime > o.start_vtime;
+            }
+            return seq > o.seq;
+        }
+    };
+
+    struct DelayedTask {
+        int64_t due_ns;
+        std::shared_ptr<QueryShare> query;
+        WorkFunction work;
+        RuntimeProfile::Counter* wait_timer;
+
+        // for a min heap on the due time
+        bool operator<(const DelayedTask& o) const {
+            return due_ns > o.due_ns;
+        }
+    };
+
+    struct WorkerQueue {
+        SpinLock lock;
+        // binary heap, see Task::operator<
+        std::vector<Task> tasks;
+    };
+
+    void _work(int worker_id);
+    bool _pop(int queue_id, Task* task);
+    // pops from the worker's own queue first, then from the others
+    bool _take(int worker_id, Task* task);
+    void _run(Task* task);
+    // the timer thread, submits the delayed tasks once they are due
+    void _submit_due_tasks();
+
+    const int _num_threads;
+    const int _max_queued_tasks;
+
+    std::vector<std::unique_ptr<WorkerQueue>> _queues;
+    std::atomic<uint32_t> _next_queue {0};
+    std::atomic<int64_t> _next_seq {0};
+    std::atomic<int64_t> _num_queued {0};
+    std::atomic<int> _num_idle {0};
+    // start time of the latest task taken by a worker
+    std::atomic<int64_t> _vtime {0};
+
+    // Workers without tasks and submitters waiting for space sleep on _lock
+    std::mutex _lock;
+    std::condition_variable _work_cv;
+    std::condition_variable _space_cv;
+    bool _shutdown = false;
+    // binary heap, see DelayedTask::operator<, guarded by _lock
+    std::vector<DelayedTask> _delayed_tasks;
+    std::condition_variable _delayed_cv;
+
+    std::mutex _queries_lock;
+    std::unordered_map<TUniqueId, std::weak_ptr<QueryShare>> _queries;
+
+    std::vector<std::thread> _workers;
+    std::thread _timer;
+};
+
+}
+
+#endif // DORIS_BE_SRC_RUNTIME_SCANNER_SCHEDULER_H
@@ -28,6 +28,7 @@
 #include "runtime/sorted_run_merger.h"
 #include "util/runtime_profile.h"
 #include "util/debug_util.h"
+#include "util/sort_key_normalizer.h"
 
 using std::deque;
 using std::string;
@@ -243,6 +244,8 @@ private:
 // Quick sort is used for sequences of tuples larger that 16 elements, and insertion sort
 // is used for smaller sequences. The TupleSorter is initialized with a RuntimeState
 // instance to check for cancellation during an in-memory sort.
+// If the first sort expr can be normalized into a memcomparable prefix, the tuples are
+// sorted by SortKeyNormalizer instead.
 class SpillSorter::TupleSorter {
 public:
     TupleSorter(const TupleRowComparator& less_than_comp, int64_t block_size,
@@ -348,6 +351,9 @@ private:
     // Tuple comparator that returns true if lhs < rhs.
     const TupleRowComparator _less_than_comp;
 
+    // Normalized key sorter built from _less_than_comp.
+    const SortKeyNormalizer _normalizer;
+
     // Runtime state instance to check for cancellation. Not owned.
     RuntimeState* const _state;
 
@@ -876,6 +882,7 @@ SpillSorter::TupleSorter::TupleSorter(
         _block_capacity(block_size / tuple_size),
         _last_tuple_block_offset(tuple_size * ((block_size / tuple_size) - 1)),
         _less_than_comp(comp),
+        _normalizer(_less_than_comp),
         _state(state) {
     _temp_tuple_buffer = new uint8_t[tuple_size];
     _temp_tuple_row = reinterpret_cast<TupleRow*>(&_temp_tuple_buffer);
@@ -889,7 +896,15 @@ SpillSorter::TupleSorter::~TupleSorter() {
 
 void SpillSorter::TupleSorter::sort(Run* run) {
     _run = run;
-    sort_helper(TupleIterator(this, 0), TupleIterator(this, _run->_num_tuples));
+    if (_normalizer.is_supported() && _run->_num_tuples > INSERTION_THRESHOLD) {
+        vector<uint8_t*> blocks;
+        for (auto block : _run->_fixed_len_blocks) {
+            blocks.push_back(block->buffer());
+        }
+        _normalizer.sort_tuples(blocks, _block_capacity, _tuple_size, _run->_num_tuples, _state);
+    } else {
+        sort_helper(TupleIterator(this, 0), TupleIterator(this, _run->_num_tuples));
+    }
     run->_is_sorted = true;
 }
 
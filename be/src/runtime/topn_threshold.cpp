@@ -0,0 +1,107 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/topn_threshold.h"
+
+#include <stdio.h>
+
+#include <limits>
+#include <mutex>
+
+#include "runtime/descriptors.h"
+#include "runtime/raw_value.h"
+#include "runtime/string_value.h"
+#include "runtime/tuple.h"
+
+namespace doris {
+
+void TopNThreshold::update(const void* value) {
+    std::string filter_value;
+    if (_type.type == TYPE_FLOAT || _type.type == TYPE_DOUBLE) {
+        // print_value() only keeps 6 significant digits, a rounded bound would
+        // prune pages holding rows of the result. The float is printed as the
+        // double it converts to exactly, storage parses bounds with atof().
+        double d = _type.type == TYPE_FLOAT
+                ? *reinterpret_cast<const float*>(value)
+                : *reinterpret_cast<const double*>(value);
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*g", std::numeric_limits<double>::max_digits10, d);
+        filter_value = buf;
+    } else {
+        RawValue::print_value(value, _type, -1, &filter_value);
+    }
+    std::string raw_value;
+    if (_type.is_string_type()) {
+        const StringValue* sv = reinterpret_cast<const StringValue*>(value);
+        raw_value.assign(sv->ptr, sv->len);
+    } else {
+        raw_value.assign(reinterpret_cast<const char*>(value), _type.get_slot_size());
+    }
+
+    std::lock_guard<SpinLock> l(_lock);
+    _filter_value.swap(filter_value);
+    _raw_value.swap(raw_value);
+    _version.fetch_add(1, std::memory_order_release);
+}
+
+bool TopNThreshold::get_condition(TCondition* condition) const {
+    std::lock_guard<SpinLock> l(_lock);
+    if (_version.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+    condition->__set_column_name(_column_name);
+    condition->__set_condition_op(_is_asc ? "<=" : ">=");
+    condition->condition_values.clear();
+    condition->condition_values.push_back(_filter_value);
+    return true;
+}
+
+int64_t TopNThreshold::get_value(std::string* buf) const {
+    std::lock_guard<SpinLock> l(_lock);
+    int64_t version = _version.load(std::memory_order_relaxed);
+    if (version == 0) {
+        return 0;
+    }
+    if (_type.is_string_type()) {
+        buf->resize(sizeof(StringValue) + _raw_value.size());
+        char* payload = &(*buf)[sizeof(StringValue)];
+        memcpy(payload, _raw_value.data(), _raw_value.size());
+        StringValue sv(payload, _raw_value.size());
+        memcpy(&(*buf)[0], &sv, sizeof(StringValue));
+    } else {
+        *buf = _raw_value;
+    }
+    return version;
+}
+
+bool TopNThresholdChecker::is_beyond(const Tuple* tuple) {
+    int64_t version = _threshold->version();
+    if (version == 0) {
+        return false;
+    }
+    if (version != _version) {
+        _version = _threshold->get_value(&_value);
+    }
+    if (tuple->is_null(_slot->null_indicator_offset())) {
+        return true;
+    }
+    int cmp = RawValue::compare(tuple->get_slot(_slot->tuple_offset()), _value.data(),
+                                _slot->type());
+    return _threshold->is_asc() ? cmp > 0 : cmp < 0;
+}
+
+} // namespace doris
@@ -0,0 +1,116 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_RUNTIME_TOPN_THRESHOLD_H
+#define DORIS_BE_SRC_RUNTIME_TOPN_THRESHOLD_H
+
+#include <atomic>
+#include <string>
+
+#include "gen_cpp/PaloInternalService_types.h"
+#include "runtime/types.h"
+#include "util/spinlock.h"
+
+namespace doris {
+
+class SlotDescriptor;
+class Tuple;
+
+// The value of the first sort column at the top of a full TopN heap, shared
+// between a TopNNode and the OlapScanNode directly below it.
+//
+// Once the heap holds offset + limit rows, a row whose first sort column sorts
+// after the heap top can never enter the result. Scanners use the bound to
+// drop such rows before materializing them, and every segment opened after an
+// update prunes the pages whose zone maps lie entirely beyond it. The TopN
+// node only ever tightens the bound.
+//
+// The bound is inclusive: rows equal to it may still win on the following
+// sort columns.
+class TopNThreshold {
+public:
+    TopNThreshold(const std::string& column_name, const TypeDescriptor& type, bool is_asc)
+        : _column_name(column_name), _type(type), _is_asc(is_asc), _version(0) { }
+
+    // Return true if a bound on a sort column with these properties can be
+    // pushed down: a full heap of non-null rows doesn't exclude nulls which
+    // sort first.
+    static bool can_bound(bool nulls_first, bool is_nullable) {
+        return !nulls_first || !is_nullable;
+    }
+
+    // Return true if storage, which returns keys ascending with nulls first,
+    // produces the rows in the order of a sort column with these properties.
+    static bool in_storage_order(bool is_asc, bool nulls_first, bool is_nullable) {
+        return is_asc && (nulls_first || !is_nullable);
+    }
+
+    const std::string& column_name() const { return _column_name; }
+    const TypeDescriptor& type() const { return _type; }
+    bool is_asc() const { return _is_asc; }
+
+    // Increases on every update, 0 means nothing was published yet.
+    int64_t version() const { return _version.load(std::memory_order_acquire); }
+
+    // Publish the slot value 'value' of type type() as the new bound.
+    void update(const void* value);
+
+    // Fill 'condition' with "column <= bound", or ">=" for descending order.
+    // Return false if nothing was published yet.
+    bool get_condition(TCondition* condition) const;
+
+    // Copy the current bound into 'buf' in slot layout, string values are
+    // copied behind the StringValue header and pointed to by it. Return the
+    // version of the copied bound, 0 if nothing was published yet.
+    int64_t get_value(std::string* buf) const;
+
+private:
+    const std::string _column_name;
+    const TypeDescriptor _type;
+    const bool _is_asc;
+
+    mutable SpinLock _lock;
+    std::atomic<int64_t> _version;
+    // the bound as olap filter string, used to build storage conditions
+    std::string _filter_value;
+    // raw bytes of the bound, string payload for string types
+    std::string _raw_value;
+};
+
+// A scanner's view of a TopNThreshold. It keeps a copy of the bound and only
+// takes the lock of the threshold when the version changed.
+class TopNThresholdChecker {
+public:
+    TopNThresholdChecker(const TopNThreshold* threshold, const SlotDescriptor* slot)
+        : _threshold(threshold), _slot(slot), _version(0) { }
+
+    // Return true if the row in 'tuple' sorts after the bound, so it can't be
+    // part of the result. Nulls sort after any bound, since the bound is only
+    // pushed down if nulls sort last.
+    bool is_beyond(const Tuple* tuple);
+
+private:
+    const TopNThreshold* _threshold;
+    const SlotDescriptor* _slot;
+    // local copy of the bound in slot layout and its version
+    std::string _value;
+    int64_t _version;
+};
+
+} // namespace doris
+
+#endif // DORIS_BE_SRC_RUNTIME_TOPN_THRESHOLD_H
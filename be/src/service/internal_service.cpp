@@ -49,8 +49,9 @@ void PInternalServiceImpl<T>::transmit_data(google::protobuf::RpcController* cnt
                                          google::protobuf::Closure* done) {
     VLOG_ROW << "transmit data: fragment_instance_id=" << print_id(request->finst_id())
             << " node=" << request->node_id();
-    _exec_env->stream_mgr()->transmit_data(request, &done);
+    auto st = _exec_env->stream_mgr()->transmit_data(request, &done);
     if (done != nullptr) {
+        st.to_protobuf(response->mutable_status());
         done->Run();
     }
 }
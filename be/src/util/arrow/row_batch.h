@@ -27,6 +27,7 @@
 
 namespace arrow {
 
+class DataType;
 class MemoryPool;
 class RecordBatch;
 class Schema;
@@ -39,6 +40,11 @@ class MemTracker;
 class ObjectPool;
 class RowBatch;
 class RowDescriptor;
+struct TypeDescriptor;
+
+// Convert Doris type to Arrow type.
+Status convert_to_arrow_type(const TypeDescriptor& type,
+                             std::shared_ptr<arrow::DataType>* result);
 
 // Convert Doris RowDescriptor to Arrow Schema.
 Status convert_to_arrow_schema(
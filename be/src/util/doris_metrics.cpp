@@ -46,6 +46,9 @@ IntCounter DorisMetrics::push_requests_fail_total;
 IntCounter DorisMetrics::push_request_duration_us;
 IntCounter DorisMetrics::push_request_write_bytes;
 IntCounter DorisMetrics::push_request_write_rows;
+IntCounter DorisMetrics::clone_download_bytes;
+IntCounter DorisMetrics::tablet_map_lock_contended_total;
+IntCounter DorisMetrics::tablet_map_lock_wait_us;
 IntCounter DorisMetrics::create_tablet_requests_total;
 IntCounter DorisMetrics::create_tablet_requests_failed;
 IntCounter DorisMetrics::drop_tablet_requests_total;
@@ -80,6 +83,10 @@ IntCounter DorisMetrics::cumulative_compaction_deltas_total;
 IntCounter DorisMetrics::cumulative_compaction_bytes_total;
 IntCounter DorisMetrics::cumulative_compaction_request_total;
 IntCounter DorisMetrics::cumulative_compaction_request_failed;
+IntCounter DorisMetrics::num_based_load_bytes;
+IntCounter DorisMetrics::num_based_compaction_write_bytes;
+IntCounter DorisMetrics::size_tiered_load_bytes;
+IntCounter DorisMetrics::size_tiered_compaction_write_bytes;
 
 IntCounter DorisMetrics::publish_task_request_total;
 IntCounter DorisMetrics::publish_task_failed_total;
@@ -161,6 +168,9 @@ void DorisMetrics::initialize(
     REGISTER_DORIS_METRIC(push_request_duration_us);
     REGISTER_DORIS_METRIC(push_request_write_bytes);
     REGISTER_DORIS_METRIC(push_request_write_rows);
+    REGISTER_DORIS_METRIC(clone_download_bytes);
+    REGISTER_DORIS_METRIC(tablet_map_lock_contended_total);
+    REGISTER_DORIS_METRIC(tablet_map_lock_wait_us);
 
 #define REGISTER_ENGINE_REQUEST_METRIC(type, status, metric) \
     _metrics->register_metric( \
@@ -212,6 +222,18 @@ void DorisMetrics::initialize(
     _metrics->register_metric(
         "compaction_bytes_total", MetricLabels().add("type", "cumulative"),
         &cumulative_compaction_bytes_total);
+    _metrics->register_metric(
+        "compaction_policy_load_bytes", MetricLabels().add("policy", "num_based"),
+        &num_based_load_bytes);
+    _metrics->register_metric(
+        "compaction_policy_write_bytes", MetricLabels().add("policy", "num_based"),
+        &num_based_compaction_write_bytes);
+    _metrics->register_metric(
+        "compaction_policy_load_bytes", MetricLabels().add("policy", "size_tiered"),
+        &size_tiered_load_bytes);
+    _metrics->register_metric(
+        "compaction_policy_write_bytes", MetricLabels().add("policy", "size_tiered"),
+        &size_tiered_compaction_write_bytes);
 
     _metrics->register_metric(
         "meta_request_total", MetricLabels().add("type", "write"),
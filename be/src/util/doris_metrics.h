@@ -63,6 +63,10 @@ public:
     static IntCounter push_request_duration_us;
     static IntCounter push_request_write_bytes;
     static IntCounter push_request_write_rows;
+    static IntCounter clone_download_bytes;
+    // the times a tablet map shard lock was contended and how long it was waited for
+    static IntCounter tablet_map_lock_contended_total;
+    static IntCounter tablet_map_lock_wait_us;
     static IntCounter create_tablet_requests_total;
     static IntCounter create_tablet_requests_failed;
     static IntCounter drop_tablet_requests_total;
@@ -99,6 +103,13 @@ public:
     static IntCounter cumulative_compaction_deltas_total;
     static IntCounter cumulative_compaction_bytes_total;
 
+    // the bytes published into the tablets of each cumulative compaction policy and
+    // the bytes compaction wrote for them, their ratio is the write amplification
+    static IntCounter num_based_load_bytes;
+    static IntCounter num_based_compaction_write_bytes;
+    static IntCounter size_tiered_load_bytes;
+    static IntCounter size_tiered_compaction_write_bytes;
+
     static IntCounter publish_task_request_total;
     static IntCounter publish_task_failed_total;
 
@@ -0,0 +1,382 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_UTIL_FLAT_HASH_SET_H
+#define DORIS_BE_SRC_UTIL_FLAT_HASH_SET_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "gutil/strings/fastmem.h"
+#include "util/hash_util.hpp"
+#include "util/slice.h"
+
+namespace doris {
+
+// Hash functor for fixed width keys. Every 8-byte word of the key is folded in
+// with the murmur3 finalizer, which is much cheaper than hashing the key as a
+// byte array and still spreads sequential ids well over a power-of-two table.
+template <typename T>
+struct FlatHashSetHash {
+    uint64_t operator()(const T& key) const {
+        uint64_t words[(sizeof(T) + 7) / 8] = {0};
+        memcpy(words, &key, sizeof(T));
+        uint64_t h = 0;
+        for (size_t i = 0; i < sizeof(words) / sizeof(uint64_t); ++i) {
+            h = mix(h ^ words[i]);
+        }
+        return h;
+    }
+
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+// An open addressing hash set with linear probing for fixed width, trivially
+// copyable keys (integers, floating points, __int128). Keys are stored inline in
+// one flat array, so insert and lookup touch a single cache line in the common
+// case instead of chasing the node pointers of std::unordered_set.
+//
+// Keys are compared by their bit pattern. The all-zero pattern marks an empty
+// slot, so the zero key is tracked by a separate flag.
+//
+// Not thread safe.
+template <typename T, typename Hash = FlatHashSetHash<T> >
+class FlatHashSet {
+public:
+    FlatHashSet() : _capacity(0), _num_slots_used(0), _has_zero(false) { }
+
+    // Return true if 'key' was not in the set before.
+    bool insert(const T& key) {
+        if (_is_zero(key)) {
+            if (_has_zero) {
+                return false;
+            }
+            _has_zero = true;
+            return true;
+        }
+        if ((_num_slots_used + 1) * 2 > _capacity) {
+            _resize(_capacity == 0 ? INITIAL_CAPACITY : _capacity * 2);
+        }
+        size_t idx = _probe(key);
+        if (!_is_zero(_slots[idx])) {
+            return false;
+        }
+        _slots[idx] = key;
+        ++_num_slots_used;
+        return true;
+    }
+
+    bool contains(const T& key) const {
+        if (_is_zero(key)) {
+            return _has_zero;
+        }
+        if (_capacity == 0) {
+            return false;
+        }
+        return !_is_zero(_slots[_probe(key)]);
+    }
+
+    // Make room for 'n' keys without rehashing.
+    void reserve(size_t n) {
+        size_t capacity = _capacity == 0 ? INITIAL_CAPACITY : _capacity;
+        while (n * 2 > capacity) {
+            capacity *= 2;
+        }
+        if (capacity > _capacity) {
+            _resize(capacity);
+        }
+    }
+
+    void clear() {
+        _slots.reset();
+        _capacity = 0;
+        _num_slots_used = 0;
+        _has_zero = false;
+    }
+
+    size_t size() const { return _num_slots_used + (_has_zero ? 1 : 0); }
+
+    bool empty() const { return size() == 0; }
+
+    // Bytes allocated for the slot array.
+    size_t memory_usage() const { return _capacity * sizeof(T); }
+
+    // Call 'func(key)' for every key in the set, in unspecified order.
+    template <typename Func>
+    void for_each(Func func) const {
+        if (_has_zero) {
+            func(T());
+        }
+        for (size_t i = 0; i < _capacity; ++i) {
+            if (!_is_zero(_slots[i])) {
+                func(_slots[i]);
+            }
+        }
+    }
+
+private:
+    static const size_t INITIAL_CAPACITY = 16;
+
+    static bool _is_zero(const T& key) {
+        static const T zero = T();
+        return memcmp(&key, &zero, sizeof(T)) == 0;
+    }
+
+    // Return the slot holding 'key', or the empty slot where it would be inserted.
+    size_t _probe(const T& key) const {
+        size_t mask = _capacity - 1;
+        size_t idx = _hash(key) & mask;
+        while (!_is_zero(_slots[idx]) && memcmp(&_slots[idx], &key, sizeof(T)) != 0) {
+            idx = (idx + 1) & mask;
+        }
+        return idx;
+    }
+
+    void _resize(size_t new_capacity) {
+        std::unique_ptr<T[]> old_slots(std::move(_slots));
+        size_t old_capacity = _capacity;
+        // value-initialization zeroes every slot
+        _slots.reset(new T[new_capacity]());
+        _capacity = new_capacity;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (!_is_zero(old_slots[i])) {
+                _slots[_probe(old_slots[i])] = old_slots[i];
+            }
+        }
+    }
+
+    Hash _hash;
+    std::unique_ptr<T[]> _slots;
+    // always zero or a power of two
+    size_t _capacity;
+    // number of non-zero keys in _slots
+    size_t _num_slots_used;
+    bool _has_zero;
+};
+
+// An open addressing hash set of byte strings. Inserted keys are copied into
+// an arena owned by the set and each slot caches the hash of its key, so
+// probing only compares the bytes of keys whose hashes match, and growing the
+// table never rehashes the strings.
+//
+// Callers that probe the same key against several sets, or that already have
+// the hash at hand, can pass it in via the '*_with_hash' methods; it must be
+// computed by FlatStringSet::hash().
+//
+// Not thread safe.
+class FlatStringSet {
+private:
+    // data == nullptr marks an empty slot
+    struct Entry {
+        const char* data;
+        uint32_t size;
+        uint32_t hash;
+    };
+
+public:
+    FlatStringSet()
+        : _capacity(0), _size(0), _arena_pos(nullptr), _arena_remain(0), _arena_bytes(0) { }
+
+    static uint32_t hash(const Slice& key) {
+        return HashUtil::hash(key.data, key.size, HASH_SEED);
+    }
+
+    // Return true if 'key' was not in the set before.
+    bool insert(const Slice& key) {
+        return insert_with_hash(key, hash(key));
+    }
+
+    // If 'stored_key' is not null, it is set to the copy of 'key' held by the
+    // set, which stays valid for the lifetime of the set.
+    bool insert_with_hash(const Slice& key, uint32_t hash, Slice* stored_key = nullptr) {
+        if ((_size + 1) * 2 > _capacity) {
+            _resize(_capacity == 0 ? INITIAL_CAPACITY : _capacity * 2);
+        }
+        Entry& entry = _slots[_probe(key, hash)];
+        bool inserted = false;
+        if (entry.data == nullptr) {
+            entry.data = _copy_to_arena(key);
+            entry.size = key.size;
+            entry.hash = hash;
+            ++_size;
+            inserted = true;
+        }
+        if (stored_key != nullptr) {
+            *stored_key = Slice(entry.data, entry.size);
+        }
+        return inserted;
+    }
+
+    bool contains(const Slice& key) const {
+        return contains_with_hash(key, hash(key));
+    }
+
+    bool contains_with_hash(const Slice& key, uint32_t hash) const {
+        if (_capacity == 0) {
+            return false;
+        }
+        return _slots[_probe(key, hash)].data != nullptr;
+    }
+
+    void reserve(size_t n) {
+        size_t capacity = _capacity == 0 ? INITIAL_CAPACITY : _capacity;
+        while (n * 2 > capacity) {
+            capacity *= 2;
+        }
+        if (capacity > _capacity) {
+            _resize(capacity);
+        }
+    }
+
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    // Bytes allocated for the slot array and the key arena.
+    size_t memory_usage() const { return _capacity * sizeof(Entry) + _arena_bytes; }
+
+    // Call 'func(const Slice& key)' for every key in the set, in unspecified order.
+    // The slices point into the arena of this set.
+    template <typename Func>
+    void for_each(Func func) const {
+        for (size_t i = 0; i < _capacity; ++i) {
+            const Entry& entry = _slots[i];
+            if (entry.data != nullptr) {
+                func(Slice(entry.data, entry.size));
+            }
+        }
+    }
+
+    // Forward iterator over the keys, in unspecified order. It is invalidated
+    // by any insert.
+    class Iterator {
+    public:
+        explicit Iterator(const FlatStringSet* set) : _set(set), _idx(0) {
+            _skip_empty();
+        }
+
+        bool valid() const { return _idx < _set->_capacity; }
+
+        Slice get() const {
+            const Entry& entry = _set->_slots[_idx];
+            return Slice(entry.data, entry.size);
+        }
+
+        void next() {
+            ++_idx;
+            _skip_empty();
+        }
+
+    private:
+        void _skip_empty() {
+            while (_idx < _set->_capacity && _set->_slots[_idx].data == nullptr) {
+                ++_idx;
+            }
+        }
+
+        const FlatStringSet* _set;
+        size_t _idx;
+    };
+
+    Iterator begin() const { return Iterator(this); }
+
+private:
+    static const size_t INITIAL_CAPACITY = 16;
+    static const size_t MIN_ARENA_CHUNK_SIZE = 4096;
+    static const size_t MAX_ARENA_CHUNK_SIZE = 1024 * 1024;
+    static const uint32_t HASH_SEED = 0;
+
+    size_t _probe(const Slice& key, uint32_t hash) const {
+        size_t mask = _capacity - 1;
+        size_t idx = FlatHashSetHash<uint32_t>::mix(hash) & mask;
+        while (true) {
+            const Entry& entry = _slots[idx];
+            if (entry.data == nullptr
+                    || (entry.hash == hash && entry.size == key.size
+                        && strings::memeq(entry.data, key.data, key.size))) {
+                return idx;
+            }
+            idx = (idx + 1) & mask;
+        }
+    }
+
+    void _resize(size_t new_capacity) {
+        std::unique_ptr<Entry[]> old_slots(std::move(_slots));
+        size_t old_capacity = _capacity;
+        _slots.reset(new Entry[new_capacity]());
+        _capacity = new_capacity;
+        size_t mask = _capacity - 1;
+        for (size_t i = 0; i < old_capacity; ++i) {
+            const Entry& entry = old_slots[i];
+            if (entry.data == nullptr) {
+                continue;
+            }
+            // keys are unique, so the first empty slot is the right one
+            size_t idx = FlatHashSetHash<uint32_t>::mix(entry.hash) & mask;
+            while (_slots[idx].data != nullptr) {
+                idx = (idx + 1) & mask;
+            }
+            _slots[idx] = entry;
+        }
+    }
+
+    const char* _copy_to_arena(const Slice& key) {
+        if (key.size == 0) {
+            // any non-null pointer will do for the empty string
+            static const char empty = '\0';
+            return &empty;
+        }
+        if (key.size > _arena_remain) {
+            size_t chunk_size = std::max(key.size,
+                    std::min(std::max(_arena_bytes, (size_t)MIN_ARENA_CHUNK_SIZE),
+                             (size_t)MAX_ARENA_CHUNK_SIZE));
+            _arena_chunks.emplace_back(new char[chunk_size]);
+            _arena_pos = _arena_chunks.back().get();
+            _arena_remain = chunk_size;
+            _arena_bytes += chunk_size;
+        }
+        char* dst = _arena_pos;
+        memcpy(dst, key.data, key.size);
+        _arena_pos += key.size;
+        _arena_remain -= key.size;
+        return dst;
+    }
+
+    std::unique_ptr<Entry[]> _slots;
+    // always zero or a power of two
+    size_t _capacity;
+    size_t _size;
+
+    std::vector<std::unique_ptr<char[]> > _arena_chunks;
+    char* _arena_pos;
+    size_t _arena_remain;
+    size_t _arena_bytes;
+};
+
+} // namespace doris
+
+#endif // DORIS_BE_SRC_UTIL_FLAT_HASH_SET_H
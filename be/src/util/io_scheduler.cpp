@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/io_scheduler.h"
+
+#include <algorithm>
+
+#include "common/config.h"
+#include "common/logging.h"
+
+namespace doris {
+
+// too few foreground reads tell nothing about their cost
+static const int64_t MIN_TUNE_FOREGROUND_BYTES = 1024 * 1024;
+// the rate isn't tuned below this fraction of the configured one
+static const int64_t MIN_RATE_DIVISOR = 16;
+// the rate goes back up by this fraction of the configured one per tune()
+static const int64_t RATE_STEP_DIVISOR = 8;
+
+static __thread IOScheduler* t_io_scheduler = nullptr;
+static __thread IOScheduler::IOClass t_io_class = IOScheduler::IO_CLASS_CLONE;
+
+const char* IOScheduler::io_class_name(IOClass io_class) {
+    switch (io_class) {
+    case IO_CLASS_CLONE:
+        return "clone";
+    case IO_CLASS_STORAGE_MIGRATION:
+        return "storage_migration";
+    case IO_CLASS_SCHEMA_CHANGE:
+        return "schema_change";
+    case IO_CLASS_CUMULATIVE_COMPACTION:
+        return "cumulative_compaction";
+    case IO_CLASS_BASE_COMPACTION:
+        return "base_compaction";
+    default:
+        return "unknown";
+    }
+}
+
+IOScheduler::IOScheduler(const std::string& name, int64_t bytes_per_second, bool auto_tune) :
+        _name(name),
+        _max_rate(bytes_per_second),
+        _auto_tune(auto_tune),
+        // allows a burst of one second
+        _bucket(bytes_per_second, bytes_per_second) {
+    _rate_metric.set_value(std::max<int64_t>(0, bytes_per_second));
+}
+
+IOScheduler::~IOScheduler() {
+    if (_registry != nullptr) {
+        for (int i = 0; i < NUM_IO_CLASSES; ++i) {
+            _registry->deregister_metric(&_bytes[i]);
+            _registry->deregister_metric(&_throttle_us[i]);
+        }
+        _registry->deregister_metric(&_rate_metric);
+        _registry->deregister_metric(&_foreground_read_cost);
+    }
+}
+
+void IOScheduler::consume(IOClass io_class, int64_t bytes) {
+    if (bytes <= 0) {
+        return;
+    }
+    _bytes[io_class].increment(bytes);
+    if (!_bucket.is_limited()) {
+        return;
+    }
+    int64_t reserved = _bucket.burst() * io_class / NUM_IO_CLASSES;
+    int64_t wait_ns = _bucket.consume(bytes, reserved);
+    if (wait_ns > 0) {
+        _throttle_us[io_class].increment(wait_ns / 1000);
+    }
+}
+
+void IOScheduler::consume_current(int64_t bytes) {
+    if (t_io_scheduler != nullptr) {
+        t_io_scheduler->consume(t_io_class, bytes);
+    }
+}
+
+void IOScheduler::report_foreground_read(int64_t io_ns, int64_t bytes) {
+    if (bytes <= 0) {
+        return;
+    }
+    _foreground_io_ns.fetch_add(io_ns);
+    _foreground_bytes.fetch_add(bytes);
+}
+
+int64_t IOScheduler::min_rate() const {
+    if (_max_rate <= 0) {
+        return 0;
+    }
+    return _auto_tune ? std::max<int64_t>(1, _max_rate / MIN_RATE_DIVISOR) : _max_rate;
+}
+
+void IOScheduler::tune() {
+    int64_t io_ns = _foreground_io_ns.exchange(0);
+    int64_t bytes = _foreground_bytes.exchange(0);
+    if (!_auto_tune || _max_rate <= 0) {
+        return;
+    }
+
+    int64_t rate = _bucket.rate();
+    bool back_off = false;
+    if (bytes >= MIN_TUNE_FOREGROUND_BYTES) {
+        double cost = static_cast<double>(io_ns) * 1024 * 1024 / bytes;
+        _foreground_read_cost.set_value(static_cast<int64_t>(cost));
+        if (_baseline_read_cost <= 0 || cost < _baseline_read_cost) {
+            _baseline_read_cost = cost;
+        } else {
+            _baseline_read_cost += (cost - _baseline_read_cost) / 64;
+        }
+        back_off = cost > _baseline_read_cost * config::storage_io_auto_tune_cost_ratio;
+    }
+    if (back_off) {
+        rate = std::max(_max_rate / MIN_RATE_DIVISOR, rate / 2);
+    } else {
+        rate = std::min(_max_rate, rate + _max_rate / RATE_STEP_DIVISOR);
+    }
+    if (rate != _bucket.rate()) {
+        VLOG(3) << "background io rate of " << _name << " is tuned to " << rate;
+        _bucket.set_rate(rate, rate);
+    }
+    _rate_metric.set_value(rate);
+}
+
+void IOScheduler::register_metrics(MetricRegistry* registry) {
+    _registry = registry;
+    for (int i = 0; i < NUM_IO_CLASSES; ++i) {
+        MetricLabels labels = MetricLabels().add("path", _name)
+                .add("io_class", io_class_name(static_cast<IOClass>(i)));
+        registry->register_metric("background_io_bytes", labels, &_bytes[i]);
+        registry->register_metric("background_io_throttle_us", labels, &_throttle_us[i]);
+    }
+    MetricLabels labels = MetricLabels().add("path", _name);
+    registry->register_metric("background_io_rate_bytes", labels, &_rate_metric);
+    registry->register_metric("foreground_read_cost_ns_per_mb", labels, &_foreground_read_cost);
+}
+
+ScopedIOClass::ScopedIOClass(IOScheduler* scheduler, IOScheduler::IOClass io_class) :
+        _prev_scheduler(t_io_scheduler),
+        _prev_io_class(t_io_class) {
+    t_io_scheduler = scheduler;
+    t_io_class = io_class;
+}
+
+ScopedIOClass::~ScopedIOClass() {
+    t_io_scheduler = _prev_scheduler;
+    t_io_class = _prev_io_class;
+}
+
+}
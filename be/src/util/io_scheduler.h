@@ -0,0 +1,119 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_UTIL_IO_SCHEDULER_H
+#define DORIS_BE_SRC_UTIL_IO_SCHEDULER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "util/metrics.h"
+#include "util/token_bucket.h"
+
+namespace doris {
+
+// Shares the I/O bandwidth of a disk among the background tasks on it, so that
+// they don't saturate the disk together and slow down the queries.
+//
+// The background tasks draw from one token bucket of 'bytes_per_second' bytes
+// per second. A task of a lower class leaves more of the bucket to the classes
+// above it: it waits until the bucket is back to a share of a second's tokens
+// which grows with the class, so the higher classes go first when the disk is
+// busy, while a class running alone still gets the whole rate.
+//
+// With 'auto_tune', tune() lowers the rate by half when the queries wait longer
+// for the disk than they did without the background I/O, and raises it again
+// step by step up to 'bytes_per_second' when they don't.
+//
+// The readers and writers of files don't know their task, they charge the I/O
+// to the class of the current thread, see ScopedIOClass.
+class IOScheduler {
+public:
+    // in the order of priority, highest first
+    enum IOClass {
+        IO_CLASS_CLONE = 0,
+        IO_CLASS_STORAGE_MIGRATION,
+        IO_CLASS_SCHEMA_CHANGE,
+        IO_CLASS_CUMULATIVE_COMPACTION,
+        IO_CLASS_BASE_COMPACTION,
+        NUM_IO_CLASSES
+    };
+
+    static const char* io_class_name(IOClass io_class);
+
+    // 'bytes_per_second' <= 0 means no limit, which isn't tuned either.
+    IOScheduler(const std::string& name, int64_t bytes_per_second, bool auto_tune);
+    ~IOScheduler();
+
+    // Charges 'bytes' to 'io_class', waits while the class is over its share.
+    void consume(IOClass io_class, int64_t bytes);
+
+    // Charges 'bytes' to the scheduler and class of the current thread, if any.
+    static void consume_current(int64_t bytes);
+
+    // Called by the queries after they spent 'io_ns' reading 'bytes' from the disk.
+    void report_foreground_read(int64_t io_ns, int64_t bytes);
+
+    // Adjusts the rate by the foreground reads since the last call. Called
+    // periodically.
+    void tune();
+
+    int64_t rate() const {
+        return _bucket.rate();
+    }
+
+    // The lowest rate tune() may set, 0 means no limit.
+    int64_t min_rate() const;
+
+    // labels the metrics with {path=name}
+    void register_metrics(MetricRegistry* registry);
+
+private:
+    std::string _name;
+    const int64_t _max_rate;
+    const bool _auto_tune;
+    TokenBucket _bucket;
+
+    std::atomic<int64_t> _foreground_io_ns{0};
+    std::atomic<int64_t> _foreground_bytes{0};
+    // the lowest cost of the foreground reads in ns per MB, which drifts up
+    // slowly to follow a disk that gets slower for good
+    double _baseline_read_cost = 0;
+
+    MetricRegistry* _registry = nullptr;
+    IntCounter _bytes[NUM_IO_CLASSES];
+    IntCounter _throttle_us[NUM_IO_CLASSES];
+    IntGauge _rate_metric;
+    IntGauge _foreground_read_cost;
+};
+
+// Charges the file I/O of the current thread to 'io_class' of 'scheduler' while
+// in scope. A null 'scheduler' leaves the I/O unthrottled.
+class ScopedIOClass {
+public:
+    ScopedIOClass(IOScheduler* scheduler, IOScheduler::IOClass io_class);
+    ~ScopedIOClass();
+
+private:
+    IOScheduler* _prev_scheduler;
+    IOScheduler::IOClass _prev_io_class;
+};
+
+}
+
+#endif // DORIS_BE_SRC_UTIL_IO_SCHEDULER_H
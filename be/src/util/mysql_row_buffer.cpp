@@ -20,8 +20,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <cmath>
+
+#include <double-conversion/double-conversion.h>
+
 #include "common/logging.h"
 #include "gutil/strings/numbers.h"
+#include "runtime/datetime_value.h"
 #include "util/mysql_global.h"
 
 namespace doris {
@@ -55,6 +60,86 @@ static char* pack_vlen(char* packet, uint64_t length) {
     int8store(packet, length);
     return packet + 8;
 }
+
+// Format the shortest digits which read back as 'value' like printf("%.<precision>g"),
+// where precision is 'short_precision' if the digits fit in it, or else
+// 'long_precision'. This gives the output of FloatToBuffer()/DoubleToBuffer(),
+// which try "%.6g"/"%.15g" and then "%.8g"/"%.17g", without the printf calls.
+// 'to' must have MAX_DOUBLE_STR_LENGTH bytes at least.
+template<typename T>
+static int format_shortest(T value, int short_precision, int long_precision, char* to) {
+    char* pos = to;
+    if (std::isnan(value)) {
+        memcpy(pos, "nan", 3);
+        return 3;
+    }
+    if (std::isinf(value)) {
+        if (value < 0) {
+            *pos++ = '-';
+        }
+        memcpy(pos, "inf", 3);
+        return pos + 3 - to;
+    }
+
+    // 17 digits at most and a trailing '\0'
+    char digits[double_conversion::DoubleToStringConverter::kBase10MaximalLength + 1];
+    bool negative = false;
+    int num_digits = 0;
+    int point = 0;
+    double_conversion::DoubleToStringConverter::DoubleToAscii(
+            value,
+            sizeof(T) == sizeof(float)
+                ? double_conversion::DoubleToStringConverter::SHORTEST_SINGLE
+                : double_conversion::DoubleToStringConverter::SHORTEST,
+            0, digits, sizeof(digits), &negative, &num_digits, &point);
+    int precision = num_digits <= short_precision ? short_precision : long_precision;
+
+    if (negative) {
+        *pos++ = '-';
+    }
+    int exponent = point - 1;
+    if (exponent < -4 || exponent >= precision) {
+        // d.ddde+XX
+        *pos++ = digits[0];
+        if (num_digits > 1) {
+            *pos++ = '.';
+            memcpy(pos, digits + 1, num_digits - 1);
+            pos += num_digits - 1;
+        }
+        *pos++ = 'e';
+        *pos++ = exponent < 0 ? '-' : '+';
+        exponent = std::abs(exponent);
+        if (exponent >= 100) {
+            *pos++ = '0' + exponent / 100;
+            exponent %= 100;
+        }
+        *pos++ = '0' + exponent / 10;
+        *pos++ = '0' + exponent % 10;
+    } else if (point <= 0) {
+        // 0.000ddd
+        *pos++ = '0';
+        *pos++ = '.';
+        memset(pos, '0', -point);
+        pos += -point;
+        memcpy(pos, digits, num_digits);
+        pos += num_digits;
+    } else if (point >= num_digits) {
+        // ddd000
+        memcpy(pos, digits, num_digits);
+        pos += num_digits;
+        memset(pos, '0', point - num_digits);
+        pos += point - num_digits;
+    } else {
+        // ddd.ddd
+        memcpy(pos, digits, point);
+        pos += point;
+        *pos++ = '.';
+        memcpy(pos, digits + point, num_digits - point);
+        pos += num_digits - point;
+    }
+    return pos - to;
+}
+
 MysqlRowBuffer::MysqlRowBuffer():
     _pos(_default_buf),
     _buf(_default_buf),
@@ -109,12 +194,7 @@ int MysqlRowBuffer::push_tinyint(int8_t data) {
         return ret;
     }
 
-    int length = snprintf(_pos + 1, MAX_TINYINT_WIDTH + 2, "%d", data);
-
-    if (length < 0) {
-        LOG(ERROR) << "snprintf failed. data = " << data;
-        return length;
-    }
+    int length = FastInt32ToBufferLeft(data, _pos + 1) - (_pos + 1);
 
     int1store(_pos, length);
     _pos += length + 1;
@@ -130,12 +210,7 @@ int MysqlRowBuffer::push_smallint(int16_t data) {
         return ret;
     }
 
-    int length = snprintf(_pos + 1, MAX_SMALLINT_WIDTH + 2, "%d", data);
-
-    if (length < 0) {
-        LOG(ERROR) << "snprintf failed. data = " << data;
-        return length;
-    }
+    int length = FastInt32ToBufferLeft(data, _pos + 1) - (_pos + 1);
 
     int1store(_pos, length);
     _pos += length + 1;
@@ -151,12 +226,7 @@ int MysqlRowBuffer::push_int(int32_t data) {
         return ret;
     }
 
-    int length = snprintf(_pos + 1, MAX_INT_WIDTH + 2, "%d", data);
-
-    if (length < 0) {
-        LOG(ERROR) << "snprintf failed. data = " << data;
-        return length;
-    }
+    int length = FastInt32ToBufferLeft(data, _pos + 1) - (_pos + 1);
 
     int1store(_pos, length);
     _pos += length + 1;
@@ -172,12 +242,7 @@ int MysqlRowBuffer::push_bigint(int64_t data) {
         return ret;
     }
 
-    int length = snprintf(_pos + 1, MAX_BIGINT_WIDTH + 2, "%ld", data);
-
-    if (length < 0) {
-        LOG(ERROR) << "snprintf failed. data = " << data;
-        return length;
-    }
+    int length = FastInt64ToBufferLeft(data, _pos + 1) - (_pos + 1);
 
     int1store(_pos, length);
     _pos += length + 1;
@@ -193,12 +258,7 @@ int MysqlRowBuffer::push_unsigned_bigint(uint64_t data) {
         return ret;
     }
 
-    int length = snprintf(_pos + 1, MAX_BIGINT_WIDTH + 3, "%ld", data);
-
-    if (length < 0) {
-        LOG(ERROR) << "snprintf failed. data = " << data;
-        return length;
-    }
+    int length = FastUInt64ToBufferLeft(data, _pos + 1) - (_pos + 1);
 
     int1store(_pos, length);
     _pos += length + 1;
@@ -214,12 +274,7 @@ int MysqlRowBuffer::push_float(float data) {
         return ret;
     }
 
-    int length = FloatToBuffer(data, MAX_FLOAT_STR_LENGTH + 2, _pos + 1);
-
-    if (length < 0) {
-        LOG(ERROR) << "gcvt float failed. data = " << data;
-        return length;
-    }
+    int length = format_shortest(data, 6, 8, _pos + 1);
 
     int1store(_pos, length);
     _pos += length + 1;
@@ -235,13 +290,24 @@ int MysqlRowBuffer::push_double(double data) {
         return ret;
     }
 
-    int length = DoubleToBuffer(data, MAX_DOUBLE_STR_LENGTH + 2, _pos + 1);
+    int length = format_shortest(data, 15, 17, _pos + 1);
 
-    if (length < 0) {
-        LOG(ERROR) << "gcvt double failed. data = " << data;
-        return length;
+    int1store(_pos, length);
+    _pos += length + 1;
+    return 0;
+}
+
+int MysqlRowBuffer::push_datetime(const DateTimeValue& data) {
+    // 1 for length, "-HHH:MM:SS" or "YYYY-MM-DD HH:MM:SS", 7 for microseconds, 1 for '\0'
+    int ret = reserve(1 + MAX_DATETIME_WIDTH + 7 + 1);
+
+    if (0 != ret) {
+        LOG(ERROR) << "mysql row buffer reserver failed.";
+        return ret;
     }
 
+    // to_string() writes the trailing '\0' and returns the position after it
+    int length = data.to_string(_pos + 1) - (_pos + 1) - 1;
     int1store(_pos, length);
     _pos += length + 1;
     return 0;
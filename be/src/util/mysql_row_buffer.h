@@ -22,6 +22,8 @@
 
 namespace doris {
 
+class DateTimeValue;
+
 // helper for construct MySQL send row
 // Now only support text protocol
 class MysqlRowBuffer {
@@ -41,6 +43,8 @@ public:
     int push_unsigned_bigint(uint64_t data);
     int push_float(float data);
     int push_double(double data);
+    // DATE, DATETIME or TIME in the format of DateTimeValue::to_string()
+    int push_datetime(const DateTimeValue& data);
     int push_string(const char* str, int length);
     int push_null();
 
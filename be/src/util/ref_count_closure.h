@@ -42,6 +42,9 @@ public:
         }
     }
 
+    // The number of references, the one of an rpc is released when it finishes.
+    int refs() const { return _refs.load(); }
+
     void join() {
         brpc::Join(cntl.call_id());
     }
@@ -0,0 +1,297 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/sort_key_normalizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "exprs/slot_ref.h"
+#include "gutil/endian.h"
+#include "runtime/datetime_value.h"
+#include "runtime/runtime_state.h"
+#include "runtime/string_value.h"
+#include "util/radix_sort.h"
+#include "util/types.h"
+
+namespace doris {
+
+struct SortKeyNormalizer::RadixSortEntryTraits {
+    using Element = Entry;
+    using Key = uint64_t;
+    using CountType = uint32_t;
+    using KeyBits = uint64_t;
+
+    static constexpr size_t PART_SIZE_BITS = 8;
+
+    using Transform = RadixSortIdentityTransform<KeyBits>;
+    using Allocator = RadixSortMallocAllocator;
+
+    static Key& extractKey(Element& elem) { return elem.key; }
+
+    static bool less(Key x, Key y) {
+        return x < y;
+    }
+};
+
+// Return the number of bytes of the memcomparable encoding of 'type', 0 if it
+// has none. 'exact' is set to false if the encoding loses information.
+static int encoded_size(PrimitiveType type, bool* exact) {
+    *exact = true;
+    switch (type) {
+    case TYPE_BOOLEAN:
+    case TYPE_TINYINT:
+        return 1;
+    case TYPE_SMALLINT:
+        return 2;
+    case TYPE_INT:
+        return 4;
+    case TYPE_BIGINT:
+        return 8;
+    case TYPE_LARGEINT:
+        return 16;
+    case TYPE_FLOAT:
+        // -0.0 and NaN compare equal to other values
+        *exact = false;
+        return 4;
+    case TYPE_DOUBLE:
+        *exact = false;
+        return 8;
+    case TYPE_DATE:
+    case TYPE_DATETIME:
+        // microseconds are dropped
+        *exact = false;
+        return 8;
+    case TYPE_DECIMALV2:
+        // comparison of decimal values only looks at the integer value
+        return 16;
+    case TYPE_CHAR:
+    case TYPE_VARCHAR:
+        // only a prefix of the string is encoded
+        *exact = false;
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+template <typename T>
+static inline void encode_signed(T value, uint8_t* buf) {
+    typedef typename std::make_unsigned<T>::type U;
+    U unsigned_value = static_cast<U>(value);
+    unsigned_value ^= (U(1) << (sizeof(U) * 8 - 1));
+    for (int i = sizeof(U) - 1; i >= 0; --i) {
+        buf[i] = static_cast<uint8_t>(unsigned_value);
+        unsigned_value >>= 8;
+    }
+}
+
+template <typename T, typename Bits>
+static inline void encode_float(T value, uint8_t* buf) {
+    Bits bits = bit_cast<Bits>(value);
+    bits = RadixSortFloatTransform<Bits>::forward(bits);
+    for (int i = sizeof(Bits) - 1; i >= 0; --i) {
+        buf[i] = static_cast<uint8_t>(bits);
+        bits >>= 8;
+    }
+}
+
+SortKeyNormalizer::SortKeyNormalizer(const TupleRowComparator& less_than) :
+        _less_than(less_than),
+        _expr_ctx(nullptr),
+        _type(INVALID_TYPE),
+        _is_asc(true),
+        _nulls_first(-1),
+        _has_null_byte(true),
+        _is_supported(false),
+        _is_exact(false) {
+    const std::vector<ExprContext*>& expr_ctxs = less_than.key_expr_ctxs();
+    if (expr_ctxs.empty()) {
+        return;
+    }
+    _expr_ctx = expr_ctxs[0];
+    _type = _expr_ctx->root()->type().type;
+    _is_asc = less_than.is_asc()[0];
+    _nulls_first = less_than.nulls_first()[0];
+    if (_expr_ctx->root()->node_type() == TExprNodeType::SLOT_REF) {
+        _has_null_byte = SlotRef::is_nullable(_expr_ctx->root());
+    }
+
+    bool exact = false;
+    int size = encoded_size(_type, &exact);
+    _is_supported = size > 0;
+    _is_exact = _is_supported && exact && expr_ctxs.size() == 1
+        && size + (_has_null_byte ? 1 : 0) <= sizeof(uint64_t);
+}
+
+uint64_t SortKeyNormalizer::normalize(TupleRow* row) const {
+    // null byte + the widest encoding
+    uint8_t buf[1 + 16];
+    memset(buf, 0, sizeof(buf));
+    uint8_t* value_buf = buf;
+    if (_has_null_byte) {
+        value_buf = buf + 1;
+    }
+
+    void* value = _expr_ctx->get_value(row);
+    if (value == nullptr) {
+        // nulls all get the same prefix, the value bytes stay zero
+        buf[0] = _nulls_first < 0 ? 0 : 2;
+    } else {
+        if (_has_null_byte) {
+            buf[0] = 1;
+        }
+        int size = 0;
+        switch (_type) {
+        case TYPE_BOOLEAN:
+            value_buf[0] = *reinterpret_cast<bool*>(value) ? 1 : 0;
+            size = 1;
+            break;
+        case TYPE_TINYINT:
+            encode_signed(*reinterpret_cast<int8_t*>(value), value_buf);
+            size = 1;
+            break;
+        case TYPE_SMALLINT:
+            encode_signed(*reinterpret_cast<int16_t*>(value), value_buf);
+            size = 2;
+            break;
+        case TYPE_INT:
+            encode_signed(*reinterpret_cast<int32_t*>(value), value_buf);
+            size = 4;
+            break;
+        case TYPE_BIGINT:
+            encode_signed(*reinterpret_cast<int64_t*>(value), value_buf);
+            size = 8;
+            break;
+        case TYPE_LARGEINT:
+        case TYPE_DECIMALV2:
+            encode_signed(reinterpret_cast<PackedInt128*>(value)->value, value_buf);
+            size = 16;
+            break;
+        case TYPE_FLOAT:
+            encode_float<float, uint32_t>(*reinterpret_cast<float*>(value), value_buf);
+            size = 4;
+            break;
+        case TYPE_DOUBLE:
+            encode_float<double, uint64_t>(*reinterpret_cast<double*>(value), value_buf);
+            size = 8;
+            break;
+        case TYPE_DATE:
+        case TYPE_DATETIME:
+            encode_signed(reinterpret_cast<DateTimeValue*>(value)->to_datetime_int64(), value_buf);
+            size = 8;
+            break;
+        case TYPE_CHAR:
+        case TYPE_VARCHAR: {
+            // shorter strings are padded with zeros, the padding is inverted
+            // as well for descending order
+            StringValue* string_value = reinterpret_cast<StringValue*>(value);
+            memcpy(value_buf, string_value->ptr, std::min<int>(string_value->len, 8));
+            size = 8;
+            break;
+        }
+        default:
+            DCHECK(false) << "unsupported type " << _type;
+            break;
+        }
+        if (!_is_asc) {
+            for (int i = 0; i < size; ++i) {
+                value_buf[i] = ~value_buf[i];
+            }
+        }
+    }
+
+    uint64_t key = 0;
+    memcpy(&key, buf, sizeof(key));
+    return BigEndian::ToHost64(key);
+}
+
+void SortKeyNormalizer::sort_tuples(const std::vector<uint8_t*>& blocks, int block_capacity,
+                                    int tuple_size, int64_t num_tuples,
+                                    RuntimeState* state) const {
+    DCHECK(_is_supported);
+    auto tuple_at = [&](uint64_t index) {
+        return blocks[index / block_capacity] + (index % block_capacity) * tuple_size;
+    };
+
+    std::unique_ptr<Entry[]> entries(new Entry[num_tuples]);
+    for (int64_t i = 0; i < num_tuples; ++i) {
+        uint8_t* tuple = tuple_at(i);
+        entries[i].key = normalize(reinterpret_cast<TupleRow*>(&tuple));
+        entries[i].index = i;
+    }
+
+    auto less_than = [&](const Entry& lhs, const Entry& rhs) {
+        if (lhs.key != rhs.key) {
+            return lhs.key < rhs.key;
+        }
+        if (_is_exact) {
+            return false;
+        }
+        return _less_than(reinterpret_cast<Tuple*>(tuple_at(lhs.index)),
+                          reinterpret_cast<Tuple*>(tuple_at(rhs.index)));
+    };
+    if (num_tuples < RADIX_SORT_THRESHOLD) {
+        std::sort(entries.get(), entries.get() + num_tuples, less_than);
+    } else {
+        RadixSort<RadixSortEntryTraits>::executeLSD(entries.get(), num_tuples);
+        if (!_is_exact) {
+            // Resolve the runs of tied prefixes by the full comparator
+            int64_t start = 0;
+            while (start < num_tuples) {
+                int64_t end = start + 1;
+                while (end < num_tuples && entries[end].key == entries[start].key) {
+                    ++end;
+                }
+                if (end - start > 1) {
+                    std::sort(entries.get() + start, entries.get() + end, less_than);
+                    if (UNLIKELY(state->is_cancelled())) {
+                        return;
+                    }
+                }
+                start = end;
+            }
+        }
+    }
+    if (UNLIKELY(state->is_cancelled())) {
+        return;
+    }
+
+    // Move the tuples into sorted order, following the cycles of the permutation
+    std::unique_ptr<uint8_t[]> temp_tuple(new uint8_t[tuple_size]);
+    std::vector<bool> placed(num_tuples, false);
+    for (int64_t i = 0; i < num_tuples; ++i) {
+        if (placed[i] || entries[i].index == i) {
+            continue;
+        }
+        memcpy(temp_tuple.get(), tuple_at(i), tuple_size);
+        int64_t dst = i;
+        while (true) {
+            placed[dst] = true;
+            int64_t src = entries[dst].index;
+            if (src == i) {
+                memcpy(tuple_at(dst), temp_tuple.get(), tuple_size);
+                break;
+            }
+            memcpy(tuple_at(dst), tuple_at(src), tuple_size);
+            dst = src;
+        }
+    }
+}
+
+} // namespace doris
@@ -0,0 +1,82 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_UTIL_SORT_KEY_NORMALIZER_H
+#define DORIS_BE_SRC_UTIL_SORT_KEY_NORMALIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "util/tuple_row_compare.h"
+
+namespace doris {
+
+class RuntimeState;
+
+// Sorts tuples by a normalized key: the first sort expr of every tuple is
+// evaluated once and encoded into a 64-bit prefix whose unsigned order is the
+// order of the comparator, the same memcomparable encoding storage's KeyCoder
+// uses (sign bit flipped, big endian), with a leading null byte for nullable
+// exprs and the bits inverted for descending order. The prefixes are radix
+// sorted, and only the tuples whose prefixes tie are compared by the full
+// comparator.
+//
+// A prefix is exact when it holds the complete value of the only sort expr,
+// e.g. a nullable INT, then ties need no further comparison at all.
+class SortKeyNormalizer {
+public:
+    explicit SortKeyNormalizer(const TupleRowComparator& less_than);
+
+    // False if the type of the first sort expr can't be normalized.
+    bool is_supported() const { return _is_supported; }
+
+    bool is_exact() const { return _is_exact; }
+
+    uint64_t normalize(TupleRow* row) const;
+
+    // Sort in place the 'num_tuples' tuples of 'tuple_size' bytes stored in
+    // 'blocks', 'block_capacity' tuples per block. Returns early if the query
+    // is cancelled, the caller must check for it.
+    void sort_tuples(const std::vector<uint8_t*>& blocks, int block_capacity,
+                     int tuple_size, int64_t num_tuples, RuntimeState* state) const;
+
+private:
+    struct Entry {
+        uint64_t key;
+        // index of the tuple in the run before sorting
+        uint64_t index;
+    };
+
+    struct RadixSortEntryTraits;
+
+    // Below this many tuples, comparison sort of the entries beats radix sort.
+    static const int64_t RADIX_SORT_THRESHOLD = 256;
+
+    const TupleRowComparator& _less_than;
+    ExprContext* _expr_ctx;
+    PrimitiveType _type;
+    bool _is_asc;
+    // -1 if nulls sort first, 1 if nulls sort last
+    int8_t _nulls_first;
+    bool _has_null_byte;
+    bool _is_supported;
+    bool _is_exact;
+};
+
+} // namespace doris
+
+#endif // DORIS_BE_SRC_UTIL_SORT_KEY_NORMALIZER_H
@@ -0,0 +1,115 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#ifndef DORIS_BE_SRC_UTIL_TOKEN_BUCKET_H
+#define DORIS_BE_SRC_UTIL_TOKEN_BUCKET_H
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "util/spinlock.h"
+#include "util/time.h"
+
+namespace doris {
+
+// Rate limiter which fills up with 'rate' tokens per second and holds at most
+// 'burst' tokens. A caller may take more tokens than there are, the bucket goes
+// into debt and later callers wait until the debt is paid off, so large requests
+// aren't starved by small ones. A rate <= 0 means no limit.
+class TokenBucket {
+public:
+    TokenBucket(int64_t rate, int64_t burst) :
+            _rate(rate),
+            _burst(std::max<int64_t>(burst, 1)),
+            _tokens(_burst),
+            _last_fill_ns(MonotonicNanos()) {
+    }
+
+    bool is_limited() const {
+        return _rate.load() > 0;
+    }
+
+    int64_t rate() const {
+        return _rate.load();
+    }
+
+    int64_t burst() const {
+        return _burst.load();
+    }
+
+    // Changes the rate from now on, the tokens filled up so far are kept.
+    void set_rate(int64_t rate, int64_t burst) {
+        std::lock_guard<SpinLock> l(_lock);
+        _fill(MonotonicNanos());
+        _rate = rate;
+        _burst = std::max<int64_t>(burst, 1);
+        _tokens = std::min<double>(_burst, _tokens);
+    }
+
+    // Takes 'tokens' and returns how long in nanoseconds the caller has to wait
+    // before it may use them, 0 if it may go on at once. The caller waits until
+    // the bucket is back to 'reserved' tokens, which are left to callers of higher
+    // priority.
+    int64_t acquire(int64_t tokens, int64_t reserved = 0) {
+        if (_rate.load() <= 0) {
+            return 0;
+        }
+        std::lock_guard<SpinLock> l(_lock);
+        int64_t rate = _rate.load();
+        if (rate <= 0) {
+            return 0;
+        }
+        _fill(MonotonicNanos());
+        _tokens -= tokens;
+        if (_tokens >= reserved) {
+            return 0;
+        }
+        return static_cast<int64_t>((reserved - _tokens) * NANOS_PER_SEC / rate);
+    }
+
+    // Like acquire(), but waits itself. Returns the time it waited in nanoseconds.
+    int64_t consume(int64_t tokens, int64_t reserved = 0) {
+        int64_t wait_ns = acquire(tokens, reserved);
+        if (wait_ns > 0) {
+            usleep(wait_ns / 1000);
+        }
+        return wait_ns;
+    }
+
+private:
+    // adds the tokens since the last fill
+    void _fill(int64_t now) {
+        double filled = static_cast<double>(now - _last_fill_ns) * _rate.load() / NANOS_PER_SEC;
+        _tokens = std::min<double>(_burst.load(), _tokens + filled);
+        _last_fill_ns = now;
+    }
+
+    std::atomic<int64_t> _rate;
+    std::atomic<int64_t> _burst;
+
+    SpinLock _lock;
+    double _tokens;
+    int64_t _last_fill_ns;
+};
+
+}
+
+#endif // DORIS_BE_SRC_UTIL_TOKEN_BUCKET_H
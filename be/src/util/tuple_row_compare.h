@@ -150,6 +150,19 @@ public:
 
     bool codegen(RuntimeState* state);
 
+    const std::vector<ExprContext*>& key_expr_ctxs() const {
+        return _key_expr_ctxs_lhs;
+    }
+
+    const std::vector<bool>& is_asc() const {
+        return _is_asc;
+    }
+
+    // -1 for the exprs whose nulls sort first, 1 for the others
+    const std::vector<int8_t>& nulls_first() const {
+        return _nulls_first;
+    }
+
 private:
     const std::vector<ExprContext*>& _key_expr_ctxs_lhs;
     const std::vector<ExprContext*>& _key_expr_ctxs_rhs;
@@ -0,0 +1,175 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "exec/olap_scan_node.h"
+
+#include <gtest/gtest.h>
+
+#include "common/config.h"
+#include "common/object_pool.h"
+#include "gen_cpp/PlanNodes_types.h"
+#include "runtime/descriptor_helper.h"
+#include "runtime/descriptors.h"
+#include "util/runtime_profile.h"
+
+namespace doris {
+
+class OlapScanNodeQueueTest : public testing::Test {
+public:
+    OlapScanNodeQueueTest() { }
+    virtual ~OlapScanNodeQueueTest() { }
+
+    void SetUp() override {
+        _queue_size = config::doris_scanner_queue_size;
+        _batch_bytes = config::doris_scanner_batch_bytes;
+
+        TDescriptorTableBuilder dtb;
+        TTupleDescriptorBuilder tuple_builder;
+        tuple_builder.add_slot(
+            TSlotDescriptorBuilder().type(TYPE_INT).column_name("k1").column_pos(0).build());
+        tuple_builder.build(&dtb);
+        ASSERT_TRUE(DescriptorTbl::create(&_obj_pool, dtb.desc_tbl(), &_desc_tbl).ok());
+
+        _tnode.node_id = 0;
+        _tnode.node_type = TPlanNodeType::OLAP_SCAN_NODE;
+        _tnode.num_children = 0;
+        _tnode.limit = -1;
+        _tnode.row_tuples.push_back(0);
+        _tnode.nullable_tuples.push_back(false);
+        _tnode.olap_scan_node.tuple_id = 0;
+        _tnode.__isset.olap_scan_node = true;
+    }
+
+    void TearDown() override {
+        config::doris_scanner_queue_size = _queue_size;
+        config::doris_scanner_batch_bytes = _batch_bytes;
+    }
+
+    // The queue depth is read from the config when the node is created
+    OlapScanNode* create_node() {
+        OlapScanNode* node = _obj_pool.add(new OlapScanNode(&_obj_pool, _tnode, *_desc_tbl));
+        node->_queue_depth_counter =
+            node->runtime_profile()->add_counter("RowBatchQueueDepth", TUnit::UNIT);
+        node->_peak_queue_depth_counter =
+            node->runtime_profile()->AddHighWaterMarkCounter("PeakRowBatchQueueDepth", TUnit::UNIT);
+        return node;
+    }
+
+    int scanner_batch_rows(int batch_size, int tuple_byte_size) {
+        return OlapScanNode::_compute_scanner_batch_rows(batch_size, tuple_byte_size);
+    }
+
+    int queue_depth(OlapScanNode* node) {
+        return node->_max_materialized_row_batches;
+    }
+
+    int peak_queue_depth(OlapScanNode* node) {
+        return node->_peak_queue_depth_counter->value();
+    }
+
+    // What get_next() does when it finds the queue empty
+    void grow(OlapScanNode* node) {
+        node->_resize_row_batch_queue(node->_max_materialized_row_batches * 2);
+    }
+
+    // What add_one_batch() does when it finds the queue full
+    void shrink(OlapScanNode* node) {
+        node->_resize_row_batch_queue(node->_max_materialized_row_batches / 2);
+    }
+
+private:
+    int32_t _queue_size;
+    int32_t _batch_bytes;
+    ObjectPool _obj_pool;
+    DescriptorTbl* _desc_tbl = nullptr;
+    TPlanNode _tnode;
+};
+
+TEST_F(OlapScanNodeQueueTest, ScannerBatchRows) {
+    config::doris_scanner_batch_bytes = 256 * 1024;
+
+    // wide tuples are bounded by the bytes
+    ASSERT_EQ(64, scanner_batch_rows(1024, 4096));
+    ASSERT_EQ(262, scanner_batch_rows(1024, 1000));
+    // a tuple wider than the bytes still reads one row a batch
+    ASSERT_EQ(1, scanner_batch_rows(1024, 1024 * 1024));
+    // narrow tuples keep the batch size
+    ASSERT_EQ(1024, scanner_batch_rows(1024, 16));
+    ASSERT_EQ(1024, scanner_batch_rows(1024, 256));
+    ASSERT_EQ(1024, scanner_batch_rows(1024, 0));
+
+    // no bound
+    config::doris_scanner_batch_bytes = 0;
+    ASSERT_EQ(1024, scanner_batch_rows(1024, 4096));
+    ASSERT_EQ(1024, scanner_batch_rows(1024, 1024 * 1024));
+}
+
+TEST_F(OlapScanNodeQueueTest, QueueDepthLimits) {
+    config::doris_scanner_queue_size = 1024;
+    OlapScanNode* node = create_node();
+    ASSERT_EQ(64, queue_depth(node));
+
+    // doubles up to doris_scanner_queue_size
+    int expected[] = {128, 256, 512, 1024, 1024, 1024};
+    for (int depth : expected) {
+        grow(node);
+        ASSERT_EQ(depth, queue_depth(node));
+    }
+    ASSERT_EQ(1024, peak_queue_depth(node));
+
+    // halves down to the initial depth
+    int expected_shrink[] = {512, 256, 128, 64, 64, 64};
+    for (int depth : expected_shrink) {
+        shrink(node);
+        ASSERT_EQ(depth, queue_depth(node));
+    }
+    ASSERT_EQ(1024, peak_queue_depth(node));
+
+    grow(node);
+    ASSERT_EQ(128, queue_depth(node));
+}
+
+TEST_F(OlapScanNodeQueueTest, SmallQueueSize) {
+    config::doris_scanner_queue_size = 8;
+    OlapScanNode* node = create_node();
+    ASSERT_EQ(1, queue_depth(node));
+    for (int i = 0; i < 8; ++i) {
+        grow(node);
+    }
+    ASSERT_EQ(8, queue_depth(node));
+    for (int i = 0; i < 8; ++i) {
+        shrink(node);
+    }
+    ASSERT_EQ(1, queue_depth(node));
+
+    // the queue always holds one batch
+    config::doris_scanner_queue_size = 0;
+    node = create_node();
+    ASSERT_EQ(1, queue_depth(node));
+    grow(node);
+    ASSERT_EQ(1, queue_depth(node));
+    shrink(node);
+    ASSERT_EQ(1, queue_depth(node));
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
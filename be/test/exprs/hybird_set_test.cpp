@@ -17,9 +17,12 @@
 
 #include "exprs/hybird_set.h"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 #include <gtest/gtest.h>
 #include "util/logging.h"
+#include "util/stopwatch.hpp"
 
 namespace doris {
 
@@ -300,7 +303,7 @@ TEST_F(HybirdSetTest, string) {
     HybirdSetBase::IteratorBase* base = set->begin();
 
     while (base->has_next()) {
-        LOG(INFO) << ((StringValue*)base->get_value())->ptr;
+        LOG(INFO) << ((StringValue*)base->get_value())->to_string();
         base->next();
     }
 
@@ -324,6 +327,46 @@ TEST_F(HybirdSetTest, string) {
     b.len = 5;
     ASSERT_FALSE(set->find(&b));
 }
+// Probe sets of 'num_keys' strings with a mix of hits and misses, the hybird
+// set backs "col IN (...)" predicates, so this is the per row cost of such scans.
+static void probe_string_set(int num_keys, int num_probes) {
+    HybirdSetBase* set = HybirdSetBase::create_set(TYPE_VARCHAR);
+    std::vector<std::string> keys;
+    for (int i = 0; i < num_keys; ++i) {
+        keys.push_back("string_value_" + std::to_string(i * 2));
+        StringValue value(keys.back());
+        set->insert(&value);
+    }
+    ASSERT_EQ(num_keys, set->size());
+
+    std::vector<std::string> probes;
+    for (int i = 0; i < num_keys * 2; ++i) {
+        probes.push_back("string_value_" + std::to_string(i));
+    }
+
+    int hits = 0;
+    MonotonicStopWatch watch;
+    watch.start();
+    for (int i = 0; i < num_probes; ++i) {
+        StringValue value(probes[i % probes.size()]);
+        hits += set->find(&value);
+    }
+    uint64_t elapsed_ns = watch.elapsed_time();
+    ASSERT_EQ(num_probes / 2, hits);
+    LOG(INFO) << "probe " << num_probes << " rows against " << num_keys << " strings: "
+              << elapsed_ns / 1000000 << "ms, "
+              << num_probes * 1000.0 / std::max<uint64_t>(elapsed_ns, 1) << " M rows/s";
+    delete set;
+}
+
+TEST_F(HybirdSetTest, string_probe_benchmark) {
+    probe_string_set(1, 1000000);
+    probe_string_set(5, 1000000);
+    probe_string_set(16, 1000000);
+    probe_string_set(17, 1000000);
+    probe_string_set(500, 1000000);
+}
+
 TEST_F(HybirdSetTest, timestamp) {
     HybirdSetBase* set = HybirdSetBase::create_set(TYPE_DATETIME);
     char s1[] = "2012-01-20 01:10:01";
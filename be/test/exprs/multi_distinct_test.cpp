@@ -0,0 +1,225 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "exprs/aggregate_functions.h"
+
+#include <cstring>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/config.h"
+#include "testutil/function_utils.h"
+
+namespace doris {
+
+// The type byte of a serialized state with a bitmap payload has the high bit set.
+static const uint8_t BITMAP_FLAG = 0x80;
+
+class MultiDistinctTest : public testing::Test {
+public:
+    void SetUp() override {
+        _utils = new FunctionUtils();
+        _ctx = _utils->get_fn_ctx();
+        _saved_bitmap_state = config::multi_distinct_bitmap_state;
+        config::multi_distinct_bitmap_state = true;
+    }
+
+    void TearDown() override {
+        config::multi_distinct_bitmap_state = _saved_bitmap_state;
+        delete _utils;
+    }
+
+protected:
+    StringVal make_state(const std::vector<int64_t>& values) {
+        StringVal state;
+        AggregateFunctions::count_or_sum_distinct_numeric_init<BigIntVal>(_ctx, &state);
+        for (int64_t value : values) {
+            BigIntVal val(value);
+            AggregateFunctions::count_or_sum_distinct_numeric_update<BigIntVal>(_ctx, val, &state);
+        }
+        return state;
+    }
+
+    // serializes and releases 'state'
+    StringVal serialize(const StringVal& state) {
+        return AggregateFunctions::count_or_sum_distinct_numeric_serialize<BigIntVal>(_ctx, state);
+    }
+
+    void merge(StringVal& src, StringVal* dst) {
+        AggregateFunctions::count_or_sum_distinct_numeric_merge<BigIntVal>(_ctx, src, dst);
+    }
+
+    // finalizes and releases 'state'
+    int64_t count(const StringVal& state) {
+        return AggregateFunctions::count_or_sum_distinct_numeric_finalize<BigIntVal>(
+                _ctx, state).val;
+    }
+
+    // finalizes and releases 'state'
+    int64_t sum(const StringVal& state) {
+        return AggregateFunctions::sum_distinct_bigint_finalize<BigIntVal>(_ctx, state).val;
+    }
+
+    static bool is_bitmap(const StringVal& serialized) {
+        return (serialized.ptr[0] & BITMAP_FLAG) != 0;
+    }
+
+    static std::vector<int64_t> range(int64_t begin, int64_t end, int64_t step = 1) {
+        std::vector<int64_t> values;
+        for (int64_t value = begin; value < end; value += step) {
+            values.push_back(value);
+        }
+        return values;
+    }
+
+    FunctionUtils* _utils = nullptr;
+    FunctionContext* _ctx = nullptr;
+    bool _saved_bitmap_state;
+};
+
+TEST_F(MultiDistinctTest, SwitchToBitmapAtThreshold) {
+    // up to the threshold, the values are listed
+    StringVal serialized = serialize(make_state(range(0, 8192)));
+    ASSERT_FALSE(is_bitmap(serialized));
+    ASSERT_EQ(FunctionContext::TYPE_BIGINT, serialized.ptr[0]);
+    ASSERT_EQ(1 + 8 * 8192, serialized.len);
+
+    serialized = serialize(make_state(range(0, 8193)));
+    ASSERT_TRUE(is_bitmap(serialized));
+    ASSERT_EQ(FunctionContext::TYPE_BIGINT, serialized.ptr[0] & ~BITMAP_FLAG);
+    ASSERT_LT(serialized.len, 8 * 8193);
+
+    StringVal state = make_state({});
+    merge(serialized, &state);
+    ASSERT_EQ(8193, count(state));
+}
+
+TEST_F(MultiDistinctTest, SparseValuesStayInSet) {
+    // the values are further apart than a bitmap pays off for
+    std::vector<int64_t> values = range(0, 9000 * 2048, 2048);
+    StringVal serialized = serialize(make_state(values));
+    ASSERT_FALSE(is_bitmap(serialized));
+    ASSERT_EQ(1 + 8 * values.size(), static_cast<size_t>(serialized.len));
+
+    // dense values added later switch it once the set has doubled
+    std::vector<int64_t> dense_values = range(0, 40000);
+    values.insert(values.end(), dense_values.begin(), dense_values.end());
+    serialized = serialize(make_state(values));
+    ASSERT_TRUE(is_bitmap(serialized));
+    StringVal state = make_state({});
+    merge(serialized, &state);
+    std::set<int64_t> expected(values.begin(), values.end());
+    ASSERT_EQ(expected.size(), static_cast<size_t>(count(state)));
+}
+
+TEST_F(MultiDistinctTest, NegativeValues) {
+    std::vector<int64_t> values = range(-10000, 9000);
+    StringVal state = make_state(values);
+    StringVal serialized = serialize(state);
+    ASSERT_TRUE(is_bitmap(serialized));
+
+    state = make_state({});
+    merge(serialized, &state);
+    StringVal copy = make_state({});
+    StringVal reserialized = serialize(state);
+    merge(reserialized, &copy);
+    ASSERT_EQ(values.size(), static_cast<size_t>(count(copy)));
+
+    state = make_state({});
+    merge(reserialized, &state);
+    int64_t expected_sum = 0;
+    for (int64_t value = -10000; value < 9000; ++value) {
+        expected_sum += value;
+    }
+    ASSERT_EQ(expected_sum, sum(state));
+}
+
+TEST_F(MultiDistinctTest, MergeSetsAndBitmaps) {
+    std::vector<int64_t> dense_values = range(0, 10000);
+    std::vector<int64_t> set_values = {5000, 5001, -7, 1L << 50, 12345};
+    std::set<int64_t> expected(dense_values.begin(), dense_values.end());
+    expected.insert(set_values.begin(), set_values.end());
+    int64_t expected_sum = 0;
+    for (int64_t value : expected) {
+        expected_sum += value;
+    }
+
+    // a set into a bitmap
+    StringVal state = make_state(dense_values);
+    StringVal serialized = serialize(make_state(set_values));
+    ASSERT_FALSE(is_bitmap(serialized));
+    merge(serialized, &state);
+    serialized = serialize(state);
+    ASSERT_TRUE(is_bitmap(serialized));
+    state = make_state({});
+    merge(serialized, &state);
+    ASSERT_EQ(expected_sum, sum(state));
+
+    // a bitmap into a set
+    state = make_state(set_values);
+    serialized = serialize(make_state(dense_values));
+    ASSERT_TRUE(is_bitmap(serialized));
+    merge(serialized, &state);
+    serialized = serialize(state);
+    ASSERT_TRUE(is_bitmap(serialized));
+    state = make_state({});
+    merge(serialized, &state);
+    ASSERT_EQ(expected.size(), static_cast<size_t>(count(state)));
+
+    // two bitmaps
+    state = make_state(range(5000, 15000));
+    serialized = serialize(make_state(dense_values));
+    merge(serialized, &state);
+    ASSERT_EQ(15000, count(state));
+}
+
+TEST_F(MultiDistinctTest, BitmapStateDisabled) {
+    // backends of older versions only read the listed values
+    config::multi_distinct_bitmap_state = false;
+    std::vector<int64_t> values = range(-5000, 5000);
+    StringVal serialized = serialize(make_state(values));
+    ASSERT_FALSE(is_bitmap(serialized));
+    ASSERT_EQ(FunctionContext::TYPE_BIGINT, serialized.ptr[0]);
+    ASSERT_EQ(1 + 8 * values.size(), static_cast<size_t>(serialized.len));
+    std::set<int64_t> listed;
+    for (size_t i = 0; i < values.size(); ++i) {
+        int64_t value;
+        memcpy(&value, serialized.ptr + 1 + 8 * i, sizeof(value));
+        listed.insert(value);
+    }
+    ASSERT_EQ(std::set<int64_t>(values.begin(), values.end()), listed);
+
+    // a bitmap state sent before the switch is still read
+    config::multi_distinct_bitmap_state = true;
+    StringVal bitmap_serialized = serialize(make_state(values));
+    ASSERT_TRUE(is_bitmap(bitmap_serialized));
+    config::multi_distinct_bitmap_state = false;
+    StringVal state = make_state({});
+    merge(bitmap_serialized, &state);
+    merge(serialized, &state);
+    ASSERT_EQ(values.size(), static_cast<size_t>(count(state)));
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -124,6 +124,19 @@ TEST_F(HttpClientTest, download) {
     auto size = fread(buf, 1, 50, fp);
     buf[size] = 0;
     ASSERT_STREQ("test1", buf);
+    fclose(fp);
+    unlink(local_file.c_str());
+
+    // observe the downloaded data
+    st = client.init("http://127.0.0.1:29998/simple_get");
+    ASSERT_TRUE(st.ok());
+    client.set_basic_auth("test1", "");
+    std::string data;
+    st = client.download(local_file, [&data] (const void* piece, size_t length) {
+        data.append((const char*)piece, length);
+    });
+    ASSERT_TRUE(st.ok());
+    ASSERT_EQ("test1", data);
     unlink(local_file.c_str());
 }
 
@@ -0,0 +1,335 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "olap/collect_iterator.h"
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gen_cpp/olap_file.pb.h"
+#include "olap/data_dir.h"
+#include "olap/reader.h"
+#include "olap/row_block.h"
+#include "olap/row_cursor.h"
+#include "olap/tablet.h"
+#include "olap/tablet_meta.h"
+
+namespace doris {
+
+// the keys of the blocks of a rowset, in order
+typedef std::vector<std::vector<int32_t>> TestBlocks;
+
+// A rowset of the test schema (k INT key, v INT value). Every row has the version
+// of the rowset as its value, so the output tells which rowset a row came from.
+class TestRowsetReader : public RowsetReader {
+public:
+    TestRowsetReader(const TabletSchema* schema, int32_t version, const TestBlocks& blocks) :
+            _version(version) {
+        RowCursor row;
+        row.init(*schema);
+        for (auto& keys : blocks) {
+            std::unique_ptr<RowBlock> block(new RowBlock(schema));
+            RowBlockInfo block_info;
+            block_info.row_num = std::max<size_t>(1, keys.size());
+            block_info.null_supported = true;
+            block->init(block_info);
+            for (int i = 0; i < keys.size(); ++i) {
+                block->get_row(i, &row);
+                row.set_not_null(0);
+                row.set_field_content(0, (const char*)&keys[i], block->mem_pool());
+                row.set_not_null(1);
+                row.set_field_content(1, (const char*)&_version, block->mem_pool());
+            }
+            block->finalize(keys.size());
+            block->set_pos(0);
+            block->set_limit(keys.size());
+            block->set_block_status(DEL_NOT_SATISFIED);
+            _blocks.push_back(std::move(block));
+        }
+    }
+
+    OLAPStatus init(RowsetReaderContext* read_context) override {
+        return OLAP_SUCCESS;
+    }
+
+    OLAPStatus next_block(RowBlock** block) override {
+        if (_next_block == _blocks.size()) {
+            *block = nullptr;
+            return OLAP_ERR_DATA_EOF;
+        }
+        *block = _blocks[_next_block++].get();
+        return OLAP_SUCCESS;
+    }
+
+    bool delete_flag() override {
+        return false;
+    }
+    Version version() override {
+        return Version(_version, _version);
+    }
+    VersionHash version_hash() override {
+        return 0;
+    }
+    RowsetSharedPtr rowset() override {
+        return nullptr;
+    }
+    int64_t filtered_rows() override {
+        return 0;
+    }
+
+private:
+    int32_t _version;
+    std::vector<std::unique_ptr<RowBlock>> _blocks;
+    size_t _next_block = 0;
+};
+
+// (key, version) of an output row
+typedef std::pair<int32_t, int32_t> TestRow;
+
+class CollectIteratorTest : public testing::Test {
+public:
+    void SetUp() override {
+        TabletMetaPB tablet_meta_pb;
+        tablet_meta_pb.set_table_id(1);
+        tablet_meta_pb.set_partition_id(1);
+        tablet_meta_pb.set_tablet_id(1);
+        tablet_meta_pb.set_schema_hash(1);
+        tablet_meta_pb.set_shard_id(0);
+        tablet_meta_pb.set_tablet_state(PB_RUNNING);
+        TabletSchemaPB* schema_pb = tablet_meta_pb.mutable_schema();
+        schema_pb->set_keys_type(DUP_KEYS);
+        schema_pb->set_num_short_key_columns(1);
+        schema_pb->set_num_rows_per_row_block(1024);
+        ColumnPB* k = schema_pb->add_column();
+        k->set_unique_id(0);
+        k->set_name("k");
+        k->set_type("INT");
+        k->set_is_key(true);
+        k->set_length(4);
+        k->set_is_nullable(false);
+        k->set_aggregation("NONE");
+        ColumnPB* v = schema_pb->add_column();
+        v->set_unique_id(1);
+        v->set_name("v");
+        v->set_type("INT");
+        v->set_is_key(false);
+        v->set_length(4);
+        v->set_is_nullable(false);
+        v->set_aggregation("NONE");
+        TabletMetaSharedPtr tablet_meta(new TabletMeta());
+        ASSERT_EQ(OLAP_SUCCESS, tablet_meta->init_from_pb(tablet_meta_pb));
+
+        _data_dir.reset(new DataDir("./ut_dir/collect_iterator_test"));
+        _tablet.reset(new Tablet(tablet_meta, _data_dir.get()));
+    }
+
+protected:
+    // A merging iterator over rowsets of the given versions and blocks.
+    void init_iterator(const std::vector<int32_t>& versions,
+                       const std::vector<TestBlocks>& rowsets) {
+        _reader.reset(new Reader());
+        _reader->_tablet = _tablet;
+        _reader->_seek_columns = {0, 1};
+        // compactions always merge
+        _reader->_reader_type = READER_CUMULATIVE_COMPACTION;
+        _iterator.reset(new CollectIterator());
+        ASSERT_EQ(OLAP_SUCCESS, _iterator->init(_reader.get()));
+        ASSERT_TRUE(_iterator->_merge);
+        for (int i = 0; i < rowsets.size(); ++i) {
+            RowsetReaderSharedPtr rs_reader(
+                    new TestRowsetReader(&_tablet->tablet_schema(), versions[i], rowsets[i]));
+            // a rowset without rows isn't added
+            OLAPStatus res = _iterator->add_child(rs_reader);
+            ASSERT_TRUE(res == OLAP_SUCCESS || res == OLAP_ERR_DATA_EOF);
+        }
+        _iterator->build_merge_tree();
+        _num_block_runs = 0;
+    }
+
+    static TestRow to_test_row(const RowCursor* row) {
+        return TestRow(*reinterpret_cast<const int32_t*>(row->cell_ptr(0)),
+                       *reinterpret_cast<const int32_t*>(row->cell_ptr(1)));
+    }
+
+    std::vector<TestRow> read_all() {
+        std::vector<TestRow> rows;
+        bool delete_flag = false;
+        const RowCursor* row = _iterator->current_row(&delete_flag);
+        while (row != nullptr) {
+            rows.push_back(to_test_row(row));
+            auto res = _iterator->next(&row, &delete_flag);
+            if (res == OLAP_ERR_DATA_EOF) {
+                EXPECT_TRUE(row == nullptr);
+                break;
+            }
+            EXPECT_EQ(OLAP_SUCCESS, res);
+            if (_iterator->_in_block_run) {
+                ++_num_block_runs;
+            }
+        }
+        EXPECT_TRUE(_iterator->current_row(&delete_flag) == nullptr);
+        return rows;
+    }
+
+    // the rows of all rowsets in key order, equal keys in version order
+    static std::vector<TestRow> expected_rows(const std::vector<int32_t>& versions,
+                                              const std::vector<TestBlocks>& rowsets) {
+        std::vector<TestRow> rows;
+        for (int i = 0; i < rowsets.size(); ++i) {
+            for (auto& keys : rowsets[i]) {
+                for (int32_t key : keys) {
+                    rows.emplace_back(key, versions[i]);
+                }
+            }
+        }
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    void check_merge(const std::vector<int32_t>& versions,
+                     const std::vector<TestBlocks>& rowsets) {
+        init_iterator(versions, rowsets);
+        ASSERT_EQ(expected_rows(versions, rowsets), read_all());
+    }
+
+    std::unique_ptr<DataDir> _data_dir;
+    TabletSharedPtr _tablet;
+    std::unique_ptr<Reader> _reader;
+    std::unique_ptr<CollectIterator> _iterator;
+    // the rows returned while the iterator was in a block run
+    int _num_block_runs = 0;
+};
+
+TEST_F(CollectIteratorTest, EqualKeysInVersionOrder) {
+    // the children aren't added in the version order
+    std::vector<int32_t> versions = {3, 1, 5, 2, 4};
+    std::vector<TestBlocks> rowsets(versions.size(), TestBlocks({{1, 2, 3}, {4, 5}}));
+    init_iterator(versions, rowsets);
+    std::vector<TestRow> rows = read_all();
+    ASSERT_EQ(25, rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        ASSERT_EQ(TestRow(i / 5 + 1, i % 5 + 1), rows[i]);
+    }
+}
+
+TEST_F(CollectIteratorTest, ChildrenReachEofAtDifferentTimes) {
+    std::vector<int32_t> versions = {1, 2, 3, 4};
+    std::vector<TestBlocks> rowsets = {
+        {{0, 1, 2, 3}, {4, 5, 6, 7, 8, 9}},
+        {{0, 2}},
+        {},
+        {{5}, {50, 60}, {70, 80, 90, 100}},
+    };
+    check_merge(versions, rowsets);
+
+    // the last child to end is the one added first
+    rowsets = {
+        {{0}, {100}},
+        {{1, 2}},
+        {{3}},
+    };
+    check_merge({1, 2, 3}, rowsets);
+
+    // a single child
+    rowsets = {TestBlocks({{1, 2, 3}, {4}})};
+    check_merge({7}, rowsets);
+
+    // no child at all
+    rowsets = {TestBlocks()};
+    init_iterator({1}, rowsets);
+    bool delete_flag = false;
+    ASSERT_TRUE(_iterator->current_row(&delete_flag) == nullptr);
+}
+
+TEST_F(CollectIteratorTest, OddAndEvenChildCounts) {
+    std::mt19937 rng(42);
+    for (int num_children = 1; num_children <= 9; ++num_children) {
+        std::vector<int32_t> versions;
+        std::vector<TestBlocks> rowsets;
+        for (int i = 0; i < num_children; ++i) {
+            versions.push_back(num_children - i);
+            // ascending keys, some shared with the other children, in blocks of 1 to 8
+            TestBlocks blocks;
+            int32_t key = rng() % 10;
+            int num_rows = rng() % 50;
+            while (num_rows > 0) {
+                int block_rows = std::min<int>(num_rows, 1 + rng() % 8);
+                std::vector<int32_t> keys;
+                for (int j = 0; j < block_rows; ++j) {
+                    keys.push_back(key);
+                    key += 1 + rng() % 3;
+                }
+                blocks.push_back(keys);
+                num_rows -= block_rows;
+            }
+            rowsets.push_back(blocks);
+        }
+        SCOPED_TRACE(num_children);
+        check_merge(versions, rowsets);
+    }
+}
+
+TEST_F(CollectIteratorTest, BlockRunHandoff) {
+    // the children take turns with whole blocks
+    std::vector<int32_t> versions = {1, 2};
+    std::vector<TestBlocks> rowsets = {
+        {{1, 2, 3, 4, 5, 6, 7, 8, 9, 10}, {21, 22, 23, 24, 25, 26, 27, 28, 29, 30}},
+        {{11, 12, 13, 14, 15, 16, 17, 18, 19, 20}, {31, 32, 33, 34, 35, 36, 37, 38, 39, 40}},
+    };
+    init_iterator(versions, rowsets);
+    ASSERT_EQ(expected_rows(versions, rowsets), read_all());
+    // every block is returned mostly without comparing
+    ASSERT_GE(_num_block_runs, 4 * 7);
+
+    // the last row of a block equals the runner-up's row: the block is only owned
+    // if its version is lower
+    rowsets = {
+        {{1, 2, 3, 4, 5}, {9}},
+        {{5, 6, 7, 8}},
+    };
+    check_merge({1, 2}, rowsets);
+    check_merge({2, 1}, rowsets);
+
+    // a run ends when the block does even though the next block would win as well
+    rowsets = {
+        {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}},
+        {{100}},
+    };
+    check_merge({1, 2}, rowsets);
+
+    // interleaved keys never start a run
+    rowsets = {
+        {{1, 3, 5, 7, 9}},
+        {{2, 4, 6, 8, 10}},
+    };
+    init_iterator({1, 2}, rowsets);
+    ASSERT_EQ(expected_rows({1, 2}, rowsets), read_all());
+    ASSERT_EQ(0, _num_block_runs);
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
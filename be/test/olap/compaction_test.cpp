@@ -0,0 +1,313 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "olap/compaction.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/config.h"
+#include "gen_cpp/AgentService_types.h"
+#include "olap/delete_handler.h"
+#include "olap/olap_cond.h"
+#include "olap/options.h"
+#include "olap/row_block.h"
+#include "olap/row_cursor.h"
+#include "olap/rowset/rowset_factory.h"
+#include "olap/rowset/rowset_reader_context.h"
+#include "olap/storage_engine.h"
+#include "olap/tablet.h"
+#include "runtime/mem_pool.h"
+#include "runtime/mem_tracker.h"
+#include "util/cpu_info.h"
+#include "util/file_utils.h"
+#include "util/logging.h"
+
+namespace doris {
+
+static StorageEngine* k_engine = nullptr;
+
+// (key, version) of a row of the test tablet (k INT key, v INT value), every row has
+// the version of its input rowset as the value
+typedef std::pair<int32_t, int32_t> TestRow;
+
+// Compacts the given rowsets, as a cumulative compaction would.
+class TestCompaction : public Compaction {
+public:
+    TestCompaction(TabletSharedPtr tablet, const std::vector<RowsetSharedPtr>& rowsets)
+            : Compaction(tablet), _rowsets(rowsets) {}
+
+    OLAPStatus compact() override {
+        RETURN_NOT_OK(pick_rowsets_to_compact());
+        RETURN_NOT_OK(do_compaction());
+        _state = CompactionState::SUCCESS;
+        return gc_unused_rowsets();
+    }
+
+    RowsetSharedPtr output_rowset() const {
+        return _output_rowset;
+    }
+
+protected:
+    OLAPStatus pick_rowsets_to_compact() override {
+        _input_rowsets = _rowsets;
+        return check_version_continuity(_input_rowsets);
+    }
+
+    std::string compaction_name() const override {
+        return "test compaction";
+    }
+
+    ReaderType compaction_type() const override {
+        return ReaderType::READER_CUMULATIVE_COMPACTION;
+    }
+
+private:
+    std::vector<RowsetSharedPtr> _rowsets;
+};
+
+class CompactionTest : public testing::Test {
+public:
+    void SetUp() override {
+        _tracker.reset(new MemTracker(-1));
+        _mem_pool.reset(new MemPool(_tracker.get()));
+        _saved_num_ranges = config::compaction_parallel_merge_num_ranges;
+        _saved_min_bytes = config::compaction_parallel_merge_min_bytes;
+        config::compaction_parallel_merge_num_ranges = 4;
+        config::compaction_parallel_merge_min_bytes = 0;
+    }
+
+    void TearDown() override {
+        if (_tablet != nullptr) {
+            k_engine->tablet_manager()->drop_tablet(_tablet->tablet_id(), _tablet->schema_hash());
+            _tablet.reset();
+        }
+        config::compaction_parallel_merge_num_ranges = _saved_num_ranges;
+        config::compaction_parallel_merge_min_bytes = _saved_min_bytes;
+        set_compaction_rowset_type(ALPHA_ROWSET);
+    }
+
+protected:
+    void set_compaction_rowset_type(RowsetTypePB rowset_type) {
+        k_engine->_compaction_rowset_type = rowset_type;
+    }
+
+    void create_tablet(int64_t tablet_id) {
+        TCreateTabletReq request;
+        request.tablet_id = tablet_id;
+        request.__set_version(1);
+        request.__set_version_hash(0);
+        request.tablet_schema.schema_hash = 1;
+        request.tablet_schema.short_key_column_count = 1;
+        request.tablet_schema.keys_type = TKeysType::DUP_KEYS;
+        request.tablet_schema.storage_type = TStorageType::COLUMN;
+
+        TColumn k;
+        k.column_name = "k";
+        k.__set_is_key(true);
+        k.column_type.type = TPrimitiveType::INT;
+        request.tablet_schema.columns.push_back(k);
+
+        TColumn v;
+        v.column_name = "v";
+        v.__set_is_key(false);
+        v.column_type.type = TPrimitiveType::INT;
+        v.__set_aggregation_type(TAggregationType::NONE);
+        request.tablet_schema.columns.push_back(v);
+
+        ASSERT_EQ(OLAP_SUCCESS, k_engine->create_tablet(request));
+        _tablet = k_engine->tablet_manager()->get_tablet(tablet_id, 1);
+        ASSERT_TRUE(_tablet != nullptr);
+    }
+
+    std::vector<TestRow> read_rowset(RowsetSharedPtr rowset) {
+        std::vector<TestRow> rows;
+        std::vector<uint32_t> return_columns = {0, 1};
+        DeleteHandler delete_handler;
+        DelPredicateArray delete_predicates;
+        EXPECT_EQ(OLAP_SUCCESS, delete_handler.init(_tablet->tablet_schema(), delete_predicates,
+                                                    rowset->end_version()));
+        std::vector<ColumnPredicate*> predicates;
+        std::set<uint32_t> load_bf_columns;
+        Conditions conditions;
+        conditions.set_tablet_schema(&_tablet->tablet_schema());
+        OlapReaderStatistics stats;
+        RowsetReaderContext context;
+        context.reader_type = READER_QUERY;
+        context.tablet_schema = &_tablet->tablet_schema();
+        context.need_ordered_result = true;
+        context.return_columns = &return_columns;
+        context.seek_columns = &return_columns;
+        context.load_bf_columns = &load_bf_columns;
+        context.conditions = &conditions;
+        context.predicates = &predicates;
+        context.delete_handler = &delete_handler;
+        context.stats = &stats;
+
+        RowsetReaderSharedPtr rs_reader;
+        EXPECT_EQ(OLAP_SUCCESS, rowset->create_reader(&rs_reader));
+        EXPECT_EQ(OLAP_SUCCESS, rs_reader->init(&context));
+        RowCursor row;
+        EXPECT_EQ(OLAP_SUCCESS, row.init(_tablet->tablet_schema()));
+        RowBlock* block = nullptr;
+        while (rs_reader->next_block(&block) == OLAP_SUCCESS) {
+            for (; block->has_remaining(); block->pos_inc()) {
+                block->get_row(block->pos(), &row);
+                rows.emplace_back(*reinterpret_cast<const int32_t*>(row.cell_ptr(0)),
+                                  *reinterpret_cast<const int32_t*>(row.cell_ptr(1)));
+            }
+        }
+        delete_handler.finalize();
+        return rows;
+    }
+
+    // Compacts the versions [2, 4] of rowsets with overlapping keys and reads the
+    // output back.
+    void check_compaction(RowsetTypePB rowset_type, RowsetSharedPtr* output_rowset) {
+        std::vector<RowsetSharedPtr> input_rowsets;
+        for (int32_t version = 2; version <= 4; ++version) {
+            // the keys of every rowset, and every third key of all of them
+            std::vector<int32_t> keys;
+            for (int32_t key = 0; key < 20000; ++key) {
+                if (key % 3 == version - 2 || key % 9 == 0) {
+                    keys.push_back(key);
+                }
+            }
+            RowsetSharedPtr rowset = write_rowset(rowset_type, version, keys);
+            ASSERT_TRUE(rowset != nullptr);
+            ASSERT_EQ(OLAP_SUCCESS, _tablet->add_rowset(rowset, false));
+            input_rowsets.push_back(rowset);
+        }
+
+        TestCompaction compaction(_tablet, input_rowsets);
+        ASSERT_EQ(OLAP_SUCCESS, compaction.compact());
+        *output_rowset = compaction.output_rowset();
+        ASSERT_TRUE(*output_rowset != nullptr);
+        ASSERT_EQ(rowset_type, (*output_rowset)->rowset_meta()->rowset_type());
+        ASSERT_EQ(Version(2, 4), (*output_rowset)->version());
+
+        std::sort(_expected_rows.begin(), _expected_rows.end());
+        ASSERT_EQ(_expected_rows.size(), (*output_rowset)->num_rows());
+        ASSERT_EQ(_expected_rows, read_rowset(*output_rowset));
+    }
+
+    RowsetSharedPtr write_rowset(RowsetTypePB rowset_type, int32_t version,
+                                 const std::vector<int32_t>& keys) {
+        RowsetWriterContext context;
+        context.rowset_id = k_engine->next_rowset_id();
+        context.tablet_uid = _tablet->tablet_uid();
+        context.tablet_id = _tablet->tablet_id();
+        context.partition_id = _tablet->partition_id();
+        context.tablet_schema_hash = _tablet->schema_hash();
+        context.rowset_type = rowset_type;
+        context.rowset_path_prefix = _tablet->tablet_path();
+        context.tablet_schema = &(_tablet->tablet_schema());
+        context.rowset_state = VISIBLE;
+        context.version = Version(version, version);
+        context.version_hash = 0;
+        std::unique_ptr<RowsetWriter> rowset_writer;
+        if (RowsetFactory::create_rowset_writer(context, &rowset_writer) != OLAP_SUCCESS) {
+            return nullptr;
+        }
+
+        RowCursor row;
+        if (row.init(_tablet->tablet_schema()) != OLAP_SUCCESS) {
+            return nullptr;
+        }
+        for (int32_t key : keys) {
+            row.set_not_null(0);
+            row.set_field_content(0, reinterpret_cast<char*>(&key), _mem_pool.get());
+            row.set_not_null(1);
+            row.set_field_content(1, reinterpret_cast<char*>(&version), _mem_pool.get());
+            if (rowset_writer->add_row(row) != OLAP_SUCCESS) {
+                return nullptr;
+            }
+            _expected_rows.emplace_back(key, version);
+        }
+        if (rowset_writer->flush() != OLAP_SUCCESS) {
+            return nullptr;
+        }
+        return rowset_writer->build();
+    }
+
+    std::unique_ptr<MemTracker> _tracker;
+    std::unique_ptr<MemPool> _mem_pool;
+    TabletSharedPtr _tablet;
+    // the rows of all input rowsets
+    std::vector<TestRow> _expected_rows;
+    int32_t _saved_num_ranges;
+    int64_t _saved_min_bytes;
+};
+
+// The range rowsets of an ALPHA output would all link their segment group 0 to the
+// same files, so it's merged on the compaction thread.
+TEST_F(CompactionTest, AlphaOutputWithKeyRanges) {
+    set_compaction_rowset_type(ALPHA_ROWSET);
+    create_tablet(10001);
+    RowsetSharedPtr output_rowset;
+    check_compaction(ALPHA_ROWSET, &output_rowset);
+}
+
+TEST_F(CompactionTest, BetaOutputWithKeyRanges) {
+    set_compaction_rowset_type(BETA_ROWSET);
+    create_tablet(10002);
+    RowsetSharedPtr output_rowset;
+    check_compaction(BETA_ROWSET, &output_rowset);
+    // a segment for each key range
+    ASSERT_GT(output_rowset->num_segments(), 1);
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    std::string conffile = std::string(getenv("DORIS_HOME")) + "/conf/be.conf";
+    if (!doris::config::init(conffile.c_str(), false)) {
+        fprintf(stderr, "error read config file. \n");
+        return -1;
+    }
+    doris::init_glog("be-test");
+    doris::CpuInfo::init();
+    ::testing::InitGoogleTest(&argc, argv);
+
+    char buffer[1024];
+    getcwd(buffer, 1024);
+    doris::config::storage_root_path = std::string(buffer) + "/data_compaction_test";
+    doris::FileUtils::remove_all(doris::config::storage_root_path);
+    doris::FileUtils::create_dir(doris::config::storage_root_path);
+    // the test compacts the tablets itself
+    doris::config::base_compaction_num_threads_per_disk = 0;
+    doris::config::cumulative_compaction_num_threads_per_disk = 0;
+    std::vector<doris::StorePath> paths;
+    paths.emplace_back(doris::config::storage_root_path, -1);
+    doris::EngineOptions options;
+    options.store_paths = paths;
+    doris::StorageEngine::open(options, &doris::k_engine);
+
+    int ret = RUN_ALL_TESTS();
+
+    delete doris::k_engine;
+    doris::k_engine = nullptr;
+    doris::FileUtils::remove_all(doris::config::storage_root_path);
+    google::protobuf::ShutdownProtobufLibrary();
+    return ret;
+}
@@ -941,6 +941,21 @@ TEST_F(TestDeleteHandler, FilterDataVersion) {
     _delete_handler.finalize();
 }
 
+TEST(DeleteHandlerTest, ParseCondition) {
+    TCondition condition;
+    ASSERT_TRUE(DeleteHandler::parse_condition("k1=1", &condition));
+    ASSERT_EQ("k1", condition.column_name);
+    ASSERT_EQ("=", condition.condition_op);
+    ASSERT_EQ(1, condition.condition_values.size());
+    ASSERT_EQ("1", condition.condition_values[0]);
+
+    ASSERT_TRUE(DeleteHandler::parse_condition("k_2 >= 2014-01-01", &condition));
+    ASSERT_EQ("k_2", condition.column_name);
+    ASSERT_EQ(">=", condition.condition_op);
+
+    ASSERT_FALSE(DeleteHandler::parse_condition("=1", &condition));
+}
+
 }  // namespace doris
 
 int main(int argc, char** argv) {
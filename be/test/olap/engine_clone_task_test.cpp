@@ -0,0 +1,353 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "olap/task/engine_clone_task.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/config.h"
+#include "http/ev_http_server.h"
+#include "http/http_channel.h"
+#include "http/http_handler.h"
+#include "http/http_headers.h"
+#include "http/http_request.h"
+#include "olap/data_dir.h"
+#include "util/file_utils.h"
+#include "util/md5.h"
+#include "util/thread_pool.hpp"
+
+namespace doris {
+
+// Serves the files of a snapshot as the download action does.
+class TestDownloadHandler : public HttpHandler {
+public:
+    void handle(HttpRequest* req) override {
+        const std::string& path = req->param("file");
+        std::string file_name = path.substr(path.rfind('/') + 1);
+        std::lock_guard<std::mutex> l(_lock);
+        auto it = _files.find(file_name);
+        if (it == _files.end()) {
+            HttpChannel::send_error(req, HttpStatus::NOT_FOUND);
+            return;
+        }
+        const std::string& content = it->second;
+        if (req->method() == HttpMethod::HEAD) {
+            req->add_output_header(HttpHeaders::CONTENT_LENGTH,
+                                   std::to_string(content.size()).c_str());
+            HttpChannel::send_reply(req);
+        } else if (req->param("acquire_md5") == "true" && _md5_supported) {
+            Md5Digest md5;
+            md5.update(content.data(), content.size());
+            md5.digest();
+            HttpChannel::send_reply(req, md5.hex());
+        } else if (req->param("acquire_md5") == "true") {
+            // a source of an older version doesn't know the parameter
+            HttpChannel::send_reply(req, content);
+        } else {
+            _downloads.push_back(file_name);
+            if (_num_corrupt_replies > 0) {
+                --_num_corrupt_replies;
+                std::string corrupt_content = content;
+                corrupt_content[corrupt_content.size() / 2] ^= 0x01;
+                HttpChannel::send_reply(req, corrupt_content);
+            } else {
+                HttpChannel::send_reply(req, content);
+            }
+        }
+    }
+
+    void reset(bool md5_supported) {
+        std::lock_guard<std::mutex> l(_lock);
+        _files.clear();
+        _downloads.clear();
+        _md5_supported = md5_supported;
+        _num_corrupt_replies = 0;
+    }
+
+    void add_file(const std::string& file_name, const std::string& content) {
+        std::lock_guard<std::mutex> l(_lock);
+        _files[file_name] = content;
+    }
+
+    // the next 'n' downloads reply the files with a byte changed
+    void corrupt_replies(int n) {
+        std::lock_guard<std::mutex> l(_lock);
+        _num_corrupt_replies = n;
+    }
+
+    // the files downloaded, in order, not counting the md5 requests
+    std::vector<std::string> downloads() {
+        std::lock_guard<std::mutex> l(_lock);
+        return _downloads;
+    }
+
+private:
+    std::mutex _lock;
+    std::map<std::string, std::string> _files;
+    std::vector<std::string> _downloads;
+    bool _md5_supported = true;
+    int _num_corrupt_replies = 0;
+};
+
+static TestDownloadHandler s_download_handler;
+static EvHttpServer* s_server = nullptr;
+
+class EngineCloneTaskTest : public testing::Test {
+public:
+    static void SetUpTestCase() {
+        s_server = new EvHttpServer(29996);
+        s_server->register_handler(GET, "/api/_tablet/_download", &s_download_handler);
+        s_server->register_handler(HEAD, "/api/_tablet/_download", &s_download_handler);
+        s_server->start();
+    }
+
+    static void TearDownTestCase() {
+        delete s_server;
+        s_server = nullptr;
+    }
+
+    void SetUp() override {
+        _saved_verify_md5 = config::clone_download_verify_md5;
+        _saved_bytes_per_sec = config::clone_download_bytes_per_sec;
+        _saved_low_speed_time = config::download_low_speed_time;
+        s_download_handler.reset(true);
+        FileUtils::remove_all(_root_path);
+        ASSERT_TRUE(FileUtils::create_dir(_local_path).ok());
+        _data_dir.reset(new DataDir(_root_path));
+        ASSERT_TRUE(_data_dir->update_capacity().ok());
+        _task.reset(new EngineCloneTask(_clone_req, _master_info, 1, &_error_msgs,
+                                        &_tablet_infos, &_res_status));
+    }
+
+    void TearDown() override {
+        config::clone_download_verify_md5 = _saved_verify_md5;
+        config::clone_download_bytes_per_sec = _saved_bytes_per_sec;
+        config::download_low_speed_time = _saved_low_speed_time;
+        FileUtils::remove_all(_root_path);
+    }
+
+protected:
+    AgentStatus download_file(const std::string& file_name, uint64_t* file_size) {
+        return _task->_download_file(*_data_dir, _remote_url_prefix + file_name,
+                                     _local_path + file_name, file_size);
+    }
+
+    AgentStatus download_files(ThreadPool* thread_pool,
+                               const std::vector<std::string>& file_names,
+                               uint64_t* total_file_size) {
+        return _task->_download_files(thread_pool, *_data_dir, _remote_url_prefix,
+                                      _local_path, file_names, total_file_size);
+    }
+
+    static int64_t download_low_speed_limit(DataDir& data_dir) {
+        return EngineCloneTask::_download_low_speed_limit(data_dir);
+    }
+
+    std::string read_local_file(const std::string& file_name) {
+        std::ifstream file(_local_path + file_name, std::ios::binary);
+        std::stringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+    static std::string make_content(size_t size, char seed) {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i) {
+            content[i] = static_cast<char>(seed + i * 7);
+        }
+        return content;
+    }
+
+    const std::string _root_path = "./ut_dir/engine_clone_task_test";
+    const std::string _local_path = _root_path + "/clone/";
+    const std::string _remote_url_prefix =
+            "http://127.0.0.1:29996/api/_tablet/_download?token=t&file=/snapshot/";
+    TCloneReq _clone_req;
+    TMasterInfo _master_info;
+    std::vector<std::string> _error_msgs;
+    std::vector<TTabletInfo> _tablet_infos;
+    AgentStatus _res_status = DORIS_SUCCESS;
+    std::unique_ptr<DataDir> _data_dir;
+    std::unique_ptr<EngineCloneTask> _task;
+    bool _saved_verify_md5;
+    int64_t _saved_bytes_per_sec;
+    int32_t _saved_low_speed_time;
+};
+
+TEST_F(EngineCloneTaskTest, DownloadFile) {
+    std::string content = make_content(100 * 1024, 'a');
+    s_download_handler.add_file("1_0.dat", content);
+    uint64_t file_size = 0;
+    ASSERT_EQ(DORIS_SUCCESS, download_file("1_0.dat", &file_size));
+    ASSERT_EQ(content.size(), file_size);
+    ASSERT_EQ(content, read_local_file("1_0.dat"));
+    ASSERT_EQ(1U, s_download_handler.downloads().size());
+}
+
+TEST_F(EngineCloneTaskTest, RetryOnMd5Mismatch) {
+    std::string content = make_content(100 * 1024, 'a');
+    s_download_handler.add_file("1_0.dat", content);
+    s_download_handler.corrupt_replies(1);
+    uint64_t file_size = 0;
+    ASSERT_EQ(DORIS_SUCCESS, download_file("1_0.dat", &file_size));
+    ASSERT_EQ(content, read_local_file("1_0.dat"));
+    ASSERT_EQ(2U, s_download_handler.downloads().size());
+
+    // every attempt corrupted
+    s_download_handler.corrupt_replies(3);
+    ASSERT_EQ(DORIS_ERROR, download_file("1_0.dat", &file_size));
+    ASSERT_EQ(5U, s_download_handler.downloads().size());
+
+    // the corrupted file is taken without the check
+    config::clone_download_verify_md5 = false;
+    s_download_handler.corrupt_replies(1);
+    ASSERT_EQ(DORIS_SUCCESS, download_file("1_0.dat", &file_size));
+    ASSERT_NE(content, read_local_file("1_0.dat"));
+    ASSERT_EQ(6U, s_download_handler.downloads().size());
+}
+
+TEST_F(EngineCloneTaskTest, SourceWithoutMd5) {
+    // a source of an older version replies the file to the md5 request, the
+    // download goes on without the check
+    s_download_handler.reset(false);
+    std::string content = make_content(100 * 1024, 'a');
+    std::string short_content = "0123456789";
+    s_download_handler.add_file("1_0.dat", content);
+    s_download_handler.add_file("1_1.dat", short_content);
+    uint64_t file_size = 0;
+    ASSERT_EQ(DORIS_SUCCESS, download_file("1_0.dat", &file_size));
+    ASSERT_EQ(content.size(), file_size);
+    ASSERT_EQ(content, read_local_file("1_0.dat"));
+    ASSERT_EQ(DORIS_SUCCESS, download_file("1_1.dat", &file_size));
+    ASSERT_EQ(short_content, read_local_file("1_1.dat"));
+    std::vector<std::string> expected_downloads = {"1_0.dat", "1_1.dat"};
+    ASSERT_EQ(expected_downloads, s_download_handler.downloads());
+}
+
+TEST_F(EngineCloneTaskTest, DownloadFiles) {
+    ThreadPool thread_pool(2, 16);
+    std::vector<std::string> file_names = {"10.hdr"};
+    uint64_t expected_size = 0;
+    for (int i = 0; i < 8; ++i) {
+        std::string file_name = "1_" + std::to_string(i) + ".dat";
+        std::string content = make_content(10 * 1024 * (i + 1), 'a' + i);
+        s_download_handler.add_file(file_name, content);
+        file_names.push_back(file_name);
+        expected_size += content.size();
+    }
+    s_download_handler.add_file("10.hdr", "header");
+    expected_size += 6;
+
+    uint64_t total_file_size = 0;
+    ASSERT_EQ(DORIS_SUCCESS, download_files(&thread_pool, file_names, &total_file_size));
+    ASSERT_EQ(expected_size, total_file_size);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_EQ(make_content(10 * 1024 * (i + 1), 'a' + i),
+                  read_local_file("1_" + std::to_string(i) + ".dat"));
+    }
+    ASSERT_EQ("header", read_local_file("10.hdr"));
+    // the header goes last
+    std::vector<std::string> downloads = s_download_handler.downloads();
+    ASSERT_EQ(file_names.size(), downloads.size());
+    ASSERT_EQ("10.hdr", downloads.back());
+
+    // the header isn't downloaded when a data file fails
+    s_download_handler.reset(true);
+    s_download_handler.add_file("10.hdr", "header");
+    s_download_handler.add_file("1_0.dat", "data");
+    ASSERT_NE(DORIS_SUCCESS, download_files(&thread_pool, {"10.hdr", "1_0.dat", "1_1.dat"},
+                                            &total_file_size));
+    downloads = s_download_handler.downloads();
+    ASSERT_TRUE(std::find(downloads.begin(), downloads.end(), "10.hdr") == downloads.end());
+
+    // the files are still downloaded once the pool is shut down
+    thread_pool.shutdown();
+    thread_pool.join();
+    s_download_handler.reset(true);
+    s_download_handler.add_file("10.hdr", "header");
+    s_download_handler.add_file("1_0.dat", "data");
+    ASSERT_EQ(DORIS_SUCCESS, download_files(&thread_pool, {"10.hdr", "1_0.dat"},
+                                            &total_file_size));
+    ASSERT_EQ(10U, total_file_size);
+}
+
+TEST_F(EngineCloneTaskTest, LowSpeedLimit) {
+    ASSERT_EQ(config::download_low_speed_limit_kbps * 1024,
+              download_low_speed_limit(*_data_dir));
+
+    // every download of the pool gets its share of the budget
+    config::clone_download_bytes_per_sec = 64 * 1024;
+    ASSERT_EQ(64 * 1024 / config::clone_download_thread_pool_size / 2,
+              download_low_speed_limit(*_data_dir));
+    config::clone_download_bytes_per_sec = 1;
+    ASSERT_EQ(1, download_low_speed_limit(*_data_dir));
+    config::clone_download_bytes_per_sec = 0;
+
+    // the io scheduler may be tuned down to a 16th of its rate
+    int64_t saved_io_bytes_per_sec = config::storage_background_io_bytes_per_sec;
+    bool saved_auto_tune = config::storage_io_auto_tune;
+    config::storage_background_io_bytes_per_sec = 12 * 1024 * 1024;
+    config::storage_io_auto_tune = true;
+    DataDir tuned_data_dir(_root_path);
+    config::storage_background_io_bytes_per_sec = saved_io_bytes_per_sec;
+    config::storage_io_auto_tune = saved_auto_tune;
+    ASSERT_EQ(12 * 1024 * 1024 / 16 / config::clone_download_thread_pool_size / 2,
+              download_low_speed_limit(tuned_data_dir));
+}
+
+// The downloads share a budget far below the default low speed limit, they
+// would all time out if they didn't take it into account.
+TEST_F(EngineCloneTaskTest, DownloadFilesOnSmallBudget) {
+    config::clone_download_bytes_per_sec = 64 * 1024;
+    config::download_low_speed_time = 2;
+    ThreadPool thread_pool(4, 16);
+    std::vector<std::string> file_names;
+    for (int i = 0; i < 4; ++i) {
+        std::string file_name = "1_" + std::to_string(i) + ".dat";
+        s_download_handler.add_file(file_name, make_content(64 * 1024, 'a' + i));
+        file_names.push_back(file_name);
+    }
+    uint64_t total_file_size = 0;
+    ASSERT_EQ(DORIS_SUCCESS, download_files(&thread_pool, file_names, &total_file_size));
+    ASSERT_EQ(4U * 64 * 1024, total_file_size);
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_EQ(make_content(64 * 1024, 'a' + i),
+                  read_local_file("1_" + std::to_string(i) + ".dat"));
+    }
+    ASSERT_EQ(4U, s_download_handler.downloads().size());
+
+    // lift the budget for the following downloads
+    config::clone_download_bytes_per_sec = 0;
+    ASSERT_EQ(DORIS_SUCCESS, download_files(&thread_pool, {}, &total_file_size));
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -21,6 +21,7 @@
 #include "gtest/gtest.h"
 #include "olap/data_dir.h"
 #include "olap/row_block.h"
+#include "olap/rowset/beta_rowset.h"
 #include "olap/rowset/beta_rowset_reader.h"
 #include "olap/rowset/rowset_factory.h"
 #include "olap/rowset/rowset_reader_context.h"
@@ -323,6 +324,53 @@ TEST_F(BetaRowsetTest, BasicFunctionTest) {
             EXPECT_EQ(100, num_rows_read);
         }
     }
+
+    {   // test split range by the short key index of the largest segment
+        RowCursor start_key;
+        ASSERT_EQ(OLAP_SUCCESS, start_key.init(tablet_schema, 2));
+        start_key.build_min_key();
+        RowCursor end_key;
+        ASSERT_EQ(OLAP_SUCCESS, end_key.init(tablet_schema, 2));
+        end_key.build_max_key();
+
+        // a block of segment 0 has 1024 rows, whose first keys are
+        // (0, 0), (10240, 102400), (20480, 204800) and (30720, 307200)
+        std::vector<OlapTuple> ranges;
+        s = rowset->split_range(start_key, end_key, 1024, &ranges);
+        ASSERT_EQ(OLAP_SUCCESS, s);
+        ASSERT_EQ(8, ranges.size());
+        for (int i = 1; i < 7; i += 2) {
+            ASSERT_EQ(ranges[i].values(), ranges[i + 1].values());
+            ASSERT_EQ(std::to_string(10240 * (i / 2 + 1)), ranges[i].get_value(0));
+            ASSERT_EQ(std::to_string(102400 * (i / 2 + 1)), ranges[i].get_value(1));
+        }
+
+        // less than a section
+        ranges.clear();
+        s = rowset->split_range(start_key, end_key, 8192, &ranges);
+        ASSERT_EQ(OLAP_SUCCESS, s);
+        ASSERT_EQ(2, ranges.size());
+    }
+
+    {   // test a rowset made up of the segments of other rowsets
+        RowsetWriterContext writer_context;
+        create_rowset_writer_context(&tablet_schema, &writer_context);
+        writer_context.rowset_id.init(10001);
+
+        std::unique_ptr<RowsetWriter> rowset_writer;
+        s = RowsetFactory::create_rowset_writer(writer_context, &rowset_writer);
+        ASSERT_EQ(OLAP_SUCCESS, s);
+        ASSERT_EQ(OLAP_SUCCESS, rowset_writer->add_rowset(rowset));
+        ASSERT_EQ(OLAP_SUCCESS, rowset_writer->add_rowset(rowset));
+        RowsetSharedPtr combined_rowset = rowset_writer->build();
+        ASSERT_TRUE(combined_rowset != nullptr);
+        ASSERT_EQ(2 * num_segments, combined_rowset->rowset_meta()->num_segments());
+        ASSERT_EQ(2 * num_segments * rows_per_segment, combined_rowset->rowset_meta()->num_rows());
+        for (int i = 0; i < 2 * num_segments; ++i) {
+            ASSERT_TRUE(FileUtils::check_exist(BetaRowset::segment_file_path(
+                    kRowsetDir, writer_context.rowset_id, i)));
+        }
+    }
 }
 
 } // namespace doris
@@ -0,0 +1,486 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "olap/schema_change.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gen_cpp/olap_file.pb.h"
+#include "olap/data_dir.h"
+#include "olap/delete_handler.h"
+#include "olap/row.h"
+#include "olap/row_block.h"
+#include "olap/row_cursor.h"
+#include "olap/tablet.h"
+#include "olap/tablet_meta.h"
+#include "olap/tablet_schema.h"
+#include "olap/tuple.h"
+#include "util/thread_pool.hpp"
+
+namespace doris {
+
+class SchemaChangeTest : public testing::Test {
+public:
+    void SetUp() override {
+        _data_dir.reset(new DataDir("./ut_dir/schema_change_test"));
+    }
+
+protected:
+    // Adds a nullable column to the schema of a DUP_KEYS table.
+    static void add_column(TabletSchemaPB* schema_pb, const std::string& type, int32_t length,
+                           int32_t index_length, bool is_key) {
+        ColumnPB* column = schema_pb->add_column();
+        column->set_unique_id(schema_pb->column_size() - 1);
+        column->set_name("c" + std::to_string(column->unique_id()));
+        column->set_type(type);
+        column->set_is_key(is_key);
+        column->set_length(length);
+        column->set_index_length(index_length);
+        column->set_is_nullable(true);
+        column->set_aggregation("NONE");
+    }
+
+    static void init_schema(TabletSchemaPB* schema_pb, int32_t num_short_key_columns,
+                            TabletSchema* schema) {
+        schema_pb->set_keys_type(DUP_KEYS);
+        schema_pb->set_num_short_key_columns(num_short_key_columns);
+        schema_pb->set_num_rows_per_row_block(1024);
+        ASSERT_EQ(OLAP_SUCCESS, schema->init_from_pb(*schema_pb));
+    }
+
+    // A row of 'schema' with the given values, nullptr for NULL.
+    static std::unique_ptr<RowCursor> make_row(const TabletSchema& schema,
+                                               const std::vector<const char*>& values) {
+        std::unique_ptr<RowCursor> row(new RowCursor());
+        EXPECT_EQ(OLAP_SUCCESS, row->init(schema));
+        EXPECT_EQ(OLAP_SUCCESS, row->allocate_memory_for_string_type(schema));
+        OlapTuple tuple;
+        for (const char* value : values) {
+            if (value == nullptr) {
+                tuple.add_null();
+            } else {
+                tuple.add_value(value);
+            }
+        }
+        EXPECT_EQ(OLAP_SUCCESS, row->from_tuple(tuple));
+        return row;
+    }
+
+    static uint64_t encode_key_prefix(const TabletSchema& schema, const RowCursor& row) {
+        std::string buf;
+        return RowBlockSorter::_encode_key_prefix(row, schema.num_short_key_columns(), &buf);
+    }
+
+    // Checks that the key prefixes of the rows keep their order, and returns the
+    // number of pairs of different rows whose prefixes are equal.
+    static int check_key_prefix_order(const TabletSchema& schema,
+                                      const std::vector<std::unique_ptr<RowCursor>>& rows) {
+        int num_ties = 0;
+        for (auto& a : rows) {
+            for (auto& b : rows) {
+                int cmp = compare_row(*a, *b);
+                uint64_t a_prefix = encode_key_prefix(schema, *a);
+                uint64_t b_prefix = encode_key_prefix(schema, *b);
+                if (cmp < 0) {
+                    EXPECT_LE(a_prefix, b_prefix) << a->to_string() << " < " << b->to_string();
+                    num_ties += a_prefix == b_prefix;
+                } else if (cmp == 0) {
+                    EXPECT_EQ(a_prefix, b_prefix) << a->to_string() << " = " << b->to_string();
+                }
+            }
+        }
+        return num_ties;
+    }
+
+    // Sorts the rows, the last column of the schema numbers them, by a RowBlockSorter
+    // and checks they come out in key order, equal keys in their order before.
+    static void check_sort(const TabletSchema& schema,
+                           const std::vector<std::unique_ptr<RowCursor>>& rows) {
+        RowBlockAllocator allocator(schema, 1024 * 1024 * 1024);
+        RowBlock* block = nullptr;
+        ASSERT_EQ(OLAP_SUCCESS, allocator.allocate(&block, rows.size(), true));
+        RowCursor dst;
+        ASSERT_EQ(OLAP_SUCCESS, dst.init(schema));
+        for (size_t i = 0; i < rows.size(); ++i) {
+            block->get_row(i, &dst);
+            copy_row(&dst, *rows[i], block->mem_pool());
+        }
+        block->finalize(rows.size());
+
+        {
+            RowBlockSorter sorter(&allocator);
+            ASSERT_TRUE(sorter.sort(&block));
+        }
+        ASSERT_EQ(rows.size(), block->row_block_info().row_num);
+        RowCursor prev;
+        ASSERT_EQ(OLAP_SUCCESS, prev.init(schema));
+        size_t seq_column = schema.num_columns() - 1;
+        for (size_t i = 1; i < rows.size(); ++i) {
+            block->get_row(i - 1, &prev);
+            block->get_row(i, &dst);
+            int cmp = compare_row(prev, dst);
+            ASSERT_LE(cmp, 0) << prev.to_string() << " before " << dst.to_string();
+            if (cmp == 0) {
+                ASSERT_LT(*reinterpret_cast<const int32_t*>(prev.cell_ptr(seq_column)),
+                          *reinterpret_cast<const int32_t*>(dst.cell_ptr(seq_column)));
+            }
+        }
+        allocator.release(block);
+    }
+
+    // k1 INT, k2 INT keys and v1 INT, v2 INT values, of unique ids 0 to 3.
+    static void init_base_schema_pb(TabletSchemaPB* schema_pb) {
+        add_column(schema_pb, "INT", 4, 4, true);
+        add_column(schema_pb, "INT", 4, 4, true);
+        add_column(schema_pb, "INT", 4, 4, false);
+        add_column(schema_pb, "INT", 4, 4, false);
+        const char* names[] = {"k1", "k2", "v1", "v2"};
+        for (int i = 0; i < 4; ++i) {
+            schema_pb->mutable_column(i)->set_name(names[i]);
+        }
+        schema_pb->set_keys_type(DUP_KEYS);
+        schema_pb->set_num_short_key_columns(2);
+        schema_pb->set_num_rows_per_row_block(1024);
+    }
+
+    // A tablet of the given schema, with a delete predicate of version 2 made of
+    // 'sub_predicates' if there are any.
+    TabletSharedPtr create_tablet(int64_t tablet_id, const TabletSchemaPB& schema_pb,
+                                  const std::vector<std::string>& sub_predicates) {
+        TabletMetaPB tablet_meta_pb;
+        tablet_meta_pb.set_table_id(1);
+        tablet_meta_pb.set_partition_id(1);
+        tablet_meta_pb.set_tablet_id(tablet_id);
+        tablet_meta_pb.set_schema_hash(1);
+        tablet_meta_pb.set_shard_id(0);
+        tablet_meta_pb.set_tablet_state(PB_RUNNING);
+        *tablet_meta_pb.mutable_schema() = schema_pb;
+        TabletMetaSharedPtr tablet_meta(new TabletMeta());
+        EXPECT_EQ(OLAP_SUCCESS, tablet_meta->init_from_pb(tablet_meta_pb));
+        if (!sub_predicates.empty()) {
+            DeletePredicatePB delete_predicate;
+            delete_predicate.set_version(2);
+            for (auto& sub_predicate : sub_predicates) {
+                delete_predicate.add_sub_predicates(sub_predicate);
+            }
+            EXPECT_EQ(OLAP_SUCCESS, tablet_meta->add_delete_predicate(delete_predicate, 2));
+        }
+        return TabletSharedPtr(new Tablet(tablet_meta, _data_dir.get()));
+    }
+
+    static bool delete_predicates_can_be_linked(TabletSharedPtr base_tablet,
+                                                TabletSharedPtr new_tablet) {
+        return SchemaChangeHandler::_delete_predicates_can_be_linked(base_tablet, new_tablet);
+    }
+
+    // Whether the schema change from 'base_tablet' to 'new_tablet' links the rowsets.
+    static bool is_linked_schema_change(TabletSharedPtr base_tablet,
+                                        TabletSharedPtr new_tablet) {
+        RowBlockChanger rb_changer(new_tablet->tablet_schema(), base_tablet);
+        bool sc_sorting = false;
+        bool sc_directly = false;
+        EXPECT_EQ(OLAP_SUCCESS, SchemaChangeHandler::_parse_request(
+                base_tablet, new_tablet, &rb_changer, &sc_sorting, &sc_directly));
+        return !sc_sorting && !sc_directly;
+    }
+
+    static OLAPStatus convert_in_parallel(
+            ThreadPool* thread_pool, size_t num_workers, size_t num_rowsets,
+            const std::function<OLAPStatus(size_t, size_t)>& convert) {
+        return SchemaChangeHandler::_convert_in_parallel(thread_pool, num_workers, num_rowsets,
+                                                         convert);
+    }
+
+    std::unique_ptr<DataDir> _data_dir;
+};
+
+TEST_F(SchemaChangeTest, KeyPrefixOfIntsAndNulls) {
+    TabletSchemaPB schema_pb;
+    add_column(&schema_pb, "INT", 4, 4, true);
+    add_column(&schema_pb, "BIGINT", 8, 8, true);
+    add_column(&schema_pb, "INT", 4, 4, false);
+    TabletSchema schema;
+    init_schema(&schema_pb, 2, &schema);
+
+    std::vector<std::unique_ptr<RowCursor>> rows;
+    const char* ints[] = {nullptr, "-2147483648", "-1", "0", "1", "2147483647"};
+    const char* bigints[] = {nullptr, "-9223372036854775808", "-1", "0", "255", "256",
+                             "9223372036854775807"};
+    int seq = 0;
+    for (const char* k1 : ints) {
+        for (const char* k2 : bigints) {
+            rows.push_back(make_row(schema, {k1, k2, std::to_string(seq++).c_str()}));
+        }
+    }
+    // nulls come first
+    ASSERT_LT(encode_key_prefix(schema, *make_row(schema, {nullptr, "0", "0"})),
+              encode_key_prefix(schema, *make_row(schema, {"-2147483648", "0", "0"})));
+    // the rows with the same INT only differ in the BIGINT cut from the prefix
+    ASSERT_GT(check_key_prefix_order(schema, rows), 0);
+
+    std::shuffle(rows.begin(), rows.end(), std::mt19937(1));
+    check_sort(schema, rows);
+}
+
+TEST_F(SchemaChangeTest, KeyPrefixOfLongStrings) {
+    TabletSchemaPB schema_pb;
+    add_column(&schema_pb, "CHAR", 12, 12, true);
+    add_column(&schema_pb, "VARCHAR", 20, 20, true);
+    add_column(&schema_pb, "INT", 4, 4, false);
+    TabletSchema schema;
+    init_schema(&schema_pb, 2, &schema);
+
+    // the strings are longer than the prefix and only differ after it
+    std::vector<std::unique_ptr<RowCursor>> rows;
+    const char* chars[] = {nullptr, "", "abcdefgh", "abcdefghij0", "abcdefghij1", "abcdefghzz"};
+    const char* varchars[] = {nullptr, "", "a", "abcdefghijklmno", "abcdefghijklmnp"};
+    int seq = 0;
+    for (int i = 0; i < 2; ++i) {
+        for (const char* k1 : chars) {
+            for (const char* k2 : varchars) {
+                rows.push_back(make_row(schema, {k1, k2, std::to_string(seq++).c_str()}));
+            }
+        }
+    }
+    ASSERT_EQ(encode_key_prefix(schema, *make_row(schema, {"abcdefghij0", "a", "0"})),
+              encode_key_prefix(schema, *make_row(schema, {"abcdefghij1", nullptr, "0"})));
+    ASSERT_GT(check_key_prefix_order(schema, rows), 0);
+
+    // ties are sorted by the whole keys
+    std::shuffle(rows.begin(), rows.end(), std::mt19937(2));
+    check_sort(schema, rows);
+}
+
+TEST_F(SchemaChangeTest, KeyPrefixStopsAfterString) {
+    TabletSchemaPB schema_pb;
+    add_column(&schema_pb, "VARCHAR", 8, 8, true);
+    add_column(&schema_pb, "INT", 4, 4, true);
+    add_column(&schema_pb, "INT", 4, 4, false);
+    TabletSchema schema;
+    init_schema(&schema_pb, 2, &schema);
+
+    // "a" < "a\x01" whatever follows, though the marker of the INT after "a" is
+    // greater than 0x01
+    std::vector<std::unique_ptr<RowCursor>> rows;
+    rows.push_back(make_row(schema, {"a", "100", "0"}));
+    rows.push_back(make_row(schema, {"a\x01", "1", "1"}));
+    rows.push_back(make_row(schema, {"a", nullptr, "2"}));
+    rows.push_back(make_row(schema, {"", "5", "3"}));
+    ASSERT_EQ(1, check_key_prefix_order(schema, rows));
+    std::reverse(rows.begin(), rows.end());
+    check_sort(schema, rows);
+
+    // a CHAR cut to its index size: "abX" < "abY" whatever follows
+    TabletSchemaPB char_schema_pb;
+    add_column(&char_schema_pb, "CHAR", 8, 2, true);
+    add_column(&char_schema_pb, "INT", 4, 4, true);
+    add_column(&char_schema_pb, "INT", 4, 4, false);
+    TabletSchema char_schema;
+    init_schema(&char_schema_pb, 2, &char_schema);
+    rows.clear();
+    rows.push_back(make_row(char_schema, {"abY", "1", "0"}));
+    rows.push_back(make_row(char_schema, {"abX", "5", "1"}));
+    rows.push_back(make_row(char_schema, {"ab", "9", "2"}));
+    ASSERT_EQ(3, check_key_prefix_order(char_schema, rows));
+    check_sort(char_schema, rows);
+}
+
+TEST_F(SchemaChangeTest, ConvertInParallel) {
+    ThreadPool thread_pool(4, 16);
+    const size_t num_rowsets = 64;
+    std::vector<std::atomic<int>> num_converts(num_rowsets);
+    for (auto& n : num_converts) {
+        n = 0;
+    }
+    // a worker has a SchemaChange of its own, it only converts a rowset at a time
+    std::vector<std::atomic<bool>> worker_busy(4);
+    for (auto& busy : worker_busy) {
+        busy = false;
+    }
+    std::atomic<int> running(0);
+    std::atomic<int> max_running(0);
+    OLAPStatus res = convert_in_parallel(&thread_pool, 4, num_rowsets,
+            [&](size_t worker, size_t rowset) {
+                EXPECT_LT(worker, 4);
+                EXPECT_FALSE(worker_busy[worker].exchange(true));
+                int now = ++running;
+                int max = max_running;
+                while (now > max && !max_running.compare_exchange_weak(max, now)) {
+                }
+                ++num_converts[rowset];
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                --running;
+                worker_busy[worker] = false;
+                return OLAP_SUCCESS;
+            });
+    ASSERT_EQ(OLAP_SUCCESS, res);
+    for (auto& n : num_converts) {
+        ASSERT_EQ(1, n);
+    }
+    ASSERT_GT(max_running, 1);
+    ASSERT_LE(max_running, 4);
+}
+
+TEST_F(SchemaChangeTest, ConvertStopsAtFirstFailure) {
+    ThreadPool thread_pool(4, 16);
+    const size_t num_workers = 4;
+    const size_t num_rowsets = 1000;
+    std::atomic<bool> failed(false);
+    std::atomic<int> num_started_after_failure(0);
+    std::atomic<int> num_converts(0);
+    OLAPStatus res = convert_in_parallel(&thread_pool, num_workers, num_rowsets,
+            [&](size_t worker, size_t rowset) {
+                if (failed) {
+                    ++num_started_after_failure;
+                }
+                ++num_converts;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                if (rowset == 10) {
+                    failed = true;
+                    return OLAP_ERR_INPUT_PARAMETER_ERROR;
+                }
+                return OLAP_SUCCESS;
+            });
+    ASSERT_EQ(OLAP_ERR_INPUT_PARAMETER_ERROR, res);
+    // the other workers may each have taken a rowset before the failure was seen
+    ASSERT_LE(num_started_after_failure, num_workers - 1);
+    ASSERT_LT(num_converts, num_rowsets);
+}
+
+TEST_F(SchemaChangeTest, ConvertOnSharedPool) {
+    // more workers than threads, from several schema changes at once
+    ThreadPool thread_pool(2, 4);
+    std::vector<std::thread> schema_changes;
+    std::atomic<int> num_converts(0);
+    for (int i = 0; i < 4; ++i) {
+        schema_changes.emplace_back([&] {
+            OLAPStatus res = convert_in_parallel(&thread_pool, 3, 10,
+                    [&](size_t worker, size_t rowset) {
+                        ++num_converts;
+                        return OLAP_SUCCESS;
+                    });
+            EXPECT_EQ(OLAP_SUCCESS, res);
+        });
+    }
+    for (auto& schema_change : schema_changes) {
+        schema_change.join();
+    }
+    ASSERT_EQ(40, num_converts);
+
+    // the conversion still runs once the pool is shut down
+    thread_pool.shutdown();
+    thread_pool.join();
+    ASSERT_EQ(OLAP_SUCCESS, convert_in_parallel(&thread_pool, 3, 10,
+            [&](size_t worker, size_t rowset) {
+                ++num_converts;
+                return OLAP_SUCCESS;
+            }));
+    ASSERT_EQ(50, num_converts);
+}
+
+TEST_F(SchemaChangeTest, LinkTabletWithDeletes) {
+    TabletSchemaPB base_schema_pb;
+    init_base_schema_pb(&base_schema_pb);
+    TabletSharedPtr base_tablet = create_tablet(1, base_schema_pb, {"k1=1", "v1>=5"});
+
+    // drop v2 and add v3, the columns of the delete predicate are untouched
+    TabletSchemaPB new_schema_pb = base_schema_pb;
+    new_schema_pb.mutable_column()->RemoveLast();
+    add_column(&new_schema_pb, "INT", 4, 4, false);
+    new_schema_pb.mutable_column(3)->set_unique_id(4);
+    new_schema_pb.mutable_column(3)->set_name("v3");
+    TabletSharedPtr new_tablet = create_tablet(2, new_schema_pb, {});
+    ASSERT_TRUE(delete_predicates_can_be_linked(base_tablet, new_tablet));
+    ASSERT_TRUE(is_linked_schema_change(base_tablet, new_tablet));
+
+    // the linked rowsets take the delete predicate to the new tablet, where it
+    // filters the rows of the versions before it as it did in the base tablet
+    const TabletSchema& new_schema = new_tablet->tablet_schema();
+    DeleteHandler delete_handler;
+    ASSERT_EQ(OLAP_SUCCESS, delete_handler.init(new_schema, base_tablet->delete_predicates(), 3));
+    ASSERT_TRUE(delete_handler.is_filter_data(1, *make_row(new_schema, {"1", "0", "5", nullptr})));
+    ASSERT_TRUE(delete_handler.is_filter_data(2, *make_row(new_schema, {"1", "7", "9", "3"})));
+    ASSERT_FALSE(delete_handler.is_filter_data(1, *make_row(new_schema, {"1", "0", "4", nullptr})));
+    ASSERT_FALSE(delete_handler.is_filter_data(1, *make_row(new_schema, {"2", "0", "5", nullptr})));
+    // loaded after the delete
+    ASSERT_FALSE(delete_handler.is_filter_data(3, *make_row(new_schema, {"1", "0", "5", nullptr})));
+    delete_handler.finalize();
+
+    // without deletes
+    TabletSharedPtr base_tablet_without_deletes = create_tablet(3, base_schema_pb, {});
+    ASSERT_TRUE(delete_predicates_can_be_linked(base_tablet_without_deletes, new_tablet));
+    ASSERT_TRUE(is_linked_schema_change(base_tablet_without_deletes, new_tablet));
+}
+
+TEST_F(SchemaChangeTest, ConvertTabletWithDeletesOnChangedColumns) {
+    TabletSchemaPB base_schema_pb;
+    init_base_schema_pb(&base_schema_pb);
+    TabletSharedPtr base_tablet = create_tablet(1, base_schema_pb, {"k1=1", "v1>=5"});
+
+    // v1 dropped
+    TabletSchemaPB dropped_schema_pb = base_schema_pb;
+    dropped_schema_pb.mutable_column()->SwapElements(2, 3);
+    dropped_schema_pb.mutable_column()->RemoveLast();
+    TabletSharedPtr new_tablet = create_tablet(2, dropped_schema_pb, {});
+    ASSERT_FALSE(delete_predicates_can_be_linked(base_tablet, new_tablet));
+    ASSERT_FALSE(is_linked_schema_change(base_tablet, new_tablet));
+    // the delete predicate can't be applied to the rows of the new schema
+    DeleteHandler delete_handler;
+    ASSERT_NE(OLAP_SUCCESS, delete_handler.init(new_tablet->tablet_schema(),
+                                                base_tablet->delete_predicates(), 3));
+    delete_handler.finalize();
+    // a linked schema change would be fine without the delete
+    TabletSharedPtr base_tablet_without_deletes = create_tablet(3, base_schema_pb, {});
+    ASSERT_TRUE(is_linked_schema_change(base_tablet_without_deletes, new_tablet));
+
+    // v1 renamed
+    TabletSchemaPB renamed_schema_pb = base_schema_pb;
+    renamed_schema_pb.mutable_column(2)->set_name("v1_renamed");
+    new_tablet = create_tablet(4, renamed_schema_pb, {});
+    ASSERT_FALSE(delete_predicates_can_be_linked(base_tablet, new_tablet));
+    ASSERT_FALSE(is_linked_schema_change(base_tablet, new_tablet));
+
+    // v1 dropped and added back, the new column doesn't have the old values
+    TabletSchemaPB readded_schema_pb = base_schema_pb;
+    readded_schema_pb.mutable_column(2)->set_unique_id(4);
+    new_tablet = create_tablet(5, readded_schema_pb, {});
+    ASSERT_FALSE(delete_predicates_can_be_linked(base_tablet, new_tablet));
+    ASSERT_FALSE(is_linked_schema_change(base_tablet, new_tablet));
+
+    // a predicate that doesn't parse
+    TabletSharedPtr bad_base_tablet = create_tablet(6, base_schema_pb, {"k1 ~ 1"});
+    new_tablet = create_tablet(7, base_schema_pb, {});
+    ASSERT_FALSE(delete_predicates_can_be_linked(bad_base_tablet, new_tablet));
+    ASSERT_TRUE(delete_predicates_can_be_linked(base_tablet, new_tablet));
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
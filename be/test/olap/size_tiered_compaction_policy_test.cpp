@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "olap/size_tiered_compaction_policy.h"
+
+#include <gtest/gtest.h>
+
+#include "olap/rowset/alpha_rowset_meta.h"
+
+namespace doris {
+
+static const int64_t MB = 1024 * 1024;
+
+class SizeTieredCompactionPolicyTest : public testing::Test {
+public:
+    SizeTieredCompactionPolicyTest() : _policy(1 * MB, 4, 64 * MB, 1000) {}
+
+protected:
+    void add_rowset(int64_t start_version, int64_t end_version, int64_t bytes,
+                    int64_t num_segments = 1, bool with_delete = false) {
+        RowsetMetaSharedPtr rs_meta(new AlphaRowsetMeta());
+        rs_meta->set_version(Version(start_version, end_version));
+        rs_meta->set_data_disk_size(bytes);
+        rs_meta->set_num_segments(num_segments);
+        if (with_delete) {
+            DeletePredicatePB delete_predicate;
+            delete_predicate.set_version(start_version);
+            rs_meta->set_delete_predicate(delete_predicate);
+        }
+        _rs_metas.push_back(rs_meta);
+    }
+
+    SizeTieredCompactionPolicy _policy;
+    std::vector<RowsetMetaSharedPtr> _rs_metas;
+};
+
+TEST_F(SizeTieredCompactionPolicyTest, Level) {
+    ASSERT_EQ(0, _policy.level(0));
+    ASSERT_EQ(0, _policy.level(1 * MB - 1));
+    ASSERT_EQ(1, _policy.level(1 * MB));
+    ASSERT_EQ(1, _policy.level(4 * MB - 1));
+    ASSERT_EQ(2, _policy.level(4 * MB));
+    ASSERT_EQ(3, _policy.level(16 * MB));
+    ASSERT_LT(0, _policy.level(INT64_MAX));
+}
+
+TEST_F(SizeTieredCompactionPolicyTest, LevelNotFull) {
+    for (int64_t version = 11; version <= 14; ++version) {
+        add_rowset(version, version, 100 * 1024);
+    }
+    // the last rowset doesn't count
+    size_t start = 0;
+    size_t end = 0;
+    ASSERT_EQ(0, _policy.calc_score(_rs_metas));
+    ASSERT_FALSE(_policy.pick_rowsets(_rs_metas, &start, &end));
+
+    add_rowset(15, 15, 100 * 1024);
+    ASSERT_EQ(4, _policy.calc_score(_rs_metas));
+    ASSERT_TRUE(_policy.pick_rowsets(_rs_metas, &start, &end));
+    ASSERT_EQ(0, start);
+    ASSERT_EQ(4, end);
+}
+
+TEST_F(SizeTieredCompactionPolicyTest, OverlappingSegments) {
+    add_rowset(11, 11, 100 * 1024, 4);
+    add_rowset(12, 12, 100 * 1024);
+    add_rowset(13, 13, 100 * 1024);
+    size_t start = 0;
+    size_t end = 0;
+    ASSERT_EQ(5, _policy.calc_score(_rs_metas));
+    ASSERT_TRUE(_policy.pick_rowsets(_rs_metas, &start, &end));
+    ASSERT_EQ(0, start);
+    ASSERT_EQ(2, end);
+}
+
+TEST_F(SizeTieredCompactionPolicyTest, SmallestLevelFirst) {
+    add_rowset(20, 30, 2 * MB);
+    add_rowset(31, 35, 2 * MB);
+    add_rowset(36, 40, 2 * MB);
+    add_rowset(41, 45, 2 * MB);
+    for (int64_t version = 46; version <= 50; ++version) {
+        add_rowset(version, version, 10 * 1024);
+    }
+    size_t start = 0;
+    size_t end = 0;
+    ASSERT_EQ(8, _policy.calc_score(_rs_metas));
+    ASSERT_TRUE(_policy.pick_rowsets(_rs_metas, &start, &end));
+    ASSERT_EQ(4, start);
+    ASSERT_EQ(8, end);
+}
+
+TEST_F(SizeTieredCompactionPolicyTest, DeletePredicate) {
+    add_rowset(11, 11, 100 * 1024);
+    add_rowset(12, 12, 100 * 1024);
+    add_rowset(13, 13, 100 * 1024, 1, true);
+    add_rowset(14, 14, 100 * 1024);
+    add_rowset(15, 15, 100 * 1024);
+    add_rowset(16, 16, 100 * 1024);
+    size_t start = 0;
+    size_t end = 0;
+    ASSERT_EQ(0, _policy.calc_score(_rs_metas));
+    ASSERT_FALSE(_policy.pick_rowsets(_rs_metas, &start, &end));
+}
+
+TEST_F(SizeTieredCompactionPolicyTest, CumulativePoint) {
+    add_rowset(20, 30, 100 * MB);
+    add_rowset(31, 31, 100 * 1024, 1, true);
+    add_rowset(32, 40, 1 * MB);
+    add_rowset(41, 41, 100 * MB);
+    ASSERT_EQ(32, _policy.calc_cumulative_point(_rs_metas, 20));
+    ASSERT_EQ(32, _policy.calc_cumulative_point(_rs_metas, 32));
+
+    // the last rowset stays above the point
+    _rs_metas.erase(_rs_metas.begin() + 2);
+    ASSERT_EQ(32, _policy.calc_cumulative_point(_rs_metas, 20));
+}
+
+}  // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -15,9 +15,11 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <atomic>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <thread>
 
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
@@ -144,6 +146,53 @@ TEST_F(TabletMgrTest, CreateTablet) {
 }
 
 
+TEST_F(TabletMgrTest, LoadTabletsFromMeta) {
+    TColumnType col_type;
+    col_type.__set_type(TPrimitiveType::SMALLINT);
+    TColumn col1;
+    col1.__set_column_name("col1");
+    col1.__set_column_type(col_type);
+    col1.__set_is_key(true);
+    std::vector<TColumn> cols;
+    cols.push_back(col1);
+    TTabletSchema tablet_schema;
+    tablet_schema.__set_short_key_column_count(1);
+    tablet_schema.__set_schema_hash(3333);
+    tablet_schema.__set_keys_type(TKeysType::AGG_KEYS);
+    tablet_schema.__set_storage_type(TStorageType::COLUMN);
+    tablet_schema.__set_columns(cols);
+    TCreateTabletReq create_tablet_req;
+    create_tablet_req.__set_tablet_schema(tablet_schema);
+    create_tablet_req.__set_version(2);
+    create_tablet_req.__set_version_hash(3333);
+    vector<DataDir*> data_dirs;
+    data_dirs.push_back(_data_dir);
+
+    std::vector<TabletMetaBinary> metas;
+    for (int64_t tablet_id = 111; tablet_id < 121; ++tablet_id) {
+        create_tablet_req.__set_tablet_id(tablet_id);
+        ASSERT_EQ(OLAP_SUCCESS, _tablet_mgr.create_tablet(create_tablet_req, data_dirs));
+        TabletSharedPtr tablet = _tablet_mgr.get_tablet(tablet_id, 3333);
+        ASSERT_TRUE(tablet != nullptr);
+        std::string meta_binary;
+        ASSERT_EQ(OLAP_SUCCESS, tablet->tablet_meta()->serialize(&meta_binary));
+        metas.push_back({tablet_id, 3333, meta_binary});
+    }
+    // a broken meta is skipped
+    metas.push_back({121, 3333, "invalid meta"});
+
+    TabletManager tablet_mgr;
+    std::set<int64_t> tablet_ids;
+    tablet_mgr.load_tablets_from_meta(_data_dir, metas, &tablet_ids);
+    ASSERT_EQ(10, tablet_ids.size());
+    for (int64_t tablet_id = 111; tablet_id < 121; ++tablet_id) {
+        ASSERT_EQ(1, tablet_ids.count(tablet_id));
+        ASSERT_TRUE(tablet_mgr.get_tablet(tablet_id, 3333) != nullptr);
+    }
+    ASSERT_TRUE(tablet_mgr.get_tablet(121, 3333) == nullptr);
+    tablet_mgr.clear();
+}
+
 TEST_F(TabletMgrTest, DropTablet) {
     TColumnType col_type;
     col_type.__set_type(TPrimitiveType::SMALLINT);
@@ -209,6 +258,141 @@ TEST_F(TabletMgrTest, DropTablet) {
     ASSERT_TRUE(!dir_exist);
 }
 
+TEST_F(TabletMgrTest, TabletsInManyShards) {
+    TColumnType col_type;
+    col_type.__set_type(TPrimitiveType::SMALLINT);
+    TColumn col1;
+    col1.__set_column_name("col1");
+    col1.__set_column_type(col_type);
+    col1.__set_is_key(true);
+    std::vector<TColumn> cols;
+    cols.push_back(col1);
+    TTabletSchema tablet_schema;
+    tablet_schema.__set_short_key_column_count(1);
+    tablet_schema.__set_schema_hash(3333);
+    tablet_schema.__set_keys_type(TKeysType::AGG_KEYS);
+    tablet_schema.__set_storage_type(TStorageType::COLUMN);
+    tablet_schema.__set_columns(cols);
+    vector<DataDir*> data_dirs;
+    data_dirs.push_back(_data_dir);
+
+    // two tablets in each shard
+    int num_tablets = 2 * config::tablet_map_shard_size;
+    for (int i = 0; i < num_tablets; ++i) {
+        TCreateTabletReq create_tablet_req;
+        create_tablet_req.__set_tablet_schema(tablet_schema);
+        create_tablet_req.__set_tablet_id(200 + i);
+        create_tablet_req.__set_partition_id(10);
+        create_tablet_req.__set_version(2);
+        create_tablet_req.__set_version_hash(3333);
+        ASSERT_EQ(OLAP_SUCCESS, _tablet_mgr.create_tablet(create_tablet_req, data_dirs));
+    }
+
+    // look the tablets up while every other one is dropped
+    std::atomic<int> num_found(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 1; i < num_tablets; i += 2) {
+                if (_tablet_mgr.get_tablet(200 + i, 3333) != nullptr) {
+                    ++num_found;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < num_tablets; i += 2) {
+        ASSERT_EQ(OLAP_SUCCESS, _tablet_mgr.drop_tablet(200 + i, 3333, false));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(4 * num_tablets / 2, num_found.load());
+
+    for (int i = 0; i < num_tablets; ++i) {
+        ASSERT_EQ(i % 2 == 1, _tablet_mgr.get_tablet(200 + i, 3333) != nullptr);
+        ASSERT_TRUE(_tablet_mgr.get_tablet(200 + i, 3333, true) != nullptr);
+    }
+    std::map<TTabletId, TTablet> tablets_info;
+    ASSERT_EQ(OLAP_SUCCESS, _tablet_mgr.report_all_tablets_info(&tablets_info));
+    ASSERT_EQ(num_tablets / 2, static_cast<int>(tablets_info.size()));
+    std::set<TabletInfo> partition_tablets;
+    _tablet_mgr.get_partition_related_tablets(10, &partition_tablets);
+    ASSERT_EQ(num_tablets / 2, static_cast<int>(partition_tablets.size()));
+}
+
+TEST_F(TabletMgrTest, CompactionCandidates) {
+    TColumnType col_type;
+    col_type.__set_type(TPrimitiveType::SMALLINT);
+    TColumn col1;
+    col1.__set_column_name("col1");
+    col1.__set_column_type(col_type);
+    col1.__set_is_key(true);
+    std::vector<TColumn> cols;
+    cols.push_back(col1);
+    TTabletSchema tablet_schema;
+    tablet_schema.__set_short_key_column_count(1);
+    tablet_schema.__set_keys_type(TKeysType::AGG_KEYS);
+    tablet_schema.__set_storage_type(TStorageType::COLUMN);
+    tablet_schema.__set_columns(cols);
+    TCreateTabletReq create_tablet_req;
+    create_tablet_req.__set_version(2);
+    create_tablet_req.__set_version_hash(3333);
+    vector<DataDir*> data_dirs;
+    data_dirs.push_back(_data_dir);
+    std::vector<TabletInfo> tablet_infos;
+    for (int64_t tablet_id = 111; tablet_id <= 113; ++tablet_id) {
+        tablet_schema.__set_schema_hash(3333);
+        create_tablet_req.__set_tablet_schema(tablet_schema);
+        create_tablet_req.__set_tablet_id(tablet_id);
+        ASSERT_EQ(OLAP_SUCCESS, _tablet_mgr.create_tablet(create_tablet_req, data_dirs));
+        TabletSharedPtr tablet = _tablet_mgr.get_tablet(tablet_id, 3333);
+        ASSERT_TRUE(tablet != nullptr);
+        tablet_infos.emplace_back(tablet_id, 3333, tablet->tablet_uid());
+    }
+
+    // a new tablet has only the initial rowset, no candidate
+    CompactionCandidate candidate;
+    ASSERT_FALSE(_data_dir->next_compaction_candidate(
+        CompactionType::CUMULATIVE_COMPACTION, nullptr, &candidate));
+
+    _data_dir->update_compaction_scores(tablet_infos[0], 3, 0);
+    _data_dir->update_compaction_scores(tablet_infos[1], 5, 10);
+    _data_dir->update_compaction_scores(tablet_infos[2], 1, 0);
+    // the highest score first
+    std::vector<int64_t> tablet_ids;
+    const CompactionCandidate* prev = nullptr;
+    while (_data_dir->next_compaction_candidate(
+            CompactionType::CUMULATIVE_COMPACTION, prev, &candidate)) {
+        tablet_ids.push_back(candidate.tablet_info.tablet_id);
+        prev = &candidate;
+    }
+    ASSERT_EQ(std::vector<int64_t>({112, 111, 113}), tablet_ids);
+    ASSERT_TRUE(_data_dir->next_compaction_candidate(
+        CompactionType::BASE_COMPACTION, nullptr, &candidate));
+    ASSERT_EQ(112, candidate.tablet_info.tablet_id);
+    ASSERT_EQ(10, candidate.score);
+    ASSERT_FALSE(_data_dir->next_compaction_candidate(
+        CompactionType::BASE_COMPACTION, &candidate, &candidate));
+
+    // a new score replaces the old one
+    _data_dir->update_compaction_scores(tablet_infos[2], 8, 0);
+    ASSERT_TRUE(_data_dir->next_compaction_candidate(
+        CompactionType::CUMULATIVE_COMPACTION, nullptr, &candidate));
+    ASSERT_EQ(113, candidate.tablet_info.tablet_id);
+    ASSERT_EQ(8, candidate.score);
+
+    // a dropped tablet is no candidate any more
+    ASSERT_EQ(OLAP_SUCCESS, _tablet_mgr.drop_tablet(113, 3333, false));
+    _data_dir->update_compaction_scores(tablet_infos[2], 9, 0);
+    ASSERT_TRUE(_data_dir->next_compaction_candidate(
+        CompactionType::CUMULATIVE_COMPACTION, nullptr, &candidate));
+    ASSERT_EQ(112, candidate.tablet_info.tablet_id);
+
+    for (int64_t tablet_id = 111; tablet_id <= 112; ++tablet_id) {
+        ASSERT_EQ(OLAP_SUCCESS, _tablet_mgr.drop_tablet(tablet_id, 3333, false));
+    }
+}
+
 TEST_F(TabletMgrTest, GetRowsetId) {
     // normal case
     {
@@ -0,0 +1,275 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "runtime/arrow_result_writer.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <arrow/array.h>
+#include <arrow/buffer.h>
+#include <arrow/io/memory.h>
+#include <arrow/ipc/reader.h>
+#include <arrow/record_batch.h>
+#include <arrow/type.h>
+#include <gtest/gtest.h>
+
+#include "common/object_pool.h"
+#include "exprs/expr.h"
+#include "exprs/expr_context.h"
+#include "gen_cpp/Exprs_types.h"
+#include "gen_cpp/PaloInternalService_types.h"
+#include "runtime/buffer_control_block.h"
+#include "runtime/datetime_value.h"
+#include "runtime/decimal_value.h"
+#include "runtime/decimalv2_value.h"
+#include "runtime/descriptor_helper.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem_pool.h"
+#include "runtime/row_batch.h"
+#include "runtime/runtime_state.h"
+#include "runtime/tuple.h"
+#include "runtime/tuple_row.h"
+#include "util/types.h"
+
+namespace doris {
+
+// the columns of the test tuple, the output exprs add a NULL literal after them
+enum TestColumn {
+    DECIMAL_COLUMN = 0,
+    DECIMALV2_COLUMN,
+    LARGEINT_COLUMN,
+    DATE_COLUMN,
+    DATETIME_COLUMN,
+    BOOLEAN_COLUMN,
+    NUM_SLOTS,
+    NULL_COLUMN = NUM_SLOTS,
+};
+
+class ArrowResultWriterTest : public testing::Test {
+public:
+    void SetUp() override {
+        TDescriptorTableBuilder table_builder;
+        TTupleDescriptorBuilder tuple;
+        tuple.add_slot(TSlotDescriptorBuilder().decimal_type(27, 3).nullable(true)
+                       .column_name("c_decimal").column_pos(DECIMAL_COLUMN).build());
+        TSlotDescriptor decimalv2_slot = TSlotDescriptorBuilder().decimal_type(27, 9)
+                .nullable(true).column_name("c_decimalv2").column_pos(DECIMALV2_COLUMN).build();
+        decimalv2_slot.slotType.types[0].scalar_type.type = to_thrift(TYPE_DECIMALV2);
+        tuple.add_slot(decimalv2_slot);
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_LARGEINT).nullable(true)
+                       .column_name("c_largeint").column_pos(LARGEINT_COLUMN).build());
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_DATE).nullable(true)
+                       .column_name("c_date").column_pos(DATE_COLUMN).build());
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_DATETIME).nullable(true)
+                       .column_name("c_datetime").column_pos(DATETIME_COLUMN).build());
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_BOOLEAN).nullable(true)
+                       .column_name("c_boolean").column_pos(BOOLEAN_COLUMN).build());
+        tuple.build(&table_builder);
+        DescriptorTbl* desc_tbl = nullptr;
+        ASSERT_TRUE(DescriptorTbl::create(&_pool, table_builder.desc_tbl(), &desc_tbl).ok());
+        _tuple_desc = desc_tbl->get_tuple_descriptor(0);
+        _row_desc.reset(new RowDescriptor(_tuple_desc, false));
+
+        _state.reset(new RuntimeState(TQueryGlobals()));
+        _state->set_desc_tbl(desc_tbl);
+        _state->init_instance_mem_tracker();
+
+        std::vector<TExpr> texprs;
+        for (SlotDescriptor* slot_desc : _tuple_desc->slots()) {
+            TExprNode node;
+            node.node_type = TExprNodeType::SLOT_REF;
+            node.type = slot_desc->type().to_thrift();
+            node.num_children = 0;
+            node.__isset.slot_ref = true;
+            node.slot_ref.slot_id = slot_desc->id();
+            node.slot_ref.tuple_id = _tuple_desc->id();
+            // the decimal is written with 3 digits of scale
+            node.__set_output_scale(slot_desc->type().type == TYPE_DECIMAL ? 3 : -1);
+            TExpr texpr;
+            texpr.nodes.push_back(node);
+            texprs.push_back(texpr);
+        }
+        TExprNode null_node;
+        null_node.node_type = TExprNodeType::NULL_LITERAL;
+        null_node.type = TypeDescriptor(TYPE_NULL).to_thrift();
+        null_node.num_children = 0;
+        TExpr null_expr;
+        null_expr.nodes.push_back(null_node);
+        texprs.push_back(null_expr);
+
+        ASSERT_TRUE(Expr::create_expr_trees(&_pool, texprs, &_output_expr_ctxs).ok());
+        ASSERT_TRUE(Expr::prepare(_output_expr_ctxs, _state.get(), *_row_desc,
+                                  _state->instance_mem_tracker()).ok());
+        ASSERT_TRUE(Expr::open(_output_expr_ctxs, _state.get()).ok());
+    }
+
+    void TearDown() override {
+        Expr::close(_output_expr_ctxs, _state.get());
+    }
+
+protected:
+    template<typename T>
+    void set_slot(Tuple* tuple, int column, const T& value) {
+        SlotDescriptor* slot_desc = _tuple_desc->slots()[column];
+        tuple->set_not_null(slot_desc->null_indicator_offset());
+        memcpy(tuple->get_slot(slot_desc->tuple_offset()), &value, sizeof(T));
+    }
+
+    // Row 0 holds values, row 1 nulls only.
+    std::unique_ptr<RowBatch> make_batch() {
+        std::unique_ptr<RowBatch> batch(
+                new RowBatch(*_row_desc, 2, _state->instance_mem_tracker()));
+        for (int i = 0; i < 2; ++i) {
+            int idx = batch->add_row();
+            Tuple* tuple = reinterpret_cast<Tuple*>(
+                    batch->tuple_data_pool()->allocate(_tuple_desc->byte_size()));
+            tuple->init(_tuple_desc->byte_size());
+            for (SlotDescriptor* slot_desc : _tuple_desc->slots()) {
+                tuple->set_null(slot_desc->null_indicator_offset());
+            }
+            if (i == 0) {
+                set_slot(tuple, DECIMAL_COLUMN, DecimalValue("-12.345"));
+                set_slot(tuple, DECIMALV2_COLUMN, DecimalV2Value("123.456"));
+                __int128 largeint = -((__int128)1 << 100);
+                set_slot(tuple, LARGEINT_COLUMN, largeint);
+                DateTimeValue date;
+                const std::string date_str = "2020-01-02";
+                date.from_date_str(date_str.data(), date_str.size());
+                date.cast_to_date();
+                set_slot(tuple, DATE_COLUMN, date);
+                DateTimeValue datetime;
+                const std::string datetime_str = "2020-01-02 03:04:05";
+                datetime.from_date_str(datetime_str.data(), datetime_str.size());
+                set_slot(tuple, DATETIME_COLUMN, datetime);
+                set_slot(tuple, BOOLEAN_COLUMN, true);
+            }
+            batch->get_row(idx)->set_tuple(0, tuple);
+            batch->commit_last_row();
+        }
+        return batch;
+    }
+
+    // Reads the record batches of the rows the writer appended to the sink.
+    static std::vector<std::shared_ptr<arrow::RecordBatch>> read_result(
+            BufferControlBlock* sinker) {
+        std::vector<std::shared_ptr<arrow::RecordBatch>> record_batches;
+        TFetchDataResult result;
+        EXPECT_TRUE(sinker->get_batch(&result).ok());
+        for (const std::string& row : result.result_batch.rows) {
+            auto buffer = std::make_shared<arrow::Buffer>(row);
+            auto stream = std::make_shared<arrow::io::BufferReader>(buffer);
+            std::shared_ptr<arrow::RecordBatchReader> reader;
+            EXPECT_TRUE(arrow::ipc::RecordBatchStreamReader::Open(stream, &reader).ok());
+            while (true) {
+                std::shared_ptr<arrow::RecordBatch> record_batch;
+                EXPECT_TRUE(reader->ReadNext(&record_batch).ok());
+                if (record_batch == nullptr) {
+                    break;
+                }
+                record_batches.push_back(record_batch);
+            }
+        }
+        return record_batches;
+    }
+
+    ObjectPool _pool;
+    TupleDescriptor* _tuple_desc = nullptr;
+    std::unique_ptr<RowDescriptor> _row_desc;
+    std::unique_ptr<RuntimeState> _state;
+    std::vector<ExprContext*> _output_expr_ctxs;
+};
+
+TEST_F(ArrowResultWriterTest, Types) {
+    BufferControlBlock sinker(TUniqueId(), 1024);
+    ASSERT_TRUE(sinker.init().ok());
+    ArrowResultWriter writer(&sinker, _output_expr_ctxs);
+    ASSERT_TRUE(writer.init(_state.get()).ok());
+
+    auto batch = make_batch();
+    ASSERT_TRUE(writer.append_row_batch(batch.get()).ok());
+
+    auto record_batches = read_result(&sinker);
+    ASSERT_EQ(1, record_batches.size());
+    const arrow::RecordBatch& record_batch = *record_batches[0];
+    ASSERT_EQ(2, record_batch.num_rows());
+    ASSERT_EQ(NUM_SLOTS + 1, record_batch.num_columns());
+    for (int i = 0; i < record_batch.num_columns(); ++i) {
+        ASSERT_EQ("c" + std::to_string(i), record_batch.schema()->field(i)->name());
+        ASSERT_TRUE(record_batch.schema()->field(i)->nullable());
+    }
+
+    // the second row is all nulls, the null bitmaps must say so
+    for (int i = 0; i < NUM_SLOTS; ++i) {
+        const arrow::Array& column = *record_batch.column(i);
+        ASSERT_EQ(1, column.null_count()) << "column " << i;
+        ASSERT_TRUE(column.IsValid(0)) << "column " << i;
+        ASSERT_TRUE(column.IsNull(1)) << "column " << i;
+    }
+
+    ASSERT_EQ(arrow::Type::STRING, record_batch.column(DECIMAL_COLUMN)->type_id());
+    ASSERT_EQ("-12.345", static_cast<const arrow::StringArray&>(
+            *record_batch.column(DECIMAL_COLUMN)).GetString(0));
+
+    ASSERT_TRUE(record_batch.column(DECIMALV2_COLUMN)->type()->Equals(
+            arrow::Decimal128Type(27, 9)));
+    ASSERT_EQ("123.456000000", static_cast<const arrow::Decimal128Array&>(
+            *record_batch.column(DECIMALV2_COLUMN)).FormatValue(0));
+
+    ASSERT_EQ(arrow::Type::STRING, record_batch.column(LARGEINT_COLUMN)->type_id());
+    ASSERT_EQ("-1267650600228229401496703205376", static_cast<const arrow::StringArray&>(
+            *record_batch.column(LARGEINT_COLUMN)).GetString(0));
+
+    ASSERT_EQ("2020-01-02", static_cast<const arrow::StringArray&>(
+            *record_batch.column(DATE_COLUMN)).GetString(0));
+    ASSERT_EQ("2020-01-02 03:04:05", static_cast<const arrow::StringArray&>(
+            *record_batch.column(DATETIME_COLUMN)).GetString(0));
+
+    ASSERT_EQ(arrow::Type::BOOL, record_batch.column(BOOLEAN_COLUMN)->type_id());
+    ASSERT_TRUE(static_cast<const arrow::BooleanArray&>(
+            *record_batch.column(BOOLEAN_COLUMN)).Value(0));
+
+    // the NULL literal is a column of the null type
+    const arrow::Array& null_column = *record_batch.column(NULL_COLUMN);
+    ASSERT_EQ(arrow::Type::NA, null_column.type_id());
+    ASSERT_EQ(2, null_column.null_count());
+}
+
+TEST_F(ArrowResultWriterTest, EmptyBatch) {
+    BufferControlBlock sinker(TUniqueId(), 1024);
+    ASSERT_TRUE(sinker.init().ok());
+    ArrowResultWriter writer(&sinker, _output_expr_ctxs);
+    ASSERT_TRUE(writer.init(_state.get()).ok());
+
+    // nothing is appended for an empty batch
+    RowBatch batch(*_row_desc, 1, _state->instance_mem_tracker());
+    ASSERT_TRUE(writer.append_row_batch(&batch).ok());
+    ASSERT_TRUE(sinker.close(Status::OK()).ok());
+    TFetchDataResult result;
+    ASSERT_TRUE(sinker.get_batch(&result).ok());
+    ASSERT_TRUE(result.eos);
+    ASSERT_TRUE(result.result_batch.rows.empty());
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
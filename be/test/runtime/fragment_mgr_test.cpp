@@ -19,6 +19,7 @@
 #include "runtime/fragment_mgr.h"
 #include "runtime/plan_fragment_executor.h"
 #include "runtime/row_batch.h"
+#include "runtime/runtime_state.h"
 #include "exec/data_sink.h"
 #include "common/config.h"
 
@@ -31,6 +32,8 @@ PlanFragmentExecutor::PlanFragmentExecutor(ExecEnv* exec_env,
                                            const report_status_callback& report_status_cb) : 
         _exec_env(exec_env),
         _report_status_cb(report_status_cb) {
+    // the pipeline engine isn't enabled by the default query options
+    _runtime_state.reset(new RuntimeState(TQueryGlobals()));
 }
 
 PlanFragmentExecutor::~PlanFragmentExecutor() {
@@ -51,6 +54,17 @@ void PlanFragmentExecutor::cancel() {
 void PlanFragmentExecutor::close() {
 }
 
+void PlanFragmentExecutor::start_pipeline() {
+}
+
+Status PlanFragmentExecutor::send_pipeline_batch(RowBatch* batch) {
+    return Status::OK();
+}
+
+Status PlanFragmentExecutor::finish_pipeline(const Status& exec_status) {
+    return exec_status;
+}
+
 class FragmentMgrTest : public testing::Test {
 public:
     FragmentMgrTest() {
@@ -0,0 +1,333 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "runtime/merge_sorter.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/config.h"
+#include "common/object_pool.h"
+#include "exprs/expr.h"
+#include "exprs/expr_context.h"
+#include "gen_cpp/Exprs_types.h"
+#include "runtime/buffered_block_mgr.h"
+#include "runtime/descriptor_helper.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem_pool.h"
+#include "runtime/row_batch.h"
+#include "runtime/runtime_state.h"
+#include "runtime/tuple.h"
+#include "runtime/tuple_row.h"
+#include "util/runtime_profile.h"
+#include "util/thread_pool.hpp"
+
+namespace doris {
+
+// A row of the input, k is NULL if k_is_null.
+struct TestRow {
+    bool k_is_null;
+    int32_t k;
+    int64_t v;
+};
+
+// Sorts by k DESC NULLS LAST, v ASC, the order is unique since v is.
+static bool test_row_less(const TestRow& lhs, const TestRow& rhs) {
+    if (lhs.k_is_null != rhs.k_is_null) {
+        return rhs.k_is_null;
+    }
+    if (!lhs.k_is_null && lhs.k != rhs.k) {
+        return lhs.k > rhs.k;
+    }
+    return lhs.v < rhs.v;
+}
+
+class MergeSorterTest : public testing::Test {
+public:
+    void SetUp() override {
+        _saved_run_rows = config::parallel_sort_run_rows;
+        config::parallel_sort_run_rows = 500;
+
+        TDescriptorTableBuilder table_builder;
+        for (int i = 0; i < 2; ++i) {
+            TTupleDescriptorBuilder tuple;
+            tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_INT).nullable(true)
+                           .column_name("k").column_pos(0).build());
+            tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_BIGINT).nullable(false)
+                           .column_name("v").column_pos(1).build());
+            tuple.build(&table_builder);
+        }
+        DescriptorTbl* desc_tbl = nullptr;
+        ASSERT_TRUE(DescriptorTbl::create(&_pool, table_builder.desc_tbl(), &desc_tbl).ok());
+        _input_tuple_desc = desc_tbl->get_tuple_descriptor(0);
+        _sort_tuple_desc = desc_tbl->get_tuple_descriptor(1);
+        _input_row_desc.reset(new RowDescriptor(_input_tuple_desc, false));
+        _sort_row_desc.reset(new RowDescriptor(_sort_tuple_desc, false));
+
+        _state.reset(new RuntimeState(TQueryGlobals()));
+        _state->set_desc_tbl(desc_tbl);
+        _state->set_is_cancelled(false);
+        _state->init_instance_mem_tracker();
+        boost::shared_ptr<BufferedBlockMgr> block_mgr;
+        ASSERT_TRUE(BufferedBlockMgr::create(_state.get(), 64 * 1024, &block_mgr).ok());
+        _state->set_block_mgr(block_mgr);
+
+        // materialize the input tuple into the sort tuple
+        _slot_expr_ctxs = make_slot_refs(_input_tuple_desc, *_input_row_desc);
+        _lhs_expr_ctxs = make_slot_refs(_sort_tuple_desc, *_sort_row_desc);
+        _rhs_expr_ctxs = make_slot_refs(_sort_tuple_desc, *_sort_row_desc);
+        _less_than.reset(new TupleRowComparator(
+                _lhs_expr_ctxs, _rhs_expr_ctxs, {false, true}, {false, false}));
+    }
+
+    void TearDown() override {
+        Expr::close(_slot_expr_ctxs, _state.get());
+        Expr::close(_lhs_expr_ctxs, _state.get());
+        Expr::close(_rhs_expr_ctxs, _state.get());
+        config::parallel_sort_run_rows = _saved_run_rows;
+    }
+
+protected:
+    std::vector<ExprContext*> make_slot_refs(TupleDescriptor* tuple_desc,
+                                             const RowDescriptor& row_desc) {
+        std::vector<TExpr> texprs;
+        for (SlotDescriptor* slot_desc : tuple_desc->slots()) {
+            TExprNode node;
+            node.node_type = TExprNodeType::SLOT_REF;
+            node.type = slot_desc->type().to_thrift();
+            node.num_children = 0;
+            node.__isset.slot_ref = true;
+            node.slot_ref.slot_id = slot_desc->id();
+            node.slot_ref.tuple_id = tuple_desc->id();
+            TExpr texpr;
+            texpr.nodes.push_back(node);
+            texprs.push_back(texpr);
+        }
+        std::vector<ExprContext*> ctxs;
+        EXPECT_TRUE(Expr::create_expr_trees(&_pool, texprs, &ctxs).ok());
+        EXPECT_TRUE(Expr::prepare(ctxs, _state.get(), row_desc,
+                                  _state->instance_mem_tracker()).ok());
+        EXPECT_TRUE(Expr::open(ctxs, _state.get()).ok());
+        return ctxs;
+    }
+
+    MergeSorter* new_sorter(int num_threads, ThreadPool* thread_pool) {
+        RuntimeProfile* profile = _pool.add(new RuntimeProfile(&_pool, "MergeSorter"));
+        return new MergeSorter(*_less_than, _slot_expr_ctxs, _sort_row_desc.get(), profile,
+                               _state.get(), num_threads, thread_pool);
+    }
+
+    static std::vector<TestRow> make_rows(int num_rows, int seed) {
+        std::vector<TestRow> rows;
+        for (int i = 0; i < num_rows; ++i) {
+            TestRow row;
+            row.k_is_null = (i + seed) % 13 == 0;
+            // many duplicated keys, resolved by v
+            row.k = ((i + seed) * 7919) % 1000 - 500;
+            row.v = i;
+            rows.push_back(row);
+        }
+        return rows;
+    }
+
+    Status add_rows(MergeSorter* sorter, const std::vector<TestRow>& rows, int begin, int end) {
+        RowBatch batch(*_input_row_desc, end - begin, _state->instance_mem_tracker());
+        SlotDescriptor* k_slot = _input_tuple_desc->slots()[0];
+        SlotDescriptor* v_slot = _input_tuple_desc->slots()[1];
+        for (int i = begin; i < end; ++i) {
+            int idx = batch.add_row();
+            Tuple* tuple = reinterpret_cast<Tuple*>(
+                    batch.tuple_data_pool()->allocate(_input_tuple_desc->byte_size()));
+            memset(tuple, 0, _input_tuple_desc->byte_size());
+            if (rows[i].k_is_null) {
+                tuple->set_null(k_slot->null_indicator_offset());
+            } else {
+                *reinterpret_cast<int32_t*>(tuple->get_slot(k_slot->tuple_offset())) = rows[i].k;
+            }
+            *reinterpret_cast<int64_t*>(tuple->get_slot(v_slot->tuple_offset())) = rows[i].v;
+            batch.get_row(idx)->set_tuple(0, tuple);
+            batch.commit_last_row();
+        }
+        return sorter->add_batch(&batch);
+    }
+
+    Status add_all_rows(MergeSorter* sorter, const std::vector<TestRow>& rows) {
+        for (int begin = 0; begin < rows.size(); begin += 100) {
+            RETURN_IF_ERROR(add_rows(sorter, rows, begin,
+                                     std::min<int>(begin + 100, rows.size())));
+        }
+        return sorter->input_done();
+    }
+
+    // Reads one batch of sorted rows and appends them to 'output'.
+    Status read_batch(MergeSorter* sorter, std::vector<TestRow>* output, bool* eos) {
+        RowBatch batch(*_sort_row_desc, _state->batch_size(), _state->instance_mem_tracker());
+        RETURN_IF_ERROR(sorter->get_next(&batch, eos));
+        SlotDescriptor* k_slot = _sort_tuple_desc->slots()[0];
+        SlotDescriptor* v_slot = _sort_tuple_desc->slots()[1];
+        for (int i = 0; i < batch.num_rows(); ++i) {
+            Tuple* tuple = batch.get_row(i)->get_tuple(0);
+            TestRow row;
+            row.k_is_null = tuple->is_null(k_slot->null_indicator_offset());
+            row.k = row.k_is_null
+                ? 0 : *reinterpret_cast<int32_t*>(tuple->get_slot(k_slot->tuple_offset()));
+            row.v = *reinterpret_cast<int64_t*>(tuple->get_slot(v_slot->tuple_offset()));
+            output->push_back(row);
+        }
+        return Status::OK();
+    }
+
+    static void check_sorted(std::vector<TestRow> input, const std::vector<TestRow>& output) {
+        std::sort(input.begin(), input.end(), test_row_less);
+        ASSERT_EQ(input.size(), output.size());
+        for (int i = 0; i < input.size(); ++i) {
+            ASSERT_EQ(input[i].k_is_null, output[i].k_is_null) << "at " << i;
+            if (!input[i].k_is_null) {
+                ASSERT_EQ(input[i].k, output[i].k) << "at " << i;
+            }
+            ASSERT_EQ(input[i].v, output[i].v) << "at " << i;
+        }
+    }
+
+    void sort_and_check(int num_rows, int num_threads, ThreadPool* thread_pool) {
+        std::vector<TestRow> rows = make_rows(num_rows, num_rows);
+        std::unique_ptr<MergeSorter> sorter(new_sorter(num_threads, thread_pool));
+        ASSERT_TRUE(add_all_rows(sorter.get(), rows).ok());
+        std::vector<TestRow> output;
+        bool eos = false;
+        while (!eos) {
+            ASSERT_TRUE(read_batch(sorter.get(), &output, &eos).ok());
+        }
+        check_sorted(rows, output);
+    }
+
+    ObjectPool _pool;
+    int64_t _saved_run_rows = 0;
+    TupleDescriptor* _input_tuple_desc = nullptr;
+    TupleDescriptor* _sort_tuple_desc = nullptr;
+    std::unique_ptr<RowDescriptor> _input_row_desc;
+    std::unique_ptr<RowDescriptor> _sort_row_desc;
+    std::unique_ptr<RuntimeState> _state;
+    std::vector<ExprContext*> _slot_expr_ctxs;
+    std::vector<ExprContext*> _lhs_expr_ctxs;
+    std::vector<ExprContext*> _rhs_expr_ctxs;
+    std::unique_ptr<TupleRowComparator> _less_than;
+};
+
+TEST_F(MergeSorterTest, SerialSort) {
+    sort_and_check(5000, 1, nullptr);
+    // without a thread pool the degree is ignored
+    sort_and_check(5000, 4, nullptr);
+}
+
+TEST_F(MergeSorterTest, ParallelSortAndMerge) {
+    ThreadPool thread_pool(4, 64);
+    // a single run, read directly
+    sort_and_check(300, 4, &thread_pool);
+    // three runs merged on the calling thread
+    sort_and_check(1400, 4, &thread_pool);
+    // 40 runs merged by 4 groups
+    sort_and_check(20000, 4, &thread_pool);
+    // more threads than the pool has, the tasks queue
+    sort_and_check(20000, 16, &thread_pool);
+}
+
+TEST_F(MergeSorterTest, SortersShareBoundedPool) {
+    // Fewer pool threads than merge groups of all sorters together: the groups must
+    // not hold the threads while their consumers are busy with the other sorters.
+    ThreadPool thread_pool(2, 4);
+    const int num_sorters = 3;
+    std::vector<std::vector<TestRow>> rows;
+    std::vector<std::unique_ptr<MergeSorter>> sorters;
+    for (int i = 0; i < num_sorters; ++i) {
+        rows.push_back(make_rows(10000, i));
+        sorters.emplace_back(new_sorter(4, &thread_pool));
+    }
+    // interleave the input of the sorters too
+    for (int begin = 0; begin < 10000; begin += 100) {
+        for (int i = 0; i < num_sorters; ++i) {
+            ASSERT_TRUE(add_rows(sorters[i].get(), rows[i], begin, begin + 100).ok());
+        }
+    }
+    for (auto& sorter : sorters) {
+        ASSERT_TRUE(sorter->input_done().ok());
+    }
+
+    std::vector<std::vector<TestRow>> outputs(num_sorters);
+    std::vector<bool> eos(num_sorters, false);
+    int num_done = 0;
+    while (num_done < num_sorters) {
+        for (int i = 0; i < num_sorters; ++i) {
+            if (eos[i]) {
+                continue;
+            }
+            bool sorter_eos = false;
+            ASSERT_TRUE(read_batch(sorters[i].get(), &outputs[i], &sorter_eos).ok());
+            if (sorter_eos) {
+                eos[i] = true;
+                ++num_done;
+            }
+        }
+    }
+    for (int i = 0; i < num_sorters; ++i) {
+        check_sorted(rows[i], outputs[i]);
+    }
+}
+
+TEST_F(MergeSorterTest, CloseBeforeEos) {
+    ThreadPool thread_pool(2, 16);
+    std::vector<TestRow> rows = make_rows(20000, 0);
+    std::unique_ptr<MergeSorter> sorter(new_sorter(4, &thread_pool));
+    ASSERT_TRUE(add_all_rows(sorter.get(), rows).ok());
+    std::vector<TestRow> output;
+    bool eos = false;
+    ASSERT_TRUE(read_batch(sorter.get(), &output, &eos).ok());
+    ASSERT_FALSE(eos);
+    // the merge tasks still running or queued must stop
+    sorter.reset();
+
+    // the pool is usable by the next sorter
+    sort_and_check(20000, 4, &thread_pool);
+}
+
+TEST_F(MergeSorterTest, Cancelled) {
+    ThreadPool thread_pool(2, 16);
+    std::vector<TestRow> rows = make_rows(20000, 0);
+    std::unique_ptr<MergeSorter> sorter(new_sorter(4, &thread_pool));
+    ASSERT_TRUE(add_all_rows(sorter.get(), rows).ok());
+    _state->set_is_cancelled(true);
+    std::vector<TestRow> output;
+    bool eos = false;
+    Status status = Status::OK();
+    while (status.ok() && !eos) {
+        status = read_batch(sorter.get(), &output, &eos);
+    }
+    // the groups return the rows merged before the cancellation, then the error
+    ASSERT_FALSE(status.ok());
+    ASSERT_LT(output.size(), rows.size());
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
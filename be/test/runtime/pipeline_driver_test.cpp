@@ -0,0 +1,430 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "runtime/pipeline_driver.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/object_pool.h"
+#include "exec/data_sink.h"
+#include "exec/exec_node.h"
+#include "runtime/descriptor_helper.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem_pool.h"
+#include "runtime/pipeline_task_scheduler.h"
+#include "runtime/plan_fragment_executor.h"
+#include "runtime/row_batch.h"
+#include "runtime/runtime_state.h"
+#include "runtime/tuple.h"
+#include "runtime/tuple_row.h"
+#include "util/cpu_info.h"
+#include "util/runtime_profile.h"
+
+namespace doris {
+
+static const int ROWS_PER_BATCH = 10;
+
+// The executor of the next fragment built by a test takes these over.
+static RuntimeState* s_state = nullptr;
+static ExecNode* s_plan = nullptr;
+static DataSink* s_sink = nullptr;
+
+// Mock used for this unittest
+PlanFragmentExecutor::PlanFragmentExecutor(ExecEnv* exec_env,
+                                           const report_status_callback& report_status_cb) :
+        _exec_env(exec_env),
+        _plan(s_plan),
+        _report_status_cb(report_status_cb) {
+    _runtime_state.reset(s_state);
+    _sink.reset(s_sink);
+}
+
+PlanFragmentExecutor::~PlanFragmentExecutor() {
+}
+
+Status PlanFragmentExecutor::prepare(const TExecPlanFragmentParams& request) {
+    return Status::OK();
+}
+
+Status PlanFragmentExecutor::open() {
+    return Status::OK();
+}
+
+void PlanFragmentExecutor::cancel() {
+}
+
+void PlanFragmentExecutor::close() {
+}
+
+void PlanFragmentExecutor::start_pipeline() {
+}
+
+Status PlanFragmentExecutor::send_pipeline_batch(RowBatch* batch) {
+    return _sink->send(runtime_state(), batch);
+}
+
+Status PlanFragmentExecutor::finish_pipeline(const Status& exec_status) {
+    Status status = _sink->close(runtime_state(), exec_status);
+    return exec_status.ok() ? status : exec_status;
+}
+
+// A source whose batches are added by the test, like a scan node whose scanners
+// haven't materialized anything yet until then.
+class TestSourceNode : public ExecNode {
+public:
+    TestSourceNode(ObjectPool* pool, const TPlanNode& tnode, const DescriptorTbl& descs) :
+            ExecNode(pool, tnode, descs),
+            _tuple_desc(descs.get_tuple_descriptor(tnode.row_tuples[0])) {
+    }
+
+    bool can_be_pipeline_source() const override {
+        return true;
+    }
+
+    bool has_output() override {
+        std::lock_guard<std::mutex> l(_lock);
+        return _num_batches > 0 || _eos;
+    }
+
+    Status get_next(RuntimeState* state, RowBatch* row_batch, bool* eos) override {
+        std::lock_guard<std::mutex> l(_lock);
+        // the driver must ask has_output() first
+        EXPECT_TRUE(_num_batches > 0 || _eos);
+        if (_num_batches > 0) {
+            --_num_batches;
+            for (int i = 0; i < ROWS_PER_BATCH; ++i) {
+                int idx = row_batch->add_row();
+                Tuple* tuple = reinterpret_cast<Tuple*>(
+                        row_batch->tuple_data_pool()->allocate(_tuple_desc->byte_size()));
+                tuple->init(_tuple_desc->byte_size());
+                row_batch->get_row(idx)->set_tuple(0, tuple);
+                row_batch->commit_last_row();
+            }
+        }
+        *eos = _num_batches == 0 && _eos;
+        return Status::OK();
+    }
+
+    void add_batches(int num_batches, bool eos) {
+        std::lock_guard<std::mutex> l(_lock);
+        _num_batches += num_batches;
+        _eos |= eos;
+    }
+
+private:
+    const TupleDescriptor* _tuple_desc;
+    std::mutex _lock;
+    int _num_batches = 0;
+    bool _eos = false;
+};
+
+// Counts the rows sent to it, is_ready() and is_idle() are set by the test.
+class TestSink : public DataSink {
+public:
+    TestSink() : _profile(&_pool, "TestSink") {
+    }
+
+    bool can_be_pipeline_sink() const override {
+        return true;
+    }
+    bool is_ready() override {
+        return ready;
+    }
+    bool is_idle() override {
+        return idle;
+    }
+
+    Status open(RuntimeState* state) override {
+        return Status::OK();
+    }
+
+    Status send(RuntimeState* state, RowBatch* batch) override {
+        num_rows += batch->num_rows();
+        return Status::OK();
+    }
+
+    Status close(RuntimeState* state, Status exec_status) override {
+        // the driver must wait for is_idle() before the sink is closed
+        EXPECT_TRUE(!exec_status.ok() || idle);
+        _closed = true;
+        return Status::OK();
+    }
+
+    RuntimeProfile* profile() override {
+        return &_profile;
+    }
+
+    bool closed() const {
+        return _closed;
+    }
+
+    std::atomic<bool> ready {true};
+    std::atomic<bool> idle {true};
+    std::atomic<int64_t> num_rows {0};
+
+private:
+    ObjectPool _pool;
+    RuntimeProfile _profile;
+};
+
+// A fragment of a single pipeline, test source -> test sink.
+struct TestFragment {
+    ~TestFragment() {
+        source->close(executor->runtime_state());
+    }
+
+    RuntimeState* state() {
+        return executor->runtime_state();
+    }
+
+    std::unique_ptr<PlanFragmentExecutor> executor;
+    // closed and deleted before the executor deletes the runtime state
+    std::unique_ptr<TestSourceNode> source;
+    TestSink* sink = nullptr;
+};
+
+class PipelineDriverTest : public testing::Test {
+public:
+    void SetUp() override {
+        TDescriptorTableBuilder table_builder;
+        TTupleDescriptorBuilder tuple;
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_INT).nullable(false)
+                       .column_name("k").column_pos(0).build());
+        tuple.build(&table_builder);
+        ASSERT_TRUE(DescriptorTbl::create(&_pool, table_builder.desc_tbl(), &_desc_tbl).ok());
+
+        _tnode.node_id = 0;
+        _tnode.node_type = TPlanNodeType::EXCHANGE_NODE;
+        _tnode.num_children = 0;
+        _tnode.limit = -1;
+        _tnode.row_tuples.push_back(0);
+        _tnode.nullable_tuples.push_back(false);
+    }
+
+protected:
+    std::unique_ptr<TestFragment> new_fragment() {
+        std::unique_ptr<TestFragment> fragment(new TestFragment());
+        RuntimeState* state = new RuntimeState(TQueryGlobals());
+        state->set_desc_tbl(_desc_tbl);
+        state->set_is_cancelled(false);
+        state->init_instance_mem_tracker();
+        fragment->source.reset(new TestSourceNode(&_pool, _tnode, *_desc_tbl));
+        EXPECT_TRUE(fragment->source->prepare(state).ok());
+        fragment->sink = new TestSink();
+
+        s_state = state;
+        s_plan = fragment->source.get();
+        s_sink = fragment->sink;
+        fragment->executor.reset(new PlanFragmentExecutor(
+                nullptr, PlanFragmentExecutor::report_status_callback()));
+        return fragment;
+    }
+
+    static std::unique_ptr<PipelineDriver> new_driver(TestFragment* fragment) {
+        std::unique_ptr<PipelineDriver> driver;
+        EXPECT_TRUE(PipelineDriver::create(fragment->executor.get(), &driver).ok());
+        return driver;
+    }
+
+    ObjectPool _pool;
+    DescriptorTbl* _desc_tbl = nullptr;
+    TPlanNode _tnode;
+};
+
+// a time slice no test reaches
+static const int64_t LONG_TIME_SLICE_NS = 3600L * 1000 * 1000 * 1000;
+
+TEST_F(PipelineDriverTest, BlockedOnSource) {
+    auto fragment = new_fragment();
+    auto driver = new_driver(fragment.get());
+
+    // nothing was materialized, the driver must not wait in get_next()
+    ASSERT_EQ(PipelineDriver::BLOCKED, driver->process(LONG_TIME_SLICE_NS));
+    ASSERT_FALSE(driver->is_ready());
+    ASSERT_EQ(0, fragment->sink->num_rows);
+
+    fragment->source->add_batches(3, false);
+    ASSERT_TRUE(driver->is_ready());
+    ASSERT_EQ(PipelineDriver::BLOCKED, driver->process(LONG_TIME_SLICE_NS));
+    ASSERT_EQ(3 * ROWS_PER_BATCH, fragment->sink->num_rows);
+    ASSERT_FALSE(driver->is_ready());
+
+    fragment->source->add_batches(1, true);
+    ASSERT_TRUE(driver->is_ready());
+    ASSERT_EQ(PipelineDriver::FINISHED, driver->process(LONG_TIME_SLICE_NS));
+    ASSERT_TRUE(driver->status().ok());
+    ASSERT_EQ(4 * ROWS_PER_BATCH, fragment->sink->num_rows);
+
+    driver->finish();
+    ASSERT_TRUE(driver->status().ok());
+    ASSERT_TRUE(fragment->sink->closed());
+}
+
+TEST_F(PipelineDriverTest, BlockedOnSink) {
+    auto fragment = new_fragment();
+    auto driver = new_driver(fragment.get());
+    fragment->source->add_batches(2, true);
+
+    fragment->sink->ready = false;
+    ASSERT_EQ(PipelineDriver::BLOCKED, driver->process(LONG_TIME_SLICE_NS));
+    ASSERT_FALSE(driver->is_ready());
+    ASSERT_EQ(0, fragment->sink->num_rows);
+
+    // the source is exhausted, but the sink still has rpcs in flight
+    fragment->sink->ready = true;
+    fragment->sink->idle = false;
+    ASSERT_TRUE(driver->is_ready());
+    ASSERT_EQ(PipelineDriver::BLOCKED, driver->process(LONG_TIME_SLICE_NS));
+    ASSERT_EQ(2 * ROWS_PER_BATCH, fragment->sink->num_rows);
+    ASSERT_FALSE(driver->is_ready());
+
+    fragment->sink->idle = true;
+    ASSERT_TRUE(driver->is_ready());
+    ASSERT_EQ(PipelineDriver::FINISHED, driver->process(LONG_TIME_SLICE_NS));
+    driver->finish();
+    ASSERT_TRUE(driver->status().ok());
+    ASSERT_TRUE(fragment->sink->closed());
+}
+
+TEST_F(PipelineDriverTest, TimeSliceUsedUp) {
+    auto fragment = new_fragment();
+    auto driver = new_driver(fragment.get());
+    fragment->source->add_batches(3, true);
+
+    // a step at a time
+    for (int i = 1; i <= 3; ++i) {
+        ASSERT_EQ(PipelineDriver::READY, driver->process(0));
+        ASSERT_EQ(i * ROWS_PER_BATCH, fragment->sink->num_rows);
+    }
+    ASSERT_EQ(PipelineDriver::FINISHED, driver->process(0));
+    driver->finish();
+    ASSERT_TRUE(driver->status().ok());
+}
+
+TEST_F(PipelineDriverTest, Cancelled) {
+    auto fragment = new_fragment();
+    auto driver = new_driver(fragment.get());
+    ASSERT_EQ(PipelineDriver::BLOCKED, driver->process(LONG_TIME_SLICE_NS));
+
+    // a cancelled driver is woken up to finish
+    fragment->state()->set_is_cancelled(true);
+    ASSERT_TRUE(driver->is_ready());
+    ASSERT_EQ(PipelineDriver::FINISHED, driver->process(LONG_TIME_SLICE_NS));
+    driver->finish();
+    ASSERT_TRUE(driver->status().is_cancelled());
+    ASSERT_TRUE(fragment->sink->closed());
+}
+
+class PipelineTaskSchedulerTest : public PipelineDriverTest {
+protected:
+    void on_finish(PipelineDriver* driver) {
+        ASSERT_TRUE(driver->status().ok());
+        std::lock_guard<std::mutex> l(_lock);
+        ++_num_finished;
+        _finished_cv.notify_all();
+    }
+
+    std::unique_ptr<PipelineDriver> new_driver(TestFragment* fragment) {
+        auto driver = PipelineDriverTest::new_driver(fragment);
+        driver->set_finish_callback(std::bind(&PipelineTaskSchedulerTest::on_finish, this,
+                                              std::placeholders::_1));
+        return driver;
+    }
+
+    bool wait_finished(int num_finished) {
+        std::unique_lock<std::mutex> l(_lock);
+        return _finished_cv.wait_for(l, std::chrono::seconds(30),
+                                     [&] { return _num_finished >= num_finished; });
+    }
+
+    std::mutex _lock;
+    std::condition_variable _finished_cv;
+    int _num_finished = 0;
+};
+
+TEST_F(PipelineTaskSchedulerTest, BlockedDriverReleasesWorker) {
+    auto waiting = new_fragment();
+    auto running = new_fragment();
+    running->source->add_batches(5, true);
+    {
+        // one worker: the second driver only runs if the first one is parked
+        PipelineTaskScheduler scheduler(1, 100);
+        scheduler.submit(new_driver(waiting.get()));
+        scheduler.submit(new_driver(running.get()));
+        ASSERT_TRUE(wait_finished(1));
+        ASSERT_TRUE(running->sink->closed());
+        ASSERT_FALSE(waiting->sink->closed());
+
+        // the poller wakes it up
+        waiting->source->add_batches(2, true);
+        ASSERT_TRUE(wait_finished(2));
+        // the drivers are deleted by the time the workers are joined
+    }
+    ASSERT_EQ(5 * ROWS_PER_BATCH, running->sink->num_rows);
+    ASSERT_EQ(2 * ROWS_PER_BATCH, waiting->sink->num_rows);
+    ASSERT_TRUE(waiting->sink->closed());
+}
+
+TEST_F(PipelineTaskSchedulerTest, ManyDrivers) {
+    const int num_fragments = 16;
+    const int num_rounds = 20;
+    std::vector<std::unique_ptr<TestFragment>> fragments;
+    for (int i = 0; i < num_fragments; ++i) {
+        fragments.push_back(new_fragment());
+    }
+    {
+        // short time slices, more drivers than workers
+        PipelineTaskScheduler scheduler(3, 1);
+        for (auto& fragment : fragments) {
+            scheduler.submit(new_driver(fragment.get()));
+        }
+        // the sources and the sinks go on in turns
+        for (int round = 0; round < num_rounds; ++round) {
+            for (int i = 0; i < num_fragments; ++i) {
+                fragments[i]->sink->ready = (round + i) % 3 != 0;
+                fragments[i]->source->add_batches(1, round == num_rounds - 1);
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        for (auto& fragment : fragments) {
+            fragment->sink->ready = true;
+        }
+        ASSERT_TRUE(wait_finished(num_fragments));
+    }
+    for (auto& fragment : fragments) {
+        ASSERT_EQ(num_rounds * ROWS_PER_BATCH, fragment->sink->num_rows);
+        ASSERT_TRUE(fragment->sink->closed());
+    }
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    doris::CpuInfo::init();
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,58 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "runtime/resource_group.h"
+
+#include <gtest/gtest.h>
+
+#include "runtime/mem_tracker.h"
+#include "util/time.h"
+
+namespace doris {
+
+TEST(ResourceGroupTest, ScanBandwidth) {
+    const int64_t rate = 1024 * 1024;
+    ResourceGroup group("test", 1, rate, -1, nullptr);
+
+    // a burst of one second
+    ASSERT_EQ(0, group.consume_scan_bytes(rate / 2));
+    ASSERT_EQ(0, group.consume_scan_bytes(rate / 4));
+
+    // over the bandwidth, the wait is left to the caller
+    int64_t start_ns = MonotonicNanos();
+    int64_t wait_ns = group.consume_scan_bytes(rate);
+    ASSERT_LT(MonotonicNanos() - start_ns, wait_ns);
+    ASSERT_GT(wait_ns, 500L * 1000 * 1000);
+    ASSERT_LE(wait_ns, 1000L * 1000 * 1000);
+
+    ASSERT_EQ(0, group.consume_scan_bytes(0));
+}
+
+TEST(ResourceGroupTest, Unlimited) {
+    ResourceGroup group("test", 1, 0, -1, nullptr);
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_EQ(0, group.consume_scan_bytes(1024L * 1024 * 1024));
+    }
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,178 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "runtime/row_batch.h"
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "common/object_pool.h"
+#include "gen_cpp/data.pb.h"
+#include "runtime/descriptor_helper.h"
+#include "runtime/descriptors.h"
+#include "runtime/mem_pool.h"
+#include "runtime/mem_tracker.h"
+#include "runtime/string_value.h"
+#include "runtime/tuple.h"
+#include "runtime/tuple_row.h"
+
+namespace doris {
+
+class RowBatchTest : public testing::Test {
+public:
+    void SetUp() override {
+        TDescriptorTableBuilder table_builder;
+        TTupleDescriptorBuilder tuple;
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_INT).nullable(true)
+                       .column_name("k1").column_pos(0).build());
+        tuple.add_slot(TSlotDescriptorBuilder().string_type(64).nullable(true)
+                       .column_name("k2").column_pos(1).build());
+        tuple.build(&table_builder);
+        DescriptorTbl* desc_tbl = nullptr;
+        ASSERT_TRUE(DescriptorTbl::create(&_pool, table_builder.desc_tbl(), &desc_tbl).ok());
+        _tuple_desc = desc_tbl->get_tuple_descriptor(0);
+        _row_desc.reset(new RowDescriptor(_tuple_desc, false));
+        _tracker.reset(new MemTracker(-1));
+    }
+
+protected:
+    // Rows of (i, "value <i % 10>"), k1 is null for every 7th row.
+    std::unique_ptr<RowBatch> make_batch(int num_rows) {
+        std::unique_ptr<RowBatch> batch(new RowBatch(*_row_desc, num_rows, _tracker.get()));
+        SlotDescriptor* int_slot = _tuple_desc->slots()[0];
+        SlotDescriptor* string_slot = _tuple_desc->slots()[1];
+        for (int i = 0; i < num_rows; ++i) {
+            int idx = batch->add_row();
+            Tuple* tuple = reinterpret_cast<Tuple*>(
+                    batch->tuple_data_pool()->allocate(_tuple_desc->byte_size()));
+            memset(tuple, 0, _tuple_desc->byte_size());
+            if (i % 7 == 0) {
+                tuple->set_null(int_slot->null_indicator_offset());
+            } else {
+                *reinterpret_cast<int32_t*>(tuple->get_slot(int_slot->tuple_offset())) = i;
+            }
+            std::string value = "value " + std::to_string(i % 10);
+            char* ptr = reinterpret_cast<char*>(batch->tuple_data_pool()->allocate(value.size()));
+            memcpy(ptr, value.data(), value.size());
+            StringValue* string_value = reinterpret_cast<StringValue*>(
+                    tuple->get_slot(string_slot->tuple_offset()));
+            string_value->ptr = ptr;
+            string_value->len = value.size();
+            batch->get_row(idx)->set_tuple(0, tuple);
+            batch->commit_last_row();
+        }
+        return batch;
+    }
+
+    void check_batch(RowBatch* batch, int num_rows) {
+        ASSERT_EQ(num_rows, batch->num_rows());
+        SlotDescriptor* int_slot = _tuple_desc->slots()[0];
+        SlotDescriptor* string_slot = _tuple_desc->slots()[1];
+        for (int i = 0; i < num_rows; ++i) {
+            Tuple* tuple = batch->get_row(i)->get_tuple(0);
+            if (i % 7 == 0) {
+                ASSERT_TRUE(tuple->is_null(int_slot->null_indicator_offset()));
+            } else {
+                ASSERT_FALSE(tuple->is_null(int_slot->null_indicator_offset()));
+                ASSERT_EQ(i, *reinterpret_cast<int32_t*>(
+                        tuple->get_slot(int_slot->tuple_offset())));
+            }
+            StringValue* string_value = reinterpret_cast<StringValue*>(
+                    tuple->get_slot(string_slot->tuple_offset()));
+            ASSERT_EQ("value " + std::to_string(i % 10), string_value->to_string());
+        }
+    }
+
+    ObjectPool _pool;
+    TupleDescriptor* _tuple_desc = nullptr;
+    std::unique_ptr<RowDescriptor> _row_desc;
+    std::unique_ptr<MemTracker> _tracker;
+};
+
+TEST_F(RowBatchTest, SerializeAndCreate) {
+    std::unique_ptr<RowBatch> batch = make_batch(1000);
+    for (auto type : {segment_v2::CompressionTypePB::NO_COMPRESSION,
+                      segment_v2::CompressionTypePB::SNAPPY,
+                      segment_v2::CompressionTypePB::LZ4,
+                      segment_v2::CompressionTypePB::ZSTD}) {
+        PRowBatch pb_batch;
+        batch->serialize(&pb_batch, type);
+        ASSERT_EQ(type != segment_v2::CompressionTypePB::NO_COMPRESSION,
+                  pb_batch.is_compressed()) << type;
+        RowBatch* output = nullptr;
+        ASSERT_TRUE(RowBatch::create(*_row_desc, pb_batch, _tracker.get(), &output).ok());
+        std::unique_ptr<RowBatch> output_guard(output);
+        check_batch(output, 1000);
+    }
+}
+
+TEST_F(RowBatchTest, CorruptedTupleData) {
+    std::unique_ptr<RowBatch> batch = make_batch(1000);
+    for (auto type : {segment_v2::CompressionTypePB::SNAPPY,
+                      segment_v2::CompressionTypePB::LZ4,
+                      segment_v2::CompressionTypePB::ZSTD}) {
+        PRowBatch pb_batch;
+        batch->serialize(&pb_batch, type);
+        ASSERT_TRUE(pb_batch.is_compressed());
+        // cut off the second half of the compressed data
+        pb_batch.mutable_tuple_data()->resize(pb_batch.tuple_data().size() / 2);
+        RowBatch* output = nullptr;
+        ASSERT_FALSE(RowBatch::create(*_row_desc, pb_batch, _tracker.get(), &output).ok())
+            << type;
+        ASSERT_EQ(nullptr, output);
+    }
+
+    // garbage that isn't snappy at all
+    PRowBatch pb_batch;
+    batch->serialize(&pb_batch, segment_v2::CompressionTypePB::SNAPPY);
+    pb_batch.set_tuple_data(std::string(64, '\xff'));
+    RowBatch* output = nullptr;
+    ASSERT_FALSE(RowBatch::create(*_row_desc, pb_batch, _tracker.get(), &output).ok());
+}
+
+TEST_F(RowBatchTest, BadCompressionType) {
+    std::unique_ptr<RowBatch> batch = make_batch(100);
+    PRowBatch pb_batch;
+    batch->serialize(&pb_batch, segment_v2::CompressionTypePB::LZ4);
+    ASSERT_TRUE(pb_batch.is_compressed());
+
+    // a codec this backend doesn't know
+    PRowBatch unknown_type = pb_batch;
+    unknown_type.set_compression_type(100);
+    RowBatch* output = nullptr;
+    ASSERT_FALSE(RowBatch::create(*_row_desc, unknown_type, _tracker.get(), &output).ok());
+
+    PRowBatch no_size = pb_batch;
+    no_size.clear_uncompressed_size();
+    ASSERT_FALSE(RowBatch::create(*_row_desc, no_size, _tracker.get(), &output).ok());
+
+    // the data decompresses to less than the sender claims
+    PRowBatch wrong_size = pb_batch;
+    wrong_size.set_uncompressed_size(pb_batch.uncompressed_size() + 100);
+    ASSERT_FALSE(RowBatch::create(*_row_desc, wrong_size, _tracker.get(), &output).ok());
+    ASSERT_EQ(nullptr, output);
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,137 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "runtime/scanner_scheduler.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "util/count_down_latch.hpp"
+#include "util/time.h"
+
+namespace doris {
+
+static TUniqueId make_query_id(int64_t lo) {
+    TUniqueId id;
+    id.hi = 1;
+    id.lo = lo;
+    return id;
+}
+
+TEST(ScannerSchedulerTest, RunAll) {
+    ScannerScheduler scheduler(4, 16);
+    auto query = scheduler.register_query(make_query_id(1));
+    ASSERT_EQ(query.get(), scheduler.register_query(make_query_id(1)).get());
+
+    RuntimeProfile profile("test");
+    RuntimeProfile::Counter* wait_timer = ADD_TIMER(&profile, "WaitTime");
+    std::atomic<int> num_run(0);
+    CountDownLatch latch(100);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(scheduler.submit(query, [&] {
+            ++num_run;
+            latch.count_down();
+        }, wait_timer));
+    }
+    latch.await();
+    ASSERT_EQ(100, num_run.load());
+    ASSERT_EQ(0, scheduler.num_queued_tasks());
+
+    scheduler.shutdown();
+    ASSERT_FALSE(scheduler.submit(query, [] {}, nullptr));
+}
+
+TEST(ScannerSchedulerTest, NewQueryIsNotStarved) {
+    ScannerScheduler scheduler(1, 1024);
+    auto long_query = scheduler.register_query(make_query_id(1));
+    auto short_query = scheduler.register_query(make_query_id(2));
+
+    std::mutex order_lock;
+    std::vector<int> order;
+    CountDownLatch started(1);
+    CountDownLatch done(21);
+    for (int i = 0; i < 20; ++i) {
+        scheduler.submit(long_query, [&, i] {
+            if (i == 0) {
+                started.count_down();
+            }
+            usleep(2000);
+            std::lock_guard<std::mutex> l(order_lock);
+            order.push_back(i);
+            done.count_down();
+        }, nullptr);
+    }
+    // the long query has 19 tasks queued when the short one arrives
+    started.await();
+    scheduler.submit(short_query, [&] {
+        std::lock_guard<std::mutex> l(order_lock);
+        order.push_back(-1);
+        done.count_down();
+    }, nullptr);
+    done.await();
+
+    auto pos = std::find(order.begin(), order.end(), -1) - order.begin();
+    ASSERT_LE(pos, 2);
+}
+
+TEST(ScannerSchedulerTest, DelayedTaskDoesNotHoldWorker) {
+    ScannerScheduler scheduler(1, 16);
+    auto query = scheduler.register_query(make_query_id(1));
+
+    std::mutex order_lock;
+    std::vector<int> order;
+    CountDownLatch done(2);
+    int64_t submit_ns = MonotonicNanos();
+    std::atomic<int64_t> delayed_run_ns(0);
+    ASSERT_TRUE(scheduler.submit_delayed(query, [&] {
+        delayed_run_ns = MonotonicNanos();
+        std::lock_guard<std::mutex> l(order_lock);
+        order.push_back(1);
+        done.count_down();
+    }, 50 * 1000 * 1000, nullptr));
+    // the only worker is free for the tasks queued meanwhile
+    ASSERT_TRUE(scheduler.submit(query, [&] {
+        std::lock_guard<std::mutex> l(order_lock);
+        order.push_back(0);
+        done.count_down();
+    }, nullptr));
+    done.await();
+
+    ASSERT_EQ(std::vector<int>({0, 1}), order);
+    ASSERT_GE(delayed_run_ns.load() - submit_ns, 50 * 1000 * 1000);
+
+    // the delayed tasks are dropped on shutdown
+    std::atomic<bool> dropped_run(false);
+    ASSERT_TRUE(scheduler.submit_delayed(query, [&] { dropped_run = true; },
+                                         3600L * 1000 * 1000 * 1000, nullptr));
+    scheduler.shutdown();
+    ASSERT_FALSE(scheduler.submit_delayed(query, [] {}, 1000, nullptr));
+    ASSERT_FALSE(dropped_run.load());
+}
+
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,252 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+
+#include "runtime/topn_threshold.h"
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/object_pool.h"
+#include "runtime/descriptor_helper.h"
+#include "runtime/descriptors.h"
+#include "runtime/string_value.h"
+#include "runtime/tuple.h"
+
+namespace doris {
+
+class TopNThresholdTest : public testing::Test {
+public:
+    void SetUp() override {
+        TDescriptorTableBuilder table_builder;
+        TTupleDescriptorBuilder tuple;
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_INT).nullable(true)
+                       .column_name("k1").column_pos(0).build());
+        tuple.add_slot(TSlotDescriptorBuilder().string_type(64).nullable(true)
+                       .column_name("k2").column_pos(1).build());
+        tuple.build(&table_builder);
+        DescriptorTbl* desc_tbl = nullptr;
+        ASSERT_TRUE(DescriptorTbl::create(&_pool, table_builder.desc_tbl(), &desc_tbl).ok());
+        _tuple_desc = desc_tbl->get_tuple_descriptor(0);
+        _int_slot = _tuple_desc->slots()[0];
+        _string_slot = _tuple_desc->slots()[1];
+    }
+
+protected:
+    Tuple* make_int_tuple(std::vector<char>* buf, const int32_t* value) {
+        buf->assign(_tuple_desc->byte_size(), 0);
+        Tuple* tuple = reinterpret_cast<Tuple*>(buf->data());
+        if (value == nullptr) {
+            tuple->set_null(_int_slot->null_indicator_offset());
+        } else {
+            *reinterpret_cast<int32_t*>(tuple->get_slot(_int_slot->tuple_offset())) = *value;
+        }
+        return tuple;
+    }
+
+    Tuple* make_string_tuple(std::vector<char>* buf, const std::string& value) {
+        buf->assign(_tuple_desc->byte_size(), 0);
+        Tuple* tuple = reinterpret_cast<Tuple*>(buf->data());
+        StringValue sv(const_cast<char*>(value.data()), value.size());
+        memcpy(tuple->get_slot(_string_slot->tuple_offset()), &sv, sizeof(StringValue));
+        return tuple;
+    }
+
+    bool int_beyond(TopNThresholdChecker* checker, const int32_t* value) {
+        std::vector<char> buf;
+        return checker->is_beyond(make_int_tuple(&buf, value));
+    }
+
+    ObjectPool _pool;
+    TupleDescriptor* _tuple_desc = nullptr;
+    SlotDescriptor* _int_slot = nullptr;
+    SlotDescriptor* _string_slot = nullptr;
+};
+
+TEST_F(TopNThresholdTest, PushDownRules) {
+    // nulls first on a nullable column can't be bounded by a non-null heap top
+    ASSERT_FALSE(TopNThreshold::can_bound(true, true));
+    ASSERT_TRUE(TopNThreshold::can_bound(true, false));
+    ASSERT_TRUE(TopNThreshold::can_bound(false, true));
+    ASSERT_TRUE(TopNThreshold::can_bound(false, false));
+
+    // storage returns keys ascending with nulls first
+    ASSERT_TRUE(TopNThreshold::in_storage_order(true, true, true));
+    ASSERT_TRUE(TopNThreshold::in_storage_order(true, false, false));
+    ASSERT_FALSE(TopNThreshold::in_storage_order(true, false, true));
+    ASSERT_FALSE(TopNThreshold::in_storage_order(false, true, false));
+    ASSERT_FALSE(TopNThreshold::in_storage_order(false, false, false));
+}
+
+TEST_F(TopNThresholdTest, NullKeys) {
+    TopNThreshold threshold("k1", _int_slot->type(), true);
+    TopNThresholdChecker checker(&threshold, _int_slot);
+    int32_t five = 5;
+    int32_t ten = 10;
+    int32_t eleven = 11;
+
+    // nothing is filtered before the heap is full, not even nulls
+    TCondition condition;
+    ASSERT_FALSE(threshold.get_condition(&condition));
+    ASSERT_FALSE(int_beyond(&checker, nullptr));
+    ASSERT_FALSE(int_beyond(&checker, &eleven));
+
+    threshold.update(&ten);
+    ASSERT_TRUE(threshold.get_condition(&condition));
+    ASSERT_EQ("<=", condition.condition_op);
+    ASSERT_EQ("10", condition.condition_values[0]);
+    ASSERT_FALSE(int_beyond(&checker, &five));
+    // the bound is inclusive
+    ASSERT_FALSE(int_beyond(&checker, &ten));
+    ASSERT_TRUE(int_beyond(&checker, &eleven));
+    // nulls sort last once the bound is pushed down
+    ASSERT_TRUE(int_beyond(&checker, nullptr));
+}
+
+TEST_F(TopNThresholdTest, DescOrder) {
+    TopNThreshold threshold("k1", _int_slot->type(), false);
+    TopNThresholdChecker checker(&threshold, _int_slot);
+    int32_t nine = 9;
+    int32_t ten = 10;
+    int32_t fifteen = 15;
+
+    threshold.update(&ten);
+    TCondition condition;
+    ASSERT_TRUE(threshold.get_condition(&condition));
+    ASSERT_EQ(">=", condition.condition_op);
+    ASSERT_FALSE(int_beyond(&checker, &fifteen));
+    ASSERT_FALSE(int_beyond(&checker, &ten));
+    ASSERT_TRUE(int_beyond(&checker, &nine));
+
+    // the checker picks up a tightened bound
+    int32_t twenty = 20;
+    threshold.update(&twenty);
+    ASSERT_TRUE(int_beyond(&checker, &fifteen));
+    ASSERT_TRUE(int_beyond(&checker, nullptr));
+
+    // string bounds keep their own copy of the payload
+    TopNThreshold string_threshold("k2", _string_slot->type(), false);
+    TopNThresholdChecker string_checker(&string_threshold, _string_slot);
+    {
+        std::string bound = "m";
+        StringValue sv(const_cast<char*>(bound.data()), bound.size());
+        string_threshold.update(&sv);
+        bound = "x";
+    }
+    std::vector<char> buf;
+    ASSERT_FALSE(string_checker.is_beyond(make_string_tuple(&buf, "z")));
+    ASSERT_FALSE(string_checker.is_beyond(make_string_tuple(&buf, "m")));
+    ASSERT_FALSE(string_checker.is_beyond(make_string_tuple(&buf, "ma")));
+    ASSERT_TRUE(string_checker.is_beyond(make_string_tuple(&buf, "l")));
+}
+
+// The storage bound of a floating point column keeps the exact value, a rounded
+// bound would prune rows of the result.
+TEST_F(TopNThresholdTest, FloatingPointBounds) {
+    TopNThreshold threshold("v1", TypeDescriptor(TYPE_DOUBLE), true);
+    TCondition condition;
+    for (double value : {1.234564, 1234567.8, 0.1, -3.0000000000000004, 1e-300, 123456789.0}) {
+        threshold.update(&value);
+        ASSERT_TRUE(threshold.get_condition(&condition));
+        ASSERT_EQ(value, atof(condition.condition_values[0].c_str()))
+                << condition.condition_values[0];
+    }
+    // more than 6 significant digits
+    double value = 1.234564;
+    threshold.update(&value);
+    ASSERT_TRUE(threshold.get_condition(&condition));
+    ASSERT_GT(atof(condition.condition_values[0].c_str()), 1.23456);
+
+    TopNThreshold float_threshold("v2", TypeDescriptor(TYPE_FLOAT), false);
+    for (float value : {1.2345678f, 1234567.9f, 0.1f, 16777215.0f}) {
+        float_threshold.update(&value);
+        ASSERT_TRUE(float_threshold.get_condition(&condition));
+        ASSERT_EQ(value, static_cast<float>(atof(condition.condition_values[0].c_str())))
+                << condition.condition_values[0];
+    }
+}
+
+// Several scanners read their own key ranges in key order while the TopN node
+// keeps tightening the bound they share.
+TEST_F(TopNThresholdTest, ScannersShareThreshold) {
+    const int num_scanners = 4;
+    const int range_size = 10000;
+    TopNThreshold threshold("k1", _int_slot->type(), true);
+    int32_t initial_bound = num_scanners * range_size;
+    threshold.update(&initial_bound);
+
+    std::atomic<bool> started(false);
+    std::vector<int32_t> first_beyond(num_scanners, -1);
+    std::vector<char> ordered(num_scanners, 1);
+    std::vector<std::thread> scanners;
+    for (int i = 0; i < num_scanners; ++i) {
+        scanners.emplace_back([&, i] {
+            TopNThresholdChecker checker(&threshold, _int_slot);
+            while (!started.load()) {
+            }
+            for (int32_t key = i * range_size; key < (i + 1) * range_size; ++key) {
+                bool beyond = int_beyond(&checker, &key);
+                if (beyond && first_beyond[i] == -1) {
+                    first_beyond[i] = key;
+                } else if (!beyond && first_beyond[i] != -1) {
+                    // the bound only tightens, a key passed after a smaller
+                    // one was dropped would be a result row gone missing
+                    ordered[i] = 0;
+                }
+            }
+        });
+    }
+    started = true;
+    for (int32_t bound = initial_bound; bound >= range_size + range_size / 2; bound -= 7) {
+        threshold.update(&bound);
+    }
+    int32_t final_bound = range_size + range_size / 2;
+    threshold.update(&final_bound);
+    for (auto& scanner : scanners) {
+        scanner.join();
+    }
+
+    for (int i = 0; i < num_scanners; ++i) {
+        ASSERT_TRUE(ordered[i]) << "scanner " << i;
+    }
+    // whatever the interleaving, every row within the final bound was seen
+    // before anything was dropped
+    for (int i = 0; i < num_scanners; ++i) {
+        if (first_beyond[i] != -1) {
+            ASSERT_GT(first_beyond[i], final_bound);
+        }
+    }
+
+    // a scanner starting now drops everything beyond the final bound
+    TopNThresholdChecker checker(&threshold, _int_slot);
+    for (int i = 0; i < num_scanners; ++i) {
+        int32_t first_key = i * range_size;
+        ASSERT_EQ(first_key > final_bound, int_beyond(&checker, &first_key));
+    }
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
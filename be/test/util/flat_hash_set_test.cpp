@@ -0,0 +1,114 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/flat_hash_set.h"
+
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <unordered_set>
+
+namespace doris {
+
+class FlatHashSetTest : public testing::Test {
+public:
+    FlatHashSetTest() { }
+    virtual ~FlatHashSetTest() { }
+};
+
+TEST_F(FlatHashSetTest, int_set) {
+    FlatHashSet<int64_t> set;
+    std::unordered_set<int64_t> expected;
+    std::mt19937_64 rng(0);
+    for (int i = 0; i < 100000; ++i) {
+        int64_t value = (int64_t)(rng() % 20000) - 10000;
+        ASSERT_EQ(expected.insert(value).second, set.insert(value));
+    }
+    ASSERT_EQ(expected.size(), set.size());
+
+    size_t visited = 0;
+    set.for_each([&expected, &visited](int64_t value) {
+        ASSERT_EQ(1, expected.count(value));
+        ++visited;
+    });
+    ASSERT_EQ(expected.size(), visited);
+    ASSERT_TRUE(set.contains(0));
+    ASSERT_FALSE(set.contains(10000));
+
+    set.clear();
+    ASSERT_TRUE(set.empty());
+    ASSERT_FALSE(set.contains(0));
+}
+
+TEST_F(FlatHashSetTest, zero_and_wide_keys) {
+    FlatHashSet<__int128> set;
+    __int128 big = ((__int128)1) << 100;
+    ASSERT_FALSE(set.contains(0));
+    ASSERT_TRUE(set.insert(0));
+    ASSERT_FALSE(set.insert(0));
+    ASSERT_TRUE(set.insert(big));
+    ASSERT_EQ(2, set.size());
+    ASSERT_TRUE(set.contains(0));
+    ASSERT_TRUE(set.contains(big));
+    ASSERT_FALSE(set.contains(big + 1));
+}
+
+TEST_F(FlatHashSetTest, reserve) {
+    FlatHashSet<int32_t> set;
+    set.reserve(1000);
+    size_t bytes = set.memory_usage();
+    for (int i = 0; i < 1000; ++i) {
+        set.insert(i);
+    }
+    ASSERT_EQ(1000, set.size());
+    ASSERT_EQ(bytes, set.memory_usage());
+}
+
+TEST_F(FlatHashSetTest, string_set) {
+    FlatStringSet set;
+    std::unordered_set<std::string> expected;
+    std::mt19937 rng(0);
+    for (int i = 0; i < 100000; ++i) {
+        std::string value = std::to_string(rng() % 20000);
+        if (i % 10 == 0) {
+            value.clear();
+        }
+        ASSERT_EQ(expected.insert(value).second,
+                  set.insert(Slice(value.data(), value.size())));
+    }
+    ASSERT_EQ(expected.size(), set.size());
+
+    size_t visited = 0;
+    set.for_each([&expected, &visited](const Slice& value) {
+        ASSERT_EQ(1, expected.count(value.to_string()));
+        ++visited;
+    });
+    ASSERT_EQ(expected.size(), visited);
+
+    ASSERT_TRUE(set.contains(Slice("", 0)));
+    ASSERT_FALSE(set.contains(Slice("abc")));
+    Slice key("19999");
+    ASSERT_EQ(expected.count("19999") == 1,
+              set.contains_with_hash(key, FlatStringSet::hash(key)));
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,111 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/io_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include "util/time.h"
+
+namespace doris {
+
+TEST(IOSchedulerTest, Unlimited) {
+    IOScheduler scheduler("test", 0, true);
+    int64_t start_ns = MonotonicNanos();
+    scheduler.consume(IOScheduler::IO_CLASS_BASE_COMPACTION, 1L << 40);
+    ASSERT_LT(MonotonicNanos() - start_ns, 100L * 1000 * 1000);
+    // no limit isn't tuned either
+    scheduler.report_foreground_read(1000L * 1000 * 1000, 1024 * 1024);
+    scheduler.tune();
+    ASSERT_EQ(0, scheduler.rate());
+}
+
+TEST(IOSchedulerTest, ScopedIOClass) {
+    // 1000 bytes per second
+    IOScheduler scheduler("test", 1000, false);
+    {
+        ScopedIOClass io_class(&scheduler, IOScheduler::IO_CLASS_CLONE);
+        // the burst of the highest class is available at once
+        int64_t start_ns = MonotonicNanos();
+        IOScheduler::consume_current(1000);
+        ASSERT_LT(MonotonicNanos() - start_ns, 50L * 1000 * 1000);
+        {
+            ScopedIOClass no_io_class(nullptr, IOScheduler::IO_CLASS_CLONE);
+            IOScheduler::consume_current(1L << 40);
+            ASSERT_LT(MonotonicNanos() - start_ns, 50L * 1000 * 1000);
+        }
+        // the bucket is empty
+        IOScheduler::consume_current(100);
+        ASSERT_GE(MonotonicNanos() - start_ns, 80L * 1000 * 1000);
+    }
+    // out of scope
+    int64_t start_ns = MonotonicNanos();
+    IOScheduler::consume_current(1L << 40);
+    ASSERT_LT(MonotonicNanos() - start_ns, 50L * 1000 * 1000);
+}
+
+TEST(IOSchedulerTest, Priority) {
+    IOScheduler scheduler("test", 1000, false);
+    // the base compaction leaves 4/5 of the burst to the classes above it
+    int64_t start_ns = MonotonicNanos();
+    scheduler.consume(IOScheduler::IO_CLASS_BASE_COMPACTION, 300);
+    ASSERT_GE(MonotonicNanos() - start_ns, 80L * 1000 * 1000);
+    // while the clone goes on at once
+    start_ns = MonotonicNanos();
+    scheduler.consume(IOScheduler::IO_CLASS_CLONE, 500);
+    ASSERT_LT(MonotonicNanos() - start_ns, 50L * 1000 * 1000);
+}
+
+TEST(IOSchedulerTest, AutoTune) {
+    const int64_t rate = 1024 * 1024;
+    IOScheduler scheduler("test", rate, true);
+    // the baseline, 1ms per MB
+    scheduler.report_foreground_read(1000 * 1000, 1024 * 1024);
+    scheduler.tune();
+    ASSERT_EQ(rate, scheduler.rate());
+
+    // 10 times slower, backs off
+    scheduler.report_foreground_read(10 * 1000 * 1000, 1024 * 1024);
+    scheduler.tune();
+    ASSERT_EQ(rate / 2, scheduler.rate());
+    scheduler.report_foreground_read(10 * 1000 * 1000, 1024 * 1024);
+    scheduler.tune();
+    ASSERT_EQ(rate / 4, scheduler.rate());
+
+    // too few reads to tell, goes back up step by step
+    scheduler.report_foreground_read(10 * 1000 * 1000, 1024);
+    scheduler.tune();
+    ASSERT_EQ(rate / 4 + rate / 8, scheduler.rate());
+    for (int i = 0; i < 10; ++i) {
+        scheduler.tune();
+    }
+    ASSERT_EQ(rate, scheduler.rate());
+
+    // never below 1/16 of the rate
+    for (int i = 0; i < 10; ++i) {
+        scheduler.report_foreground_read(100 * 1000 * 1000, 1024 * 1024);
+        scheduler.tune();
+    }
+    ASSERT_EQ(rate / 16, scheduler.rate());
+}
+
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
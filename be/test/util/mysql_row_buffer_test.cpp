@@ -0,0 +1,180 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/mysql_row_buffer.h"
+
+#include <gtest/gtest.h>
+
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/logging.h"
+#include "gutil/strings/numbers.h"
+#include "runtime/datetime_value.h"
+#include "util/stopwatch.hpp"
+
+namespace doris {
+
+// the value of a row buffer holding a single field
+static std::string field(const MysqlRowBuffer& buffer) {
+    return std::string(buffer.buf() + 1, (uint8_t)buffer.buf()[0]);
+}
+
+TEST(MysqlRowBufferTest, Integers) {
+    MysqlRowBuffer buffer;
+    buffer.push_tinyint(std::numeric_limits<int8_t>::min());
+    ASSERT_EQ("-128", field(buffer));
+    buffer.reset();
+    buffer.push_smallint(std::numeric_limits<int16_t>::min());
+    ASSERT_EQ("-32768", field(buffer));
+    buffer.reset();
+    buffer.push_int(0);
+    ASSERT_EQ("0", field(buffer));
+    buffer.reset();
+    buffer.push_int(std::numeric_limits<int32_t>::max());
+    ASSERT_EQ("2147483647", field(buffer));
+    buffer.reset();
+    buffer.push_bigint(std::numeric_limits<int64_t>::min());
+    ASSERT_EQ("-9223372036854775808", field(buffer));
+    buffer.reset();
+    buffer.push_unsigned_bigint(std::numeric_limits<uint64_t>::max());
+    ASSERT_EQ("18446744073709551615", field(buffer));
+}
+
+TEST(MysqlRowBufferTest, Doubles) {
+    MysqlRowBuffer buffer;
+    std::vector<std::pair<double, std::string>> cases = {
+        {0, "0"}, {-0.0, "-0"}, {0.1, "0.1"}, {-2.5, "-2.5"}, {100, "100"},
+        {1e15, "1e+15"}, {123456789012345.0, "123456789012345"}, {0.0001, "0.0001"},
+        {1e-5, "1e-05"}, {1.5e-300, "1.5e-300"}, {0.1 + 0.2, "0.30000000000000004"},
+        // shortest digits which read back, "%.17g" gives 0.33333333333333331
+        {1.0 / 3, "0.3333333333333333"},
+        {std::numeric_limits<double>::infinity(), "inf"},
+        {-std::numeric_limits<double>::infinity(), "-inf"}};
+    for (auto& c : cases) {
+        buffer.reset();
+        buffer.push_double(c.first);
+        ASSERT_EQ(c.second, field(buffer));
+    }
+
+    buffer.reset();
+    buffer.push_float(0.1f);
+    ASSERT_EQ("0.1", field(buffer));
+    buffer.reset();
+    buffer.push_float(1234567.0f);
+    ASSERT_EQ("1234567", field(buffer));
+    buffer.reset();
+    buffer.push_float(1e10f);
+    ASSERT_EQ("1e+10", field(buffer));
+
+    // all values read back
+    std::mt19937_64 rng(0);
+    for (int i = 0; i < 100000; ++i) {
+        double value = (double)(int64_t)rng() / (1 + rng() % 100000);
+        buffer.reset();
+        buffer.push_double(value);
+        ASSERT_EQ(value, strtod(field(buffer).c_str(), nullptr));
+        buffer.reset();
+        buffer.push_float((float)value);
+        ASSERT_EQ((float)value, strtof(field(buffer).c_str(), nullptr));
+    }
+}
+
+TEST(MysqlRowBufferTest, DateTime) {
+    MysqlRowBuffer buffer;
+    DateTimeValue value;
+    std::string str = "2019-12-01 08:09:10";
+    ASSERT_TRUE(value.from_date_str(str.data(), str.size()));
+    buffer.push_datetime(value);
+    ASSERT_EQ(str, field(buffer));
+
+    buffer.reset();
+    value.cast_to_date();
+    buffer.push_datetime(value);
+    ASSERT_EQ("2019-12-01", field(buffer));
+}
+
+// the formatting of MysqlRowBuffer before it used FastInt64ToBufferLeft(),
+// double_conversion and push_datetime()
+static void push_int_printf(MysqlRowBuffer* buffer, int64_t data) {
+    char buf[32];
+    int length = snprintf(buf, sizeof(buf), "%ld", data);
+    buffer->push_string(buf, length);
+}
+
+static void push_double_printf(MysqlRowBuffer* buffer, double data) {
+    char buf[kDoubleToBufferSize];
+    int length = DoubleToBuffer(data, sizeof(buf), buf);
+    buffer->push_string(buf, length);
+}
+
+static void push_datetime_to_string(MysqlRowBuffer* buffer, const DateTimeValue& data) {
+    char buf[64];
+    char* pos = data.to_string(buf);
+    buffer->push_string(buf, pos - buf - 1);
+}
+
+// Prints the rows/s of formatting rows of a bigint, a double and a datetime.
+TEST(MysqlRowBufferTest, Benchmark) {
+    const int num_rows = 1000000;
+    std::mt19937_64 rng(0);
+    std::vector<int64_t> ints;
+    std::vector<double> doubles;
+    for (int i = 0; i < num_rows; ++i) {
+        ints.push_back(rng() % 100000000000L);
+        doubles.push_back((double)(int64_t)rng() / (1 + rng() % 100000));
+    }
+    DateTimeValue datetime;
+    std::string str = "2019-12-01 08:09:10";
+    datetime.from_date_str(str.data(), str.size());
+
+    MysqlRowBuffer buffer;
+    MonotonicStopWatch watch;
+    watch.start();
+    for (int i = 0; i < num_rows; ++i) {
+        buffer.reset();
+        push_int_printf(&buffer, ints[i]);
+        push_double_printf(&buffer, doubles[i]);
+        push_datetime_to_string(&buffer, datetime);
+    }
+    int64_t old_ns = watch.elapsed_time();
+
+    watch.start();
+    for (int i = 0; i < num_rows; ++i) {
+        buffer.reset();
+        buffer.push_bigint(ints[i]);
+        buffer.push_double(doubles[i]);
+        buffer.push_datetime(datetime);
+    }
+    int64_t new_ns = watch.elapsed_time();
+
+    LOG(INFO) << "snprintf: " << num_rows * 1000000000L / std::max<int64_t>(old_ns, 1)
+              << " rows/s, now: " << num_rows * 1000000000L / std::max<int64_t>(new_ns, 1)
+              << " rows/s";
+}
+
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,369 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/sort_key_normalizer.h"
+
+#include <cstring>
+#include <limits>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/object_pool.h"
+#include "exprs/expr_context.h"
+#include "exprs/slot_ref.h"
+#include "runtime/descriptor_helper.h"
+#include "runtime/descriptors.h"
+#include "runtime/runtime_state.h"
+#include "runtime/string_value.h"
+#include "runtime/tuple.h"
+#include "runtime/tuple_row.h"
+
+namespace doris {
+
+enum TestSlot {
+    INT_SLOT = 0,
+    FLOAT_SLOT,
+    DOUBLE_SLOT,
+    VARCHAR_SLOT,
+    BIGINT_SLOT,
+    TINYINT_SLOT,
+};
+
+class SortKeyNormalizerTest : public testing::Test {
+public:
+    void SetUp() override {
+        TDescriptorTableBuilder table_builder;
+        TTupleDescriptorBuilder tuple;
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_INT).nullable(true)
+                       .column_name("k_int").column_pos(0).build());
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_FLOAT).nullable(true)
+                       .column_name("k_float").column_pos(1).build());
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_DOUBLE).nullable(true)
+                       .column_name("k_double").column_pos(2).build());
+        tuple.add_slot(TSlotDescriptorBuilder().string_type(32).nullable(true)
+                       .column_name("k_varchar").column_pos(3).build());
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_BIGINT).nullable(false)
+                       .column_name("k_bigint").column_pos(4).build());
+        tuple.add_slot(TSlotDescriptorBuilder().type(TYPE_TINYINT).nullable(false)
+                       .column_name("k_tinyint").column_pos(5).build());
+        tuple.build(&table_builder);
+        DescriptorTbl* desc_tbl = nullptr;
+        ASSERT_TRUE(DescriptorTbl::create(&_pool, table_builder.desc_tbl(), &desc_tbl).ok());
+        _tuple_desc = desc_tbl->get_tuple_descriptor(0);
+        _row_desc.reset(new RowDescriptor(_tuple_desc, false));
+    }
+
+protected:
+    // The comparator keeps references to the expr contexts, they are owned by
+    // the pool as well.
+    TupleRowComparator* make_comparator(const std::vector<int>& slots, bool is_asc,
+                                        bool nulls_first) {
+        auto lhs_ctxs = _pool.add(new std::vector<ExprContext*>());
+        auto rhs_ctxs = _pool.add(new std::vector<ExprContext*>());
+        for (int slot : slots) {
+            lhs_ctxs->push_back(make_slot_ref(slot));
+            rhs_ctxs->push_back(make_slot_ref(slot));
+        }
+        return _pool.add(new TupleRowComparator(
+            *lhs_ctxs, *rhs_ctxs, std::vector<bool>(slots.size(), is_asc),
+            std::vector<bool>(slots.size(), nulls_first)));
+    }
+
+    ExprContext* make_slot_ref(int slot) {
+        SlotDescriptor* slot_desc = _tuple_desc->slots()[slot];
+        SlotRef* slot_ref = _pool.add(new SlotRef(slot_desc));
+        EXPECT_TRUE(slot_ref->prepare(slot_desc, *_row_desc).ok());
+        return _pool.add(new ExprContext(slot_ref));
+    }
+
+    Tuple* new_tuple() {
+        _tuples.emplace_back(_tuple_desc->byte_size(), 0);
+        return reinterpret_cast<Tuple*>(_tuples.back().data());
+    }
+
+    template <typename T>
+    Tuple* make_tuple(int slot, const T* value) {
+        Tuple* tuple = new_tuple();
+        set_value(tuple, slot, value);
+        return tuple;
+    }
+
+    template <typename T>
+    void set_value(Tuple* tuple, int slot, const T* value) {
+        SlotDescriptor* slot_desc = _tuple_desc->slots()[slot];
+        if (value == nullptr) {
+            tuple->set_null(slot_desc->null_indicator_offset());
+        } else {
+            tuple->set_not_null(slot_desc->null_indicator_offset());
+            *reinterpret_cast<T*>(tuple->get_slot(slot_desc->tuple_offset())) = *value;
+        }
+    }
+
+    Tuple* make_string_tuple(const std::string* value) {
+        if (value == nullptr) {
+            return make_tuple<StringValue>(VARCHAR_SLOT, nullptr);
+        }
+        StringValue sv(const_cast<char*>(value->data()), value->size());
+        return make_tuple(VARCHAR_SLOT, &sv);
+    }
+
+    static uint64_t normalize(const SortKeyNormalizer& normalizer, Tuple* tuple) {
+        return normalizer.normalize(reinterpret_cast<TupleRow*>(&tuple));
+    }
+
+    // Check that the prefixes of 'tuples' are in non-decreasing order, and
+    // strictly increasing where the comparator says so.
+    static void check_order(const SortKeyNormalizer& normalizer,
+                            const TupleRowComparator& less_than,
+                            const std::vector<Tuple*>& tuples) {
+        for (int i = 1; i < tuples.size(); ++i) {
+            uint64_t prev = normalize(normalizer, tuples[i - 1]);
+            uint64_t cur = normalize(normalizer, tuples[i]);
+            EXPECT_LE(prev, cur) << "at " << i;
+            if (less_than(tuples[i - 1], tuples[i]) && normalizer.is_exact()) {
+                EXPECT_LT(prev, cur) << "at " << i;
+            }
+            EXPECT_FALSE(less_than(tuples[i], tuples[i - 1])) << "at " << i;
+        }
+    }
+
+    // Copy 'tuples' into blocks of 'block_capacity' tuples, sort them and
+    // return the sorted tuples.
+    std::vector<Tuple*> sort(const SortKeyNormalizer& normalizer,
+                             const std::vector<Tuple*>& tuples, int block_capacity) {
+        int tuple_size = _tuple_desc->byte_size();
+        std::vector<uint8_t*> blocks;
+        for (int i = 0; i < tuples.size(); ++i) {
+            if (i % block_capacity == 0) {
+                _blocks.emplace_back(block_capacity * tuple_size);
+                blocks.push_back(_blocks.back().data());
+            }
+            memcpy(blocks.back() + (i % block_capacity) * tuple_size, tuples[i], tuple_size);
+        }
+        RuntimeState state((TQueryGlobals()));
+        normalizer.sort_tuples(blocks, block_capacity, tuple_size, tuples.size(), &state);
+        std::vector<Tuple*> sorted;
+        for (int i = 0; i < tuples.size(); ++i) {
+            sorted.push_back(reinterpret_cast<Tuple*>(
+                    blocks[i / block_capacity] + (i % block_capacity) * tuple_size));
+        }
+        return sorted;
+    }
+
+    ObjectPool _pool;
+    TupleDescriptor* _tuple_desc = nullptr;
+    std::unique_ptr<RowDescriptor> _row_desc;
+    std::list<std::vector<char>> _tuples;
+    std::list<std::vector<uint8_t>> _blocks;
+};
+
+TEST_F(SortKeyNormalizerTest, Exactness) {
+    // null byte + 4 bytes
+    EXPECT_TRUE(SortKeyNormalizer(*make_comparator({INT_SLOT}, true, true)).is_exact());
+    // no null byte for a not nullable slot
+    EXPECT_TRUE(SortKeyNormalizer(*make_comparator({BIGINT_SLOT}, true, true)).is_exact());
+    EXPECT_TRUE(SortKeyNormalizer(*make_comparator({TINYINT_SLOT}, false, false)).is_exact());
+    // the later exprs have to be compared
+    SortKeyNormalizer two_keys(*make_comparator({INT_SLOT, BIGINT_SLOT}, true, true));
+    EXPECT_TRUE(two_keys.is_supported());
+    EXPECT_FALSE(two_keys.is_exact());
+    // -0.0 and NaN
+    SortKeyNormalizer float_key(*make_comparator({FLOAT_SLOT}, true, true));
+    EXPECT_TRUE(float_key.is_supported());
+    EXPECT_FALSE(float_key.is_exact());
+    // only a prefix of strings
+    SortKeyNormalizer string_key(*make_comparator({VARCHAR_SLOT}, true, true));
+    EXPECT_TRUE(string_key.is_supported());
+    EXPECT_FALSE(string_key.is_exact());
+}
+
+TEST_F(SortKeyNormalizerTest, SignedInts) {
+    TupleRowComparator* less_than = make_comparator({INT_SLOT}, true, true);
+    SortKeyNormalizer normalizer(*less_than);
+    std::vector<int32_t> values = {std::numeric_limits<int32_t>::min(), -65536, -256, -1,
+                                   0, 1, 255, 256, 65536, std::numeric_limits<int32_t>::max()};
+    std::vector<Tuple*> tuples;
+    for (int32_t value : values) {
+        tuples.push_back(make_tuple(INT_SLOT, &value));
+    }
+    check_order(normalizer, *less_than, tuples);
+
+    TupleRowComparator* bigint_less_than = make_comparator({BIGINT_SLOT}, true, true);
+    SortKeyNormalizer bigint_normalizer(*bigint_less_than);
+    std::vector<int64_t> bigint_values = {std::numeric_limits<int64_t>::min(), -1, 0, 1,
+                                          std::numeric_limits<int64_t>::max()};
+    std::vector<Tuple*> bigint_tuples;
+    for (int64_t value : bigint_values) {
+        bigint_tuples.push_back(make_tuple(BIGINT_SLOT, &value));
+    }
+    check_order(bigint_normalizer, *bigint_less_than, bigint_tuples);
+    // no null byte, the prefix is the value with the sign bit flipped
+    EXPECT_EQ(0, normalize(bigint_normalizer, bigint_tuples.front()));
+    EXPECT_EQ(std::numeric_limits<uint64_t>::max(),
+              normalize(bigint_normalizer, bigint_tuples.back()));
+}
+
+TEST_F(SortKeyNormalizerTest, Floats) {
+    TupleRowComparator* less_than = make_comparator({FLOAT_SLOT}, true, true);
+    SortKeyNormalizer normalizer(*less_than);
+    std::vector<float> values = {-std::numeric_limits<float>::infinity(),
+                                 std::numeric_limits<float>::lowest(), -1.5f, -0.0f,
+                                 0.0f, std::numeric_limits<float>::denorm_min(), 1.5f,
+                                 std::numeric_limits<float>::max(),
+                                 std::numeric_limits<float>::infinity()};
+    std::vector<Tuple*> tuples;
+    for (float value : values) {
+        tuples.push_back(make_tuple(FLOAT_SLOT, &value));
+    }
+    check_order(normalizer, *less_than, tuples);
+
+    // -0.0 and 0.0 are equal to the comparator, either order is fine, but the
+    // prefixes must not put -0.0 after 0.0
+    float negative_zero = -0.0f;
+    float zero = 0.0f;
+    EXPECT_LE(normalize(normalizer, make_tuple(FLOAT_SLOT, &negative_zero)),
+              normalize(normalizer, make_tuple(FLOAT_SLOT, &zero)));
+
+    // NaN sorts after +inf, consistently
+    float nan = std::numeric_limits<float>::quiet_NaN();
+    float inf = std::numeric_limits<float>::infinity();
+    uint64_t nan_key = normalize(normalizer, make_tuple(FLOAT_SLOT, &nan));
+    EXPECT_GT(nan_key, normalize(normalizer, make_tuple(FLOAT_SLOT, &inf)));
+    EXPECT_EQ(nan_key, normalize(normalizer, make_tuple(FLOAT_SLOT, &nan)));
+
+    TupleRowComparator* double_less_than = make_comparator({DOUBLE_SLOT}, true, true);
+    SortKeyNormalizer double_normalizer(*double_less_than);
+    std::vector<double> double_values = {-std::numeric_limits<double>::infinity(), -1e300,
+                                         -1.0, -0.0, 0.0, 1e-300, 1.0, 1e300,
+                                         std::numeric_limits<double>::infinity()};
+    std::vector<Tuple*> double_tuples;
+    for (double value : double_values) {
+        double_tuples.push_back(make_tuple(DOUBLE_SLOT, &value));
+    }
+    check_order(double_normalizer, *double_less_than, double_tuples);
+}
+
+TEST_F(SortKeyNormalizerTest, Desc) {
+    TupleRowComparator* less_than = make_comparator({INT_SLOT}, false, false);
+    SortKeyNormalizer normalizer(*less_than);
+    EXPECT_TRUE(normalizer.is_exact());
+    std::vector<int32_t> values = {std::numeric_limits<int32_t>::max(), 1, 0, -1,
+                                   std::numeric_limits<int32_t>::min()};
+    std::vector<Tuple*> tuples;
+    for (int32_t value : values) {
+        tuples.push_back(make_tuple(INT_SLOT, &value));
+    }
+    check_order(normalizer, *less_than, tuples);
+
+    TupleRowComparator* float_less_than = make_comparator({FLOAT_SLOT}, false, false);
+    SortKeyNormalizer float_normalizer(*float_less_than);
+    std::vector<float> float_values = {std::numeric_limits<float>::infinity(), 2.5f, 0.0f,
+                                       -2.5f, -std::numeric_limits<float>::infinity()};
+    std::vector<Tuple*> float_tuples;
+    for (float value : float_values) {
+        float_tuples.push_back(make_tuple(FLOAT_SLOT, &value));
+    }
+    check_order(float_normalizer, *float_less_than, float_tuples);
+
+    TupleRowComparator* string_less_than = make_comparator({VARCHAR_SLOT}, false, false);
+    SortKeyNormalizer string_normalizer(*string_less_than);
+    // the zero padding of shorter strings is inverted too, so "ab" sorts after "abc"
+    std::vector<std::string> strings = {"b", "abc", "ab", "a", ""};
+    std::vector<Tuple*> string_tuples;
+    for (const std::string& value : strings) {
+        string_tuples.push_back(make_string_tuple(&value));
+    }
+    check_order(string_normalizer, *string_less_than, string_tuples);
+}
+
+TEST_F(SortKeyNormalizerTest, Nulls) {
+    int32_t min_value = std::numeric_limits<int32_t>::min();
+    int32_t max_value = std::numeric_limits<int32_t>::max();
+    for (bool is_asc : {true, false}) {
+        const int32_t* low = is_asc ? &min_value : &max_value;
+        const int32_t* high = is_asc ? &max_value : &min_value;
+
+        // the null byte isn't inverted for descending order
+        TupleRowComparator* nulls_first = make_comparator({INT_SLOT}, is_asc, true);
+        check_order(SortKeyNormalizer(*nulls_first), *nulls_first,
+                    {make_tuple<int32_t>(INT_SLOT, nullptr), make_tuple(INT_SLOT, low),
+                     make_tuple(INT_SLOT, high)});
+
+        TupleRowComparator* nulls_last = make_comparator({INT_SLOT}, is_asc, false);
+        check_order(SortKeyNormalizer(*nulls_last), *nulls_last,
+                    {make_tuple(INT_SLOT, low), make_tuple(INT_SLOT, high),
+                     make_tuple<int32_t>(INT_SLOT, nullptr)});
+    }
+
+    // all nulls get the same prefix, whatever is left in the slot
+    SortKeyNormalizer normalizer(*make_comparator({INT_SLOT}, true, false));
+    Tuple* null_tuple = make_tuple(INT_SLOT, &max_value);
+    set_value<int32_t>(null_tuple, INT_SLOT, nullptr);
+    EXPECT_EQ(normalize(normalizer, make_tuple<int32_t>(INT_SLOT, nullptr)),
+              normalize(normalizer, null_tuple));
+}
+
+TEST_F(SortKeyNormalizerTest, StringPrefixTies) {
+    TupleRowComparator* less_than = make_comparator({VARCHAR_SLOT}, true, true);
+    SortKeyNormalizer normalizer(*less_than);
+
+    std::string long1 = "abcdefgh1";
+    std::string long2 = "abcdefgh2";
+    std::string short_value = "ab";
+    std::string zero_padded("ab\0", 3);
+    // strings longer than the prefix share it
+    EXPECT_EQ(normalize(normalizer, make_string_tuple(&long1)),
+              normalize(normalizer, make_string_tuple(&long2)));
+    // so do the strings that only differ by trailing zeros
+    EXPECT_EQ(normalize(normalizer, make_string_tuple(&short_value)),
+              normalize(normalizer, make_string_tuple(&zero_padded)));
+
+    // Both sort paths must resolve the ties by the full comparator
+    std::vector<std::string> strings = {"abcdefgh9", "abcdefgh", "b", zero_padded,
+                                        "abcdefgh10", "", "ab", "abcdefgh1", "abcdefgi"};
+    for (int copies : {1, 64}) {
+        std::vector<Tuple*> tuples;
+        for (int i = 0; i < copies; ++i) {
+            for (const std::string& value : strings) {
+                tuples.push_back(make_string_tuple(&value));
+            }
+            tuples.push_back(make_string_tuple(nullptr));
+        }
+        std::vector<Tuple*> sorted = sort(normalizer, tuples, 7);
+        ASSERT_EQ(tuples.size(), sorted.size());
+        for (int i = 1; i < sorted.size(); ++i) {
+            EXPECT_FALSE((*less_than)(sorted[i], sorted[i - 1])) << "at " << i;
+        }
+        // nulls first
+        EXPECT_TRUE(sorted.front()->is_null(
+                _tuple_desc->slots()[VARCHAR_SLOT]->null_indicator_offset()));
+        StringValue* last = reinterpret_cast<StringValue*>(sorted.back()->get_slot(
+                _tuple_desc->slots()[VARCHAR_SLOT]->tuple_offset()));
+        EXPECT_EQ("b", last->to_string());
+    }
+}
+
+} // namespace doris
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,77 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "util/token_bucket.h"
+
+#include <gtest/gtest.h>
+
+namespace doris {
+
+TEST(TokenBucketTest, Unlimited) {
+    TokenBucket bucket(0, 0);
+    ASSERT_FALSE(bucket.is_limited());
+    ASSERT_EQ(0, bucket.acquire(1L << 40));
+}
+
+TEST(TokenBucketTest, Debt) {
+    // 1000 tokens per second
+    TokenBucket bucket(1000, 100);
+    ASSERT_TRUE(bucket.is_limited());
+    // the burst is available at once
+    ASSERT_EQ(0, bucket.acquire(100));
+    // 500 tokens in debt, about half a second to wait
+    int64_t wait_ns = bucket.acquire(500);
+    ASSERT_GT(wait_ns, 400L * 1000 * 1000);
+    ASSERT_LE(wait_ns, 500L * 1000 * 1000);
+    // the next caller waits for the debt as well
+    ASSERT_GT(bucket.acquire(1), wait_ns - 100L * 1000 * 1000);
+}
+
+TEST(TokenBucketTest, Reserved) {
+    TokenBucket bucket(1000, 1000);
+    ASSERT_EQ(1000, bucket.burst());
+    ASSERT_EQ(0, bucket.acquire(500));
+    // 400 tokens are left, the caller waits until 600 are back
+    int64_t wait_ns = bucket.acquire(100, 600);
+    ASSERT_GT(wait_ns, 100L * 1000 * 1000);
+    ASSERT_LE(wait_ns, 200L * 1000 * 1000);
+}
+
+TEST(TokenBucketTest, SetRate) {
+    TokenBucket bucket(0, 0);
+    ASSERT_FALSE(bucket.is_limited());
+    bucket.set_rate(1000, 100);
+    ASSERT_TRUE(bucket.is_limited());
+    ASSERT_EQ(1000, bucket.rate());
+    // the change doesn't refill the bucket
+    ASSERT_GT(bucket.acquire(200), 50L * 1000 * 1000);
+}
+
+TEST(TokenBucketTest, Refill) {
+    TokenBucket bucket(1000 * 1000, 1000);
+    ASSERT_EQ(0, bucket.acquire(1000));
+    // 1000 tokens are back after a millisecond
+    usleep(2000);
+    ASSERT_EQ(0, bucket.acquire(1000));
+}
+
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
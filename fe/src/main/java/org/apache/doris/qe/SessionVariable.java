@@ -75,6 +75,10 @@ public class SessionVariable implements Serializable, Writable {
     public static final String FORWARD_TO_MASTER = "forward_to_master";
     // user can set instance num after exchange, no need to be equal to nums of before exchange
     public static final String PARALLEL_EXCHANGE_INSTANCE_NUM = "parallel_exchange_instance_num";
+    public static final String PARALLEL_SORT_DEGREE = "parallel_sort_degree";
+    public static final String EXCHANGE_COMPRESSION_CODEC = "exchange_compression_codec";
+    public static final String ENABLE_PIPELINE_ENGINE = "enable_pipeline_engine";
+    public static final String RESOURCE_GROUP = "resource_group";
 
     // max memory used on every backend.
     @VariableMgr.VarAttr(name = EXEC_MEM_LIMIT)
@@ -198,6 +202,31 @@ public class SessionVariable implements Serializable, Writable {
     @VariableMgr.VarAttr(name = FORWARD_TO_MASTER)
     private boolean forwardToMaster = false;
 
+    /*
+     * the number of threads one sort node uses to sort and merge its input
+     * 1 means disable this feature
+     */
+    @VariableMgr.VarAttr(name = PARALLEL_SORT_DEGREE)
+    private int parallelSortDegree = 1;
+
+    /*
+     * codec of the data sent between fragments: none, snappy, lz4 or zstd
+     */
+    @VariableMgr.VarAttr(name = EXCHANGE_COMPRESSION_CODEC)
+    private String exchangeCompressionCodec = "snappy";
+
+    /*
+     * run the fragments the backends support on the pipeline engine's worker threads
+     */
+    @VariableMgr.VarAttr(name = ENABLE_PIPELINE_ENGINE)
+    private boolean enablePipelineEngine = false;
+
+    /*
+     * the resource group of the queries on the backends, empty for none
+     */
+    @VariableMgr.VarAttr(name = RESOURCE_GROUP)
+    private String resourceGroup = "";
+
     public long getMaxExecMemByte() {
         return maxExecMemByte;
     }
@@ -461,6 +490,38 @@ public class SessionVariable implements Serializable, Writable {
         this.forwardToMaster = forwardToMaster;
     }
 
+    public int getParallelSortDegree() {
+        return parallelSortDegree;
+    }
+
+    public void setParallelSortDegree(int parallelSortDegree) {
+        this.parallelSortDegree = parallelSortDegree;
+    }
+
+    public String getExchangeCompressionCodec() {
+        return exchangeCompressionCodec;
+    }
+
+    public void setExchangeCompressionCodec(String exchangeCompressionCodec) {
+        this.exchangeCompressionCodec = exchangeCompressionCodec;
+    }
+
+    public boolean isEnablePipelineEngine() {
+        return enablePipelineEngine;
+    }
+
+    public void setEnablePipelineEngine(boolean enablePipelineEngine) {
+        this.enablePipelineEngine = enablePipelineEngine;
+    }
+
+    public String getResourceGroup() {
+        return resourceGroup;
+    }
+
+    public void setResourceGroup(String resourceGroup) {
+        this.resourceGroup = resourceGroup;
+    }
+
     // Serialize to thrift object
     // used for rest api
     public TQueryOptions toThrift() {
@@ -479,6 +540,10 @@ public class SessionVariable implements Serializable, Writable {
 
         tResult.setBatch_size(batchSize);
         tResult.setDisable_stream_preaggregations(disableStreamPreaggregations);
+        tResult.setParallel_sort_degree(parallelSortDegree);
+        tResult.setExchange_compression_codec(exchangeCompressionCodec);
+        tResult.setEnable_pipeline_engine(enablePipelineEngine);
+        tResult.setResource_group(resourceGroup);
         return tResult;
     }
 
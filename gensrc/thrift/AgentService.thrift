@@ -41,6 +41,11 @@ struct TTabletSchema {
     6: optional double bloom_filter_fpp
 }
 
+enum TCompactionPolicy {
+    NUM_BASED,
+    SIZE_TIERED
+}
+
 struct TCreateTabletReq {
     1: required Types.TTabletId tablet_id
     2: required TTabletSchema tablet_schema
@@ -58,6 +63,8 @@ struct TCreateTabletReq {
     11: optional i64 allocation_term
     // indicate whether this tablet is a compute storage split mode, we call it "eco mode"
     12: optional bool is_eco_mode
+    // the cumulative compaction policy of the tablet, be's default if not set
+    13: optional TCompactionPolicy compaction_policy
 }
 
 struct TDropTabletReq {
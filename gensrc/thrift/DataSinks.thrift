@@ -52,8 +52,15 @@ struct TDataStreamSink {
   3: optional bool ignore_not_found
 }
 
-// Reserved for 
+enum TResultSinkType {
+    // rows in MySQL text protocol, relayed to the client by the FE
+    MYSQL_PROTOCAL,
+    // Arrow IPC record batches, fetched by the client from the BE
+    ARROW
+}
+
 struct TResultSink {
+    1: optional TResultSinkType type
 }
 
 struct TMysqlTableSink {
@@ -126,6 +126,18 @@ struct TQueryOptions {
 
   // multithreaded degree of intra-node parallelism
   27: optional i32 mt_dop = 0;
+
+  // number of threads a sort node sorts and merges its input with
+  28: optional i32 parallel_sort_degree = 1;
+
+  // codec of the row batches sent between fragments: none, snappy, lz4 or zstd
+  29: optional string exchange_compression_codec = "snappy";
+
+  // run the fragment instances on the pipeline engine if their plans allow it
+  30: optional bool enable_pipeline_engine = false;
+
+  // resource group of the query, see be config resource_groups
+  31: optional string resource_group = "";
 }
 
 // A scan range plus the parameters needed to execute that scan.
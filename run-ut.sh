@@ -155,6 +155,11 @@ ${DORIS_TEST_BINARY_DIR}/util/coding_test
 ${DORIS_TEST_BINARY_DIR}/util/faststring_test
 ${DORIS_TEST_BINARY_DIR}/util/tdigest_test
 ${DORIS_TEST_BINARY_DIR}/util/radix_sort_test
+${DORIS_TEST_BINARY_DIR}/util/sort_key_normalizer_test
+${DORIS_TEST_BINARY_DIR}/util/flat_hash_set_test
+${DORIS_TEST_BINARY_DIR}/util/token_bucket_test
+${DORIS_TEST_BINARY_DIR}/util/io_scheduler_test
+${DORIS_TEST_BINARY_DIR}/util/mysql_row_buffer_test
 ${DORIS_TEST_BINARY_DIR}/util/block_compression_test
 ${DORIS_TEST_BINARY_DIR}/util/arrow/arrow_row_block_test
 ${DORIS_TEST_BINARY_DIR}/util/arrow/arrow_row_batch_test
@@ -173,6 +178,7 @@ ${DORIS_TEST_BINARY_DIR}/exprs/timestamp_functions_test
 ${DORIS_TEST_BINARY_DIR}/exprs/percentile_approx_test
 ${DORIS_TEST_BINARY_DIR}/exprs/bitmap_function_test
 ${DORIS_TEST_BINARY_DIR}/exprs/hll_function_test
+${DORIS_TEST_BINARY_DIR}/exprs/multi_distinct_test
 
 ## Running geo unit test
 ${DORIS_TEST_BINARY_DIR}/geo/geo_functions_test
@@ -197,6 +203,7 @@ ${DORIS_TEST_BINARY_DIR}/exec/es_scan_reader_test
 ${DORIS_TEST_BINARY_DIR}/exec/es_query_builder_test
 ${DORIS_TEST_BINARY_DIR}/exec/tablet_info_test
 ${DORIS_TEST_BINARY_DIR}/exec/tablet_sink_test
+${DORIS_TEST_BINARY_DIR}/exec/olap_scan_node_queue_test
 
 # Running runtime Unittest
 ${DORIS_TEST_BINARY_DIR}/runtime/external_scan_context_mgr_test
@@ -216,6 +223,13 @@ ${DORIS_TEST_BINARY_DIR}/runtime/snapshot_loader_test
 ${DORIS_TEST_BINARY_DIR}/runtime/user_function_cache_test
 ${DORIS_TEST_BINARY_DIR}/runtime/small_file_mgr_test
 ${DORIS_TEST_BINARY_DIR}/runtime/mem_pool_test
+${DORIS_TEST_BINARY_DIR}/runtime/scanner_scheduler_test
+${DORIS_TEST_BINARY_DIR}/runtime/resource_group_test
+${DORIS_TEST_BINARY_DIR}/runtime/topn_threshold_test
+${DORIS_TEST_BINARY_DIR}/runtime/merge_sorter_test
+${DORIS_TEST_BINARY_DIR}/runtime/row_batch_test
+${DORIS_TEST_BINARY_DIR}/runtime/pipeline_driver_test
+${DORIS_TEST_BINARY_DIR}/runtime/arrow_result_writer_test
 ${DORIS_TEST_BINARY_DIR}/runtime/memory/chunk_allocator_test
 ${DORIS_TEST_BINARY_DIR}/runtime/memory/system_allocator_test
 # Running expr Unittest
@@ -278,10 +292,15 @@ ${DORIS_TEST_BINARY_DIR}/olap/storage_types_test
 ${DORIS_TEST_BINARY_DIR}/olap/generic_iterators_test
 ${DORIS_TEST_BINARY_DIR}/olap/aggregate_func_test
 ${DORIS_TEST_BINARY_DIR}/olap/short_key_index_test
+${DORIS_TEST_BINARY_DIR}/olap/size_tiered_compaction_policy_test
 ${DORIS_TEST_BINARY_DIR}/olap/key_coder_test
 ${DORIS_TEST_BINARY_DIR}/olap/page_cache_test
 ${DORIS_TEST_BINARY_DIR}/olap/hll_test
 ${DORIS_TEST_BINARY_DIR}/olap/selection_vector_test
+${DORIS_TEST_BINARY_DIR}/olap/collect_iterator_test
+${DORIS_TEST_BINARY_DIR}/olap/compaction_test
+${DORIS_TEST_BINARY_DIR}/olap/schema_change_test
+${DORIS_TEST_BINARY_DIR}/olap/engine_clone_task_test
 
 # Running routine load test
 ${DORIS_TEST_BINARY_DIR}/runtime/kafka_consumer_pipe_test